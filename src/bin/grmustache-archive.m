@@ -0,0 +1,115 @@
+// The MIT License
+//
+// Copyright (c) 2014 Gwendal Roué
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+// Generates the template archive of a directory. Build with
+// `make bin/grmustache-archive`, and run:
+//
+//   grmustache-archive [-e extension] [-o output] directory
+//
+// -e extension  The extension of template files (default: mustache).
+// -o output     The output file (default: standard output).
+//
+// Templates are named after their path relative to the directory, without
+// extension, as in a repository created with
+// +[GRMustacheTemplateRepository templateRepositoryWithDirectory:].
+//
+// Load the archive with
+// -[GRMustacheTemplateRepository registerTemplateArchiveAtPath:error:].
+
+#import <Foundation/Foundation.h>
+#import <unistd.h>
+#import "GRMustacheTemplateRepository_private.h"
+#import "GRMustacheTemplateArchiveGenerator_private.h"
+
+static void usage(void)
+{
+    fprintf(stderr, "usage: grmustache-archive [-e extension] [-o output] directory\n");
+    exit(64);
+}
+
+int main(int argc, char * const argv[])
+{
+    @autoreleasepool {
+        NSString *templateExtension = @"mustache";
+        NSString *outputPath = nil;
+        
+        int option;
+        while ((option = getopt(argc, argv, "e:o:")) != -1) {
+            switch (option) {
+                case 'e':
+                    templateExtension = [NSString stringWithUTF8String:optarg];
+                    break;
+                case 'o':
+                    outputPath = [NSString stringWithUTF8String:optarg];
+                    break;
+                default:
+                    usage();
+            }
+        }
+        if (optind != argc - 1) {
+            usage();
+        }
+        NSString *directoryPath = [[NSString stringWithUTF8String:argv[optind]] stringByStandardizingPath];
+        
+        
+        // Template names, sorted for stable outputs
+        
+        NSMutableArray *templateNames = [NSMutableArray array];
+        NSDirectoryEnumerator *enumerator = [[NSFileManager defaultManager] enumeratorAtPath:directoryPath];
+        for (NSString *relativePath in enumerator) {
+            if ([[enumerator fileAttributes] fileType] != NSFileTypeRegular) {
+                continue;
+            }
+            if (templateExtension.length == 0) {
+                [templateNames addObject:relativePath];
+            } else if ([relativePath.pathExtension isEqualToString:templateExtension]) {
+                [templateNames addObject:[relativePath stringByDeletingPathExtension]];
+            }
+        }
+        [templateNames sortUsingSelector:@selector(compare:)];
+        
+        
+        // Generate
+        
+        GRMustacheTemplateRepository *templateRepository = [GRMustacheTemplateRepository templateRepositoryWithDirectory:directoryPath templateExtension:templateExtension encoding:NSUTF8StringEncoding];
+        GRMustacheTemplateArchiveGenerator *archiveGenerator = [GRMustacheTemplateArchiveGenerator templateArchiveGeneratorWithTemplateRepository:templateRepository];
+        NSError *error;
+        NSData *data = [archiveGenerator archiveDataWithTemplateNames:templateNames error:&error];
+        if (!data) {
+            fprintf(stderr, "grmustache-archive: %s\n", error.localizedDescription.UTF8String);
+            return 1;
+        }
+        
+        
+        // Output
+        
+        if (outputPath) {
+            if (![data writeToFile:outputPath options:NSDataWritingAtomic error:&error]) {
+                fprintf(stderr, "grmustache-archive: %s\n", error.localizedDescription.UTF8String);
+                return 1;
+            }
+        } else {
+            fwrite(data.bytes, 1, data.length, stdout);
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,119 @@
+// The MIT License
+//
+// Copyright (c) 2014 Gwendal Roué
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+// Generates the Objective-C source code of the precompiled templates of a
+// directory. Build with `make bin/grmustache-precompile`, and run:
+//
+//   grmustache-precompile [-e extension] [-f function] [-o output] directory
+//
+// -e extension  The extension of template files (default: mustache).
+// -f function   The name of the generated registration function
+//               (default: GRMustacheRegisterPrecompiledTemplates).
+// -o output     The output file (default: standard output).
+//
+// Templates are named after their path relative to the directory, without
+// extension, as in a repository created with
+// +[GRMustacheTemplateRepository templateRepositoryWithDirectory:].
+
+#import <Foundation/Foundation.h>
+#import <unistd.h>
+#import "GRMustacheTemplateRepository_private.h"
+#import "GRMustacheSourceGenerator_private.h"
+
+static void usage(void)
+{
+    fprintf(stderr, "usage: grmustache-precompile [-e extension] [-f function] [-o output] directory\n");
+    exit(64);
+}
+
+int main(int argc, char * const argv[])
+{
+    @autoreleasepool {
+        NSString *templateExtension = @"mustache";
+        NSString *registrationFunctionName = @"GRMustacheRegisterPrecompiledTemplates";
+        NSString *outputPath = nil;
+        
+        int option;
+        while ((option = getopt(argc, argv, "e:f:o:")) != -1) {
+            switch (option) {
+                case 'e':
+                    templateExtension = [NSString stringWithUTF8String:optarg];
+                    break;
+                case 'f':
+                    registrationFunctionName = [NSString stringWithUTF8String:optarg];
+                    break;
+                case 'o':
+                    outputPath = [NSString stringWithUTF8String:optarg];
+                    break;
+                default:
+                    usage();
+            }
+        }
+        if (optind != argc - 1) {
+            usage();
+        }
+        NSString *directoryPath = [[NSString stringWithUTF8String:argv[optind]] stringByStandardizingPath];
+        
+        
+        // Template names, sorted for stable outputs
+        
+        NSMutableArray *templateNames = [NSMutableArray array];
+        NSDirectoryEnumerator *enumerator = [[NSFileManager defaultManager] enumeratorAtPath:directoryPath];
+        for (NSString *relativePath in enumerator) {
+            if ([[enumerator fileAttributes] fileType] != NSFileTypeRegular) {
+                continue;
+            }
+            if (templateExtension.length == 0) {
+                [templateNames addObject:relativePath];
+            } else if ([relativePath.pathExtension isEqualToString:templateExtension]) {
+                [templateNames addObject:[relativePath stringByDeletingPathExtension]];
+            }
+        }
+        [templateNames sortUsingSelector:@selector(compare:)];
+        
+        
+        // Generate
+        
+        GRMustacheTemplateRepository *templateRepository = [GRMustacheTemplateRepository templateRepositoryWithDirectory:directoryPath templateExtension:templateExtension encoding:NSUTF8StringEncoding];
+        GRMustacheSourceGenerator *sourceGenerator = [GRMustacheSourceGenerator sourceGeneratorWithTemplateRepository:templateRepository];
+        NSError *error;
+        NSString *source = [sourceGenerator sourceWithTemplateNames:templateNames registrationFunctionName:registrationFunctionName error:&error];
+        if (!source) {
+            fprintf(stderr, "grmustache-precompile: %s\n", error.localizedDescription.UTF8String);
+            return 1;
+        }
+        
+        
+        // Output
+        
+        if (outputPath) {
+            if (![source writeToFile:outputPath atomically:YES encoding:NSUTF8StringEncoding error:&error]) {
+                fprintf(stderr, "grmustache-precompile: %s\n", error.localizedDescription.UTF8String);
+                return 1;
+            }
+        } else {
+            NSData *data = [source dataUsingEncoding:NSUTF8StringEncoding];
+            fwrite(data.bytes, 1, data.length, stdout);
+        }
+    }
+    return 0;
+}
@@ -20,15 +20,68 @@
 // OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
 // THE SOFTWARE.
 
+#import <pthread.h>
 #import "GRMustacheExpression_private.h"
 
+// Process-wide tables of interned expressions and identifiers.
+//
+// They are fed by template compilation, and templates may be compiled from
+// arbitrary strings: each table is emptied when it is full, so that it never
+// grows without bound. Interning is only an optimization: expressions and
+// identifiers that are no longer in the tables remain valid, and keep on
+// being compared by value.
+#define GRMustacheInternTableCapacity 4096
+
+static CFMutableSetRef internedExpressions;
+static CFMutableSetRef internedIdentifiers;
+static pthread_mutex_t internMutex = PTHREAD_MUTEX_INITIALIZER;
+
 @implementation GRMustacheExpression
-@synthesize token=_token;
 
-- (void)dealloc
++ (void)initialize
+{
+    if (self == [GRMustacheExpression class]) {
+        internedExpressions = CFSetCreateMutable(NULL, 0, &kCFTypeSetCallBacks);
+        internedIdentifiers = CFSetCreateMutable(NULL, 0, &kCFTypeSetCallBacks);
+    }
+}
+
++ (NSString *)internedIdentifier:(NSString *)identifier
 {
-    [_token release];
-    [super dealloc];
+    pthread_mutex_lock(&internMutex);
+    NSString *internedIdentifier = (NSString *)CFSetGetValue(internedIdentifiers, identifier);
+    if (internedIdentifier == nil) {
+        internedIdentifier = [[identifier copy] autorelease];
+        if (CFSetGetCount(internedIdentifiers) >= GRMustacheInternTableCapacity) {
+            CFSetRemoveAllValues(internedIdentifiers);
+        }
+        CFSetAddValue(internedIdentifiers, internedIdentifier);
+    } else {
+        // Another thread may empty the table as soon as we unlock.
+        [[internedIdentifier retain] autorelease];
+    }
+    pthread_mutex_unlock(&internMutex);
+    return internedIdentifier;
+}
+
+- (instancetype)internedExpression
+{
+    // Subclasses intern their identifiers and sub-expressions before calling
+    // this implementation.
+    pthread_mutex_lock(&internMutex);
+    GRMustacheExpression *internedExpression = (GRMustacheExpression *)CFSetGetValue(internedExpressions, self);
+    if (internedExpression == nil) {
+        internedExpression = self;
+        if (CFSetGetCount(internedExpressions) >= GRMustacheInternTableCapacity) {
+            CFSetRemoveAllValues(internedExpressions);
+        }
+        CFSetAddValue(internedExpressions, internedExpression);
+    } else {
+        // Another thread may empty the table as soon as we unlock.
+        [[internedExpression retain] autorelease];
+    }
+    pthread_mutex_unlock(&internMutex);
+    return internedExpression;
 }
 
 - (BOOL)isEqual:(id)anObject
@@ -36,6 +89,11 @@
     return [super isEqual:anObject];
 }
 
+- (NSUInteger)keyAccessCount
+{
+    return 0;
+}
+
 - (BOOL)acceptVisitor:(id<GRMustacheExpressionVisitor>)visitor error:(NSError **)error
 {
     return YES;
@@ -23,24 +23,17 @@
 #import <Foundation/Foundation.h>
 #import "GRMustacheAvailabilityMacros_private.h"
 
-@class GRMustacheToken;
 @protocol GRMustacheExpressionVisitor;
 
 /**
  * The GRMustacheExpression is the base class for objects that represent
  * Mustache expression such as `name`, `uppercase(name)`, or `user.name`.
+ *
+ * Expressions are immutable, so that equal expressions can be shared by all
+ * templates (see internedExpression). The location of an expression in a
+ * template is held by the tag that contains it.
  */
-@interface GRMustacheExpression : NSObject {
-@private
-    GRMustacheToken *_token;
-}
-
-/**
- * This property stores a token whose sole purpose is to help the library user
- * debugging his templates, using the token's ability to output its location
- * (`{{ foo }}` at line 23 of /path/to/template).
- */
-@property (nonatomic, retain) GRMustacheToken *token GRMUSTACHE_API_INTERNAL;
+@interface GRMustacheExpression : NSObject
 
 /**
  * Returns a Boolean value that indicates whether the receiver and a given
@@ -58,6 +51,47 @@
  */
 - (BOOL)isEqual:(id)anObject; // no availability macro for Foundation method declaration
 
+/**
+ * Returns the canonical expression that is equal to the receiver.
+ *
+ * Canonical expressions are stored in a bounded process-wide table. Their
+ * identifiers are interned (see internedIdentifier:), and so are their
+ * sub-expressions: equal expressions of compiled templates are thus usually
+ * the same object.
+ *
+ * This method is thread-safe.
+ *
+ * @return The canonical expression equal to the receiver.
+ */
+- (instancetype)internedExpression GRMUSTACHE_API_INTERNAL;
+
+/**
+ * Returns the canonical string that is equal to _identifier_.
+ *
+ * Canonical strings are stored in a bounded process-wide table: equal
+ * interned identifiers are usually the same object, and can be compared by
+ * pointer before they are compared by value.
+ *
+ * This method is thread-safe.
+ *
+ * @param identifier  An identifier.
+ *
+ * @return The canonical string equal to _identifier_.
+ */
++ (NSString *)internedIdentifier:(NSString *)identifier GRMUSTACHE_API_INTERNAL;
+
+/**
+ * The number of key accesses performed by the expression, that is to say the
+ * number of identifier and scoped expressions it contains.
+ *
+ * Expressions are shared between templates, and do not hold any key access
+ * inline cache. Instead, tags provide one inline cache for each key access of
+ * their expression, in the order of evaluation.
+ *
+ * @see -[GRMustacheTag keyAccessInlineCaches]
+ */
+@property (nonatomic, readonly) NSUInteger keyAccessCount GRMUSTACHE_API_INTERNAL;
+
 /**
  * Has the visitor visit the expression.
  */
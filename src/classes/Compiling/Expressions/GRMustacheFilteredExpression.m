@@ -44,27 +44,42 @@
 
 #pragma mark - GRMustacheExpression
 
-- (void)setToken:(GRMustacheToken *)token
-{
-    [super setToken:token];
-    _filterExpression.token = token;
-    _argumentExpression.token = token;
-}
-
 - (BOOL)isEqual:(id)expression
 {
+    if (expression == self) {
+        return YES;
+    }
     if (![expression isKindOfClass:[GRMustacheFilteredExpression class]]) {
         return NO;
     }
-    if (![_filterExpression isEqual:((GRMustacheFilteredExpression *)expression).filterExpression]) {
+    GRMustacheFilteredExpression *filteredExpression = (GRMustacheFilteredExpression *)expression;
+    if (filteredExpression.isCurried != _curried) {
         return NO;
     }
-    return [_argumentExpression isEqual:((GRMustacheFilteredExpression *)expression).argumentExpression];
+    if (filteredExpression.filterExpression != _filterExpression && ![_filterExpression isEqual:filteredExpression.filterExpression]) {
+        return NO;
+    }
+    return filteredExpression.argumentExpression == _argumentExpression || [_argumentExpression isEqual:filteredExpression.argumentExpression];
 }
 
 - (NSUInteger)hash
 {
-    return [_filterExpression hash] ^ [_argumentExpression hash];
+    return _hash;
+}
+
+- (NSUInteger)keyAccessCount
+{
+    return _filterExpression.keyAccessCount + _argumentExpression.keyAccessCount;
+}
+
+- (instancetype)internedExpression
+{
+    GRMustacheExpression *filterExpression = [_filterExpression internedExpression];
+    GRMustacheExpression *argumentExpression = [_argumentExpression internedExpression];
+    if (filterExpression != _filterExpression || argumentExpression != _argumentExpression) {
+        return [[GRMustacheFilteredExpression expressionWithFilterExpression:filterExpression argumentExpression:argumentExpression curried:_curried] internedExpression];
+    }
+    return [super internedExpression];
 }
 
 - (BOOL)acceptVisitor:(id<GRMustacheExpressionVisitor>)visitor error:(NSError **)error
@@ -82,6 +97,7 @@
         _filterExpression = [filterExpression retain];
         _argumentExpression = [argumentExpression retain];
         _curried = curried;
+        _hash = ([filterExpression hash] * 31 + [argumentExpression hash]) * 2 + (curried ? 1 : 0);
     }
     return self;
 }
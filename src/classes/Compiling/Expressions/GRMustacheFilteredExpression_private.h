@@ -31,6 +31,7 @@
     GRMustacheExpression *_filterExpression;
     GRMustacheExpression *_argumentExpression;
     BOOL _curried;
+    NSUInteger _hash;
 }
 
 @property (nonatomic, retain, readonly) GRMustacheExpression *filterExpression GRMUSTACHE_API_INTERNAL;
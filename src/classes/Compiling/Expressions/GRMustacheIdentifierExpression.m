@@ -42,15 +42,33 @@
 
 - (BOOL)isEqual:(id)expression
 {
+    if (expression == self) {
+        return YES;
+    }
     if (![expression isKindOfClass:[GRMustacheIdentifierExpression class]]) {
         return NO;
     }
-    return [_identifier isEqual:((GRMustacheIdentifierExpression *)expression).identifier];
+    NSString *identifier = ((GRMustacheIdentifierExpression *)expression).identifier;
+    return identifier == _identifier || [_identifier isEqual:identifier];
 }
 
 - (NSUInteger)hash
 {
-    return [_identifier hash];
+    return _hash;
+}
+
+- (NSUInteger)keyAccessCount
+{
+    return 1;
+}
+
+- (instancetype)internedExpression
+{
+    NSString *identifier = [GRMustacheExpression internedIdentifier:_identifier];
+    if (identifier != _identifier) {
+        return [[GRMustacheIdentifierExpression expressionWithIdentifier:identifier] internedExpression];
+    }
+    return [super internedExpression];
 }
 
 - (BOOL)acceptVisitor:(id<GRMustacheExpressionVisitor>)visitor error:(NSError **)error
@@ -66,6 +84,7 @@
     self = [super init];
     if (self) {
         _identifier = [identifier retain];
+        _hash = [identifier hash];
     }
     return self;
 }
@@ -29,6 +29,7 @@
 @interface GRMustacheIdentifierExpression : GRMustacheExpression {
 @private
     NSString *_identifier;
+    NSUInteger _hash;
 }
 
 @property (nonatomic, retain, readonly) NSString *identifier GRMUSTACHE_API_INTERNAL;
@@ -45,6 +45,11 @@ static GRMustacheImplicitIteratorExpression *instance;
     return expression == instance;
 }
 
+- (instancetype)internedExpression
+{
+    return instance;
+}
+
 - (BOOL)acceptVisitor:(id<GRMustacheExpressionVisitor>)visitor error:(NSError **)error
 {
     return [visitor visitImplicitIteratorExpression:self error:error];
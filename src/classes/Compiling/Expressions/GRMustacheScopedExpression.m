@@ -43,26 +43,40 @@
 
 #pragma mark - GRMustacheExpression
 
-- (void)setToken:(GRMustacheToken *)token
-{
-    [super setToken:token];
-    _baseExpression.token = token;
-}
-
 - (BOOL)isEqual:(id)expression
 {
+    if (expression == self) {
+        return YES;
+    }
     if (![expression isKindOfClass:[GRMustacheScopedExpression class]]) {
         return NO;
     }
-    if (![_baseExpression isEqual:((GRMustacheScopedExpression *)expression).baseExpression]) {
+    GRMustacheExpression *baseExpression = ((GRMustacheScopedExpression *)expression).baseExpression;
+    if (baseExpression != _baseExpression && ![_baseExpression isEqual:baseExpression]) {
         return NO;
     }
-    return [_identifier isEqual:((GRMustacheScopedExpression *)expression).identifier];
+    NSString *identifier = ((GRMustacheScopedExpression *)expression).identifier;
+    return identifier == _identifier || [_identifier isEqual:identifier];
 }
 
 - (NSUInteger)hash
 {
-    return [_baseExpression hash] ^ [_identifier hash];
+    return _hash;
+}
+
+- (NSUInteger)keyAccessCount
+{
+    return _baseExpression.keyAccessCount + 1;
+}
+
+- (instancetype)internedExpression
+{
+    GRMustacheExpression *baseExpression = [_baseExpression internedExpression];
+    NSString *identifier = [GRMustacheExpression internedIdentifier:_identifier];
+    if (baseExpression != _baseExpression || identifier != _identifier) {
+        return [[GRMustacheScopedExpression expressionWithBaseExpression:baseExpression identifier:identifier] internedExpression];
+    }
+    return [super internedExpression];
 }
 
 - (BOOL)acceptVisitor:(id<GRMustacheExpressionVisitor>)visitor error:(NSError **)error
@@ -79,6 +93,7 @@
     if (self) {
         _baseExpression = [baseExpression retain];
         _identifier = [identifier retain];
+        _hash = [baseExpression hash] * 31 + [identifier hash];
     }
     return self;
 }
@@ -30,6 +30,7 @@
 @private
     GRMustacheExpression *_baseExpression;
     NSString *_identifier;
+    NSUInteger _hash;
 }
 
 @property (nonatomic, retain, readonly) GRMustacheExpression *baseExpression GRMUSTACHE_API_INTERNAL;
@@ -121,6 +121,8 @@
 @synthesize tagValueStack=_tagValueStack;
 @synthesize currentASTNodes=_currentASTNodes;
 @synthesize ASTNodesStack=_ASTNodesStack;
+@synthesize predictsRenderingLength=_predictsRenderingLength;
+@synthesize partialTemplateIDs=_partialTemplateIDs;
 
 - (instancetype)initWithContentType:(GRMustacheContentType)contentType
 {
@@ -133,6 +135,8 @@
         _tagValueStack = [[NSMutableArray alloc] initWithCapacity:20];
         _contentType = contentType;
         _contentTypeLocked = NO;
+        _expressionParser = [[GRMustacheExpressionParser alloc] init];
+        _partialTemplateIDs = [[NSMutableSet alloc] init];
     }
     return self;
 }
@@ -158,7 +162,7 @@
     }
     
     // Success
-    return [GRMustacheTemplateAST templateASTWithASTNodes:_currentASTNodes contentType:_contentType];
+    return [self templateASTWithASTNodes:_currentASTNodes];
 }
 
 - (void)dealloc
@@ -168,6 +172,8 @@
     [_tagValueStack release];
     [_openingTokenStack release];
     [_baseTemplateID release];
+    [_expressionParser release];
+    [_partialTemplateIDs release];
     [super dealloc];
 }
 
@@ -217,16 +223,14 @@
         case GRMustacheTokenTypeEscapedVariable: {
             // Expression validation
             NSError *error;
-            GRMustacheExpressionParser *expressionParser = [[[GRMustacheExpressionParser alloc] init] autorelease];
-            GRMustacheExpression *expression = [expressionParser parseExpression:token.tagInnerContent empty:NULL error:&error];
+            GRMustacheExpression *expression = [self parseExpression:token.tagInnerContent empty:NULL error:&error];
             if (expression == nil) {
                 [self failWithFatalError:[self parseErrorAtToken:token description:error.localizedDescription]];
                 return NO;
             }
             
             // Success: append GRMustacheVariableTag
-            expression.token = token;
-            [_currentASTNodes addObject:[GRMustacheVariableTag variableTagWithExpression:expression escapesHTML:YES contentType:_contentType]];
+            [_currentASTNodes addObject:[GRMustacheVariableTag variableTagWithExpression:expression escapesHTML:YES contentType:_contentType token:token]];
             
             // lock _contentType
             _contentTypeLocked = YES;
@@ -236,16 +240,14 @@
         case GRMustacheTokenTypeUnescapedVariable: {
             // Expression validation
             NSError *error;
-            GRMustacheExpressionParser *expressionParser = [[[GRMustacheExpressionParser alloc] init] autorelease];
-            GRMustacheExpression *expression = [expressionParser parseExpression:token.tagInnerContent empty:NULL error:&error];
+            GRMustacheExpression *expression = [self parseExpression:token.tagInnerContent empty:NULL error:&error];
             if (expression == nil) {
                 [self failWithFatalError:[self parseErrorAtToken:token description:error.localizedDescription]];
                 return NO;
             }
             
             // Success: append GRMustacheVariableTag
-            expression.token = token;
-            [_currentASTNodes addObject:[GRMustacheVariableTag variableTagWithExpression:expression escapesHTML:NO contentType:_contentType]];
+            [_currentASTNodes addObject:[GRMustacheVariableTag variableTagWithExpression:expression escapesHTML:NO contentType:_contentType token:token]];
             
             // lock _contentType
             _contentTypeLocked = YES;
@@ -256,8 +258,7 @@
             // Expression validation
             NSError *error;
             BOOL empty;
-            GRMustacheExpressionParser *expressionParser = [[[GRMustacheExpressionParser alloc] init] autorelease];
-            GRMustacheExpression *expression = [expressionParser parseExpression:token.tagInnerContent empty:&empty error:&error];
+            GRMustacheExpression *expression = [self parseExpression:token.tagInnerContent empty:&empty error:&error];
             
             if (_currentOpeningToken &&
                 _currentOpeningToken.type == GRMustacheTokenTypeInvertedSectionOpening &&
@@ -271,12 +272,13 @@
                 
                 NSRange openingTokenRange = _currentOpeningToken.range;
                 NSRange innerRange = NSMakeRange(openingTokenRange.location + openingTokenRange.length, token.range.location - (openingTokenRange.location + openingTokenRange.length));
-                GRMustacheTemplateAST *templateAST = [GRMustacheTemplateAST templateASTWithASTNodes:_currentASTNodes contentType:_contentType];
+                GRMustacheTemplateAST *templateAST = [self templateASTWithASTNodes:_currentASTNodes];
                 GRMustacheSectionTag *sectionTag = [GRMustacheSectionTag sectionTagWithExpression:(GRMustacheExpression *)_currentTagValue
                                                                                          inverted:YES
                                                                                    templateString:token.templateString
                                                                                        innerRange:innerRange
-                                                                                 innerTemplateAST:templateAST];
+                                                                                 innerTemplateAST:templateAST
+                                                                                            token:_currentOpeningToken];
                 
                 [_openingTokenStack removeLastObject];
                 self.currentOpeningToken = token;
@@ -299,7 +301,6 @@
                 
                 // Prepare a new section
                 
-                expression.token = token;
                 self.currentTagValue = expression;
                 [_tagValueStack addObject:_currentTagValue];
                 
@@ -319,8 +320,7 @@
             // Expression validation
             NSError *error;
             BOOL empty;
-            GRMustacheExpressionParser *expressionParser = [[[GRMustacheExpressionParser alloc] init] autorelease];
-            GRMustacheExpression *expression = [expressionParser parseExpression:token.tagInnerContent empty:&empty error:&error];
+            GRMustacheExpression *expression = [self parseExpression:token.tagInnerContent empty:&empty error:&error];
             
             if (_currentOpeningToken &&
                 _currentOpeningToken.type == GRMustacheTokenTypeSectionOpening &&
@@ -334,12 +334,13 @@
                 
                 NSRange openingTokenRange = _currentOpeningToken.range;
                 NSRange innerRange = NSMakeRange(openingTokenRange.location + openingTokenRange.length, token.range.location - (openingTokenRange.location + openingTokenRange.length));
-                GRMustacheTemplateAST *templateAST = [GRMustacheTemplateAST templateASTWithASTNodes:_currentASTNodes contentType:_contentType];
+                GRMustacheTemplateAST *templateAST = [self templateASTWithASTNodes:_currentASTNodes];
                 GRMustacheSectionTag *sectionTag = [GRMustacheSectionTag sectionTagWithExpression:(GRMustacheExpression *)_currentTagValue
                                                                                          inverted:NO
                                                                                    templateString:token.templateString
                                                                                        innerRange:innerRange
-                                                                                 innerTemplateAST:templateAST];
+                                                                                 innerTemplateAST:templateAST
+                                                                                            token:_currentOpeningToken];
                 
                 [_openingTokenStack removeLastObject];
                 self.currentOpeningToken = token;
@@ -362,7 +363,6 @@
                 
                 // Prepare a new section
                 
-                expression.token = token;
                 self.currentTagValue = expression;
                 [_tagValueStack addObject:_currentTagValue];
                 
@@ -443,8 +443,7 @@
                     // or an empty `{{/}}` closing tags.
                     NSError *error;
                     BOOL empty;
-                    GRMustacheExpressionParser *expressionParser = [[[GRMustacheExpressionParser alloc] init] autorelease];
-                    GRMustacheExpression *expression = [expressionParser parseExpression:token.tagInnerContent empty:&empty error:&error];
+                    GRMustacheExpression *expression = [self parseExpression:token.tagInnerContent empty:&empty error:&error];
                     if (expression == nil && !empty) {
                         [self failWithFatalError:[self parseErrorAtToken:token description:error.localizedDescription]];
                         return NO;
@@ -466,12 +465,13 @@
                     // Success: create new GRMustacheSectionTag
                     NSRange openingTokenRange = _currentOpeningToken.range;
                     NSRange innerRange = NSMakeRange(openingTokenRange.location + openingTokenRange.length, token.range.location - (openingTokenRange.location + openingTokenRange.length));
-                    GRMustacheTemplateAST *templateAST = [GRMustacheTemplateAST templateASTWithASTNodes:_currentASTNodes contentType:_contentType];
+                    GRMustacheTemplateAST *templateAST = [self templateASTWithASTNodes:_currentASTNodes];
                     wrapperASTNode = [GRMustacheSectionTag sectionTagWithExpression:(GRMustacheExpression *)_currentTagValue
                                                                            inverted:(_currentOpeningToken.type == GRMustacheTokenTypeInvertedSectionOpening)
                                                                      templateString:token.templateString
                                                                          innerRange:innerRange
-                                                                   innerTemplateAST:templateAST];
+                                                                   innerTemplateAST:templateAST
+                                                                              token:_currentOpeningToken];
                 } break;
                     
                 case GRMustacheTokenTypeInheritableSectionOpening: {
@@ -495,7 +495,7 @@
                     }
                     
                     // Success: create new GRMustacheInheritableSection
-                    GRMustacheTemplateAST *templateAST = [GRMustacheTemplateAST templateASTWithASTNodes:_currentASTNodes contentType:_contentType];
+                    GRMustacheTemplateAST *templateAST = [self templateASTWithASTNodes:_currentASTNodes];
                     wrapperASTNode = [GRMustacheInheritableSectionNode inheritableSectionNodeWithName:(NSString *)_currentTagValue innerTemplateAST:templateAST];
                 } break;
                     
@@ -514,11 +514,15 @@
                     
                     // Ask templateRepository for inheritable template
                     partialName = (NSString *)_currentTagValue;
-                    GRMustacheTemplateAST *templateAST = [_templateRepository templateASTNamed:partialName relativeToTemplateID:_baseTemplateID error:&error];
+                    id partialTemplateID = nil;
+                    GRMustacheTemplateAST *templateAST = [_templateRepository templateASTNamed:partialName relativeToTemplateID:_baseTemplateID templateID:&partialTemplateID error:&error];
                     if (templateAST == nil) {
                         [self failWithFatalError:error];
                         return NO;
                     }
+                    if (partialTemplateID) {
+                        [_partialTemplateIDs addObject:partialTemplateID];
+                    }
                     
                     // Check for consistency of HTML safety
                     //
@@ -538,7 +542,7 @@
                     
                     // Success: create new GRMustacheInheritedPartialNode
                     GRMustachePartialNode *partialNode = [GRMustachePartialNode partialNodeWithTemplateAST:templateAST name:partialName];
-                    GRMustacheTemplateAST *overridingTemplateAST = [GRMustacheTemplateAST templateASTWithASTNodes:_currentASTNodes contentType:_contentType];
+                    GRMustacheTemplateAST *overridingTemplateAST = [self templateASTWithASTNodes:_currentASTNodes];
                     wrapperASTNode = [GRMustacheInheritedPartialNode inheritedPartialNodeWithParentPartialNode:partialNode overridingTemplateAST:overridingTemplateAST];
                 } break;
                     
@@ -572,11 +576,15 @@
             }
             
             // Ask templateRepository for partial template
-            GRMustacheTemplateAST *templateAST = [_templateRepository templateASTNamed:partialName relativeToTemplateID:_baseTemplateID error:&partialError];
+            id partialTemplateID = nil;
+            GRMustacheTemplateAST *templateAST = [_templateRepository templateASTNamed:partialName relativeToTemplateID:_baseTemplateID templateID:&partialTemplateID error:&partialError];
             if (templateAST == nil) {
                 [self failWithFatalError:partialError];
                 return NO;
             }
+            if (partialTemplateID) {
+                [_partialTemplateIDs addObject:partialTemplateID];
+            }
             
             // Success: append ASTNode
             GRMustachePartialNode *partialNode = [GRMustachePartialNode partialNodeWithTemplateAST:templateAST name:partialName];
@@ -615,6 +623,32 @@
     self.openingTokenStack = nil;
 }
 
+/**
+ * Parses an expression, and returns its canonical instance, shared by all
+ * compiled templates.
+ *
+ * @see -[GRMustacheExpressionParser parseExpression:empty:error:]
+ * @see -[GRMustacheExpression internedExpression]
+ */
+- (GRMustacheExpression *)parseExpression:(NSString *)string empty:(BOOL *)empty error:(NSError **)error
+{
+    return [[_expressionParser parseExpression:string empty:empty error:error] internedExpression];
+}
+
+/**
+ * Returns a template AST built with the current content type.
+ *
+ * @param templateASTNodes  An array of <GRMustacheTemplateASTNode> instances.
+ *
+ * @return A GRMustacheTemplateAST instance
+ */
+- (GRMustacheTemplateAST *)templateASTWithASTNodes:(NSArray *)templateASTNodes
+{
+    GRMustacheTemplateAST *templateAST = [GRMustacheTemplateAST templateASTWithASTNodes:templateASTNodes contentType:_contentType];
+    templateAST.predictsRenderingLength = _predictsRenderingLength;
+    return templateAST;
+}
+
 /**
  * Builds and returns an NSError of domain GRMustacheErrorDomain, code
  * GRMustacheErrorCodeParseError, related to a specific location in a template,
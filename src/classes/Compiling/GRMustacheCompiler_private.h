@@ -27,6 +27,7 @@
 
 @class GRMustacheTemplateRepository;
 @class GRMustacheTemplateAST;
+@class GRMustacheExpressionParser;
 
 /**
  * The GRMustacheCompiler interprets GRMustacheTokens provided by a
@@ -50,10 +51,14 @@
     NSObject *_currentTagValue;
     NSMutableArray *_tagValueStack;
     
+    GRMustacheExpressionParser *_expressionParser;
+    
     GRMustacheTemplateRepository *_templateRepository;
     id _baseTemplateID;
+    NSMutableSet *_partialTemplateIDs;
     GRMustacheContentType _contentType;
     BOOL _contentTypeLocked;
+    BOOL _predictsRenderingLength;
 }
 
 /**
@@ -66,6 +71,23 @@
  */
 @property (nonatomic, retain) id baseTemplateID GRMUSTACHE_API_INTERNAL;
 
+/**
+ * The IDs of the templates that were loaded from the template repository's data
+ * source for partial tags, and that the compiled template depends on.
+ *
+ * Precompiled partials are not included.
+ *
+ * @see -[GRMustacheTemplateRepository reloadChangedTemplates]
+ */
+@property (nonatomic, readonly) NSSet *partialTemplateIDs GRMUSTACHE_API_INTERNAL;
+
+/**
+ * Whether the compiled ASTs predict the length of their renderings.
+ *
+ * @see GRMustacheTemplateAST.predictsRenderingLength
+ */
+@property (nonatomic) BOOL predictsRenderingLength GRMUSTACHE_API_INTERNAL;
+
 /**
  * Returns an initialized compiler.
  *
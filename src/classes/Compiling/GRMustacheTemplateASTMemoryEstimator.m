@@ -0,0 +1,235 @@
+// The MIT License
+//
+// Copyright (c) 2014 Gwendal Roué
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#import <objc/runtime.h>
+#import "GRMustacheTemplateASTMemoryEstimator_private.h"
+#import "GRMustacheTemplateASTVisitor_private.h"
+#import "GRMustacheTemplateAST_private.h"
+#import "GRMustacheInheritedPartialNode_private.h"
+#import "GRMustacheInheritableSectionNode_private.h"
+#import "GRMustachePartialNode_private.h"
+#import "GRMustacheVariableTag_private.h"
+#import "GRMustacheSectionTag_private.h"
+#import "GRMustacheTextNode_private.h"
+#import "GRMustachePrecompiledNode_private.h"
+#import "GRMustacheToken_private.h"
+
+@interface GRMustacheTemplateASTMemoryEstimator() <GRMustacheTemplateASTVisitor>
+
+/**
+ * Adds the instance size of object to the estimate, and returns YES, unless
+ * object is nil or has already been counted.
+ */
+- (BOOL)countObject:(id)object;
+
+/**
+ * Counts the string, and its characters.
+ */
+- (void)countString:(NSString *)string;
+
+/**
+ * Counts the data, and its bytes.
+ */
+- (void)countData:(NSData *)data;
+
+/**
+ * Counts the array, and its storage. Elements are not counted.
+ */
+- (void)countArray:(NSArray *)array;
+
+/**
+ * Counts the tag and its token.
+ */
+- (void)countTag:(GRMustacheTag *)tag;
+
+@end
+
+@implementation GRMustacheTemplateASTMemoryEstimator
+
++ (NSUInteger)memorySizeOfTemplateAST:(GRMustacheTemplateAST *)templateAST
+{
+    GRMustacheTemplateASTMemoryEstimator *estimator = [[self alloc] init];
+    [estimator visitTemplateAST:templateAST error:NULL];
+    NSUInteger memorySize = estimator->_memorySize;
+    [estimator release];
+    return memorySize;
+}
+
+- (void)dealloc
+{
+    CFRelease(_countedObjects);
+    [super dealloc];
+}
+
+- (instancetype)init
+{
+    self = [super init];
+    if (self) {
+        _countedObjects = CFSetCreateMutable(NULL, 0, NULL);
+    }
+    return self;
+}
+
+
+#pragma mark - <GRMustacheTemplateASTVisitor>
+
+- (BOOL)visitTemplateAST:(GRMustacheTemplateAST *)templateAST error:(NSError **)error
+{
+    if (![self countObject:templateAST]) {
+        return YES;
+    }
+    
+    NSArray *templateASTNodes = templateAST.templateASTNodes;
+    [self countArray:templateASTNodes];
+    for (id<GRMustacheTemplateASTNode> templateASTNode in templateASTNodes) {
+        [templateASTNode acceptTemplateASTVisitor:self error:NULL];
+    }
+    if (templateAST.staticTextNode) {
+        [self visitTextNode:templateAST.staticTextNode error:NULL];
+    }
+    return YES;
+}
+
+- (BOOL)visitInheritedPartialNode:(GRMustacheInheritedPartialNode *)inheritedPartialNode error:(NSError **)error
+{
+    if ([self countObject:inheritedPartialNode]) {
+        [self countObject:inheritedPartialNode.parentPartialNode];
+        [self visitTemplateAST:inheritedPartialNode.overridingTemplateAST error:NULL];
+    }
+    return YES;
+}
+
+- (BOOL)visitInheritableSectionNode:(GRMustacheInheritableSectionNode *)inheritableSectionNode error:(NSError **)error
+{
+    if ([self countObject:inheritableSectionNode]) {
+        [self countString:inheritableSectionNode.name];
+        [self visitTemplateAST:inheritableSectionNode.innerTemplateAST error:NULL];
+    }
+    return YES;
+}
+
+- (BOOL)visitPartialNode:(GRMustachePartialNode *)partialNode error:(NSError **)error
+{
+    // Partial ASTs are accounted separately
+    if ([self countObject:partialNode]) {
+        [self countString:partialNode.name];
+    }
+    return YES;
+}
+
+- (BOOL)visitVariableTag:(GRMustacheVariableTag *)variableTag error:(NSError **)error
+{
+    [self countTag:variableTag];
+    return YES;
+}
+
+- (BOOL)visitSectionTag:(GRMustacheSectionTag *)sectionTag error:(NSError **)error
+{
+    if ([self countObject:sectionTag]) {
+        [self countTag:sectionTag];
+        [self visitTemplateAST:sectionTag.innerTemplateAST error:NULL];
+    }
+    return YES;
+}
+
+- (BOOL)visitTextNode:(GRMustacheTextNode *)textNode error:(NSError **)error
+{
+    if ([self countObject:textNode]) {
+        [self countString:textNode.text];
+        [self countData:textNode.UTF8Data];
+    }
+    return YES;
+}
+
+- (BOOL)visitPrecompiledNode:(GRMustachePrecompiledNode *)precompiledNode error:(NSError **)error
+{
+    if (![self countObject:precompiledNode]) {
+        return YES;
+    }
+    
+    // Precompiled texts are not copied: only their nodes use memory.
+    NSArray *textNodes = precompiledNode.textNodes;
+    [self countArray:textNodes];
+    for (GRMustacheTextNode *textNode in textNodes) {
+        [self countObject:textNode];
+        [self countObject:textNode.text];
+        [self countObject:textNode.UTF8Data];
+    }
+    
+    NSArray *tags = precompiledNode.tags;
+    [self countArray:tags];
+    for (GRMustacheTag *tag in tags) {
+        [tag acceptTemplateASTVisitor:self error:NULL];
+    }
+    
+    NSArray *partialNodes = precompiledNode.partialNodes;
+    [self countArray:partialNodes];
+    for (GRMustachePartialNode *partialNode in partialNodes) {
+        [self visitPartialNode:partialNode error:NULL];
+    }
+    return YES;
+}
+
+
+#pragma mark - Private
+
+- (BOOL)countObject:(id)object
+{
+    if (object == nil || CFSetContainsValue(_countedObjects, object)) {
+        return NO;
+    }
+    CFSetAddValue(_countedObjects, object);
+    _memorySize += class_getInstanceSize(object_getClass(object));
+    return YES;
+}
+
+- (void)countString:(NSString *)string
+{
+    if ([self countObject:string]) {
+        _memorySize += string.length * sizeof(unichar);
+    }
+}
+
+- (void)countData:(NSData *)data
+{
+    if ([self countObject:data]) {
+        _memorySize += data.length;
+    }
+}
+
+- (void)countArray:(NSArray *)array
+{
+    if ([self countObject:array]) {
+        _memorySize += array.count * sizeof(id);
+    }
+}
+
+- (void)countTag:(GRMustacheTag *)tag
+{
+    [self countObject:tag];
+    GRMustacheToken *token = tag.token;
+    if ([self countObject:token]) {
+        [self countString:token.templateString];
+    }
+}
+
+@end
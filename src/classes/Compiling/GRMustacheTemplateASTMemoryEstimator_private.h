@@ -0,0 +1,55 @@
+// The MIT License
+//
+// Copyright (c) 2014 Gwendal Roué
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#import <Foundation/Foundation.h>
+#import "GRMustacheAvailabilityMacros_private.h"
+
+@class GRMustacheTemplateAST;
+
+/**
+ * The GRMustacheTemplateASTMemoryEstimator estimates the number of bytes used
+ * by a template AST: its nodes, tokens, strings, and UTF-8 encodings.
+ *
+ * Objects that are shared by several nodes, such as the text nodes shared by
+ * GRMustacheTemplateASTOptimizer, or the template string shared by all tokens
+ * of a template, are counted once. Interned expressions are shared by all
+ * templates, and are not counted.
+ *
+ * The estimator does not descend into partials: they are cached, and
+ * accounted, separately.
+ *
+ * @see GRMustacheTemplateRepository
+ */
+@interface GRMustacheTemplateASTMemoryEstimator : NSObject {
+@private
+    CFMutableSetRef _countedObjects;
+    NSUInteger _memorySize;
+}
+
+/**
+ * Returns the estimated number of bytes used by a template AST.
+ *
+ * @param templateAST  A template AST.
+ */
++ (NSUInteger)memorySizeOfTemplateAST:(GRMustacheTemplateAST *)templateAST GRMUSTACHE_API_INTERNAL;
+
+@end
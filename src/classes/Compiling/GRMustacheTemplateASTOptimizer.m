@@ -0,0 +1,235 @@
+// The MIT License
+//
+// Copyright (c) 2014 Gwendal Roué
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#import "GRMustacheTemplateASTOptimizer_private.h"
+#import "GRMustacheTemplateASTVisitor_private.h"
+#import "GRMustacheTemplateAST_private.h"
+#import "GRMustacheInheritedPartialNode_private.h"
+#import "GRMustacheInheritableSectionNode_private.h"
+#import "GRMustachePartialNode_private.h"
+#import "GRMustacheVariableTag_private.h"
+#import "GRMustacheSectionTag_private.h"
+#import "GRMustacheTextNode_private.h"
+#import "GRMustachePrecompiledNode_private.h"
+
+#if !defined(NS_BLOCK_ASSERTIONS)
+// For testing purpose
+GRMustacheTemplateASTOptimizerStatistics GRMustacheTemplateASTOptimizerCurrentStatistics;
+#endif
+
+@interface GRMustacheTemplateASTOptimizer() <GRMustacheTemplateASTVisitor>
+@end
+
+@implementation GRMustacheTemplateASTOptimizer
+
++ (instancetype)templateASTOptimizer
+{
+    return [[[self alloc] init] autorelease];
+}
+
+- (void)dealloc
+{
+    [_textNodeForText release];
+    [super dealloc];
+}
+
+- (instancetype)init
+{
+    self = [super init];
+    if (self) {
+        _textNodeForText = [[NSMutableDictionary alloc] init];
+    }
+    return self;
+}
+
+- (void)optimizeTemplateAST:(GRMustacheTemplateAST *)templateAST
+{
+    [self visitTemplateAST:templateAST error:NULL];
+}
+
+
+#pragma mark - <GRMustacheTemplateASTVisitor>
+
+- (BOOL)visitTemplateAST:(GRMustacheTemplateAST *)templateAST error:(NSError **)error
+{
+    if (templateAST.isPlaceholder) {
+        return YES;
+    }
+    
+    // Save the state of the enclosing AST
+    NSMutableArray *enclosingOptimizedASTNodes = _optimizedASTNodes;
+    GRMustacheTextNode *enclosingPendingTextNode = _pendingTextNode;
+    NSMutableString *enclosingPendingText = _pendingText;
+    
+    NSArray *templateASTNodes = templateAST.templateASTNodes;
+    _optimizedASTNodes = [NSMutableArray arrayWithCapacity:templateASTNodes.count];
+    _pendingTextNode = nil;
+    _pendingText = nil;
+    
+    for (id<GRMustacheTemplateASTNode> ASTNode in templateASTNodes) {
+        [ASTNode acceptTemplateASTVisitor:self error:error];
+    }
+    [self flushPendingTextNode];
+    
+#if !defined(NS_BLOCK_ASSERTIONS)
+    GRMustacheTemplateASTOptimizerCurrentStatistics.nodeCountBeforeOptimization += templateASTNodes.count;
+    GRMustacheTemplateASTOptimizerCurrentStatistics.nodeCountAfterOptimization += _optimizedASTNodes.count;
+#endif
+    
+    templateAST.templateASTNodes = _optimizedASTNodes;
+    
+    // ASTs that contain only text render without any rendering engine
+    switch (_optimizedASTNodes.count) {
+        case 0:
+            templateAST.staticTextNode = [self textNodeWithText:@""];
+            break;
+        
+        case 1: {
+            id<GRMustacheTemplateASTNode> ASTNode = [_optimizedASTNodes objectAtIndex:0];
+            if ([ASTNode isKindOfClass:[GRMustacheTextNode class]]) {
+                templateAST.staticTextNode = (GRMustacheTextNode *)ASTNode;
+            }
+        } break;
+    }
+#if !defined(NS_BLOCK_ASSERTIONS)
+    if (templateAST.staticTextNode) {
+        ++GRMustacheTemplateASTOptimizerCurrentStatistics.staticTemplateASTCount;
+    }
+#endif
+    
+    // Restore the state of the enclosing AST
+    _optimizedASTNodes = enclosingOptimizedASTNodes;
+    _pendingTextNode = enclosingPendingTextNode;
+    _pendingText = enclosingPendingText;
+    
+    return YES;
+}
+
+- (BOOL)visitInheritedPartialNode:(GRMustacheInheritedPartialNode *)inheritedPartialNode error:(NSError **)error
+{
+    [self visitTemplateAST:inheritedPartialNode.overridingTemplateAST error:error];
+    return [self appendASTNode:inheritedPartialNode];
+}
+
+- (BOOL)visitInheritableSectionNode:(GRMustacheInheritableSectionNode *)inheritableSectionNode error:(NSError **)error
+{
+    [self visitTemplateAST:inheritableSectionNode.innerTemplateAST error:error];
+    return [self appendASTNode:inheritableSectionNode];
+}
+
+- (BOOL)visitPartialNode:(GRMustachePartialNode *)partialNode error:(NSError **)error
+{
+    // Partial ASTs are optimized when they are compiled.
+    return [self appendASTNode:partialNode];
+}
+
+- (BOOL)visitVariableTag:(GRMustacheVariableTag *)variableTag error:(NSError **)error
+{
+    return [self appendASTNode:variableTag];
+}
+
+- (BOOL)visitSectionTag:(GRMustacheSectionTag *)sectionTag error:(NSError **)error
+{
+    [self visitTemplateAST:sectionTag.innerTemplateAST error:error];
+    return [self appendASTNode:sectionTag];
+}
+
+- (BOOL)visitTextNode:(GRMustacheTextNode *)textNode error:(NSError **)error
+{
+    if (_pendingTextNode == nil) {
+        _pendingTextNode = textNode;
+    } else {
+        if (_pendingText == nil) {
+            _pendingText = [NSMutableString stringWithString:_pendingTextNode.text];
+        }
+        [_pendingText appendString:textNode.text];
+#if !defined(NS_BLOCK_ASSERTIONS)
+        ++GRMustacheTemplateASTOptimizerCurrentStatistics.mergedTextNodeCount;
+#endif
+    }
+    return YES;
+}
+
+- (BOOL)visitPrecompiledNode:(GRMustachePrecompiledNode *)precompiledNode error:(NSError **)error
+{
+    return [self appendASTNode:precompiledNode];
+}
+
+
+#pragma mark - Private
+
+- (BOOL)appendASTNode:(id<GRMustacheTemplateASTNode>)ASTNode
+{
+    [self flushPendingTextNode];
+    [_optimizedASTNodes addObject:ASTNode];
+    return YES;
+}
+
+/**
+ * Appends the text nodes met since the last non-text node, as a single text
+ * node.
+ */
+- (void)flushPendingTextNode
+{
+    if (_pendingTextNode == nil) {
+        return;
+    }
+    
+    GRMustacheTextNode *textNode;
+    if (_pendingText) {
+        textNode = [self textNodeWithText:[[_pendingText copy] autorelease]];
+    } else {
+        textNode = [_textNodeForText objectForKey:_pendingTextNode.text];
+        if (textNode) {
+#if !defined(NS_BLOCK_ASSERTIONS)
+            ++GRMustacheTemplateASTOptimizerCurrentStatistics.sharedTextNodeCount;
+#endif
+        } else {
+            textNode = _pendingTextNode;
+            [_textNodeForText setObject:textNode forKey:textNode.text];
+        }
+    }
+    [_optimizedASTNodes addObject:textNode];
+    
+    _pendingTextNode = nil;
+    _pendingText = nil;
+}
+
+/**
+ * Returns a text node, shared with all equal text nodes of the optimized
+ * template.
+ */
+- (GRMustacheTextNode *)textNodeWithText:(NSString *)text
+{
+    GRMustacheTextNode *textNode = [_textNodeForText objectForKey:text];
+    if (textNode) {
+#if !defined(NS_BLOCK_ASSERTIONS)
+        ++GRMustacheTemplateASTOptimizerCurrentStatistics.sharedTextNodeCount;
+#endif
+    } else {
+        textNode = [GRMustacheTextNode textNodeWithText:text];
+        [_textNodeForText setObject:textNode forKey:text];
+    }
+    return textNode;
+}
+
+@end
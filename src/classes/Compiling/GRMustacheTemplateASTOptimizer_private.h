@@ -0,0 +1,79 @@
+// The MIT License
+//
+// Copyright (c) 2014 Gwendal Roué
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#import <Foundation/Foundation.h>
+#import "GRMustacheAvailabilityMacros_private.h"
+
+@class GRMustacheTemplateAST;
+@class GRMustacheTextNode;
+
+#if !defined(NS_BLOCK_ASSERTIONS)
+// For testing purpose
+typedef struct {
+    NSUInteger nodeCountBeforeOptimization;     // number of AST nodes output by the compiler
+    NSUInteger nodeCountAfterOptimization;      // number of AST nodes left by the optimizer
+    NSUInteger mergedTextNodeCount;             // number of text nodes merged into their previous sibling
+    NSUInteger sharedTextNodeCount;             // number of text nodes replaced by an equal one
+    NSUInteger staticTemplateASTCount;          // number of ASTs that contain only text
+} GRMustacheTemplateASTOptimizerStatistics;
+extern GRMustacheTemplateASTOptimizerStatistics GRMustacheTemplateASTOptimizerCurrentStatistics GRMUSTACHE_API_INTERNAL;
+#endif
+
+/**
+ * The GRMustacheTemplateASTOptimizer rewrites the ASTs output by
+ * GRMustacheCompiler, so that they render faster:
+ *
+ * - Adjacent text nodes, such as the ones left around comments, pragmas and
+ *   set delimiters tags, are merged into a single text node.
+ *
+ * - Equal text nodes share a single instance, and thus a single string and a
+ *   single UTF-8 encoding.
+ *
+ * - ASTs that contain only text get a staticTextNode, which lets sections and
+ *   partials render without any rendering engine.
+ *
+ * The optimizer does not descend into partials: they are optimized when they
+ * are compiled.
+ *
+ * @see GRMustacheTemplateAST.staticTextNode
+ */
+@interface GRMustacheTemplateASTOptimizer : NSObject {
+@private
+    NSMutableDictionary *_textNodeForText;
+    NSMutableArray *_optimizedASTNodes;
+    GRMustacheTextNode *_pendingTextNode;
+    NSMutableString *_pendingText;
+}
+
+/**
+ * Returns a new optimizer.
+ */
++ (instancetype)templateASTOptimizer GRMUSTACHE_API_INTERNAL;
+
+/**
+ * Optimizes a template AST, and all template ASTs it contains, in place.
+ *
+ * @param templateAST  A template AST that has not been rendered yet.
+ */
+- (void)optimizeTemplateAST:(GRMustacheTemplateAST *)templateAST GRMUSTACHE_API_INTERNAL;
+
+@end
@@ -0,0 +1,165 @@
+// The MIT License
+//
+// Copyright (c) 2014 Gwendal Roué
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#import "GRMustacheTemplateProgram_private.h"
+#import "GRMustacheTemplateASTVisitor_private.h"
+#import "GRMustacheTemplateAST_private.h"
+#import "GRMustacheInheritedPartialNode_private.h"
+#import "GRMustacheInheritableSectionNode_private.h"
+#import "GRMustachePartialNode_private.h"
+#import "GRMustacheVariableTag_private.h"
+#import "GRMustacheSectionTag_private.h"
+#import "GRMustacheTextNode_private.h"
+#import "GRMustachePrecompiledNode_private.h"
+
+@interface GRMustacheTemplateProgram() <GRMustacheTemplateASTVisitor>
+- (instancetype)initWithTemplateAST:(GRMustacheTemplateAST *)templateAST;
+- (NSUInteger)appendInstructionWithType:(GRMustacheInstructionType)type node:(id)node;
+@end
+
+@implementation GRMustacheTemplateProgram
+@synthesize instructionCount=_instructionCount;
+@synthesize maximumSectionDepth=_maximumSectionDepth;
+
++ (instancetype)templateProgramWithTemplateAST:(GRMustacheTemplateAST *)templateAST
+{
+    return [[[self alloc] initWithTemplateAST:templateAST] autorelease];
+}
+
+- (const GRMustacheInstruction *)instructions
+{
+    return _instructions;
+}
+
+- (void)dealloc
+{
+    for (NSUInteger i = 0; i < _instructionCount; ++i) {
+        [_instructions[i].node release];
+    }
+    free(_instructions);
+    [super dealloc];
+}
+
+
+#pragma mark - <GRMustacheTemplateASTVisitor>
+
+- (BOOL)visitTemplateAST:(GRMustacheTemplateAST *)templateAST error:(NSError **)error
+{
+    for (id<GRMustacheTemplateASTNode> ASTNode in templateAST.templateASTNodes) {
+        [ASTNode acceptTemplateASTVisitor:self error:NULL];
+    }
+    return YES;
+}
+
+- (BOOL)visitInheritedPartialNode:(GRMustacheInheritedPartialNode *)inheritedPartialNode error:(NSError **)error
+{
+    [self appendInstructionWithType:GRMustacheInstructionTypeNode node:inheritedPartialNode];
+    return YES;
+}
+
+- (BOOL)visitInheritableSectionNode:(GRMustacheInheritableSectionNode *)inheritableSectionNode error:(NSError **)error
+{
+    [self appendInstructionWithType:GRMustacheInstructionTypeNode node:inheritableSectionNode];
+    return YES;
+}
+
+- (BOOL)visitPartialNode:(GRMustachePartialNode *)partialNode error:(NSError **)error
+{
+    [self appendInstructionWithType:GRMustacheInstructionTypePartial node:partialNode];
+    return YES;
+}
+
+- (BOOL)visitVariableTag:(GRMustacheVariableTag *)variableTag error:(NSError **)error
+{
+    [self appendInstructionWithType:GRMustacheInstructionTypeVariable node:variableTag];
+    return YES;
+}
+
+- (BOOL)visitSectionTag:(GRMustacheSectionTag *)sectionTag error:(NSError **)error
+{
+    GRMustacheTemplateAST *innerTemplateAST = sectionTag.innerTemplateAST;
+    if (innerTemplateAST.contentType != _contentType) {
+        // The content must be rendered by its own rendering engine
+        [self appendInstructionWithType:GRMustacheInstructionTypeNode node:sectionTag];
+        return YES;
+    }
+    
+    NSUInteger sectionIndex = [self appendInstructionWithType:GRMustacheInstructionTypeSection node:sectionTag];
+    
+    _sectionDepth += 1;
+    _maximumSectionDepth = MAX(_maximumSectionDepth, _sectionDepth);
+    GRMustacheTextNode *staticTextNode = innerTemplateAST.staticTextNode;
+    if (staticTextNode) {
+        [self visitTextNode:staticTextNode error:NULL];
+    } else {
+        [self visitTemplateAST:innerTemplateAST error:NULL];
+    }
+    _sectionDepth -= 1;
+    
+    NSUInteger endSectionIndex = [self appendInstructionWithType:GRMustacheInstructionTypeEndSection node:sectionTag];
+    _instructions[endSectionIndex].target = sectionIndex + 1;
+    _instructions[sectionIndex].target = endSectionIndex + 1;
+    return YES;
+}
+
+- (BOOL)visitTextNode:(GRMustacheTextNode *)textNode error:(NSError **)error
+{
+    [self appendInstructionWithType:GRMustacheInstructionTypeText node:textNode];
+    return YES;
+}
+
+- (BOOL)visitPrecompiledNode:(GRMustachePrecompiledNode *)precompiledNode error:(NSError **)error
+{
+    [self appendInstructionWithType:GRMustacheInstructionTypeNode node:precompiledNode];
+    return YES;
+}
+
+
+#pragma mark - Private
+
+- (instancetype)initWithTemplateAST:(GRMustacheTemplateAST *)templateAST
+{
+    NSAssert(!templateAST.isPlaceholder, @"Can't build program for placeholder AST");
+    
+    self = [super init];
+    if (self) {
+        _contentType = templateAST.contentType;
+        [self visitTemplateAST:templateAST error:NULL];
+    }
+    return self;
+}
+
+- (NSUInteger)appendInstructionWithType:(GRMustacheInstructionType)type node:(id)node
+{
+    if (_instructionCount == _instructionCapacity) {
+        _instructionCapacity = MAX(2 * _instructionCapacity, 16);
+        _instructions = realloc(_instructions, _instructionCapacity * sizeof(GRMustacheInstruction));
+    }
+    
+    GRMustacheInstruction *instruction = _instructions + _instructionCount;
+    instruction->type = type;
+    instruction->node = [node retain];
+    instruction->target = 0;
+    return _instructionCount++;
+}
+
+@end
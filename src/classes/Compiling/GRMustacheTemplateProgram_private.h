@@ -0,0 +1,125 @@
+// The MIT License
+//
+// Copyright (c) 2014 Gwendal Roué
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#import <Foundation/Foundation.h>
+#import "GRMustacheAvailabilityMacros_private.h"
+#import "GRMustacheContentType.h"
+
+@class GRMustacheTemplateAST;
+
+/**
+ * The operations of a GRMustacheTemplateProgram.
+ */
+typedef NS_ENUM(NSInteger, GRMustacheInstructionType) {
+    /**
+     * Appends the text of a GRMustacheTextNode.
+     */
+    GRMustacheInstructionTypeText,
+    
+    /**
+     * Evaluates the expression of a GRMustacheVariableTag, and renders its
+     * value.
+     */
+    GRMustacheInstructionTypeVariable,
+    
+    /**
+     * Evaluates the expression of a GRMustacheSectionTag, and jumps to the
+     * instruction at index _target_ if the section should not render.
+     * Otherwise, pushes the value or its first enumeration item on the context
+     * stack as needed, and executes the next instruction.
+     */
+    GRMustacheInstructionTypeSection,
+    
+    /**
+     * Ends the content of a section: pops the context stack, and jumps back to
+     * the instruction at index _target_ if there are enumeration items left.
+     */
+    GRMustacheInstructionTypeEndSection,
+    
+    /**
+     * Renders the template AST of a GRMustachePartialNode.
+     */
+    GRMustacheInstructionTypePartial,
+    
+    /**
+     * Has the rendering engine visit an AST node. Used for nodes that deal
+     * with template inheritance, and for precompiled nodes.
+     */
+    GRMustacheInstructionTypeNode,
+};
+
+/**
+ * An instruction of a GRMustacheTemplateProgram.
+ */
+typedef struct {
+    GRMustacheInstructionType type;
+    id node;            // The AST node the instruction comes from (retained by the program)
+    NSUInteger target;  // The jump target of section instructions
+} GRMustacheInstruction;
+
+/**
+ * A GRMustacheTemplateProgram is a template AST lowered into a flat array of
+ * instructions.
+ *
+ * The content of sections is inlined into the program of their enclosing
+ * AST, between a GRMustacheInstructionTypeSection and a
+ * GRMustacheInstructionTypeEndSection instruction, so that
+ * GRMustacheRenderingEngine can render a whole template in a single loop,
+ * without any AST visit.
+ *
+ * @see GRMustacheTemplateAST.program
+ * @see GRMustacheRenderingEngine
+ */
+@interface GRMustacheTemplateProgram : NSObject {
+@private
+    GRMustacheInstruction *_instructions;
+    NSUInteger _instructionCount;
+    NSUInteger _instructionCapacity;
+    NSUInteger _sectionDepth;
+    NSUInteger _maximumSectionDepth;
+    GRMustacheContentType _contentType;
+}
+
+/**
+ * The instructions.
+ */
+@property (nonatomic, readonly) const GRMustacheInstruction *instructions GRMUSTACHE_API_INTERNAL;
+
+/**
+ * The number of instructions.
+ */
+@property (nonatomic, readonly) NSUInteger instructionCount GRMUSTACHE_API_INTERNAL;
+
+/**
+ * The maximum number of nested sections, that is to say the number of
+ * sections a rendering engine has to keep track of.
+ */
+@property (nonatomic, readonly) NSUInteger maximumSectionDepth GRMUSTACHE_API_INTERNAL;
+
+/**
+ * Returns a program that renders a template AST.
+ *
+ * @param templateAST  A template AST that is not a placeholder.
+ */
++ (instancetype)templateProgramWithTemplateAST:(GRMustacheTemplateAST *)templateAST GRMUSTACHE_API_INTERNAL;
+
+@end
@@ -0,0 +1,79 @@
+// The MIT License
+//
+// Copyright (c) 2014 Gwendal Roué
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#import "GRMustachePrecompiledNode_private.h"
+#import "GRMustacheTemplateASTVisitor_private.h"
+
+@implementation GRMustachePrecompiledNode
+@synthesize renderingFunction=_renderingFunction;
+@synthesize templateString=_templateString;
+@synthesize textNodes=_textNodes;
+@synthesize tags=_tags;
+@synthesize partialNodes=_partialNodes;
+
++ (instancetype)precompiledNodeWithRenderingFunction:(GRMustachePrecompiledRenderingFunction)renderingFunction templateString:(NSString *)templateString textNodes:(NSArray *)textNodes tags:(NSArray *)tags partialNodes:(NSArray *)partialNodes
+{
+    return [[[self alloc] initWithRenderingFunction:renderingFunction templateString:templateString textNodes:textNodes tags:tags partialNodes:partialNodes] autorelease];
+}
+
+- (void)dealloc
+{
+    [_templateString release];
+    [_textNodes release];
+    [_tags release];
+    [_partialNodes release];
+    [super dealloc];
+}
+
+
+#pragma mark - <GRMustacheTemplateASTNode>
+
+- (BOOL)acceptTemplateASTVisitor:(id<GRMustacheTemplateASTVisitor>)visitor error:(NSError **)error
+{
+    return [visitor visitPrecompiledNode:self error:error];
+}
+
+- (id<GRMustacheTemplateASTNode>)resolveTemplateASTNode:(id<GRMustacheTemplateASTNode>)templateASTNode
+{
+    // Templates that use inheritance are not precompiled: precompiled nodes
+    // never override any node.
+    return templateASTNode;
+}
+
+
+#pragma mark - Private
+
+- (instancetype)initWithRenderingFunction:(GRMustachePrecompiledRenderingFunction)renderingFunction templateString:(NSString *)templateString textNodes:(NSArray *)textNodes tags:(NSArray *)tags partialNodes:(NSArray *)partialNodes
+{
+    NSAssert(renderingFunction, @"WTF");
+    self = [super init];
+    if (self) {
+        _renderingFunction = renderingFunction;
+        _templateString = [templateString retain];
+        _textNodes = [textNodes retain];
+        _tags = [tags retain];
+        _partialNodes = [partialNodes retain];
+    }
+    return self;
+}
+
+@end
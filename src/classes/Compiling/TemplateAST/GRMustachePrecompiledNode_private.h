@@ -0,0 +1,100 @@
+// The MIT License
+//
+// Copyright (c) 2014 Gwendal Roué
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#import <Foundation/Foundation.h>
+#import "GRMustacheAvailabilityMacros_private.h"
+#import "GRMustacheTemplateASTNode_private.h"
+#import "GRMustachePrecompiledTemplate.h"
+
+@class GRMustacheRenderingEngine;
+@class GRMustachePrecompiledNode;
+
+/**
+ * The state of the rendering of a precompiled node.
+ *
+ * @see GRMustachePrecompiledRenderText
+ * @see GRMustachePrecompiledRenderTag
+ * @see GRMustachePrecompiledRenderPartial
+ */
+struct GRMustachePrecompiledRendering {
+    GRMustacheRenderingEngine *renderingEngine;
+    GRMustachePrecompiledNode *precompiledNode;
+    NSError **error;
+};
+
+/**
+ * A GRMustachePrecompiledNode is an AST node that renders a block of a
+ * precompiled template, the whole template or the content of a section.
+ *
+ * Its rendering function renders the nodes of its tables, in the order of the
+ * original template.
+ *
+ * @see GRMustachePrecompiledTemplate
+ */
+@interface GRMustachePrecompiledNode : NSObject<GRMustacheTemplateASTNode> {
+@private
+    GRMustachePrecompiledRenderingFunction _renderingFunction;
+    NSString *_templateString;
+    NSArray *_textNodes;
+    NSArray *_tags;
+    NSArray *_partialNodes;
+}
+
+/**
+ * The function that renders the node.
+ */
+@property (nonatomic, readonly) GRMustachePrecompiledRenderingFunction renderingFunction GRMUSTACHE_API_INTERNAL;
+
+/**
+ * The source of the rendered block.
+ */
+@property (nonatomic, retain, readonly) NSString *templateString GRMUSTACHE_API_INTERNAL;
+
+/**
+ * The GRMustacheTextNode instances of the block.
+ */
+@property (nonatomic, retain, readonly) NSArray *textNodes GRMUSTACHE_API_INTERNAL;
+
+/**
+ * The GRMustacheVariableTag and GRMustacheSectionTag instances of the block.
+ */
+@property (nonatomic, retain, readonly) NSArray *tags GRMUSTACHE_API_INTERNAL;
+
+/**
+ * The GRMustachePartialNode instances of the block.
+ */
+@property (nonatomic, retain, readonly) NSArray *partialNodes GRMUSTACHE_API_INTERNAL;
+
+/**
+ * Returns a newly created precompiled node.
+ *
+ * @param renderingFunction  The rendering function of the block.
+ * @param templateString     The source of the block.
+ * @param textNodes          The text nodes of the block.
+ * @param tags               The tags of the block.
+ * @param partialNodes       The partial nodes of the block.
+ *
+ * @return A newly created precompiled node.
+ */
++ (instancetype)precompiledNodeWithRenderingFunction:(GRMustachePrecompiledRenderingFunction)renderingFunction templateString:(NSString *)templateString textNodes:(NSArray *)textNodes tags:(NSArray *)tags partialNodes:(NSArray *)partialNodes GRMUSTACHE_API_INTERNAL;
+
+@end
@@ -24,24 +24,31 @@
 #import "GRMustacheExpression_private.h"
 #import "GRMustacheToken_private.h"
 #import "GRMustacheTemplateAST_private.h"
+#import "GRMustacheTextNode_private.h"
 #import "GRMustacheRenderingEngine_private.h"
+#import "GRMustacheTranslateCharacters_private.h"
 
 @implementation GRMustacheSectionTag
 @synthesize expression=_expression;
 @synthesize innerTemplateAST=_innerTemplateAST;
 @synthesize inverted=_inverted;
+@synthesize innerRange=_innerRange;
+@synthesize token=_token;
+@synthesize keyAccessInlineCaches=_keyAccessInlineCaches;
 
 - (void)dealloc
 {
     [_expression release];
     [_templateString release];
     [_innerTemplateAST release];
+    [_token release];
+    free(_keyAccessInlineCaches);
     [super dealloc];
 }
 
-+ (instancetype)sectionTagWithExpression:(GRMustacheExpression *)expression inverted:(BOOL)inverted templateString:(NSString *)templateString innerRange:(NSRange)innerRange innerTemplateAST:(GRMustacheTemplateAST *)innerTemplateAST
++ (instancetype)sectionTagWithExpression:(GRMustacheExpression *)expression inverted:(BOOL)inverted templateString:(NSString *)templateString innerRange:(NSRange)innerRange innerTemplateAST:(GRMustacheTemplateAST *)innerTemplateAST token:(GRMustacheToken *)token
 {
-    return [[[self alloc] initWithExpression:expression inverted:inverted templateString:templateString innerRange:innerRange innerTemplateAST:innerTemplateAST] autorelease];
+    return [[[self alloc] initWithExpression:expression inverted:inverted templateString:templateString innerRange:innerRange innerTemplateAST:innerTemplateAST token:token] autorelease];
 }
 
 
@@ -49,11 +56,10 @@
 
 - (NSString *)description
 {
-    GRMustacheToken *token = _expression.token;
-    if (token.templateID) {
-        return [NSString stringWithFormat:@"<%@ `%@` at line %lu of template %@>", [self class], token.templateSubstring, (unsigned long)token.line, token.templateID];
+    if (_token.templateID) {
+        return [NSString stringWithFormat:@"<%@ `%@` at line %lu of template %@>", [self class], _token.templateSubstring, (unsigned long)_token.line, _token.templateID];
     } else {
-        return [NSString stringWithFormat:@"<%@ `%@` at line %lu>", [self class], token.templateSubstring, (unsigned long)token.line];
+        return [NSString stringWithFormat:@"<%@ `%@` at line %lu>", [self class], _token.templateSubstring, (unsigned long)_token.line];
     }
 }
 
@@ -69,10 +75,60 @@
 
 - (NSString *)renderContentWithContext:(GRMustacheContext *)context HTMLSafe:(BOOL *)HTMLSafe error:(NSError **)error
 {
+    GRMustacheTextNode *staticTextNode = _innerTemplateAST.staticTextNode;
+    if (staticTextNode) {
+        // Text-only content: no need for a rendering engine
+        if (HTMLSafe) {
+            *HTMLSafe = (_innerTemplateAST.contentType == GRMustacheContentTypeHTML);
+        }
+        return staticTextNode.text;
+    }
+    
     GRMustacheRenderingEngine *renderingEngine = [GRMustacheRenderingEngine renderingEngineWithContentType:_innerTemplateAST.contentType context:context];
     return [renderingEngine renderTemplateAST:_innerTemplateAST HTMLSafe:HTMLSafe error:error];
 }
 
+- (BOOL)renderContentWithContext:(GRMustacheContext *)context intoBuffer:(GRMustacheBuffer *)buffer escapesHTML:(BOOL)escapesHTML HTMLSafe:(BOOL *)HTMLSafe error:(NSError **)error
+{
+    GRMustacheContentType contentType = _innerTemplateAST.contentType;
+    BOOL contentHTMLSafe = (contentType == GRMustacheContentTypeHTML);
+    GRMustacheTextNode *staticTextNode = _innerTemplateAST.staticTextNode;
+    
+    if (staticTextNode) {
+        // Text-only content: no need for a rendering engine
+        if (contentHTMLSafe || !escapesHTML) {
+            GRMustacheBufferAppendStringWithUTF8Data(buffer, staticTextNode.text, staticTextNode.UTF8Data);
+        } else {
+            GRMustacheBufferAppendHTMLEscapedString(buffer, staticTextNode.text);
+        }
+        if (HTMLSafe) {
+            *HTMLSafe = contentHTMLSafe;
+        }
+        return YES;
+    }
+    
+    GRMustacheRenderingEngine *renderingEngine = [GRMustacheRenderingEngine renderingEngineWithContentType:contentType context:context];
+    
+    if (contentHTMLSafe || !escapesHTML) {
+        // No escaping needed: render right into the buffer
+        if (![renderingEngine renderTemplateAST:_innerTemplateAST intoBuffer:buffer error:error]) {
+            return NO;
+        }
+    } else {
+        // Text content embedded in HTML: render separately, and escape
+        NSString *rendering = [renderingEngine renderTemplateAST:_innerTemplateAST HTMLSafe:NULL error:error];
+        if (!rendering) {
+            return NO;
+        }
+        GRMustacheBufferAppendHTMLEscapedString(buffer, rendering);
+    }
+    
+    if (HTMLSafe) {
+        *HTMLSafe = contentHTMLSafe;
+    }
+    return YES;
+}
+
 
 #pragma mark - <GRMustacheTemplateASTNode>
 
@@ -84,7 +140,7 @@
 
 #pragma mark - Private
 
-- (instancetype)initWithExpression:(GRMustacheExpression *)expression inverted:(BOOL)inverted templateString:(NSString *)templateString innerRange:(NSRange)innerRange innerTemplateAST:(GRMustacheTemplateAST *)innerTemplateAST
+- (instancetype)initWithExpression:(GRMustacheExpression *)expression inverted:(BOOL)inverted templateString:(NSString *)templateString innerRange:(NSRange)innerRange innerTemplateAST:(GRMustacheTemplateAST *)innerTemplateAST token:(GRMustacheToken *)token
 {
     self = [super init];
     if (self) {
@@ -93,6 +149,17 @@
         _templateString = [templateString retain];
         _innerRange = innerRange;
         _innerTemplateAST = [innerTemplateAST retain];
+        _token = [token retain];
+        
+        NSUInteger keyAccessCount = expression.keyAccessCount;
+        if (keyAccessCount > 0) {
+            // Zeroed memory is a valid empty inline cache.
+            _keyAccessInlineCaches = calloc(keyAccessCount, sizeof(GRMustacheKeyAccessInlineCache));
+            if (_keyAccessInlineCaches == NULL) {
+                [self release];
+                [NSException raise:NSMallocException format:@"Out of memory."];
+            }
+        }
     }
     return self;
 }
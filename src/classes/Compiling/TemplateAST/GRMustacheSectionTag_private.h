@@ -26,6 +26,7 @@
 
 @class GRMustacheExpression;
 @class GRMustacheTemplateAST;
+@class GRMustacheToken;
 
 @interface GRMustacheSectionTag : GRMustacheTag {
 @private
@@ -34,11 +35,19 @@
     NSString *_templateString;
     NSRange _innerRange;
     GRMustacheTemplateAST *_innerTemplateAST;
+    GRMustacheToken *_token;
+    GRMustacheKeyAccessInlineCache *_keyAccessInlineCaches;
 }
 
 @property (nonatomic, retain, readonly) GRMustacheExpression *expression GRMUSTACHE_API_INTERNAL;
 @property (nonatomic, retain, readonly) GRMustacheTemplateAST *innerTemplateAST GRMUSTACHE_API_INTERNAL;
 
+/**
+ * The range of the inner template string of the section in the template
+ * string of its token.
+ */
+@property (nonatomic, readonly) NSRange innerRange GRMUSTACHE_API_INTERNAL;
+
 
 /**
  * Builds a GRMustacheSectionTag.
@@ -56,11 +65,13 @@
  * @param innerRange        The range of the inner template string of the
  *                          section in _templateString_.
  * @param innerTemplateAST  The AST of the inner content of the section.
+ * @param token             The opening token of the section, for debugging
+ *                          purpose.
  *
  * @return A GRMustacheSectionTag
  *
  * @see GRMustacheExpression
  */
-+ (instancetype)sectionTagWithExpression:(GRMustacheExpression *)expression inverted:(BOOL)inverted templateString:(NSString *)templateString innerRange:(NSRange)innerRange innerTemplateAST:(GRMustacheTemplateAST *)innerTemplateAST GRMUSTACHE_API_INTERNAL;
++ (instancetype)sectionTagWithExpression:(GRMustacheExpression *)expression inverted:(BOOL)inverted templateString:(NSString *)templateString innerRange:(NSRange)innerRange innerTemplateAST:(GRMustacheTemplateAST *)innerTemplateAST token:(GRMustacheToken *)token GRMUSTACHE_API_INTERNAL;
 
 @end
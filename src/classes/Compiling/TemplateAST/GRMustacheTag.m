@@ -49,12 +49,30 @@
     return nil;
 }
 
+- (BOOL)renderContentWithContext:(GRMustacheContext *)context intoBuffer:(GRMustacheBuffer *)buffer escapesHTML:(BOOL)escapesHTML HTMLSafe:(BOOL *)HTMLSafe error:(NSError **)error
+{
+    [self doesNotRecognizeSelector:_cmd];
+    return NO;
+}
+
 - (BOOL)isInverted
 {
     [self doesNotRecognizeSelector:_cmd];
     return NO;
 }
 
+- (GRMustacheToken *)token
+{
+    [self doesNotRecognizeSelector:_cmd];
+    return nil;
+}
+
+- (GRMustacheKeyAccessInlineCache *)keyAccessInlineCaches
+{
+    [self doesNotRecognizeSelector:_cmd];
+    return NULL;
+}
+
 #pragma mark - <GRMustacheTemplateASTNode>
 
 - (id<GRMustacheTemplateASTNode>)resolveTemplateASTNode:(id<GRMustacheTemplateASTNode>)templateASTNode
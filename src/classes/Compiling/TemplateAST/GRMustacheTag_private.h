@@ -23,9 +23,12 @@
 #import <Foundation/Foundation.h>
 #import "GRMustacheAvailabilityMacros_private.h"
 #import "GRMustacheTemplateASTNode_private.h"
+#import "GRMustacheBuffer_private.h"
+#import "GRMustacheKeyAccess_private.h"
 
 @class GRMustacheContext;
 @class GRMustacheTemplateRepository;
+@class GRMustacheToken;
 
 // Documented in GRMustacheTag.h
 typedef NS_ENUM(NSUInteger, GRMustacheTagType) {
@@ -48,9 +51,48 @@ typedef NS_ENUM(NSUInteger, GRMustacheTagType) {
 // Documented in GRMustacheTag.h
 - (NSString *)renderContentWithContext:(GRMustacheContext *)context HTMLSafe:(BOOL *)HTMLSafe error:(NSError **)error GRMUSTACHE_API_PUBLIC;
 
+/**
+ * Appends the rendering of the tag content to a buffer.
+ *
+ * This is the buffer-based counterpart of
+ * renderContentWithContext:HTMLSafe:error:, used by the built-in rendering
+ * objects.
+ *
+ * @param context      A rendering context.
+ * @param buffer       The buffer the rendering is appended to.
+ * @param escapesHTML  YES if a HTML-unsafe rendering should be HTML-escaped
+ *                     before it is appended to the buffer.
+ * @param HTMLSafe     Upon return contains YES if the content is HTML-safe.
+ * @param error        If there is an error rendering the content, upon return
+ *                     contains an NSError object that describes the problem.
+ *
+ * @return YES if the rendering succeeded, NO otherwise.
+ */
+- (BOOL)renderContentWithContext:(GRMustacheContext *)context intoBuffer:(GRMustacheBuffer *)buffer escapesHTML:(BOOL)escapesHTML HTMLSafe:(BOOL *)HTMLSafe error:(NSError **)error GRMUSTACHE_API_INTERNAL;
+
 /**
  * TODO
  */
 @property (nonatomic, readonly, getter=isInverted) BOOL inverted GRMUSTACHE_API_INTERNAL;
 
+/**
+ * The token of the tag, whose sole purpose is to help the library user
+ * debugging his templates, using the token's ability to output its location
+ * (`{{ foo }}` at line 23 of /path/to/template).
+ */
+@property (nonatomic, retain, readonly) GRMustacheToken *token GRMUSTACHE_API_INTERNAL;
+
+/**
+ * The key access inline caches of the tag, one for each key access of its
+ * expression, in the order of evaluation. NULL if the expression does not
+ * access any key.
+ *
+ * Expressions are shared between templates: inline caches belong to tags so
+ * that each call site only sees the classes of its own objects.
+ *
+ * @see -[GRMustacheExpression keyAccessCount]
+ * @see GRMustacheKeyAccessInlineCache
+ */
+@property (nonatomic, readonly) GRMustacheKeyAccessInlineCache *keyAccessInlineCaches GRMUSTACHE_API_INTERNAL;
+
 @end
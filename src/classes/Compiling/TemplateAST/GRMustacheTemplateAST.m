@@ -20,17 +20,21 @@
 // OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
 // THE SOFTWARE.
 
+#import <libkern/OSAtomic.h>
 #import "GRMustacheTemplateAST_private.h"
 #import "GRMustacheTemplateASTNode_private.h"
 #import "GRMustacheTemplateASTVisitor_private.h"
+#import "GRMustacheTemplateProgram_private.h"
 
 @implementation GRMustacheTemplateAST
-@synthesize templateASTNodes=_templateASTNodes;
-@synthesize contentType=_contentType;
+@synthesize staticTextNode=_staticTextNode;
+@synthesize predictsRenderingLength=_predictsRenderingLength;
 
 - (void)dealloc
 {
     [_templateASTNodes release];
+    [_staticTextNode release];
+    [_program release];
     [super dealloc];
 }
 
@@ -50,6 +54,54 @@
     return (_templateASTNodes == nil);
 }
 
+- (NSArray *)templateASTNodes
+{
+    return _templateASTNodes;
+}
+
+- (void)setTemplateASTNodes:(NSArray *)templateASTNodes
+{
+    if (_templateASTNodes != templateASTNodes) {
+        [_templateASTNodes release];
+        _templateASTNodes = [templateASTNodes retain];
+        [self invalidateProgram];
+    }
+}
+
+- (GRMustacheContentType)contentType
+{
+    return _contentType;
+}
+
+- (void)setContentType:(GRMustacheContentType)contentType
+{
+    if (_contentType != contentType) {
+        _contentType = contentType;
+        [self invalidateProgram];
+    }
+}
+
+- (GRMustacheTemplateProgram *)program
+{
+    GRMustacheTemplateProgram *program = _program;
+    if (program == nil) {
+        // Concurrent renderings may build several programs: only one of them
+        // is kept.
+        program = [[GRMustacheTemplateProgram templateProgramWithTemplateAST:self] retain];
+        if (!OSAtomicCompareAndSwapPtrBarrier(nil, program, (void * volatile *)&_program)) {
+            [program release];
+            program = _program;
+        }
+    }
+    return program;
+}
+
+- (void)invalidateProgram
+{
+    [_program release];
+    _program = nil;
+}
+
 - (instancetype)initWithASTNodes:(NSArray *)templateASTNodes contentType:(GRMustacheContentType)contentType
 {
     self = [super init];
@@ -60,6 +112,28 @@
     return self;
 }
 
+- (NSUInteger)renderingLengthEstimate
+{
+    return atomic_load_explicit(&_renderingLengthEstimate, memory_order_relaxed);
+}
+
+- (void)recordRenderingLength:(NSUInteger)length
+{
+    if (!_predictsRenderingLength) {
+        return;
+    }
+    
+    // Moving average, where each rendering weighs 1/4. The first rendering
+    // gives the initial estimate.
+    NSUInteger estimate = atomic_load_explicit(&_renderingLengthEstimate, memory_order_relaxed);
+    if (estimate == 0) {
+        estimate = length;
+    } else {
+        estimate = estimate - estimate / 4 + length / 4;
+    }
+    atomic_store_explicit(&_renderingLengthEstimate, estimate, memory_order_relaxed);
+}
+
 
 #pragma mark - <GRMustacheTemplateASTNode>
 
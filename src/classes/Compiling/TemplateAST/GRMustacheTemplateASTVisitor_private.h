@@ -30,6 +30,7 @@
 @class GRMustacheVariableTag;
 @class GRMustacheSectionTag;
 @class GRMustacheTextNode;
+@class GRMustachePrecompiledNode;
 
 @protocol GRMustacheTemplateASTVisitor <NSObject>
 
@@ -41,5 +42,6 @@
 - (BOOL)visitVariableTag:(GRMustacheVariableTag *)variableTag error:(NSError **)error GRMUSTACHE_API_INTERNAL;
 - (BOOL)visitSectionTag:(GRMustacheSectionTag *)sectionTag error:(NSError **)error GRMUSTACHE_API_INTERNAL;
 - (BOOL)visitTextNode:(GRMustacheTextNode *)textNode error:(NSError **)error GRMUSTACHE_API_INTERNAL;
+- (BOOL)visitPrecompiledNode:(GRMustachePrecompiledNode *)precompiledNode error:(NSError **)error GRMUSTACHE_API_INTERNAL;
 
 @end
@@ -21,11 +21,15 @@
 // THE SOFTWARE.
 
 #import <Foundation/Foundation.h>
+#import <stdatomic.h>
 #import "GRMustacheAvailabilityMacros_private.h"
 #import "GRMustacheContentType.h"
 #import "GRMustacheTemplateASTVisitor_private.h"
 #import "GRMustacheTemplateASTNode_private.h"
 
+@class GRMustacheTextNode;
+@class GRMustacheTemplateProgram;
+
 /**
  * The GRMustacheTemplateAST represents the abstract syntax tree of a template.
  */
@@ -33,6 +37,10 @@
 @private
     NSArray *_templateASTNodes;
     GRMustacheContentType _contentType;
+    GRMustacheTextNode *_staticTextNode;
+    GRMustacheTemplateProgram *_program;
+    BOOL _predictsRenderingLength;
+    _Atomic(NSUInteger) _renderingLengthEstimate;
 }
 
 /**
@@ -47,6 +55,56 @@
  */
 @property (nonatomic) GRMustacheContentType contentType GRMUSTACHE_API_INTERNAL;
 
+/**
+ * The single text node of an AST that contains nothing but text, or nil.
+ *
+ * Set by GRMustacheTemplateASTOptimizer: sections and partials whose AST has
+ * a static text node render this text without any rendering engine.
+ */
+@property (nonatomic, retain) GRMustacheTextNode *staticTextNode GRMUSTACHE_API_INTERNAL;
+
+/**
+ * The AST lowered into a flat array of instructions, built on first access.
+ *
+ * The program is built again if the AST nodes or the content type change.
+ *
+ * @see GRMustacheRenderingEngine
+ */
+@property (nonatomic, readonly) GRMustacheTemplateProgram *program GRMUSTACHE_API_INTERNAL;
+
+/**
+ * Whether the AST keeps track of the length of its renderings, so that
+ * rendering engines can allocate buffers of the right size.
+ *
+ * @see GRMustacheConfiguration.predictsRenderingLength
+ * @see renderingLengthEstimate
+ */
+@property (nonatomic) BOOL predictsRenderingLength GRMUSTACHE_API_INTERNAL;
+
+/**
+ * The expected number of characters or bytes that the next rendering will
+ * copy into its buffer, or 0 when it is unknown. Long strings that buffers
+ * reference instead of copying are not counted.
+ *
+ * The estimate is an exponentially weighted moving average of recent
+ * renderings: a single unusually long rendering does not make all following
+ * renderings allocate oversized buffers.
+ *
+ * @see recordRenderingLength:
+ */
+@property (nonatomic, readonly) NSUInteger renderingLengthEstimate GRMUSTACHE_API_INTERNAL;
+
+/**
+ * Updates renderingLengthEstimate with the length of a complete rendering.
+ *
+ * Does nothing unless predictsRenderingLength is YES.
+ *
+ * Concurrent renderings may lose a few samples, which only makes the estimate
+ * a little less accurate: the estimate is read and written with relaxed
+ * atomic operations, and no locking is involved.
+ */
+- (void)recordRenderingLength:(NSUInteger)length GRMUSTACHE_API_INTERNAL;
+
 /**
  * Used by GRMustacheTemplateRepository, which uses placeholder ASTs when
  * building recursive templates.
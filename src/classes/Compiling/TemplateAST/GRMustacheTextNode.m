@@ -27,12 +27,18 @@
 
 + (instancetype)textNodeWithText:(NSString *)text
 {
-    return [[[self alloc] initWithText:text] autorelease];
+    return [[[self alloc] initWithText:text UTF8Data:[text dataUsingEncoding:NSUTF8StringEncoding]] autorelease];
+}
+
++ (instancetype)textNodeWithText:(NSString *)text UTF8Data:(NSData *)UTF8Data
+{
+    return [[[self alloc] initWithText:text UTF8Data:UTF8Data] autorelease];
 }
 
 - (void)dealloc
 {
     [_text release];
+    [_UTF8Data release];
     [super dealloc];
 }
 
@@ -41,6 +47,11 @@
     return _text;
 }
 
+- (NSData *)UTF8Data
+{
+    return _UTF8Data;
+}
+
 
 #pragma mark - <GRMustacheTemplateASTNode>
 
@@ -57,12 +68,13 @@
 
 #pragma mark - Private
 
-- (instancetype)initWithText:(NSString *)text
+- (instancetype)initWithText:(NSString *)text UTF8Data:(NSData *)UTF8Data
 {
     NSAssert(text, @"WTF");
     self = [self init];
     if (self) {
         _text = [text retain];
+        _UTF8Data = [UTF8Data retain];
     }
     return self;
 }
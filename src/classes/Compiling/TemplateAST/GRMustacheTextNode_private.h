@@ -30,6 +30,7 @@
 @interface GRMustacheTextNode: NSObject<GRMustacheTemplateASTNode> {
 @private
     NSString *_text;
+    NSData *_UTF8Data;
 }
 
 /**
@@ -37,6 +38,12 @@
  */
 @property (nonatomic, retain, readonly) NSString *text GRMUSTACHE_API_INTERNAL;
 
+/**
+ * The UTF-8 encoding of the text, computed once at compile time, so that
+ * UTF-8 renderings copy static text without encoding it again.
+ */
+@property (nonatomic, retain, readonly) NSData *UTF8Data GRMUSTACHE_API_INTERNAL;
+
 /**
  * Builds and returns a GRMustacheTextNode.
  *
@@ -45,6 +52,16 @@
  */
 + (instancetype)textNodeWithText:(NSString *)string GRMUSTACHE_API_INTERNAL;
 
+/**
+ * Builds and returns a GRMustacheTextNode, given a text and its UTF-8
+ * encoding.
+ *
+ * @param string    The string that should be rendered.
+ * @param UTF8Data  The UTF-8 encoding of string.
+ * @return a GRMustacheTextNode
+ */
++ (instancetype)textNodeWithText:(NSString *)string UTF8Data:(NSData *)UTF8Data GRMUSTACHE_API_INTERNAL;
+
 @end
 
 
@@ -27,16 +27,20 @@
 @implementation GRMustacheVariableTag
 @synthesize expression=_expression;
 @synthesize escapesHTML=_escapesHTML;
+@synthesize token=_token;
+@synthesize keyAccessInlineCaches=_keyAccessInlineCaches;
 
 - (void)dealloc
 {
     [_expression release];
+    [_token release];
+    free(_keyAccessInlineCaches);
     [super dealloc];
 }
 
-+ (instancetype)variableTagWithExpression:(GRMustacheExpression *)expression escapesHTML:(BOOL)escapesHTML contentType:(GRMustacheContentType)contentType
++ (instancetype)variableTagWithExpression:(GRMustacheExpression *)expression escapesHTML:(BOOL)escapesHTML contentType:(GRMustacheContentType)contentType token:(GRMustacheToken *)token
 {
-    return [[[self alloc] initWithExpression:expression escapesHTML:escapesHTML contentType:contentType] autorelease];
+    return [[[self alloc] initWithExpression:expression escapesHTML:escapesHTML contentType:contentType token:token] autorelease];
 }
 
 
@@ -44,11 +48,10 @@
 
 - (NSString *)description
 {
-    GRMustacheToken *token = _expression.token;
-    if (token.templateID) {
-        return [NSString stringWithFormat:@"<%@ `%@` at line %lu of template %@>", [self class], token.templateSubstring, (unsigned long)token.line, token.templateID];
+    if (_token.templateID) {
+        return [NSString stringWithFormat:@"<%@ `%@` at line %lu of template %@>", [self class], _token.templateSubstring, (unsigned long)_token.line, _token.templateID];
     } else {
-        return [NSString stringWithFormat:@"<%@ `%@` at line %lu>", [self class], token.templateSubstring, (unsigned long)token.line];
+        return [NSString stringWithFormat:@"<%@ `%@` at line %lu>", [self class], _token.templateSubstring, (unsigned long)_token.line];
     }
 }
 
@@ -75,6 +78,14 @@
     return @"";
 }
 
+- (BOOL)renderContentWithContext:(GRMustacheContext *)context intoBuffer:(GRMustacheBuffer *)buffer escapesHTML:(BOOL)escapesHTML HTMLSafe:(BOOL *)HTMLSafe error:(NSError **)error
+{
+    if (HTMLSafe) {
+        *HTMLSafe = (_contentType == GRMustacheContentTypeHTML);
+    }
+    return YES;
+}
+
 
 #pragma mark - <GRMustacheTemplateASTNode>
 
@@ -86,13 +97,24 @@
 
 #pragma mark - Private
 
-- (instancetype)initWithExpression:(GRMustacheExpression *)expression escapesHTML:(BOOL)escapesHTML contentType:(GRMustacheContentType)contentType
+- (instancetype)initWithExpression:(GRMustacheExpression *)expression escapesHTML:(BOOL)escapesHTML contentType:(GRMustacheContentType)contentType token:(GRMustacheToken *)token
 {
     self = [super init];
     if (self) {
         _expression = [expression retain];
         _escapesHTML = escapesHTML;
         _contentType = contentType;
+        _token = [token retain];
+        
+        NSUInteger keyAccessCount = expression.keyAccessCount;
+        if (keyAccessCount > 0) {
+            // Zeroed memory is a valid empty inline cache.
+            _keyAccessInlineCaches = calloc(keyAccessCount, sizeof(GRMustacheKeyAccessInlineCache));
+            if (_keyAccessInlineCaches == NULL) {
+                [self release];
+                [NSException raise:NSMallocException format:@"Out of memory."];
+            }
+        }
     }
     return self;
 }
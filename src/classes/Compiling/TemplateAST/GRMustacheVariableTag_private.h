@@ -25,12 +25,15 @@
 #import "GRMustacheContentType.h"
 
 @class GRMustacheExpression;
+@class GRMustacheToken;
 
 @interface GRMustacheVariableTag : GRMustacheTag {
 @private
     GRMustacheExpression *_expression;
     BOOL _escapesHTML;
     GRMustacheContentType _contentType;
+    GRMustacheToken *_token;
+    GRMustacheKeyAccessInlineCache *_keyAccessInlineCaches;
 }
 
 @property (nonatomic, retain, readonly) GRMustacheExpression *expression GRMUSTACHE_API_INTERNAL;
@@ -43,11 +46,12 @@
  *                     contex.
  * @param escapesHTML  YES if the value should be escaped.
  * @param contentType  The content type of the tag rendering.
+ * @param token        The token of the tag, for debugging purpose.
  *
  * @return a GRMustacheVariableTag
  *
  * @see GRMustacheExpression
  */
-+ (instancetype)variableTagWithExpression:(GRMustacheExpression *)expression escapesHTML:(BOOL)escapesHTML contentType:(GRMustacheContentType)contentType GRMUSTACHE_API_INTERNAL;
++ (instancetype)variableTagWithExpression:(GRMustacheExpression *)expression escapesHTML:(BOOL)escapesHTML contentType:(GRMustacheContentType)contentType token:(GRMustacheToken *)token GRMUSTACHE_API_INTERNAL;
 
 @end
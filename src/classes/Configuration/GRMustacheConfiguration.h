@@ -293,4 +293,50 @@
  */
 @property (nonatomic, copy) NSString *tagEndDelimiter AVAILABLE_GRMUSTACHE_VERSION_7_0_AND_LATER;
 
+
+////////////////////////////////////////////////////////////////////////////////
+/// @name Tuning Rendering Performance
+////////////////////////////////////////////////////////////////////////////////
+
+/**
+ * Whether templates predict the length of their renderings, or not. The
+ * default value is YES.
+ *
+ * Templates keep track of the length of their recent renderings, and allocate
+ * their rendering buffer accordingly: large renderings do not go through
+ * several buffer growths.
+ *
+ * Set this property to NO when the lengths of the renderings of a template
+ * vary a lot, and you prefer to save memory.
+ *
+ * @since v7.4
+ */
+@property (nonatomic) BOOL predictsRenderingLength AVAILABLE_GRMUSTACHE_VERSION_7_4_AND_LATER;
+
+/**
+ * Whether templates render trusted data, or not. The default value is NO.
+ *
+ * When YES, templates skip the safety checks that protect them from
+ * untrusted data:
+ *
+ * - Keys are not restricted to the safe keys of rendered objects, just as
+ *   with `-[GRMustacheContext contextWithUnsafeKeyAccess]`.
+ *
+ * - NSUndefinedKeyException is not caught. Regular objects do not raise it
+ *   for missing keys, since GRMustache does not ask them for keys they do not
+ *   provide. But objects with a custom implementation of `valueForKey:` must
+ *   not raise for unknown keys.
+ *
+ * - The items of rendered collections are not checked for consistent HTML
+ *   escaping.
+ *
+ * Only set this property to YES when you fully control the rendered data,
+ * such as your own view models.
+ *
+ * **Companion guide:** https://github.com/groue/GRMustache/blob/master/Guides/security.md
+ *
+ * @since v7.4
+ */
+@property (nonatomic) BOOL rendersTrustedData AVAILABLE_GRMUSTACHE_VERSION_7_4_AND_LATER;
+
 @end
@@ -29,6 +29,8 @@
 @synthesize tagStartDelimiter=_tagStartDelimiter;
 @synthesize tagEndDelimiter=_tagEndDelimiter;
 @synthesize baseContext=_baseContext;
+@synthesize predictsRenderingLength=_predictsRenderingLength;
+@synthesize rendersTrustedData=_rendersTrustedData;
 @synthesize locked=_locked;
 
 + (GRMustacheConfiguration *)defaultConfiguration
@@ -51,6 +53,7 @@
     [_tagStartDelimiter release];
     [_tagEndDelimiter release];
     [_baseContext release];
+    [_renderingBaseContext release];
     [super dealloc];
 }
 
@@ -62,13 +65,30 @@
         _tagStartDelimiter = [@"{{" retain];    // useless retain that matches the release in dealloc
         _tagEndDelimiter = [@"}}" retain];      // useless retain that matches the release in dealloc
         _baseContext = [[GRMustacheContext contextWithObject:[GRMustache standardLibrary]] retain];
+        _predictsRenderingLength = YES;
     }
     return self;
 }
 
 - (void)lock
 {
-    _locked = YES;
+    // Repositories lock their configuration as they compile templates, which
+    // may happen in several threads.
+    @synchronized(self) {
+        if (!_locked) {
+            GRMustacheContext *renderingBaseContext = [_baseContext contextByFlatteningProtectedContextStack];
+            if (_rendersTrustedData) {
+                renderingBaseContext = [renderingBaseContext contextWithTrustedData];
+            }
+            _renderingBaseContext = [renderingBaseContext retain];
+            _locked = YES;
+        }
+    }
+}
+
+- (GRMustacheContext *)renderingBaseContext
+{
+    return _renderingBaseContext ?: _baseContext;
 }
 
 - (void)setContentType:(GRMustacheContentType)contentType
@@ -123,6 +143,20 @@
     }
 }
 
+- (void)setPredictsRenderingLength:(BOOL)predictsRenderingLength
+{
+    [self assertNotLocked];
+    
+    _predictsRenderingLength = predictsRenderingLength;
+}
+
+- (void)setRendersTrustedData:(BOOL)rendersTrustedData
+{
+    [self assertNotLocked];
+    
+    _rendersTrustedData = rendersTrustedData;
+}
+
 - (void)extendBaseContextWithObject:(id)object
 {
     self.baseContext = [self.baseContext contextByAddingObject:object];
@@ -148,6 +182,8 @@
     configuration.tagStartDelimiter = _tagStartDelimiter;
     configuration.tagEndDelimiter = _tagEndDelimiter;
     configuration.baseContext = _baseContext;
+    configuration.predictsRenderingLength = _predictsRenderingLength;
+    configuration.rendersTrustedData = _rendersTrustedData;
     // Do not copy the _locked flag, so that the copy is mutable.
     return configuration;
 }
@@ -34,6 +34,9 @@
     NSString *_tagStartDelimiter;
     NSString *_tagEndDelimiter;
     GRMustacheContext *_baseContext;
+    GRMustacheContext *_renderingBaseContext;
+    BOOL _predictsRenderingLength;
+    BOOL _rendersTrustedData;
     BOOL _locked;
 }
 
@@ -56,6 +59,12 @@
 // Documented in GRMustacheConfiguration.h
 @property (nonatomic, retain) GRMustacheContext *baseContext GRMUSTACHE_API_PUBLIC;
 
+// Documented in GRMustacheConfiguration.h
+@property (nonatomic) BOOL predictsRenderingLength GRMUSTACHE_API_PUBLIC;
+
+// Documented in GRMustacheConfiguration.h
+@property (nonatomic) BOOL rendersTrustedData GRMUSTACHE_API_PUBLIC;
+
 // Documented in GRMustacheConfiguration.h
 - (void)extendBaseContextWithObject:(id)object GRMUSTACHE_API_PUBLIC;
 
@@ -72,6 +81,26 @@
  */
 @property (nonatomic, getter = isLocked, readonly) BOOL locked GRMUSTACHE_API_INTERNAL;
 
+/**
+ * The base context of the templates built with the receiver.
+ *
+ * When the receiver is locked, it is a context that performs the same key
+ * lookups as baseContext, but for the immutable protected dictionaries at the
+ * top of its protected context stack, which are merged into a single one: the
+ * protected key lookups, which happen before any other lookup, then cost a
+ * single hash probe. All other objects of baseContext are kept as is, so that
+ * templates see their later mutations, just as with baseContext.
+ *
+ * When rendersTrustedData is YES, this context renders trusted data (see
+ * -[GRMustacheContext contextWithTrustedData]).
+ *
+ * Otherwise, it is baseContext.
+ *
+ * @see lock
+ * @see -[GRMustacheContext contextByFlatteningProtectedContextStack]
+ */
+@property (nonatomic, readonly) GRMustacheContext *renderingBaseContext GRMUSTACHE_API_INTERNAL;
+
 /**
  * Locks the receiver.
  *
@@ -81,6 +110,8 @@
  * The goal is to prevent the user to build template and alter the configuration
  * afterwards.
  *
+ * Locking the receiver builds renderingBaseContext.
+ *
  * @see locked
  */
 - (void)lock GRMUSTACHE_API_INTERNAL;
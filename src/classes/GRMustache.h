@@ -73,6 +73,34 @@ typedef struct {
 + (NSObject *)standardLibrary AVAILABLE_GRMUSTACHE_VERSION_7_0_AND_LATER;
 
 
+////////////////////////////////////////////////////////////////////////////////
+/// @name Safe key access
+////////////////////////////////////////////////////////////////////////////////
+
+/**
+ * Computes the safe keys of the provided classes ahead of rendering.
+ *
+ * Safe keys are the keys that templates can access through `valueForKey:`
+ * (see the GRMustacheSafeKeyAccess protocol). They are computed once for each
+ * class, on the first rendering that queries an instance of this class, and
+ * are then shared by all threads.
+ *
+ * Calling this method at startup, for your model classes, saves this work
+ * from the first renderings. Safe keys of NSManagedObject subclasses depend on
+ * their Core Data entity: they are computed on the first rendering that
+ * queries one of their instances.
+ *
+ * @param classes  An array of classes.
+ *
+ * **Companion guide:** https://github.com/groue/GRMustache/blob/master/Guides/security.md
+ *
+ * @see GRMustacheSafeKeyAccess protocol
+ *
+ * @since v7.4
+ */
++ (void)prewarmSafeKeysForClasses:(NSArray *)classes AVAILABLE_GRMUSTACHE_VERSION_7_4_AND_LATER;
+
+
 ////////////////////////////////////////////////////////////////////////////////
 /// @name Building rendering objects
 ////////////////////////////////////////////////////////////////////////////////
@@ -104,12 +132,14 @@ typedef struct {
 #import "GRMustacheTemplate.h"
 #import "GRMustacheTagDelegate.h"
 #import "GRMustacheTemplateRepository.h"
+#import "GRMustachePrecompiledTemplate.h"
 #import "GRMustacheFilter.h"
 #import "GRMustacheError.h"
 #import "GRMustacheVersion.h"
 #import "GRMustacheContentType.h"
 #import "GRMustacheContext.h"
 #import "GRMustacheRendering.h"
+#import "GRMustacheOutputSink.h"
 #import "GRMustacheTag.h"
 #import "GRMustacheConfiguration.h"
 #import "GRMustacheLocalizer.h"
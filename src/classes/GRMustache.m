@@ -101,6 +101,11 @@
     return standardLibrary;
 }
 
++ (void)prewarmSafeKeysForClasses:(NSArray *)classes
+{
+    [GRMustacheKeyAccess prewarmSafeKeysForClasses:classes];
+}
+
 + (id<GRMustacheRendering>)renderingObjectForObject:(id)object
 {
     return [GRMustacheRendering renderingObjectForObject:object];
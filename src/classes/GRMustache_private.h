@@ -42,6 +42,9 @@ typedef struct {
 // Documented in GRMustache.h
 + (NSObject *)standardLibrary GRMUSTACHE_API_PUBLIC;
 
+// Documented in GRMustache.h
++ (void)prewarmSafeKeysForClasses:(NSArray *)classes GRMUSTACHE_API_PUBLIC;
+
 // Documented in GRMustache.h
 + (id<GRMustacheRendering>)renderingObjectForObject:(id)object GRMUSTACHE_API_PUBLIC_BUT_DEPRECATED;
 
@@ -22,6 +22,7 @@
 
 #import <objc/runtime.h>
 #import <pthread.h>
+#import <stdatomic.h>
 #import "GRMustacheContext_private.h"
 #import "GRMustacheTag_private.h"
 #import "GRMustacheExpression_private.h"
@@ -31,6 +32,11 @@
 #import "GRMustacheTagDelegate.h"
 #import "GRMustacheExpressionInvocation_private.h"
 
+#if !defined(NS_BLOCK_ASSERTIONS)
+// For testing purpose
+GRMustacheContextStatistics GRMustacheContextCurrentStatistics;
+#endif
+
 #define GRMUSTACHE_STACK_RELEASE(stackName) \
     [GRMUSTACHE_STACK_TOP_IVAR(stackName) release]; \
     [GRMUSTACHE_STACK_PARENT_IVAR(stackName) release]
@@ -49,6 +55,23 @@
     } \
     GRMUSTACHE_STACK_TOP(stackName, targetContext) = [object retain];
 
+// Context frames don't retain the stacks they share with the context they
+// derive from: this context outlives them.
+#define GRMUSTACHE_STACK_SHARE(stackName, sourceContext, targetContext) \
+    GRMUSTACHE_STACK_TOP(stackName, targetContext) = GRMUSTACHE_STACK_TOP(stackName, sourceContext); \
+    GRMUSTACHE_STACK_PARENT(stackName, targetContext) = GRMUSTACHE_STACK_PARENT(stackName, sourceContext)
+
+#define GRMUSTACHE_STACK_SHARE_PUSH(stackName, sourceContext, targetContext, object) \
+    NSAssert(object, @"WTF"); \
+    if (GRMUSTACHE_STACK_TOP(stackName, sourceContext)) { \
+        GRMUSTACHE_STACK_PARENT(stackName, targetContext) = sourceContext; \
+    } \
+    GRMUSTACHE_STACK_TOP(stackName, targetContext) = object;
+
+#define GRMUSTACHE_STACK_MATERIALIZE(stackName, sourceContext, targetContext) \
+    GRMUSTACHE_STACK_TOP(stackName, targetContext) = [GRMUSTACHE_STACK_TOP(stackName, sourceContext) retain]; \
+    GRMUSTACHE_STACK_PARENT(stackName, targetContext) = [[GRMUSTACHE_STACK_PARENT(stackName, sourceContext) materializedContext] retain]
+
 #define GRMUSTACHE_STACK_TOP(stackName, context) context->GRMUSTACHE_STACK_TOP_IVAR(stackName)
 
 #define GRMUSTACHE_STACK_PARENT(stackName, context) context->GRMUSTACHE_STACK_PARENT_IVAR(stackName)
@@ -90,6 +113,213 @@ static BOOL objectConformsToTagDelegateProtocol(id object)
 }
 
 
+// =============================================================================
+#pragma mark - Expression Cache
+
+/**
+ * The maximum number of parsed expressions kept by the expression cache of
+ * hasValue:forMustacheExpression:error:.
+ *
+ * Those expressions are provided at runtime by rendering objects and tag
+ * delegates, and may be arbitrary: the cache is flushed when it is full, so
+ * that it never grows without bound. For the same reason, cached expressions
+ * are not interned.
+ */
+#define GRMustacheExpressionCacheCapacity 256
+
+static CFMutableDictionaryRef expressionCache;
+static pthread_mutex_t expressionCacheMutex = PTHREAD_MUTEX_INITIALIZER;
+
+/**
+ * Returns a retained expression parsed from string, or nil if string is not a
+ * valid expression.
+ */
+static GRMustacheExpression *createExpressionForString(NSString *string, NSError **error)
+{
+    if (string == nil) {
+        // Let the parser build the error
+        return [[[[[GRMustacheExpressionParser alloc] init] autorelease] parseExpression:string empty:NULL error:error] retain];
+    }
+    
+    pthread_mutex_lock(&expressionCacheMutex);
+    GRMustacheExpression *expression = nil;
+    if (expressionCache) {
+        expression = [(GRMustacheExpression *)CFDictionaryGetValue(expressionCache, string) retain];
+    }
+    pthread_mutex_unlock(&expressionCacheMutex);
+    
+    if (expression) {
+#if !defined(NS_BLOCK_ASSERTIONS)
+        // For testing purpose
+        atomic_fetch_add_explicit(&GRMustacheContextCurrentStatistics.expressionCacheHitCount, 1, memory_order_relaxed);
+#endif
+        return expression;
+    }
+    
+#if !defined(NS_BLOCK_ASSERTIONS)
+    // For testing purpose
+    atomic_fetch_add_explicit(&GRMustacheContextCurrentStatistics.expressionCacheMissCount, 1, memory_order_relaxed);
+#endif
+    
+    // Parse outside of the lock. Invalid expressions are not cached: they
+    // are not expected to be evaluated often.
+    GRMustacheExpressionParser *parser = [[GRMustacheExpressionParser alloc] init];
+    expression = [[parser parseExpression:string empty:NULL error:error] retain];
+    [parser release];
+    if (!expression) {
+        return nil;
+    }
+    
+    // Copy the key, which may be a mutable string.
+    NSString *key = [string copy];
+    pthread_mutex_lock(&expressionCacheMutex);
+    if (!expressionCache) {
+        expressionCache = CFDictionaryCreateMutable(NULL, 0, &kCFTypeDictionaryKeyCallBacks, &kCFTypeDictionaryValueCallBacks);
+    } else if (CFDictionaryGetCount(expressionCache) >= GRMustacheExpressionCacheCapacity) {
+        CFDictionaryRemoveAllValues(expressionCache);
+    }
+    CFDictionarySetValue(expressionCache, key, expression);
+    pthread_mutex_unlock(&expressionCacheMutex);
+    [key release];
+    
+    return expression;
+}
+
+
+// =============================================================================
+#pragma mark - Context Frame Arena
+
+/**
+ * The number of context frames in an arena chunk.
+ */
+#define GRMustacheContextArenaChunkCapacity 64
+
+/**
+ * A chunk of context frames.
+ */
+typedef struct GRMustacheContextArenaChunk {
+    struct GRMustacheContextArenaChunk *previous;
+    NSUInteger count;           // The number of allocated frames
+    BOOL sealed;                // YES if a frame has escaped: the chunk no longer allocates frames
+    atomic_size_t references;   // The arena, and escaped frames (see popContextFrame)
+    char frames[];              // GRMustacheContextArenaChunkCapacity frames of contextFrameSize bytes
+} GRMustacheContextArenaChunk;
+
+/**
+ * The per-thread arena of context frames.
+ *
+ * Frames are allocated and freed in LIFO order, as sections get rendered, so
+ * that a frame costs a few pointer moves. The first chunk is kept for the
+ * lifetime of the thread. Other chunks are freed as soon as the renderings
+ * that needed them are over.
+ *
+ * A chunk that contains an escaped frame is sealed: it is removed from the
+ * arena as soon as its other frames are popped, and freed by the last
+ * escaped frame that gets deallocated.
+ */
+typedef struct {
+    GRMustacheContextArenaChunk *chunk;         // The chunk of the last allocated frame
+    GRMustacheContextArenaChunk *spareChunk;    // An empty chunk, or NULL
+    NSUInteger frameCount;
+} GRMustacheContextArena;
+
+static size_t contextFrameSize;
+
+static void releaseContextArenaChunk(GRMustacheContextArenaChunk *chunk)
+{
+    // Escaped frames may be deallocated on any thread
+    if (atomic_fetch_sub_explicit(&chunk->references, 1, memory_order_acq_rel) == 1) {
+        free(chunk);
+    }
+}
+
+static pthread_key_t GRContextArenaKey;
+void freeContextArena(void *arena) {
+    GRMustacheContextArenaChunk *chunk = ((GRMustacheContextArena *)arena)->chunk;
+    while (chunk) {
+        GRMustacheContextArenaChunk *previous = chunk->previous;
+        releaseContextArenaChunk(chunk);
+        chunk = previous;
+    }
+    free(((GRMustacheContextArena *)arena)->spareChunk);
+    free(arena);
+}
+#define setupContextArena() pthread_key_create(&GRContextArenaKey, freeContextArena)
+#define getCurrentThreadContextArena() (GRMustacheContextArena *)pthread_getspecific(GRContextArenaKey)
+#define setCurrentThreadContextArena(arena) pthread_setspecific(GRContextArenaKey, arena)
+
+static void *allocateContextFrame(void)
+{
+    GRMustacheContextArena *arena = getCurrentThreadContextArena();
+    if (!arena) {
+        arena = calloc(1, sizeof(GRMustacheContextArena));
+        if (arena == NULL) {
+            [NSException raise:NSMallocException format:@"Out of memory."];
+        }
+        setCurrentThreadContextArena(arena);
+    }
+    
+    GRMustacheContextArenaChunk *chunk = arena->chunk;
+    if (chunk == NULL || chunk->sealed || chunk->count == GRMustacheContextArenaChunkCapacity) {
+        GRMustacheContextArenaChunk *newChunk = arena->spareChunk;
+        if (newChunk) {
+            arena->spareChunk = NULL;
+        } else {
+            newChunk = malloc(sizeof(GRMustacheContextArenaChunk) + GRMustacheContextArenaChunkCapacity * contextFrameSize);
+            if (newChunk == NULL) {
+                [NSException raise:NSMallocException format:@"Out of memory."];
+            }
+        }
+        newChunk->previous = chunk;
+        newChunk->count = 0;
+        newChunk->sealed = NO;
+        atomic_init(&newChunk->references, 1);
+        arena->chunk = chunk = newChunk;
+    }
+    
+    void *bytes = chunk->frames + chunk->count * contextFrameSize;
+    chunk->count += 1;
+    arena->frameCount += 1;
+    memset(bytes, 0, contextFrameSize); // objc_constructInstance requires zeroed memory
+    return bytes;
+}
+
+/**
+ * Returns a frame to the arena, and returns the chunk that contains it.
+ *
+ * The memory of an escaped frame is not reused: its chunk is sealed, and
+ * retained until releaseContextArenaChunk() is called.
+ */
+static GRMustacheContextArenaChunk *freeContextFrame(void *bytes, BOOL escaped)
+{
+    GRMustacheContextArena *arena = getCurrentThreadContextArena();
+    GRMustacheContextArenaChunk *chunk = arena->chunk;
+    NSCAssert(chunk && chunk->count > 0 && bytes == chunk->frames + (chunk->count - 1) * contextFrameSize, @"Context frames must be popped in the reverse order of their creation, on the thread that created them");
+    
+    if (escaped) {
+        chunk->sealed = YES;
+        atomic_fetch_add_explicit(&chunk->references, 1, memory_order_relaxed);
+    }
+    
+    chunk->count -= 1;
+    arena->frameCount -= 1;
+    if (chunk->count == 0 && chunk->sealed) {
+        arena->chunk = chunk->previous;
+        releaseContextArenaChunk(chunk);
+    } else if (chunk->count == 0 && chunk->previous) {
+        arena->chunk = chunk->previous;
+        free(arena->spareChunk);
+        arena->spareChunk = chunk;
+    }
+    if (arena->frameCount == 0 && arena->spareChunk) {
+        // Renderings are over
+        free(arena->spareChunk);
+        arena->spareChunk = NULL;
+    }
+    return chunk;
+}
+
+
 // =============================================================================
 #pragma mark - GRMustacheContext
 
@@ -98,6 +328,10 @@ static BOOL objectConformsToTagDelegateProtocol(id object)
 + (void)initialize
 {
     setupTagDelegateClasses();
+    setupContextArena();
+    
+    // Frames are 16-bytes aligned
+    contextFrameSize = (class_getInstanceSize([GRMustacheContext class]) + 15) & ~(size_t)15;
 }
 
 - (BOOL)unsafeKeyAccess
@@ -105,6 +339,11 @@ static BOOL objectConformsToTagDelegateProtocol(id object)
     return _unsafeKeyAccess;
 }
 
+- (BOOL)trustedData
+{
+    return _trustedData;
+}
+
 
 // =============================================================================
 #pragma mark - Creating Contexts
@@ -152,6 +391,17 @@ static BOOL objectConformsToTagDelegateProtocol(id object)
     GRMUSTACHE_STACK_RELEASE(hiddenContextStack);
     GRMUSTACHE_STACK_RELEASE(tagDelegateStack);
     GRMUSTACHE_STACK_RELEASE(inheritedPartialNodeStack);
+    if (_hiddenObjects) {
+        CFRelease(_hiddenObjects);
+    }
+    if (_escapedContextFrameChunk) {
+        // The memory of an escaped context frame belongs to the arena (see
+        // popContextFrame).
+        GRMustacheContextArenaChunk *chunk = _escapedContextFrameChunk;
+        objc_destructInstance(self);
+        releaseContextArenaChunk(chunk);
+        return;
+    }
     [super dealloc];
 }
 
@@ -161,12 +411,17 @@ static BOOL objectConformsToTagDelegateProtocol(id object)
 
 - (instancetype)contextByAddingTagDelegate:(id<GRMustacheTagDelegate>)tagDelegate
 {
+    if (_contextFrame) {
+        return [[self materializedContext] contextByAddingTagDelegate:tagDelegate];
+    }
+    
     if (tagDelegate == nil) {
         return self;
     }
     
     GRMustacheContext *context = [GRMustacheContext context];
     context->_unsafeKeyAccess = _unsafeKeyAccess;
+    context->_trustedData = _trustedData;
     
     GRMUSTACHE_STACK_COPY(contextStack, self, context);
     GRMUSTACHE_STACK_COPY(protectedContextStack, self, context);
@@ -180,12 +435,17 @@ static BOOL objectConformsToTagDelegateProtocol(id object)
 
 - (instancetype)newContextByAddingObject:(id)object
 {
+    if (_contextFrame) {
+        return [[self materializedContext] newContextByAddingObject:object];
+    }
+    
     if (object == nil) {
         return [self retain];
     }
     
     GRMustacheContext *context = [[GRMustacheContext alloc] init];
     context->_unsafeKeyAccess = _unsafeKeyAccess;
+    context->_trustedData = _trustedData;
     
     GRMUSTACHE_STACK_COPY(protectedContextStack, self, context);
     GRMUSTACHE_STACK_COPY(hiddenContextStack, self, context);
@@ -210,12 +470,17 @@ static BOOL objectConformsToTagDelegateProtocol(id object)
 
 - (instancetype)contextByAddingProtectedObject:(id)object
 {
+    if (_contextFrame) {
+        return [[self materializedContext] contextByAddingProtectedObject:object];
+    }
+    
     if (object == nil) {
         return self;
     }
     
     GRMustacheContext *context = [GRMustacheContext context];
     context->_unsafeKeyAccess = _unsafeKeyAccess;
+    context->_trustedData = _trustedData;
     
     GRMUSTACHE_STACK_COPY(contextStack, self, context);
     GRMUSTACHE_STACK_COPY(hiddenContextStack, self, context);
@@ -229,12 +494,17 @@ static BOOL objectConformsToTagDelegateProtocol(id object)
 
 - (instancetype)contextByAddingHiddenObject:(id)object
 {
+    if (_contextFrame) {
+        return [[self materializedContext] contextByAddingHiddenObject:object];
+    }
+    
     if (object == nil) {
         return self;
     }
     
     GRMustacheContext *context = [GRMustacheContext context];
     context->_unsafeKeyAccess = _unsafeKeyAccess;
+    context->_trustedData = _trustedData;
     
     GRMUSTACHE_STACK_COPY(contextStack, self, context);
     GRMUSTACHE_STACK_COPY(protectedContextStack, self, context);
@@ -248,12 +518,17 @@ static BOOL objectConformsToTagDelegateProtocol(id object)
 
 - (instancetype)contextByAddingInheritedPartialNode:(GRMustacheInheritedPartialNode *)inheritedPartialNode
 {
+    if (_contextFrame) {
+        return [[self materializedContext] contextByAddingInheritedPartialNode:inheritedPartialNode];
+    }
+    
     if (inheritedPartialNode == nil) {
         return self;
     }
     
     GRMustacheContext *context = [GRMustacheContext context];
     context->_unsafeKeyAccess = _unsafeKeyAccess;
+    context->_trustedData = _trustedData;
     
     GRMUSTACHE_STACK_COPY(contextStack, self, context);
     GRMUSTACHE_STACK_COPY(protectedContextStack, self, context);
@@ -265,13 +540,92 @@ static BOOL objectConformsToTagDelegateProtocol(id object)
     return context;
 }
 
+/**
+ * Returns YES if _object_ is an immutable dictionary of Foundation.
+ *
+ * Only those dictionaries can be merged into a single one without altering
+ * key lookups: mutable dictionaries may change after the merge, and subclasses
+ * may override objectForKey: or valueForKey:.
+ */
+static BOOL isFlattenableDictionary(id object)
+{
+    // Foundation dictionaries are instances of private subclasses, which
+    // encode themselves as their public class.
+    return [object classForCoder] == [NSDictionary class];
+}
+
+- (instancetype)contextByFlatteningProtectedContextStack
+{
+    if (_contextFrame) {
+        return [[self materializedContext] contextByFlatteningProtectedContextStack];
+    }
+    
+    // Collect dictionaries from the top of the protected stack, and the first
+    // protected context that is not flattened.
+    
+    NSMutableArray *dictionaries = [NSMutableArray array];
+    GRMustacheContext *protectedParent = nil;
+    GRMUSTACHE_STACK_ENUMERATE(protectedContextStack, self, context) {
+        id object = GRMUSTACHE_STACK_TOP(protectedContextStack, context);
+        if (!isFlattenableDictionary(object)) {
+            protectedParent = context;
+            break;
+        }
+        [dictionaries addObject:object];
+    }
+    
+    if (dictionaries.count == 0) {
+        return self;
+    }
+    
+    // Upper dictionaries override lower ones
+    
+    NSMutableDictionary *mergedDictionary = [NSMutableDictionary dictionary];
+    for (NSDictionary *dictionary in [dictionaries reverseObjectEnumerator]) {
+        [mergedDictionary addEntriesFromDictionary:dictionary];
+    }
+    
+    GRMustacheContext *context = [GRMustacheContext context];
+    context->_unsafeKeyAccess = _unsafeKeyAccess;
+    context->_trustedData = _trustedData;
+    
+    GRMUSTACHE_STACK_COPY(contextStack, self, context);
+    GRMUSTACHE_STACK_COPY(hiddenContextStack, self, context);
+    GRMUSTACHE_STACK_COPY(inheritedPartialNodeStack, self, context);
+    GRMUSTACHE_STACK_COPY(tagDelegateStack, self, context);
+    
+    GRMUSTACHE_STACK_TOP(protectedContextStack, context) = [mergedDictionary copy];
+    GRMUSTACHE_STACK_PARENT(protectedContextStack, context) = [protectedParent retain];
+    
+    return context;
+}
+
 - (instancetype)contextWithUnsafeKeyAccess
 {
+    return [self contextWithUnsafeKeyAccessAndTrustedData:_trustedData];
+}
+
+- (instancetype)contextWithTrustedData
+{
+    return [self contextWithUnsafeKeyAccessAndTrustedData:YES];
+}
+
+/**
+ * Returns a copy of the receiver, and of all the contexts it derives from,
+ * with unsafe key access, and the provided trusted data flag.
+ */
+- (instancetype)contextWithUnsafeKeyAccessAndTrustedData:(BOOL)trustedData
+{
+    if (_contextFrame) {
+        return [[self materializedContext] contextWithUnsafeKeyAccessAndTrustedData:trustedData];
+    }
+    
 #define GRMUSTACHE_CREATE_DEEP_UNSAFE_CONTEXTS(stackName) \
     GRMUSTACHE_STACK_ENUMERATE(stackName, self, __context) { \
         GRMustacheContext *__unsafeContext = CFDictionaryGetValue(unsafeContextForContext, __context); \
         if (!__unsafeContext) { \
             __unsafeContext = [GRMustacheContext contextWithUnsafeKeyAccess]; \
+            __unsafeContext->_trustedData = trustedData; \
             GRMUSTACHE_STACK_COPY(contextStack, __context, __unsafeContext); \
             GRMUSTACHE_STACK_COPY(protectedContextStack, __context, __unsafeContext); \
             GRMUSTACHE_STACK_COPY(hiddenContextStack, __context, __unsafeContext); \
@@ -335,6 +689,98 @@ static BOOL objectConformsToTagDelegateProtocol(id object)
     return unsafeContext;
 }
 
+
+// =============================================================================
+#pragma mark - Context Frames
+
+- (GRMustacheContext *)pushContextFrameWithObject:(id)object
+{
+    GRMustacheContext *context = objc_constructInstance([GRMustacheContext class], allocateContextFrame());
+    context->_contextFrame = YES;
+    context->_contextFrameObject = [object retain];
+    context->_unsafeKeyAccess = _unsafeKeyAccess;
+    context->_trustedData = _trustedData;
+    
+    GRMUSTACHE_STACK_SHARE(protectedContextStack, self, context);
+    GRMUSTACHE_STACK_SHARE(hiddenContextStack, self, context);
+    GRMUSTACHE_STACK_SHARE(inheritedPartialNodeStack, self, context);
+    
+    GRMUSTACHE_STACK_SHARE_PUSH(contextStack, self, context, object);
+    
+    if (objectConformsToTagDelegateProtocol(object)) {
+        GRMUSTACHE_STACK_SHARE_PUSH(tagDelegateStack, self, context, object);
+    } else {
+        GRMUSTACHE_STACK_SHARE(tagDelegateStack, self, context);
+    }
+    
+    return context;
+}
+
+- (void)popContextFrame
+{
+    NSAssert(_contextFrame, @"Not a context frame");
+    
+    BOOL escaped = ([self retainCount] > 1);
+    if (escaped) {
+        // The frame is still referenced, although the contexts it derives
+        // from are about to go away. Turn it into a regular context that
+        // retains its stacks, and leave its memory out of the arena until it
+        // is deallocated.
+        GRMUSTACHE_STACK_MATERIALIZE(contextStack, self, self);
+        GRMUSTACHE_STACK_MATERIALIZE(protectedContextStack, self, self);
+        GRMUSTACHE_STACK_MATERIALIZE(hiddenContextStack, self, self);
+        GRMUSTACHE_STACK_MATERIALIZE(tagDelegateStack, self, self);
+        GRMUSTACHE_STACK_MATERIALIZE(inheritedPartialNodeStack, self, self);
+        _contextFrame = NO;
+    }
+    
+    [_contextFrameObject release];
+    _contextFrameObject = nil;
+    [_materializedContext release];
+    _materializedContext = nil;
+    if (_lookupMemo) {
+        CFRelease(_lookupMemo);
+        _lookupMemo = NULL;
+    }
+    
+    if (escaped) {
+        _escapedContextFrameChunk = freeContextFrame(self, YES);
+        [self release];
+    } else {
+        objc_destructInstance(self);
+        freeContextFrame(self, NO);
+    }
+}
+
+- (instancetype)materializedContext
+{
+    if (!_contextFrame) {
+        return self;
+    }
+    
+    if (_materializedContext == nil) {
+        // Frames the receiver derives from are materialized as well, and
+        // keep their materialized context for their other children.
+        GRMustacheContext *context = [[GRMustacheContext alloc] init];
+        context->_unsafeKeyAccess = _unsafeKeyAccess;
+        context->_trustedData = _trustedData;
+        
+        GRMUSTACHE_STACK_MATERIALIZE(contextStack, self, context);
+        GRMUSTACHE_STACK_MATERIALIZE(protectedContextStack, self, context);
+        GRMUSTACHE_STACK_MATERIALIZE(hiddenContextStack, self, context);
+        GRMUSTACHE_STACK_MATERIALIZE(tagDelegateStack, self, context);
+        GRMUSTACHE_STACK_MATERIALIZE(inheritedPartialNodeStack, self, context);
+        
+        _materializedContext = context;
+    }
+    return _materializedContext;
+}
+
+- (BOOL)isContextFrame
+{
+    return _contextFrame;
+}
+
 // =============================================================================
 #pragma mark - Context Stack
 
@@ -348,12 +794,228 @@ static BOOL objectConformsToTagDelegateProtocol(id object)
     return [self valueForMustacheKey:key protected:NULL];
 }
 
+static id valueForKeyInContextFrame(GRMustacheContext *context, NSString *key, GRMustacheKeyAccessInlineCache *inlineCache, GRMustacheContext *frame, GRMustacheContext **location);
+
+/**
+ * Returns the value for _key_ in _object_, an object of the context stack of
+ * _context_.
+ *
+ * _inlineCache_ is the inline cache of the expression that queries _key_, or
+ * NULL.
+ */
+static id valueForKeyInContextObject(NSString *key, GRMustacheKeyAccessInlineCache *inlineCache, id object, GRMustacheContext *context)
+{
+#if !defined(NS_BLOCK_ASSERTIONS)
+    atomic_fetch_add_explicit(&GRMustacheContextCurrentStatistics.keyProbeCount, 1, memory_order_relaxed);
+#endif
+    if (context->_trustedData) {
+        return [GRMustacheKeyAccess trustedValueForMustacheKey:key inObject:object inlineCache:inlineCache];
+    }
+    return [GRMustacheKeyAccess valueForMustacheKey:key inObject:object unsafeKeyAccess:context->_unsafeKeyAccess inlineCache:inlineCache];
+}
+
+/**
+ * Returns YES if _object_ is in the hidden context stack of _context_.
+ */
+static BOOL isHiddenObject(GRMustacheContext *context, id object)
+{
+    id hiddenObject = GRMUSTACHE_STACK_TOP(hiddenContextStack, context);
+    if (hiddenObject == nil) {
+        return NO;
+    }
+    if (object == hiddenObject) {
+        return YES;
+    }
+    
+    // The rest of the hidden stack lives in the hidden parent, a regular
+    // context that is shared by all the contexts built on top of it.
+    
+    GRMustacheContext *hiddenParent = GRMUSTACHE_STACK_PARENT(hiddenContextStack, context);
+    if (hiddenParent == nil) {
+        return NO;
+    }
+    if (GRMUSTACHE_STACK_PARENT(hiddenContextStack, hiddenParent) == nil) {
+        return (object == GRMUSTACHE_STACK_TOP(hiddenContextStack, hiddenParent));
+    }
+    
+    CFSetRef hiddenObjects = atomic_load_explicit(&hiddenParent->_hiddenObjects, memory_order_acquire);
+    if (hiddenObjects == NULL) {
+        // Objects are retained by the hidden stack
+        CFMutableSetRef objects = CFSetCreateMutable(NULL, 0, NULL);
+        GRMUSTACHE_STACK_ENUMERATE(hiddenContextStack, hiddenParent, hiddenContext) {
+            CFSetAddValue(objects, GRMUSTACHE_STACK_TOP(hiddenContextStack, hiddenContext));
+        }
+        
+        // Contexts may be shared between threads
+        CFSetRef expected = NULL;
+        if (atomic_compare_exchange_strong_explicit(&hiddenParent->_hiddenObjects, &expected, objects, memory_order_release, memory_order_acquire)) {
+            hiddenObjects = objects;
+        } else {
+            CFRelease(objects);
+            hiddenObjects = expected;
+        }
+    }
+    return CFSetContainsValue(hiddenObjects, object);
+}
+
+/**
+ * Looks for _key_ in the context stack of _entry_, skipping the hidden objects
+ * of _context_, and returns the found value.
+ *
+ * Upon return, _location_ contains the entry of the context stack that has
+ * provided the value, or nil.
+ */
+static id valueForKeyInContextStack(GRMustacheContext *context, NSString *key, GRMustacheKeyAccessInlineCache *inlineCache, GRMustacheContext *entry, GRMustacheContext **location)
+{
+    for (; entry; entry = GRMUSTACHE_STACK_PARENT(contextStack, entry)) {
+        // The memo of a frame applies to contexts that hide the same objects.
+        // The top object of the queried context is always checked, so that
+        // short-lived frames, such as enumeration items, don't create memos
+        // they would use only once.
+        if (entry->_contextFrame &&
+            entry != context &&
+            GRMUSTACHE_STACK_TOP(hiddenContextStack, entry) == GRMUSTACHE_STACK_TOP(hiddenContextStack, context) &&
+            GRMUSTACHE_STACK_PARENT(hiddenContextStack, entry) == GRMUSTACHE_STACK_PARENT(hiddenContextStack, context))
+        {
+            return valueForKeyInContextFrame(context, key, inlineCache, entry, location);
+        }
+        
+        id contextObject = GRMUSTACHE_STACK_TOP(contextStack, entry);
+        if (isHiddenObject(context, contextObject)) {
+            continue;
+        }
+        id value = valueForKeyInContextObject(key, inlineCache, contextObject, entry);
+        if (value != nil) {
+            *location = entry;
+            return value;
+        }
+    }
+    
+    *location = nil;
+    return nil;
+}
+
+/**
+ * Returns YES if whether _object_ provides a key or not can not change.
+ *
+ * Strings and numbers provide keys through methods that never return nil,
+ * even for mutable strings. Collections must be immutable. Instances of
+ * CoreFoundation classes that are shared by mutable and immutable
+ * collections are kind of the mutable class, and are not considered
+ * immutable.
+ */
+static BOOL isImmutableContextObject(id object)
+{
+    if ([object isKindOfClass:[NSString class]] || [object isKindOfClass:[NSNumber class]] || object == [NSNull null]) {
+        return YES;
+    }
+    if ([object isKindOfClass:[NSDictionary class]]) {
+        return ![object isKindOfClass:[NSMutableDictionary class]];
+    }
+    if ([object isKindOfClass:[NSArray class]]) {
+        return ![object isKindOfClass:[NSMutableArray class]];
+    }
+    return NO;
+}
+
+/**
+ * The memo value of keys that are not provided by any entry below a frame.
+ */
+static const void *GRMustacheContextLookupBottom = &GRMustacheContextLookupBottom;
+
+/**
+ * Memo keys are retained, and compared by identity.
+ */
+static const void *retainMemoKey(CFAllocatorRef allocator, const void *key)
+{
+    return [(id)key retain];
+}
+
+static void releaseMemoKey(CFAllocatorRef allocator, const void *key)
+{
+    [(id)key release];
+}
+
+static const CFDictionaryKeyCallBacks memoKeyCallBacks = { 0, retainMemoKey, releaseMemoKey, NULL, NULL, NULL };
+
+/**
+ * Same as valueForKeyInContextStack(), but asks _entry_ for the key without
+ * using its memo.
+ */
+static id valueForKeyInContextEntry(GRMustacheContext *context, NSString *key, GRMustacheKeyAccessInlineCache *inlineCache, GRMustacheContext *entry, GRMustacheContext **location)
+{
+    if (entry == nil) {
+        *location = nil;
+        return nil;
+    }
+    id contextObject = GRMUSTACHE_STACK_TOP(contextStack, entry);
+    if (!isHiddenObject(context, contextObject)) {
+        id value = valueForKeyInContextObject(key, inlineCache, contextObject, entry);
+        if (value != nil) {
+            *location = entry;
+            return value;
+        }
+    }
+    return valueForKeyInContextStack(context, key, inlineCache, GRMUSTACHE_STACK_PARENT(contextStack, entry), location);
+}
+
+/**
+ * Same as valueForKeyInContextStack(), but uses and updates the memo of
+ * _frame_.
+ *
+ * The memo of a frame tells, for a key, the first entry of the context stack,
+ * starting from the frame, that either provides the key, or whose answer may
+ * change. Only entries whose objects are immutable are skipped this way:
+ * mutable objects are always asked again, so that memos never have to be
+ * invalidated. Entries below the frame outlive it: the memo does not retain
+ * them.
+ */
+static id valueForKeyInContextFrame(GRMustacheContext *context, NSString *key, GRMustacheKeyAccessInlineCache *inlineCache, GRMustacheContext *frame, GRMustacheContext **location)
+{
+    CFMutableDictionaryRef memo = frame->_lookupMemo;
+    const void *memoizedEntry;
+    if (memo && CFDictionaryGetValueIfPresent(memo, key, &memoizedEntry)) {
+#if !defined(NS_BLOCK_ASSERTIONS)
+        atomic_fetch_add_explicit(&GRMustacheContextCurrentStatistics.memoHitCount, 1, memory_order_relaxed);
+#endif
+        GRMustacheContext *entry = (memoizedEntry == GRMustacheContextLookupBottom) ? nil : (GRMustacheContext *)memoizedEntry;
+        return valueForKeyInContextEntry(context, key, inlineCache, entry, location);
+    }
+    if (memo == NULL) {
+        memo = CFDictionaryCreateMutable(NULL, 0, &memoKeyCallBacks, NULL);
+        frame->_lookupMemo = memo;
+    }
+    
+    GRMustacheContext *entry = frame;
+    for (; entry; entry = GRMUSTACHE_STACK_PARENT(contextStack, entry)) {
+        id contextObject = GRMUSTACHE_STACK_TOP(contextStack, entry);
+        if (!isImmutableContextObject(contextObject)) {
+            break;
+        }
+        if (!isHiddenObject(context, contextObject)) {
+            id value = valueForKeyInContextObject(key, inlineCache, contextObject, entry);
+            if (value != nil) {
+                CFDictionarySetValue(memo, key, entry);
+                *location = entry;
+                return value;
+            }
+        }
+    }
+    CFDictionarySetValue(memo, key, entry ?: GRMustacheContextLookupBottom);
+    return valueForKeyInContextEntry(context, key, inlineCache, entry, location);
+}
+
 - (id)valueForMustacheKey:(NSString *)key protected:(BOOL *)protected
+{
+    return [self valueForMustacheKey:key inlineCache:NULL protected:protected];
+}
+
+- (id)valueForMustacheKey:(NSString *)key inlineCache:(GRMustacheKeyAccessInlineCache *)inlineCache protected:(BOOL *)protected
 {
     // First look for in the protected context stack
     
     GRMUSTACHE_STACK_ENUMERATE(protectedContextStack, self, context) {
-        id value = [GRMustacheKeyAccess valueForMustacheKey:key inObject:GRMUSTACHE_STACK_TOP(protectedContextStack, context) unsafeKeyAccess:context->_unsafeKeyAccess];
+        id value = valueForKeyInContextObject(key, inlineCache, GRMUSTACHE_STACK_TOP(protectedContextStack, context), context);
         if (value != nil) {
             if (protected != NULL) {
                 *protected = YES;
@@ -365,27 +1027,14 @@ static BOOL objectConformsToTagDelegateProtocol(id object)
     
     // Then look for in the regular context stack
     
-    GRMUSTACHE_STACK_ENUMERATE(contextStack, self, context) {
-        // First check for contextObject:
-        //
-        // context = [GRMustacheContext contextWithObject:@{key:value}];
-        // assert([context valueForKey:key] == value);
-        id contextObject = GRMUSTACHE_STACK_TOP(contextStack, context);
-        BOOL hidden = NO;
-        GRMUSTACHE_STACK_ENUMERATE(hiddenContextStack, self, hiddenContext) {
-            if (contextObject == GRMUSTACHE_STACK_TOP(hiddenContextStack, hiddenContext)) {
-                hidden = YES;
-                break;
-            }
-        }
-        if (hidden) { continue; }
-        id value = [GRMustacheKeyAccess valueForMustacheKey:key inObject:contextObject unsafeKeyAccess:context->_unsafeKeyAccess];
-        if (value != nil) {
-            if (protected != NULL) {
-                *protected = NO;
-            }
-            return value;
+    GRMustacheContext *location;
+    GRMustacheContext *entry = GRMUSTACHE_STACK_TOP(contextStack, self) ? self : nil;
+    id value = valueForKeyInContextStack(self, key, inlineCache, entry, &location);
+    if (value != nil) {
+        if (protected != NULL) {
+            *protected = NO;
         }
+        return value;
     }
     
     
@@ -396,20 +1045,27 @@ static BOOL objectConformsToTagDelegateProtocol(id object)
 
 - (BOOL)hasValue:(id *)value forMustacheExpression:(NSString *)string error:(NSError **)error
 {
-    GRMustacheExpressionParser *parser = [[[GRMustacheExpressionParser alloc] init] autorelease];
-    GRMustacheExpression *expression = [parser parseExpression:string empty:NULL error:error];
-    
-    GRMustacheExpressionInvocation *invocation = [[[GRMustacheExpressionInvocation alloc] init] autorelease];
-    invocation.context = self;
-    invocation.expression = expression;
-    if (![invocation invokeReturningError:error]) {
+    GRMustacheExpression *expression = createExpressionForString(string, error);
+    if (!expression) {
         return NO;
     }
     
-    if (value) {
-        *value = invocation.value;
+    // Filters may raise: make sure the invocation gets back to the pool.
+    GRMustacheExpressionInvocation *invocation = [GRMustacheExpressionInvocation newPooledExpressionInvocation];
+    BOOL success = NO;
+    @try {
+        invocation.context = self;
+        invocation.expression = expression;
+        success = [invocation invokeReturningError:error];
+        if (success && value) {
+            *value = invocation.value;
+        }
     }
-    return YES;
+    @finally {
+        [invocation releaseToPool];
+        [expression release];
+    }
+    return success;
 }
 
 
@@ -430,6 +1086,11 @@ static BOOL objectConformsToTagDelegateProtocol(id object)
     return tagDelegateStack;
 }
 
+- (BOOL)hasTagDelegate
+{
+    return (GRMUSTACHE_STACK_TOP(tagDelegateStack, self) != nil);
+}
+
 
 // =============================================================================
 #pragma mark - Overriding Template AST Stack
@@ -448,4 +1109,9 @@ static BOOL objectConformsToTagDelegateProtocol(id object)
     return inheritedPartialNodeStack;
 }
 
+- (BOOL)hasInheritedPartialNode
+{
+    return (GRMUSTACHE_STACK_TOP(inheritedPartialNodeStack, self) != nil);
+}
+
 @end
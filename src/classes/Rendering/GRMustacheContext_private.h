@@ -21,7 +21,9 @@
 // THE SOFTWARE.
 
 #import <Foundation/Foundation.h>
+#import <stdatomic.h>
 #import "GRMustacheAvailabilityMacros_private.h"
+#import "GRMustacheKeyAccess_private.h"
 
 @protocol GRMustacheTagDelegate;
 @protocol GRMustacheTemplateASTNode;
@@ -67,6 +69,16 @@
     GRMUSTACHE_STACK_DECLARE_IVARS(inheritedPartialNodeStack, GRMustacheInheritedPartialNode *);
     
     BOOL _unsafeKeyAccess;
+    BOOL _trustedData;
+    
+    // Context frames (see pushContextFrameWithObject:)
+    BOOL _contextFrame;
+    id _contextFrameObject;                     // The only object retained by a frame
+    GRMustacheContext *_materializedContext;    // Lazily created, or nil
+    CFMutableDictionaryRef _lookupMemo;         // Lazily created, or NULL (see valueForMustacheKey:protected:)
+    void *_escapedContextFrameChunk;            // The arena chunk of an escaped frame, or NULL (see popContextFrame)
+    
+    _Atomic(CFSetRef) _hiddenObjects;           // Lazily created, or NULL (see valueForMustacheKey:protected:)
 }
 
 // Documented in GRMustacheContext.h
@@ -109,12 +121,101 @@
 // Documented in GRMustacheContext.h
 @property (nonatomic, readonly) BOOL unsafeKeyAccess GRMUSTACHE_API_PUBLIC;
 
+/**
+ * Whether this context renders trusted data or not.
+ *
+ * Contexts that render trusted data have unsafe key access, do not catch
+ * NSUndefinedKeyException, and do not check that the items of rendered
+ * collections are consistently HTML-escaped.
+ *
+ * @see contextWithTrustedData
+ * @see -[GRMustacheConfiguration rendersTrustedData]
+ */
+@property (nonatomic, readonly) BOOL trustedData GRMUSTACHE_API_INTERNAL;
+
+/**
+ * Returns a new rendering context that is the copy of the receiver, for
+ * trusted data.
+ *
+ * Just as contextWithUnsafeKeyAccess, trusted data applies to the receiver,
+ * and to all contexts derived from it.
+ *
+ * @see trustedData
+ */
+- (instancetype)contextWithTrustedData GRMUSTACHE_API_INTERNAL;
+
 /**
  * Same as [contextByAddingObject:object], but returns a retained object.
  * This method helps efficiently managing memory, and targeting slow methods.
  */
 - (instancetype)newContextByAddingObject:(id)object GRMUSTACHE_API_INTERNAL;
 
+/**
+ * Returns a GRMustacheContext object identical to the receiver, but for the
+ * immutable Foundation dictionaries at the top of the protected context stack,
+ * which are replaced with a single dictionary that merges them.
+ *
+ * Mutable dictionaries, instances of NSDictionary subclasses, and all other
+ * protected objects are kept as is: the returned context performs the same key
+ * lookups as the receiver, with a single hash probe for the keys of the merged
+ * dictionaries.
+ *
+ * @return A GRMustacheContext object.
+ *
+ * @see -[GRMustacheConfiguration renderingBaseContext]
+ */
+- (instancetype)contextByFlatteningProtectedContextStack GRMUSTACHE_API_INTERNAL;
+
+/**
+ * Returns a context frame identical to the receiver, but for the context stack
+ * that is extended with _object_ (and the tag delegate stack, if _object_ is a
+ * tag delegate).
+ *
+ * Context frames are the lightweight contexts of sections and enumeration
+ * items. They are allocated from an arena of the current thread, and only
+ * retain _object_: the contexts they derive from outlive them.
+ *
+ * Each frame must be popped with popContextFrame, on the same thread, in the
+ * reverse order of creation. Frames must not be given to user code, which may
+ * keep them longer: give it the materializedContext instead.
+ *
+ * @param object  An object that enters the context stack. Must not be nil.
+ *
+ * @return A context frame.
+ *
+ * @see popContextFrame
+ * @see materializedContext
+ */
+- (GRMustacheContext *)pushContextFrameWithObject:(id)object GRMUSTACHE_API_INTERNAL;
+
+/**
+ * Releases a context frame returned by pushContextFrameWithObject:.
+ *
+ * A frame that is still retained elsewhere has escaped. Rather than being
+ * freed, it becomes a regular context that retains its stacks, and is freed
+ * by its last release.
+ *
+ * @see pushContextFrameWithObject:
+ */
+- (void)popContextFrame GRMUSTACHE_API_INTERNAL;
+
+/**
+ * Returns a regular context that is equivalent to the receiver, and can be
+ * retained beyond the lifetime of the receiver.
+ *
+ * Context frames create their materialized context on first call, along with
+ * the materialized contexts of the frames they derive from. Other contexts
+ * return self.
+ *
+ * @see pushContextFrameWithObject:
+ */
+- (instancetype)materializedContext GRMUSTACHE_API_INTERNAL;
+
+/**
+ * YES if the receiver has been returned by pushContextFrameWithObject:.
+ */
+@property (nonatomic, readonly, getter=isContextFrame) BOOL contextFrame GRMUSTACHE_API_INTERNAL;
+
 /**
  * Returns a GRMustacheContext object identical to the receiver, but for the
  * hidden object stack that is extended with _object_.
@@ -148,6 +249,15 @@
  * Performs a key lookup in the receiver's context stack, and returns the found
  * value.
  *
+ * Context frames memoize the entry of the context stack that provides a key,
+ * or the absence of any such entry, for the lookups that go through them.
+ * Memos are keyed by key identity, and are dropped with the frame, at the end
+ * of the rendering of its section or enumeration item. Values themselves are
+ * not memoized: they are always fetched from the memoized entry. When this
+ * entry no longer provides the key, the lookup is performed again. Objects
+ * that start providing a key during the lifetime of a frame may thus be
+ * missed by lookups that go through this frame.
+ *
  * @param key       The searched key.
  * @param protected Upon return, is YES if the value comes from the protected
  *                  context stack.
@@ -158,6 +268,22 @@
  */
 - (id)valueForMustacheKey:(NSString *)key protected:(BOOL *)protected GRMUSTACHE_API_INTERNAL;
 
+/**
+ * Same as valueForMustacheKey:protected:, but queries the objects of the
+ * context stacks through the provided inline cache.
+ *
+ * @param key         The searched key.
+ * @param inlineCache The inline cache of the expression that queries _key_,
+ *                    or NULL.
+ * @param protected   Upon return, is YES if the value comes from the
+ *                    protected context stack.
+ *
+ * @return The value found in the context stack.
+ *
+ * @see GRMustacheKeyAccessInlineCache
+ */
+- (id)valueForMustacheKey:(NSString *)key inlineCache:(GRMustacheKeyAccessInlineCache *)inlineCache protected:(BOOL *)protected GRMUSTACHE_API_INTERNAL;
+
 /**
  * Returns an array containing all tag delegates in the delegate stack.
  * Array may be null (meaning there is no tag delegate in the stack).
@@ -166,9 +292,36 @@
  */
 - (NSArray *)tagDelegateStack GRMUSTACHE_API_INTERNAL;
 
+/**
+ * Returns YES if the delegate stack contains at least one tag delegate.
+ *
+ * Unlike tagDelegateStack, this method does not build any array.
+ */
+- (BOOL)hasTagDelegate GRMUSTACHE_API_INTERNAL;
+
 /**
  * TODO
  */
 - (NSArray *)inheritedPartialNodeStack GRMUSTACHE_API_INTERNAL;
 
+/**
+ * Returns YES if the context is rendering an inherited partial, that is to
+ * say if template AST nodes may be overridden.
+ *
+ * Unlike inheritedPartialNodeStack, this method does not build any array.
+ */
+- (BOOL)hasInheritedPartialNode GRMUSTACHE_API_INTERNAL;
+
 @end
+
+#if !defined(NS_BLOCK_ASSERTIONS)
+// For testing purpose
+// Counters are atomic, since renderings may run concurrently.
+typedef struct {
+    _Atomic(NSUInteger) keyProbeCount;   // number of objects asked for a key by key lookups
+    _Atomic(NSUInteger) memoHitCount;    // number of key lookups answered by the memo of a context frame
+    _Atomic(NSUInteger) expressionCacheHitCount;     // number of hasValue:forMustacheExpression:error: calls that did not parse their expression
+    _Atomic(NSUInteger) expressionCacheMissCount;    // number of hasValue:forMustacheExpression:error: calls that parsed their expression
+} GRMustacheContextStatistics;
+extern GRMustacheContextStatistics GRMustacheContextCurrentStatistics GRMUSTACHE_API_INTERNAL;
+#endif
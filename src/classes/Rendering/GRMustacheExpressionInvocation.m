@@ -20,6 +20,7 @@
 // OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
 // THE SOFTWARE.
 
+#import <pthread.h>
 #import "GRMustacheExpressionInvocation_private.h"
 #import "GRMustacheExpressionVisitor_private.h"
 #import "GRMustacheFilter_private.h"
@@ -31,20 +32,96 @@
 #import "GRMustacheKeyAccess_private.h"
 #import "GRMustacheError.h"
 
+
+// =============================================================================
+#pragma mark - Expression Invocation Pool
+
+/**
+ * The maximum number of idle expression invocations kept by each thread.
+ */
+#define GRMustacheExpressionInvocationPoolCapacity 8
+
+// Evaluations are reentrant, when a filter or a rendering object evaluates an
+// expression or renders a template: each thread keeps a stack of idle
+// invocations instead of a single one.
+static pthread_key_t GRExpressionInvocationPoolKey;
+void freeExpressionInvocationPool(void *pool) {
+    CFRelease((CFMutableArrayRef)pool);
+}
+#define setupExpressionInvocationPool() pthread_key_create(&GRExpressionInvocationPoolKey, freeExpressionInvocationPool)
+#define getCurrentThreadExpressionInvocationPool() (CFMutableArrayRef)pthread_getspecific(GRExpressionInvocationPoolKey)
+#define setCurrentThreadExpressionInvocationPool(pool) pthread_setspecific(GRExpressionInvocationPoolKey, pool)
+
+
+// =============================================================================
+#pragma mark - GRMustacheExpressionInvocation
+
 @interface GRMustacheExpressionInvocation()<GRMustacheExpressionVisitor>
 @end
 
 @implementation GRMustacheExpressionInvocation
 @synthesize context=_context;
 @synthesize expression=_expression;
+@synthesize token=_token;
+@synthesize keyAccessInlineCaches=_keyAccessInlineCaches;
 @synthesize value=_value;
 @synthesize valueIsProtected=_valueIsProtected;
 
++ (void)initialize
+{
+    setupExpressionInvocationPool();
+}
+
++ (instancetype)newPooledExpressionInvocation
+{
+    CFMutableArrayRef pool = getCurrentThreadExpressionInvocationPool();
+    if (pool) {
+        CFIndex count = CFArrayGetCount(pool);
+        if (count > 0) {
+            GRMustacheExpressionInvocation *invocation = [(GRMustacheExpressionInvocation *)CFArrayGetValueAtIndex(pool, count - 1) retain];
+            CFArrayRemoveValueAtIndex(pool, count - 1);
+            return invocation;
+        }
+    }
+    return [[GRMustacheExpressionInvocation alloc] init];
+}
+
+- (void)releaseToPool
+{
+    _context = nil;
+    _expression = nil;
+    _token = nil;
+    _keyAccessInlineCaches = NULL;  // The next expression may not come from a tag
+    _value = nil;
+    
+    CFMutableArrayRef pool = getCurrentThreadExpressionInvocationPool();
+    if (!pool) {
+        pool = CFArrayCreateMutable(NULL, GRMustacheExpressionInvocationPoolCapacity, &kCFTypeArrayCallBacks);
+        setCurrentThreadExpressionInvocationPool(pool);
+    }
+    if (CFArrayGetCount(pool) < GRMustacheExpressionInvocationPoolCapacity) {
+        CFArrayAppendValue(pool, self);
+    }
+    [self release];
+}
+
 - (BOOL)invokeReturningError:(NSError **)error
 {
+    _keyAccessIndex = 0;
     return [_expression acceptVisitor:self error:error];
 }
 
+/**
+ * Returns the inline cache of the next key access, or NULL.
+ */
+- (GRMustacheKeyAccessInlineCache *)nextKeyAccessInlineCache
+{
+    if (_keyAccessInlineCaches == NULL) {
+        return NULL;
+    }
+    return &_keyAccessInlineCaches[_keyAccessIndex++];
+}
+
 
 #pragma mark - <GRMustacheExpressionVisitor>
 
@@ -61,7 +138,7 @@
     id argument = _value;
     
     if (filter == nil) {
-        GRMustacheToken *token = expression.token;
+        GRMustacheToken *token = _token;
         NSString *renderingErrorDescription = nil;
         if (token) {
             if (token.templateID) {
@@ -80,7 +157,7 @@
     }
     
     if (![filter respondsToSelector:@selector(transformedValue:)]) {
-        GRMustacheToken *token = expression.token;
+        GRMustacheToken *token = _token;
         NSString *renderingErrorDescription = nil;
         if (token) {
             if (token.templateID) {
@@ -110,7 +187,7 @@
 
 - (BOOL)visitIdentifierExpression:(GRMustacheIdentifierExpression *)expression error:(NSError **)error
 {
-    _value = [_context valueForMustacheKey:expression.identifier protected:&_valueIsProtected];
+    _value = [_context valueForMustacheKey:expression.identifier inlineCache:[self nextKeyAccessInlineCache] protected:&_valueIsProtected];
     return YES;
 }
 
@@ -120,7 +197,13 @@
         return NO;
     }
     
-    _value = [GRMustacheKeyAccess valueForMustacheKey:expression.identifier inObject:_value unsafeKeyAccess:_context.unsafeKeyAccess];
+    // The base expression has consumed its own inline caches.
+    GRMustacheKeyAccessInlineCache *inlineCache = [self nextKeyAccessInlineCache];
+    if (_context.trustedData) {
+        _value = [GRMustacheKeyAccess trustedValueForMustacheKey:expression.identifier inObject:_value inlineCache:inlineCache];
+    } else {
+        _value = [GRMustacheKeyAccess valueForMustacheKey:expression.identifier inObject:_value unsafeKeyAccess:_context.unsafeKeyAccess inlineCache:inlineCache];
+    }
     _valueIsProtected = NO;
     return YES;
 }
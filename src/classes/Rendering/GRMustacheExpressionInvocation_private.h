@@ -22,9 +22,11 @@
 
 #import <Foundation/Foundation.h>
 #import "GRMustacheAvailabilityMacros_private.h"
+#import "GRMustacheKeyAccess_private.h"
 
 @class GRMustacheContext;
 @class GRMustacheExpression;
+@class GRMustacheToken;
 
 /**
  * TODO
@@ -33,6 +35,9 @@
 @private
     GRMustacheContext *_context;
     GRMustacheExpression *_expression;
+    GRMustacheToken *_token;
+    GRMustacheKeyAccessInlineCache *_keyAccessInlineCaches;
+    NSUInteger _keyAccessIndex;
     id _value;
     BOOL _valueIsProtected;
 }
@@ -47,6 +52,20 @@
  */
 @property (nonatomic, assign) GRMustacheExpression *expression GRMUSTACHE_API_INTERNAL;
 
+/**
+ * The token of the tag that contains the expression, if any. It is used for
+ * building error messages.
+ */
+@property (nonatomic, assign) GRMustacheToken *token GRMUSTACHE_API_INTERNAL;
+
+/**
+ * The inline caches for the key accesses of the expression, in the order of
+ * evaluation, or NULL.
+ *
+ * @see -[GRMustacheTag keyAccessInlineCaches]
+ */
+@property (nonatomic, assign) GRMustacheKeyAccessInlineCache *keyAccessInlineCaches GRMUSTACHE_API_INTERNAL;
+
 /**
  * TODO
  */
@@ -57,6 +76,26 @@
  */
 @property (nonatomic, readonly) BOOL valueIsProtected GRMUSTACHE_API_INTERNAL;
 
+/**
+ * Returns a retained expression invocation, taken from the pool of idle
+ * invocations of the current thread if possible.
+ *
+ * An invocation is not reentrant: evaluations may trigger nested evaluations
+ * (filters, rendering objects, key-value coding getters), and each of them
+ * must use its own invocation. Invocations are cheap to pool, not to create.
+ *
+ * @see releaseToPool
+ */
++ (instancetype)newPooledExpressionInvocation GRMUSTACHE_API_INTERNAL;
+
+/**
+ * Resets the receiver, returns it to the pool of the current thread, and
+ * releases it.
+ *
+ * @see newPooledExpressionInvocation
+ */
+- (void)releaseToPool GRMUSTACHE_API_INTERNAL;
+
 /**
  * TODO
  */
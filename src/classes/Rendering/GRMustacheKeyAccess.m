@@ -21,26 +21,145 @@
 // THE SOFTWARE.
 
 #import <objc/message.h>
-#import <pthread.h>
+#import <stdatomic.h>
 #import "GRMustacheKeyAccess_private.h"
 #import "GRMustacheSafeKeyAccess.h"
 
 #if !defined(NS_BLOCK_ASSERTIONS)
 // For testing purpose
 BOOL GRMustacheKeyAccessDidCatchNSUndefinedKeyException;
+GRMustacheKeyAccessStatistics GRMustacheKeyAccessCurrentStatistics;
 #endif
 
 
 // =============================================================================
 #pragma mark - Safe key access
 
-static pthread_key_t GRSafeKeysForClassKey;
-void freeSafeKeysForClass(void *objects) {
-    CFRelease((CFMutableDictionaryRef)objects);
+// Process-wide registry of safe keys: a hash table of classes, whose buckets
+// are linked lists of immutable nodes.
+//
+// Readers do not lock: nodes are published by an atomic compare-and-swap of
+// the head of their bucket, and are never modified or freed afterwards.
+// Classes live as long as the process anyway.
+
+typedef struct GRMustacheSafeKeysNode {
+    Class klass;
+    NSSet *safeKeys;    // retained
+    struct GRMustacheSafeKeysNode *next;
+} GRMustacheSafeKeysNode;
+
+#define GRMustacheSafeKeysBucketCount 256
+static GRMustacheSafeKeysNode * _Atomic safeKeysBuckets[GRMustacheSafeKeysBucketCount];
+
+static inline GRMustacheSafeKeysNode * _Atomic *safeKeysBucketForClass(Class klass)
+{
+    // Classes are aligned: ignore the low bits of their address.
+    return &safeKeysBuckets[((uintptr_t)klass >> 4) % GRMustacheSafeKeysBucketCount];
+}
+
+static GRMustacheSafeKeysNode *safeKeysNodeInList(GRMustacheSafeKeysNode *node, Class klass)
+{
+    for (; node; node = node->next) {
+        if (node->klass == klass) {
+            return node;
+        }
+    }
+    return NULL;
+}
+
+
+// =============================================================================
+#pragma mark - Key accessors
+
+// Process-wide registry of key accessors: a hash table of classes, whose
+// buckets are linked lists of class nodes. Each class node holds a hash table
+// of keys, whose buckets are linked lists of immutable key accessor nodes, one
+// for each (key, key access mode) pair.
+//
+// As for safe keys, readers do not lock: nodes are published by an atomic
+// compare-and-swap of the head of their bucket, and are never modified or
+// freed afterwards, so that inline caches can hold key accessors without any
+// memory management.
+//
+// The number of accessors of a class is bounded, so that objects queried for
+// an unbounded set of keys do not make the registry grow forever: extra keys
+// get GRMustacheKeyAccessorUnregistered, which runs the full key-fetching
+// logic.
+
+typedef struct GRMustacheKeyAccessorNode {
+    GRMustacheKeyAccessor accessor;     // accessor.key is copied
+    NSUInteger hash;
+    struct GRMustacheKeyAccessorNode *next;
+} GRMustacheKeyAccessorNode;
+
+#define GRMustacheKeyAccessorBucketCount 32
+#define GRMustacheKeyAccessorMaxCountPerClass 256
+
+typedef struct GRMustacheKeyAccessorsNode {
+    Class klass;
+    atomic_size_t accessorCount;
+    GRMustacheKeyAccessorNode * _Atomic accessorBuckets[GRMustacheKeyAccessorBucketCount];
+    struct GRMustacheKeyAccessorsNode *next;
+} GRMustacheKeyAccessorsNode;
+
+#define GRMustacheKeyAccessorsBucketCount 256
+static GRMustacheKeyAccessorsNode * _Atomic keyAccessorsBuckets[GRMustacheKeyAccessorsBucketCount];
+
+// Its nil class never matches any object: inline caches never hold it.
+static const GRMustacheKeyAccessor GRMustacheKeyAccessorUnregistered = { Nil, nil, NO, GRMustacheKeyAccessorTypeDynamic, NULL, NULL };
+
+static GRMustacheKeyAccessorsNode *keyAccessorsNodeInList(GRMustacheKeyAccessorsNode *node, Class klass)
+{
+    for (; node; node = node->next) {
+        if (node->klass == klass) {
+            return node;
+        }
+    }
+    return NULL;
+}
+
+static GRMustacheKeyAccessorsNode *keyAccessorsNodeForClass(Class klass)
+{
+    // Classes are aligned: ignore the low bits of their address.
+    GRMustacheKeyAccessorsNode * _Atomic *bucket = &keyAccessorsBuckets[((uintptr_t)klass >> 4) % GRMustacheKeyAccessorsBucketCount];
+    GRMustacheKeyAccessorsNode *head = atomic_load_explicit(bucket, memory_order_acquire);
+    GRMustacheKeyAccessorsNode *node = keyAccessorsNodeInList(head, klass);
+    if (node) {
+        return node;
+    }
+    
+    // Zeroed memory is a valid initial state for atomic counters and
+    // pointers.
+    GRMustacheKeyAccessorsNode *newNode = calloc(1, sizeof(GRMustacheKeyAccessorsNode));
+    if (newNode == NULL) {
+        [NSException raise:NSMallocException format:@"Out of memory."];
+    }
+    newNode->klass = klass;
+    while (YES) {
+        newNode->next = head;
+        if (atomic_compare_exchange_weak_explicit(bucket, &head, newNode, memory_order_release, memory_order_acquire)) {
+            return newNode;
+        }
+        node = keyAccessorsNodeInList(head, klass);
+        if (node) {
+            free(newNode);
+            return node;
+        }
+    }
 }
-#define setupSafeKeysForClass() pthread_key_create(&GRSafeKeysForClassKey, freeSafeKeysForClass)
-#define getCurrentThreadSafeKeysForClass() (CFMutableDictionaryRef)pthread_getspecific(GRSafeKeysForClassKey)
-#define setCurrentThreadSafeKeysForClass(classes) pthread_setspecific(GRSafeKeysForClassKey, classes)
+
+static const GRMustacheKeyAccessor *keyAccessorInList(GRMustacheKeyAccessorNode *node, NSString *key, NSUInteger hash, BOOL unsafeKeyAccess)
+{
+    for (; node; node = node->next) {
+        if (node->hash == hash && node->accessor.unsafeKeyAccess == unsafeKeyAccess && [node->accessor.key isEqualToString:key]) {
+            return &node->accessor;
+        }
+    }
+    return NULL;
+}
+
+static IMP NSObjectValueForKeyIMP;
+static IMP NSObjectRespondsToSelectorIMP;
 
 
 // =============================================================================
@@ -115,17 +234,22 @@ static Class NSManagedObjectClass;
 {
     NSOrderedSetClass = NSClassFromString(@"NSOrderedSet");
     NSManagedObjectClass = NSClassFromString(@"NSManagedObject");
+    NSObjectValueForKeyIMP = class_getMethodImplementation([NSObject class], @selector(valueForKey:));
+    NSObjectRespondsToSelectorIMP = class_getMethodImplementation([NSObject class], @selector(respondsToSelector:));
     [self setupSafeKeyAccessForFoundationClasses];
-    setupSafeKeysForClass();
 }
 
 + (id)valueForMustacheKey:(NSString *)key inObject:(id)object unsafeKeyAccess:(BOOL)unsafeKeyAccess
 {
-    if (object == nil) {
-        return nil;
-    }
-    
-    
+    return [self valueForMustacheKey:key inObject:object unsafeKeyAccess:unsafeKeyAccess inlineCache:NULL];
+}
+
+/**
+ * The full key-fetching logic, for objects whose key accessors can not be
+ * cached (see GRMustacheKeyAccessorTypeDynamic).
+ */
++ (id)dynamicValueForMustacheKey:(NSString *)key inObject:(id)object unsafeKeyAccess:(BOOL)unsafeKeyAccess
+{
     // Try objectForKeyedSubscript: first (see https://github.com/groue/GRMustache/issues/66:)
     
     if ([object respondsToSelector:@selector(objectForKeyedSubscript:)]) {
@@ -139,23 +263,155 @@ static Class NSManagedObjectClass;
         return nil;
     }
     
+    return [self valueForKey:key inObject:object];
+}
+
++ (id)valueForMustacheKey:(NSString *)key inObject:(id)object unsafeKeyAccess:(BOOL)unsafeKeyAccess inlineCache:(GRMustacheKeyAccessInlineCache *)inlineCache
+{
+    if (object == nil) {
+        return nil;
+    }
     
-    @try {
-        
-        // We don't want to use NSArray, NSSet and NSOrderedSet implementation
-        // of valueForKey:, because they return another collection: see issue
-        // #21 and "anchored key should not extract properties inside an array"
-        // test in src/tests/Public/v4.0/GRMustacheSuites/compound_keys.json
-        //
-        // Instead, we want the behavior of NSObject's implementation of valueForKey:.
-        
-        if ([self objectIsFoundationCollectionWhoseImplementationOfValueForKeyReturnsAnotherCollection:object]) {
-            return [self valueForMustacheKey:key inFoundationCollectionObject:object];
-        } else {
-            return [object valueForKey:key];
+    const GRMustacheKeyAccessor *accessor = [self accessorForMustacheKey:key inObject:object unsafeKeyAccess:unsafeKeyAccess inlineCache:inlineCache];
+    return [self valueForMustacheKey:key inObject:object unsafeKeyAccess:unsafeKeyAccess accessor:accessor];
+}
+
++ (id)trustedValueForMustacheKey:(NSString *)key inObject:(id)object inlineCache:(GRMustacheKeyAccessInlineCache *)inlineCache
+{
+    if (object == nil) {
+        return nil;
+    }
+    
+    // Trusted data uses the accessors of unsafe key access, and is not
+    // guarded against NSUndefinedKeyException.
+    
+    const GRMustacheKeyAccessor *accessor = [self accessorForMustacheKey:key inObject:object unsafeKeyAccess:YES inlineCache:inlineCache];
+    switch (accessor->type) {
+        case GRMustacheKeyAccessorTypeDynamic:
+            if ([object respondsToSelector:@selector(objectForKeyedSubscript:)]) {
+                return [object objectForKeyedSubscript:key];
+            }
+            return [self unguardedValueForKey:key inObject:object];
+            
+        case GRMustacheKeyAccessorTypeValueForKey:
+            return [self unguardedValueForKey:key inObject:object];
+            
+        default:
+            return [self valueForMustacheKey:key inObject:object unsafeKeyAccess:YES accessor:accessor];
+    }
+}
+
+/**
+ * Returns the key accessor for the class of object, key, and key access mode,
+ * looking first in the provided inline cache, and updating it on cache miss.
+ */
++ (const GRMustacheKeyAccessor *)accessorForMustacheKey:(NSString *)key inObject:(id)object unsafeKeyAccess:(BOOL)unsafeKeyAccess inlineCache:(GRMustacheKeyAccessInlineCache *)inlineCache
+{
+    if (inlineCache == NULL) {
+        return [self accessorForMustacheKey:key inObject:object unsafeKeyAccess:unsafeKeyAccess];
+    }
+    
+    
+    // Look for the accessor in the inline cache
+    
+    Class klass = object_getClass(object);
+    for (NSUInteger i = 0; i < GRMustacheKeyAccessInlineCacheSize; ++i) {
+        const GRMustacheKeyAccessor *candidate = atomic_load_explicit(&inlineCache->accessors[i], memory_order_acquire);
+        if (candidate && candidate->klass == klass && candidate->unsafeKeyAccess == unsafeKeyAccess && (candidate->key == key || [candidate->key isEqualToString:key])) {
+#if !defined(NS_BLOCK_ASSERTIONS)
+            atomic_fetch_add_explicit(&GRMustacheKeyAccessCurrentStatistics.inlineCacheHitCount, 1, memory_order_relaxed);
+#endif
+            return candidate;
         }
     }
     
+#if !defined(NS_BLOCK_ASSERTIONS)
+    atomic_fetch_add_explicit(&GRMustacheKeyAccessCurrentStatistics.inlineCacheMissCount, 1, memory_order_relaxed);
+#endif
+    // Fill the slots in a round-robin fashion. Concurrent updates may
+    // overwrite each other: this only costs a future cache miss.
+    const GRMustacheKeyAccessor *accessor = [self accessorForMustacheKey:key inObject:object unsafeKeyAccess:unsafeKeyAccess];
+    if (accessor != &GRMustacheKeyAccessorUnregistered) {
+        unsigned int slot = atomic_fetch_add_explicit(&inlineCache->nextSlot, 1, memory_order_relaxed) % GRMustacheKeyAccessInlineCacheSize;
+        atomic_store_explicit(&inlineCache->accessors[slot], accessor, memory_order_release);
+    }
+    return accessor;
+}
+
+/**
+ * Extracts the value for _key_ from _object_, with the key accessor of the
+ * class of _object_.
+ */
++ (id)valueForMustacheKey:(NSString *)key inObject:(id)object unsafeKeyAccess:(BOOL)unsafeKeyAccess accessor:(const GRMustacheKeyAccessor *)accessor
+{
+    SEL selector = accessor->selector;
+    IMP implementation = accessor->implementation;
+    switch (accessor->type) {
+        case GRMustacheKeyAccessorTypeDynamic:
+            return [self dynamicValueForMustacheKey:key inObject:object unsafeKeyAccess:unsafeKeyAccess];
+            
+        case GRMustacheKeyAccessorTypeNone:
+        case GRMustacheKeyAccessorTypeMissing:
+            return nil;
+            
+        case GRMustacheKeyAccessorTypeKeyedSubscript:
+            return ((id(*)(id, SEL, id))implementation)(object, selector, key);
+            
+        case GRMustacheKeyAccessorTypeValueForKey:
+            return [self valueForKey:key inObject:object];
+            
+        case GRMustacheKeyAccessorTypeObjectGetter:
+            return ((id(*)(id, SEL))implementation)(object, selector);
+            
+        case GRMustacheKeyAccessorTypeCharGetter:
+            return [NSNumber numberWithChar:((char(*)(id, SEL))implementation)(object, selector)];
+            
+        case GRMustacheKeyAccessorTypeIntGetter:
+            return [NSNumber numberWithInt:((int(*)(id, SEL))implementation)(object, selector)];
+            
+        case GRMustacheKeyAccessorTypeShortGetter:
+            return [NSNumber numberWithShort:((short(*)(id, SEL))implementation)(object, selector)];
+            
+        case GRMustacheKeyAccessorTypeLongGetter:
+            return [NSNumber numberWithLong:((long(*)(id, SEL))implementation)(object, selector)];
+            
+        case GRMustacheKeyAccessorTypeLongLongGetter:
+            return [NSNumber numberWithLongLong:((long long(*)(id, SEL))implementation)(object, selector)];
+            
+        case GRMustacheKeyAccessorTypeUnsignedCharGetter:
+            return [NSNumber numberWithUnsignedChar:((unsigned char(*)(id, SEL))implementation)(object, selector)];
+            
+        case GRMustacheKeyAccessorTypeUnsignedIntGetter:
+            return [NSNumber numberWithUnsignedInt:((unsigned int(*)(id, SEL))implementation)(object, selector)];
+            
+        case GRMustacheKeyAccessorTypeUnsignedShortGetter:
+            return [NSNumber numberWithUnsignedShort:((unsigned short(*)(id, SEL))implementation)(object, selector)];
+            
+        case GRMustacheKeyAccessorTypeUnsignedLongGetter:
+            return [NSNumber numberWithUnsignedLong:((unsigned long(*)(id, SEL))implementation)(object, selector)];
+            
+        case GRMustacheKeyAccessorTypeUnsignedLongLongGetter:
+            return [NSNumber numberWithUnsignedLongLong:((unsigned long long(*)(id, SEL))implementation)(object, selector)];
+            
+        case GRMustacheKeyAccessorTypeBoolGetter:
+            return [NSNumber numberWithBool:((_Bool(*)(id, SEL))implementation)(object, selector)];
+            
+        case GRMustacheKeyAccessorTypeFloatGetter:
+            return [NSNumber numberWithFloat:((float(*)(id, SEL))implementation)(object, selector)];
+            
+        case GRMustacheKeyAccessorTypeDoubleGetter:
+            return [NSNumber numberWithDouble:((double(*)(id, SEL))implementation)(object, selector)];
+    }
+    
+    return nil;
+}
+
++ (id)valueForKey:(NSString *)key inObject:(id)object
+{
+    @try {
+        return [self unguardedValueForKey:key inObject:object];
+    }
+    
     @catch (NSException *exception) {
         
         // Swallow NSUndefinedKeyException only
@@ -163,11 +419,293 @@ static Class NSManagedObjectClass;
         if (![[exception name] isEqualToString:NSUndefinedKeyException]) {
             [exception raise];
         }
+#if !defined(NS_BLOCK_ASSERTIONS)
+        GRMustacheKeyAccessDidCatchNSUndefinedKeyException = YES;
+#endif
     }
     
     return nil;
 }
 
+/**
+ * Sends the `valueForKey:` message to object, or emulates NSObject's
+ * implementation for Foundation collections. NSUndefinedKeyException is not
+ * caught.
+ */
++ (id)unguardedValueForKey:(NSString *)key inObject:(id)object
+{
+    // We don't want to use NSArray, NSSet and NSOrderedSet implementation
+    // of valueForKey:, because they return another collection: see issue
+    // #21 and "anchored key should not extract properties inside an array"
+    // test in src/tests/Public/v4.0/GRMustacheSuites/compound_keys.json
+    //
+    // Instead, we want the behavior of NSObject's implementation of valueForKey:.
+    
+    if ([self objectIsFoundationCollectionWhoseImplementationOfValueForKeyReturnsAnotherCollection:object]) {
+        return [self valueForMustacheKey:key inFoundationCollectionObject:object];
+    } else {
+        return [object valueForKey:key];
+    }
+}
+
+
+// =============================================================================
+#pragma mark - Key accessors
+
++ (const GRMustacheKeyAccessor *)accessorForMustacheKey:(NSString *)key inObject:(id)object unsafeKeyAccess:(BOOL)unsafeKeyAccess
+{
+    Class klass = object_getClass(object);
+    GRMustacheKeyAccessorsNode *accessors = keyAccessorsNodeForClass(klass);
+    NSUInteger hash = [key hash];
+    GRMustacheKeyAccessorNode * _Atomic *bucket = &accessors->accessorBuckets[hash % GRMustacheKeyAccessorBucketCount];
+    GRMustacheKeyAccessorNode *head = atomic_load_explicit(bucket, memory_order_acquire);
+    const GRMustacheKeyAccessor *accessor = keyAccessorInList(head, key, hash, unsafeKeyAccess);
+    if (accessor) {
+        return accessor;
+    }
+    
+    
+    // Reserve a slot in the class, or give up registration.
+    
+    if (atomic_fetch_add_explicit(&accessors->accessorCount, 1, memory_order_relaxed) >= GRMustacheKeyAccessorMaxCountPerClass) {
+        atomic_fetch_sub_explicit(&accessors->accessorCount, 1, memory_order_relaxed);
+        return &GRMustacheKeyAccessorUnregistered;
+    }
+    
+    
+    // Resolve before allocating, since resolution may run user code
+    // (`safeMustacheKeys`, `respondsToSelector:`) that may raise.
+    
+#if !defined(NS_BLOCK_ASSERTIONS)
+    atomic_fetch_add_explicit(&GRMustacheKeyAccessCurrentStatistics.accessorResolutionCount, 1, memory_order_relaxed);
+#endif
+    GRMustacheKeyAccessor resolvedAccessor = { klass, nil, unsafeKeyAccess, GRMustacheKeyAccessorTypeDynamic, NULL, NULL };
+    @try {
+        [self resolveAccessor:&resolvedAccessor forMustacheKey:key inObject:object];
+    }
+    @catch (NSException *exception) {
+        atomic_fetch_sub_explicit(&accessors->accessorCount, 1, memory_order_relaxed);
+        [exception raise];
+    }
+    
+    GRMustacheKeyAccessorNode *newNode = malloc(sizeof(GRMustacheKeyAccessorNode));
+    if (newNode == NULL) {
+        [NSException raise:NSMallocException format:@"Out of memory."];
+    }
+    newNode->accessor = resolvedAccessor;
+    newNode->accessor.key = [key copy];  // Mutable keys must not alter the registry
+    newNode->hash = hash;
+    
+    
+    // Publish, unless another thread was faster.
+    
+    while (YES) {
+        accessor = keyAccessorInList(head, key, hash, unsafeKeyAccess);
+        if (accessor) {
+            atomic_fetch_sub_explicit(&accessors->accessorCount, 1, memory_order_relaxed);
+            [newNode->accessor.key release];
+            free(newNode);
+            return accessor;
+        }
+        newNode->next = head;
+        if (atomic_compare_exchange_weak_explicit(bucket, &head, newNode, memory_order_release, memory_order_acquire)) {
+            return &newNode->accessor;
+        }
+    }
+}
+
+/**
+ * Fills _accessor_ so that it implements the logic of
+ * valueForMustacheKey:inObject:unsafeKeyAccess: for all instances of the class
+ * of _object_.
+ */
++ (void)resolveAccessor:(GRMustacheKeyAccessor *)accessor forMustacheKey:(NSString *)key inObject:(id)object
+{
+    Class klass = accessor->klass;
+    
+    // Objects that override respondsToSelector: may not answer consistently
+    // for all instances of their class (proxies, for instance). Let them go
+    // through the full logic.
+    
+    if (class_getMethodImplementation(klass, @selector(respondsToSelector:)) != NSObjectRespondsToSelectorIMP) {
+        accessor->type = GRMustacheKeyAccessorTypeDynamic;
+        return;
+    }
+    
+    if ([object respondsToSelector:@selector(objectForKeyedSubscript:)]) {
+        accessor->type = GRMustacheKeyAccessorTypeKeyedSubscript;
+        accessor->selector = @selector(objectForKeyedSubscript:);
+        accessor->implementation = class_getMethodImplementation(klass, @selector(objectForKeyedSubscript:));
+        return;
+    }
+    
+    if (!accessor->unsafeKeyAccess && ![self isSafeMustacheKey:key forObject:object]) {
+        accessor->type = GRMustacheKeyAccessorTypeNone;
+        return;
+    }
+    
+    
+    // Calling a getter directly is only equivalent to `valueForKey:` when
+    // the class uses NSObject's implementation. Foundation collections
+    // emulate NSObject's implementation (see
+    // valueForMustacheKey:inFoundationCollectionObject:), and thus can use
+    // getters directly.
+    
+    accessor->type = GRMustacheKeyAccessorTypeValueForKey;
+    BOOL foundationCollection = [self objectIsFoundationCollectionWhoseImplementationOfValueForKeyReturnsAnotherCollection:object];
+    if (!foundationCollection && class_getMethodImplementation(klass, @selector(valueForKey:)) != NSObjectValueForKeyIMP) {
+        return;
+    }
+    if (key.length == 0) {
+        return;
+    }
+    
+    
+    // Default Search Pattern for valueForKey: look for get<Key>, <key>, or
+    // is<Key>, in that order.
+    
+    NSString *keyWithUppercaseInitial = [NSString stringWithFormat:@"%@%@",
+                                         [[key substringToIndex:1] uppercaseString],
+                                         [key substringFromIndex:1]];
+    NSArray *accessorNames = [NSArray arrayWithObjects:
+                              [NSString stringWithFormat:@"get%@", keyWithUppercaseInitial],
+                              key,
+                              [NSString stringWithFormat:@"is%@", keyWithUppercaseInitial],
+                              nil];
+    
+    for (NSString *accessorName in accessorNames) {
+        SEL selector = NSSelectorFromString(accessorName);
+        Method method = class_getInstanceMethod(klass, selector);
+        if (method == NULL) {
+            continue;
+        }
+        if (method_getNumberOfArguments(method) != 2) {
+            // Not a getter: let valueForKey: decide.
+            return;
+        }
+        
+        char returnType[32];
+        method_getReturnType(method, returnType, sizeof(returnType));
+        
+        // Skip type qualifiers (const, oneway, etc.)
+        const char *objCType = returnType;
+        while (*objCType && strchr("rnNoORV", *objCType)) {
+            ++objCType;
+        }
+        
+        GRMustacheKeyAccessorType type;
+        switch (objCType[0]) {
+            case '@':
+            case '#':
+                type = GRMustacheKeyAccessorTypeObjectGetter;
+                break;
+            case 'c':
+                type = GRMustacheKeyAccessorTypeCharGetter;
+                break;
+            case 'i':
+                type = GRMustacheKeyAccessorTypeIntGetter;
+                break;
+            case 's':
+                type = GRMustacheKeyAccessorTypeShortGetter;
+                break;
+            case 'l':
+                type = GRMustacheKeyAccessorTypeLongGetter;
+                break;
+            case 'q':
+                type = GRMustacheKeyAccessorTypeLongLongGetter;
+                break;
+            case 'C':
+                type = GRMustacheKeyAccessorTypeUnsignedCharGetter;
+                break;
+            case 'I':
+                type = GRMustacheKeyAccessorTypeUnsignedIntGetter;
+                break;
+            case 'S':
+                type = GRMustacheKeyAccessorTypeUnsignedShortGetter;
+                break;
+            case 'L':
+                type = GRMustacheKeyAccessorTypeUnsignedLongGetter;
+                break;
+            case 'Q':
+                type = GRMustacheKeyAccessorTypeUnsignedLongLongGetter;
+                break;
+            case 'B':
+                type = GRMustacheKeyAccessorTypeBoolGetter;
+                break;
+            case 'f':
+                type = GRMustacheKeyAccessorTypeFloatGetter;
+                break;
+            case 'd':
+                type = GRMustacheKeyAccessorTypeDoubleGetter;
+                break;
+            default:
+                // Structs, pointers, void...: let valueForKey: box the value.
+                return;
+        }
+        
+        accessor->type = type;
+        accessor->selector = selector;
+        accessor->implementation = method_getImplementation(method);
+        return;
+    }
+    
+    
+    // No getter. Foundation collections stop here. For other classes, unless
+    // the rest of the search pattern of valueForKey: finds something, the key
+    // is missing.
+    
+    if (foundationCollection || ![self classMayProvideValue:klass forKeyWithUppercaseInitial:keyWithUppercaseInitial key:key]) {
+        accessor->type = GRMustacheKeyAccessorTypeMissing;
+    }
+}
+
+/**
+ * Returns YES if NSObject's implementation of `valueForKey:` may return a
+ * value, or raise an exception other than NSUndefinedKeyException, for a key
+ * that has no get<Key>, <key>, or is<Key> getter.
+ */
++ (BOOL)classMayProvideValue:(Class)klass forKeyWithUppercaseInitial:(NSString *)keyWithUppercaseInitial key:(NSString *)key
+{
+    // valueForUndefinedKey: is overridden
+    
+    if (class_getMethodImplementation(klass, @selector(valueForUndefinedKey:)) != class_getMethodImplementation([NSObject class], @selector(valueForUndefinedKey:))) {
+        return YES;
+    }
+    
+    
+    // Private getters, and collection accessors
+    
+    NSArray *methodNames = [NSArray arrayWithObjects:
+                            [NSString stringWithFormat:@"_get%@", keyWithUppercaseInitial],
+                            [NSString stringWithFormat:@"_%@", key],
+                            [NSString stringWithFormat:@"countOf%@", keyWithUppercaseInitial],
+                            nil];
+    for (NSString *methodName in methodNames) {
+        if (class_getInstanceMethod(klass, NSSelectorFromString(methodName))) {
+            return YES;
+        }
+    }
+    
+    
+    // Instance variables
+    
+    if ([klass accessInstanceVariablesDirectly]) {
+        NSArray *ivarNames = [NSArray arrayWithObjects:
+                              [NSString stringWithFormat:@"_%@", key],
+                              [NSString stringWithFormat:@"_is%@", keyWithUppercaseInitial],
+                              key,
+                              [NSString stringWithFormat:@"is%@", keyWithUppercaseInitial],
+                              nil];
+        for (NSString *ivarName in ivarNames) {
+            if (class_getInstanceVariable(klass, [ivarName UTF8String])) {
+                return YES;
+            }
+        }
+    }
+    
+    return NO;
+}
+
 
 // =============================================================================
 #pragma mark - Foundation collections
@@ -421,31 +959,76 @@ class_addProtocol(klass, protocol);\
 
 + (BOOL)isSafeMustacheKey:(NSString *)key forObject:(id)object
 {
+    NSSet *safeKeys = [self safeKeysForClass:[object class] object:object];
+    return [safeKeys containsObject:key];
+}
+
++ (void)prewarmSafeKeysForClasses:(NSArray *)classes
+{
+    for (Class klass in classes) {
+        [self safeKeysForClass:klass object:nil];
+    }
+}
+
+/**
+ * Returns the safe keys of _klass_, from the registry, or after having
+ * registered them.
+ *
+ * @param klass   A class
+ * @param object  An instance of _klass_, or nil. Safe keys of
+ *                NSManagedObject subclasses depend on their entity, and are
+ *                not registered until an instance is provided.
+ */
++ (NSSet *)safeKeysForClass:(Class)klass object:(id)object
+{
+    GRMustacheSafeKeysNode * _Atomic *bucket = safeKeysBucketForClass(klass);
+    GRMustacheSafeKeysNode *node = safeKeysNodeInList(atomic_load_explicit(bucket, memory_order_acquire), klass);
+    if (node) {
+        return node->safeKeys;
+    }
+    
+    
+    // Compute safe keys
+    
     NSSet *safeKeys = nil;
-    {
-        CFMutableDictionaryRef safeKeysForClass = getCurrentThreadSafeKeysForClass();
-        if (!safeKeysForClass) {
-            safeKeysForClass = CFDictionaryCreateMutable(NULL, 0, NULL, &kCFTypeDictionaryValueCallBacks);
-            setCurrentThreadSafeKeysForClass(safeKeysForClass);
-        }
-        
-        Class klass = [object class];
-        safeKeys = (NSSet *)CFDictionaryGetValue(safeKeysForClass, klass);
-        if (safeKeys == nil) {
-            if ([klass respondsToSelector:@selector(safeMustacheKeys)]) {
-                safeKeys = [klass safeMustacheKeys] ?: [NSSet set];
-            } else {
-                NSMutableSet *keys = [self propertyGettersForClass:klass];
-                if (NSManagedObjectClass && [object isKindOfClass:NSManagedObjectClass]) {
-                    [keys unionSet:[NSSet setWithArray:[[[object entity] propertiesByName] allKeys]]];
-                }
-                safeKeys = keys;
+    if ([klass respondsToSelector:@selector(safeMustacheKeys)]) {
+        safeKeys = [klass safeMustacheKeys] ?: [NSSet set];
+    } else {
+        NSMutableSet *keys = [self propertyGettersForClass:klass];
+        if (NSManagedObjectClass && [klass isSubclassOfClass:NSManagedObjectClass]) {
+            if (object == nil) {
+                return keys;
             }
-            CFDictionarySetValue(safeKeysForClass, klass, safeKeys);
+            [keys unionSet:[NSSet setWithArray:[[[object entity] propertiesByName] allKeys]]];
         }
+        safeKeys = keys;
     }
     
-    return [safeKeys containsObject:key];
+    
+    // Publish, unless another thread was faster.
+    
+#if !defined(NS_BLOCK_ASSERTIONS)
+    atomic_fetch_add_explicit(&GRMustacheKeyAccessCurrentStatistics.safeKeysRegistrationCount, 1, memory_order_relaxed);
+#endif
+    GRMustacheSafeKeysNode *newNode = malloc(sizeof(GRMustacheSafeKeysNode));
+    if (newNode == NULL) {
+        [NSException raise:NSMallocException format:@"Out of memory."];
+    }
+    newNode->klass = klass;
+    newNode->safeKeys = [safeKeys copy];
+    GRMustacheSafeKeysNode *head = atomic_load_explicit(bucket, memory_order_acquire);
+    while (YES) {
+        node = safeKeysNodeInList(head, klass);
+        if (node) {
+            [newNode->safeKeys release];
+            free(newNode);
+            return node->safeKeys;
+        }
+        newNode->next = head;
+        if (atomic_compare_exchange_weak_explicit(bucket, &head, newNode, memory_order_release, memory_order_acquire)) {
+            return newNode->safeKeys;
+        }
+    }
 }
 
 + (NSMutableSet *)propertyGettersForClass:(Class)klass
@@ -21,8 +21,128 @@
 // THE SOFTWARE.
 
 #import <Foundation/Foundation.h>
+#import <stdatomic.h>
 #import "GRMustacheAvailabilityMacros_private.h"
 
+#if !defined(NS_BLOCK_ASSERTIONS)
+// For testing purpose
+// Counters are atomic, since renderings may run concurrently.
+extern BOOL GRMustacheKeyAccessDidCatchNSUndefinedKeyException;
+typedef struct {
+    _Atomic(NSUInteger) accessorResolutionCount;
+    _Atomic(NSUInteger) inlineCacheHitCount;
+    _Atomic(NSUInteger) inlineCacheMissCount;
+    _Atomic(NSUInteger) safeKeysRegistrationCount;
+} GRMustacheKeyAccessStatistics;
+extern GRMustacheKeyAccessStatistics GRMustacheKeyAccessCurrentStatistics;
+#endif
+
+/**
+ * The ways a key accessor extracts a value from an object.
+ *
+ * @see GRMustacheKeyAccessor
+ */
+typedef NS_ENUM(NSInteger, GRMustacheKeyAccessorType) {
+    /**
+     * Nothing could be cached: the full key-fetching logic runs for each
+     * value. This is the case for objects that override
+     * `respondsToSelector:`, such as proxies.
+     */
+    GRMustacheKeyAccessorTypeDynamic = 0,
+    
+    /**
+     * The key is not safe: the value is nil.
+     */
+    GRMustacheKeyAccessorTypeNone,
+    
+    /**
+     * The value is returned by `objectForKeyedSubscript:`.
+     */
+    GRMustacheKeyAccessorTypeKeyedSubscript,
+    
+    /**
+     * The class does not provide the key: the value is nil. This type
+     * prevents NSUndefinedKeyException from being raised and caught.
+     */
+    GRMustacheKeyAccessorTypeMissing,
+    
+    /**
+     * The value is returned by `valueForKey:`, guarded against
+     * NSUndefinedKeyException.
+     */
+    GRMustacheKeyAccessorTypeValueForKey,
+    
+    /**
+     * The value is returned by a getter method which returns an object.
+     */
+    GRMustacheKeyAccessorTypeObjectGetter,
+    
+    /**
+     * The value is the NSNumber built from the scalar returned by a getter
+     * method.
+     */
+    GRMustacheKeyAccessorTypeCharGetter,
+    GRMustacheKeyAccessorTypeIntGetter,
+    GRMustacheKeyAccessorTypeShortGetter,
+    GRMustacheKeyAccessorTypeLongGetter,
+    GRMustacheKeyAccessorTypeLongLongGetter,
+    GRMustacheKeyAccessorTypeUnsignedCharGetter,
+    GRMustacheKeyAccessorTypeUnsignedIntGetter,
+    GRMustacheKeyAccessorTypeUnsignedShortGetter,
+    GRMustacheKeyAccessorTypeUnsignedLongGetter,
+    GRMustacheKeyAccessorTypeUnsignedLongLongGetter,
+    GRMustacheKeyAccessorTypeBoolGetter,
+    GRMustacheKeyAccessorTypeFloatGetter,
+    GRMustacheKeyAccessorTypeDoubleGetter,
+} GRMUSTACHE_API_INTERNAL;
+
+/**
+ * A key accessor is the resolved outcome of the GRMustache key-fetching logic
+ * for a given key, a given class, and a given key access mode: it tells how to
+ * extract the value for the key from instances of the class, without going
+ * through the full logic again.
+ *
+ * Key accessors are created once for each (class, key, mode) triplet, and
+ * live as long as the process: they can be shared by several threads without
+ * any retain or release. The number of accessors of a class is bounded:
+ * beyond, keys get an accessor with a nil class, which runs the full
+ * key-fetching logic, and is never stored in inline caches.
+ *
+ * @see GRMustacheKeyAccessInlineCache
+ */
+typedef struct {
+    Class klass;
+    NSString *key;
+    BOOL unsafeKeyAccess;
+    GRMustacheKeyAccessorType type;
+    SEL selector;
+    IMP implementation;
+} GRMustacheKeyAccessor;
+
+#define GRMustacheKeyAccessInlineCacheSize 4
+
+/**
+ * A polymorphic inline cache holds the key accessors of a single key, for the
+ * last few classes of the objects that were queried for that key.
+ *
+ * Inline caches are held by the tags whose expressions query keys, such as
+ * `{{ name }}` or `{{ user.name }}`, so that repeated renderings of the same
+ * tag over objects of the same shape do not go through the full key-fetching
+ * logic.
+ *
+ * Each slot is an atomic pointer to an immutable and immortal key accessor:
+ * an inline cache can be read and updated concurrently without any lock. A
+ * race may only lose a cache entry, never read a torn one. Cached accessors
+ * are checked against the queried key, so that an inline cache used for the
+ * wrong key only costs cache misses.
+ *
+ * @see GRMustacheKeyAccessor
+ */
+typedef struct {
+    _Atomic(const GRMustacheKeyAccessor *) accessors[GRMustacheKeyAccessInlineCacheSize];
+    atomic_uint nextSlot;
+} GRMustacheKeyAccessInlineCache;
+
 /**
  * GRMustacheKeyAccess implements all the GRMustache key-fetching logic.
  */
@@ -47,4 +167,68 @@
  */
 + (id)valueForMustacheKey:(NSString *)key inObject:(id)object unsafeKeyAccess:(BOOL)unsafeKeyAccess GRMUSTACHE_API_INTERNAL;
 
+/**
+ * Returns the same value as valueForMustacheKey:inObject:unsafeKeyAccess:,
+ * but uses and updates the provided inline cache.
+ *
+ * All calls with a given inline cache must provide the same key.
+ *
+ * @param key              The searched key
+ * @param object           The queried object
+ * @param unsafeKeyAccess  If YES, the `valueForKey:` method will be used
+ *                         without any restriction.
+ * @param inlineCache      An inline cache dedicated to _key_. If NULL, the
+ *                         method behaves exactly like
+ *                         valueForMustacheKey:inObject:unsafeKeyAccess:.
+ *
+ * @return The value that should be handled by Mustache rendering for a given
+ *         key.
+ *
+ * @see GRMustacheKeyAccessInlineCache
+ */
++ (id)valueForMustacheKey:(NSString *)key inObject:(id)object unsafeKeyAccess:(BOOL)unsafeKeyAccess inlineCache:(GRMustacheKeyAccessInlineCache *)inlineCache GRMUSTACHE_API_INTERNAL;
+
+/**
+ * Returns the value for _key_ in _object_ for trusted data.
+ *
+ * The key is not checked against the safe keys of the object, and
+ * NSUndefinedKeyException is not caught: the object is trusted not to raise
+ * for keys it does not provide.
+ *
+ * @param key          The searched key
+ * @param object       The queried object
+ * @param inlineCache  An inline cache dedicated to _key_, or NULL.
+ *
+ * @return The value that should be handled by Mustache rendering for a given
+ *         key.
+ *
+ * @see -[GRMustacheConfiguration rendersTrustedData]
+ */
++ (id)trustedValueForMustacheKey:(NSString *)key inObject:(id)object inlineCache:(GRMustacheKeyAccessInlineCache *)inlineCache GRMUSTACHE_API_INTERNAL;
+
+/**
+ * Returns the key accessor for the class of object, key, and key access mode.
+ *
+ * @param key              The searched key
+ * @param object           An object whose class defines the accessor
+ * @param unsafeKeyAccess  The key access mode
+ *
+ * @return An immortal key accessor, whose class is nil if the registry of
+ *         the class of object is full.
+ */
++ (const GRMustacheKeyAccessor *)accessorForMustacheKey:(NSString *)key inObject:(id)object unsafeKeyAccess:(BOOL)unsafeKeyAccess GRMUSTACHE_API_INTERNAL;
+
+/**
+ * Computes the safe keys of the provided classes, and stores them in the
+ * process-wide registry that is shared by all rendering threads.
+ *
+ * Safe keys are otherwise computed on the first rendering that queries an
+ * instance of each class.
+ *
+ * @param classes  An array of classes.
+ *
+ * @see [GRMustache prewarmSafeKeysForClasses:]
+ */
++ (void)prewarmSafeKeysForClasses:(NSArray *)classes GRMUSTACHE_API_INTERNAL;
+
 @end
@@ -0,0 +1,111 @@
+// The MIT License
+//
+// Copyright (c) 2014 Gwendal Roué
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#import <Foundation/Foundation.h>
+#import "GRMustacheAvailabilityMacros.h"
+
+
+// =============================================================================
+#pragma mark - <GRMustacheOutputSink>
+
+
+/**
+ * The protocol for objects that receive the bytes of a template rendering as
+ * soon as they are produced.
+ *
+ * Output sinks let you render large documents without holding the whole
+ * rendering in memory: the rendering is flushed to the sink by chunks, while
+ * the rest of the template is still rendering.
+ *
+ * The GRMustacheOutputSink class provides sinks for NSOutputStream and file
+ * descriptors.
+ *
+ * @see -[GRMustacheTemplate renderObject:toSink:error:]
+ *
+ * @since v7.4
+ */
+@protocol GRMustacheOutputSink <NSObject>
+
+/**
+ * Writes bytes.
+ *
+ * The bytes are the UTF-8 encoding of a fragment of a template rendering.
+ * Fragment boundaries always fall between two characters.
+ *
+ * @param bytes   A buffer of bytes.
+ * @param length  The length of the buffer.
+ * @param error   If there is an error writing the bytes, upon return contains
+ *                an NSError object that describes the problem.
+ *
+ * @return YES if all bytes could be written, NO otherwise.
+ *
+ * @since v7.4
+ */
+- (BOOL)writeBytes:(const uint8_t *)bytes length:(NSUInteger)length error:(NSError **)error AVAILABLE_GRMUSTACHE_VERSION_7_4_AND_LATER;
+
+@end
+
+
+// =============================================================================
+#pragma mark - GRMustacheOutputSink
+
+/**
+ * The GRMustacheOutputSink class builds output sinks for the most common
+ * destinations of a rendering.
+ *
+ * @see GRMustacheOutputSink protocol
+ *
+ * @since v7.4
+ */
+@interface GRMustacheOutputSink : NSObject
+
+////////////////////////////////////////////////////////////////////////////////
+/// @name Creating Output Sinks
+////////////////////////////////////////////////////////////////////////////////
+
+/**
+ * Returns an output sink that writes into an output stream.
+ *
+ * The stream must be open. It is not closed when the rendering is complete.
+ *
+ * @param outputStream  An open output stream.
+ *
+ * @return An output sink.
+ *
+ * @since v7.4
+ */
++ (id<GRMustacheOutputSink>)outputSinkWithOutputStream:(NSOutputStream *)outputStream AVAILABLE_GRMUSTACHE_VERSION_7_4_AND_LATER;
+
+/**
+ * Returns an output sink that writes into a file descriptor.
+ *
+ * The file descriptor is not closed when the rendering is complete.
+ *
+ * @param fileDescriptor  A file descriptor open for writing.
+ *
+ * @return An output sink.
+ *
+ * @since v7.4
+ */
++ (id<GRMustacheOutputSink>)outputSinkWithFileDescriptor:(int)fileDescriptor AVAILABLE_GRMUSTACHE_VERSION_7_4_AND_LATER;
+
+@end
@@ -0,0 +1,157 @@
+// The MIT License
+//
+// Copyright (c) 2014 Gwendal Roué
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#import <unistd.h>
+#import <errno.h>
+#import "GRMustacheOutputSink_private.h"
+#import "GRMustacheError.h"
+
+
+// =============================================================================
+#pragma mark - Output Sink declarations
+
+
+// GRMustacheOutputStreamSink writes into an NSOutputStream
+
+@interface GRMustacheOutputStreamSink : NSObject<GRMustacheOutputSink> {
+@private
+    NSOutputStream *_outputStream;
+}
+- (instancetype)initWithOutputStream:(NSOutputStream *)outputStream;
+@end
+
+
+// GRMustacheFileDescriptorSink writes into a file descriptor
+
+@interface GRMustacheFileDescriptorSink : NSObject<GRMustacheOutputSink> {
+@private
+    int _fileDescriptor;
+}
+- (instancetype)initWithFileDescriptor:(int)fileDescriptor;
+@end
+
+
+// =============================================================================
+#pragma mark - GRMustacheOutputSink
+
+@implementation GRMustacheOutputSink
+
++ (id<GRMustacheOutputSink>)outputSinkWithOutputStream:(NSOutputStream *)outputStream
+{
+    return [[[GRMustacheOutputStreamSink alloc] initWithOutputStream:outputStream] autorelease];
+}
+
++ (id<GRMustacheOutputSink>)outputSinkWithFileDescriptor:(int)fileDescriptor
+{
+    return [[[GRMustacheFileDescriptorSink alloc] initWithFileDescriptor:fileDescriptor] autorelease];
+}
+
+@end
+
+
+// =============================================================================
+#pragma mark - Output Sink Implementations
+
+@implementation GRMustacheOutputStreamSink
+
+- (void)dealloc
+{
+    [_outputStream release];
+    [super dealloc];
+}
+
+- (instancetype)initWithOutputStream:(NSOutputStream *)outputStream
+{
+    if (outputStream == nil) {
+        [NSException raise:NSInvalidArgumentException format:@"Can't build an output sink with a nil output stream."];
+    }
+    
+    self = [super init];
+    if (self) {
+        _outputStream = [outputStream retain];
+    }
+    return self;
+}
+
+- (BOOL)writeBytes:(const uint8_t *)bytes length:(NSUInteger)length error:(NSError **)error
+{
+    while (length > 0) {
+        NSInteger written = [_outputStream write:bytes maxLength:length];
+        if (written < 0) {
+            if (error != NULL) {
+                *error = [_outputStream streamError];
+            }
+            return NO;
+        }
+        if (written == 0) {
+            // Fixed-length stream has reached its capacity
+            if (error != NULL) {
+                *error = [NSError errorWithDomain:GRMustacheErrorDomain
+                                             code:GRMustacheErrorCodeRenderingError
+                                         userInfo:[NSDictionary dictionaryWithObject:@"Output stream has reached its capacity" forKey:NSLocalizedDescriptionKey]];
+            }
+            return NO;
+        }
+        bytes += written;
+        length -= written;
+    }
+    return YES;
+}
+
+@end
+
+
+@implementation GRMustacheFileDescriptorSink
+
+- (instancetype)initWithFileDescriptor:(int)fileDescriptor
+{
+    if (fileDescriptor < 0) {
+        [NSException raise:NSInvalidArgumentException format:@"Can't build an output sink with an invalid file descriptor."];
+    }
+    
+    self = [super init];
+    if (self) {
+        _fileDescriptor = fileDescriptor;
+    }
+    return self;
+}
+
+- (BOOL)writeBytes:(const uint8_t *)bytes length:(NSUInteger)length error:(NSError **)error
+{
+    while (length > 0) {
+        ssize_t written = write(_fileDescriptor, bytes, length);
+        if (written < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            if (error != NULL) {
+                *error = [NSError errorWithDomain:NSPOSIXErrorDomain code:errno userInfo:nil];
+            }
+            return NO;
+        }
+        bytes += written;
+        length -= written;
+    }
+    return YES;
+}
+
+@end
@@ -24,11 +24,14 @@
 #import <pthread.h>
 #import "GRMustacheRendering_private.h"
 #import "GRMustacheTag_private.h"
+#import "GRMustacheSectionTag_private.h"
+#import "GRMustacheRenderingEngine_private.h"
 #import "GRMustacheConfiguration_private.h"
 #import "GRMustacheContext_private.h"
 #import "GRMustacheError.h"
 #import "GRMustacheTemplateRepository_private.h"
 #import "GRMustacheBuffer_private.h"
+#import "GRMustacheTranslateCharacters_private.h"
 
 
 // =============================================================================
@@ -37,7 +40,7 @@
 
 // GRMustacheNilRendering renders for nil
 
-@interface GRMustacheNilRendering : NSObject<GRMustacheRenderingWithIterationSupport>
+@interface GRMustacheNilRendering : NSObject<GRMustacheRenderingWithBufferSupport>
 @end
 static GRMustacheNilRendering *nilRendering;
 
@@ -65,6 +68,17 @@ static NSString *GRMustacheRenderWithIterationSupportNSString(NSString *self, SE
 static NSString *GRMustacheRenderWithIterationSupportNSObject(NSObject *self, SEL _cmd, GRMustacheTag *tag, BOOL enumerationItem, GRMustacheContext *context, BOOL *HTMLSafe, NSError **error);
 static NSString *GRMustacheRenderWithIterationSupportNSFastEnumeration(id<NSFastEnumeration> self, SEL _cmd, GRMustacheTag *tag, BOOL enumerationItem, GRMustacheContext *context, BOOL *HTMLSafe, NSError **error);
 
+typedef BOOL (*GRMustacheRenderIntoBufferIMP)(id self, SEL _cmd, GRMustacheTag *tag, BOOL enumerationItem, GRMustacheContext *context, GRMustacheBuffer *buffer, BOOL escapesHTML, BOOL *HTMLSafe, NSError **error);
+static BOOL GRMustacheRenderIntoBufferGeneric(id self, SEL _cmd, GRMustacheTag *tag, BOOL enumerationItem, GRMustacheContext *context, GRMustacheBuffer *buffer, BOOL escapesHTML, BOOL *HTMLSafe, NSError **error);
+static BOOL GRMustacheRenderIntoBufferNSNull(NSNull *self, SEL _cmd, GRMustacheTag *tag, BOOL enumerationItem, GRMustacheContext *context, GRMustacheBuffer *buffer, BOOL escapesHTML, BOOL *HTMLSafe, NSError **error);
+static BOOL GRMustacheRenderIntoBufferNSNumber(NSNumber *self, SEL _cmd, GRMustacheTag *tag, BOOL enumerationItem, GRMustacheContext *context, GRMustacheBuffer *buffer, BOOL escapesHTML, BOOL *HTMLSafe, NSError **error);
+static BOOL GRMustacheRenderIntoBufferNSString(NSString *self, SEL _cmd, GRMustacheTag *tag, BOOL enumerationItem, GRMustacheContext *context, GRMustacheBuffer *buffer, BOOL escapesHTML, BOOL *HTMLSafe, NSError **error);
+static BOOL GRMustacheRenderIntoBufferNSObject(NSObject *self, SEL _cmd, GRMustacheTag *tag, BOOL enumerationItem, GRMustacheContext *context, GRMustacheBuffer *buffer, BOOL escapesHTML, BOOL *HTMLSafe, NSError **error);
+static BOOL GRMustacheRenderIntoBufferNSFastEnumeration(id<NSFastEnumeration> self, SEL _cmd, GRMustacheTag *tag, BOOL enumerationItem, GRMustacheContext *context, GRMustacheBuffer *buffer, BOOL escapesHTML, BOOL *HTMLSafe, NSError **error);
+
+static BOOL GRMustacheRenderingObjectSupportsBuffer(id renderingObject, BOOL enumerationItem);
+static void GRMustacheBufferAppendRendering(GRMustacheBuffer *buffer, NSString *rendering, BOOL escapesHTML);
+
 typedef BOOL (*GRMustacheBoolValueIMP)(id self, SEL _cmd);
 static BOOL GRMustacheBoolValueGeneric(id self, SEL _cmd);
 static BOOL GRMustacheBoolValueNSNull(NSNull *self, SEL _cmd);
@@ -124,11 +138,11 @@ void freeCurrentContentTypeStack(void *objects) {
     // Other classes will be dynamically attached their rendering implementation
     // in the GRMustacheRenderWithIterationSupportGeneric implementation
     // attached to NSObject.
-    [self registerRenderWithIterationSupportIMP:GRMustacheRenderWithIterationSupportNSNull   boolValueIMP:GRMustacheBoolValueNSNull   forClass:[NSNull class]];
-    [self registerRenderWithIterationSupportIMP:GRMustacheRenderWithIterationSupportNSNumber boolValueIMP:GRMustacheBoolValueNSNumber forClass:[NSNumber class]];
-    [self registerRenderWithIterationSupportIMP:GRMustacheRenderWithIterationSupportNSString boolValueIMP:GRMustacheBoolValueNSString forClass:[NSString class]];
-    [self registerRenderWithIterationSupportIMP:GRMustacheRenderWithIterationSupportNSObject boolValueIMP:GRMustacheBoolValueNSObject forClass:[NSDictionary class]];
-    [self registerRenderWithIterationSupportIMP:GRMustacheRenderWithIterationSupportGeneric  boolValueIMP:GRMustacheBoolValueGeneric  forClass:[NSObject class]];
+    [self registerRenderWithIterationSupportIMP:GRMustacheRenderWithIterationSupportNSNull   renderIntoBufferIMP:GRMustacheRenderIntoBufferNSNull   boolValueIMP:GRMustacheBoolValueNSNull   forClass:[NSNull class]];
+    [self registerRenderWithIterationSupportIMP:GRMustacheRenderWithIterationSupportNSNumber renderIntoBufferIMP:GRMustacheRenderIntoBufferNSNumber boolValueIMP:GRMustacheBoolValueNSNumber forClass:[NSNumber class]];
+    [self registerRenderWithIterationSupportIMP:GRMustacheRenderWithIterationSupportNSString renderIntoBufferIMP:GRMustacheRenderIntoBufferNSString boolValueIMP:GRMustacheBoolValueNSString forClass:[NSString class]];
+    [self registerRenderWithIterationSupportIMP:GRMustacheRenderWithIterationSupportNSObject renderIntoBufferIMP:GRMustacheRenderIntoBufferNSObject boolValueIMP:GRMustacheBoolValueNSObject forClass:[NSDictionary class]];
+    [self registerRenderWithIterationSupportIMP:GRMustacheRenderWithIterationSupportGeneric  renderIntoBufferIMP:GRMustacheRenderIntoBufferGeneric  boolValueIMP:GRMustacheBoolValueGeneric  forClass:[NSObject class]];
     
     // Besides, provide all objects the ability to render as an enumeration item
     // or not through GRMustacheRenderGeneric:
@@ -147,6 +161,78 @@ void freeCurrentContentTypeStack(void *objects) {
     return [[[GRMustacheBlockRendering alloc] initWithRenderingBlock:renderingBlock] autorelease];
 }
 
++ (BOOL)renderObject:(id)renderingObject forMustacheTag:(GRMustacheTag *)tag asEnumerationItem:(BOOL)enumerationItem context:(GRMustacheContext *)context intoBuffer:(GRMustacheBuffer *)buffer escapesHTML:(BOOL)escapesHTML HTMLSafe:(BOOL *)HTMLSafe error:(NSError **)error
+{
+    if (GRMustacheRenderingObjectSupportsBuffer(renderingObject, enumerationItem)) {
+        return [(id<GRMustacheRenderingWithBufferSupport>)renderingObject renderForMustacheTag:tag asEnumerationItem:enumerationItem context:context intoBuffer:buffer escapesHTML:escapesHTML HTMLSafe:HTMLSafe error:error];
+    }
+    
+    // Custom rendering object: use the string-returning API.
+    //
+    // User code may keep the context: don't give it a context frame.
+    
+    context = [context materializedContext];
+    
+    NSString *rendering = nil;
+    NSError *renderingError = nil;  // Default nil, so that we can help lazy coders who return nil as a valid rendering.
+    BOOL renderingHTMLSafe = NO;    // Default NO, so that we assume unsafe rendering from lazy coders who do not explicitly set it.
+    if (enumerationItem) {
+        rendering = [renderingObject renderForMustacheTag:tag asEnumerationItem:YES context:context HTMLSafe:&renderingHTMLSafe error:&renderingError];
+    } else {
+        rendering = [renderingObject renderForMustacheTag:tag context:context HTMLSafe:&renderingHTMLSafe error:&renderingError];
+    }
+    
+    if (!rendering) {
+        if (renderingError) {
+            if (error != NULL) {
+                *error = renderingError;
+            }
+            return NO;
+        }
+        
+        // Rendering is nil, but rendering error is not set.
+        //
+        // Assume a rendering object coded by a lazy programmer, whose
+        // intention is to render nothing.
+        
+        rendering = @"";
+    }
+    
+    if (HTMLSafe != NULL) {
+        *HTMLSafe = renderingHTMLSafe;
+    }
+    GRMustacheBufferAppendRendering(buffer, rendering, escapesHTML && !renderingHTMLSafe);
+    return YES;
+}
+
++ (GRMustacheRenderingObjectKind)kindOfRenderingObject:(id)renderingObject asEnumerationItem:(BOOL)enumerationItem
+{
+    if (renderingObject == nilRendering) {
+        return GRMustacheRenderingObjectKindNull;
+    }
+    
+    if (!GRMustacheRenderingObjectSupportsBuffer(renderingObject, enumerationItem)) {
+        return GRMustacheRenderingObjectKindCustom;
+    }
+    
+    IMP renderIMP = class_getMethodImplementation(object_getClass(renderingObject), @selector(renderForMustacheTag:asEnumerationItem:context:HTMLSafe:error:));
+    if (renderIMP == (IMP)GRMustacheRenderWithIterationSupportNSNull) {
+        return GRMustacheRenderingObjectKindNull;
+    } else if (renderIMP == (IMP)GRMustacheRenderWithIterationSupportNSNumber) {
+        return GRMustacheRenderingObjectKindNumber;
+    } else if (renderIMP == (IMP)GRMustacheRenderWithIterationSupportNSString) {
+        return GRMustacheRenderingObjectKindString;
+    } else if (renderIMP == (IMP)GRMustacheRenderWithIterationSupportNSObject) {
+        return GRMustacheRenderingObjectKindObject;
+    } else if (renderIMP == (IMP)GRMustacheRenderWithIterationSupportNSFastEnumeration) {
+        return GRMustacheRenderingObjectKindEnumeration;
+    }
+    
+    // GRMustacheRenderWithIterationSupportGeneric: the class has not rendered
+    // yet, and will register its rendering implementation on first use.
+    return GRMustacheRenderingObjectKindCustom;
+}
+
 
 #pragma mark - Current Template Repository
 
@@ -209,17 +295,21 @@ void freeCurrentContentTypeStack(void *objects) {
 
 /**
  * Have the class _aClass_ conform to the
- * GRMustacheRenderingWithIterationSupport protocol.
+ * GRMustacheRenderingWithBufferSupport protocol.
  *
- * @param renderIMP     the implementation of the
- *                      renderForMustacheTag:asEnumerationItem:context:HTMLSafe:error:
- *                      method.
- * @param boolValueIMP  the implementation of the mustacheBoolValue method.
- * @param aClass        the class to modify.
+ * @param renderIMP            the implementation of the
+ *                             renderForMustacheTag:asEnumerationItem:context:HTMLSafe:error:
+ *                             method.
+ * @param renderIntoBufferIMP  the implementation of the
+ *                             renderForMustacheTag:asEnumerationItem:context:intoBuffer:escapesHTML:HTMLSafe:error:
+ *                             method.
+ * @param boolValueIMP         the implementation of the mustacheBoolValue
+ *                             method.
+ * @param aClass               the class to modify.
  */
-+ (void)registerRenderWithIterationSupportIMP:(GRMustacheRenderWithIterationSupportIMP)renderIMP boolValueIMP:(GRMustacheBoolValueIMP)boolValueIMP forClass:(Class)klass
++ (void)registerRenderWithIterationSupportIMP:(GRMustacheRenderWithIterationSupportIMP)renderIMP renderIntoBufferIMP:(GRMustacheRenderIntoBufferIMP)renderIntoBufferIMP boolValueIMP:(GRMustacheBoolValueIMP)boolValueIMP forClass:(Class)klass
 {
-    Protocol *protocol = @protocol(GRMustacheRenderingWithIterationSupport);
+    Protocol *protocol = @protocol(GRMustacheRenderingWithBufferSupport);
     
     // Add method implementations
     
@@ -229,6 +319,12 @@ void freeCurrentContentTypeStack(void *objects) {
         class_addMethod(klass, selector, (IMP)renderIMP, methodDescription.types);
     }
     
+    {
+        SEL selector = @selector(renderForMustacheTag:asEnumerationItem:context:intoBuffer:escapesHTML:HTMLSafe:error:);
+        struct objc_method_description methodDescription = protocol_getMethodDescription(protocol, selector, YES, YES);
+        class_addMethod(klass, selector, (IMP)renderIntoBufferIMP, methodDescription.types);
+    }
+    
     {
         SEL selector = @selector(mustacheBoolValue);
         struct objc_method_description methodDescription = protocol_getMethodDescription(protocol, selector, YES, YES);
@@ -294,6 +390,20 @@ void freeCurrentContentTypeStack(void *objects) {
     }
 }
 
+- (BOOL)renderForMustacheTag:(GRMustacheTag *)tag asEnumerationItem:(BOOL)enumerationItem context:(GRMustacheContext *)context intoBuffer:(GRMustacheBuffer *)buffer escapesHTML:(BOOL)escapesHTML HTMLSafe:(BOOL *)HTMLSafe error:(NSError **)error
+{
+    switch (tag.type) {
+        case GRMustacheTagTypeVariable:
+            // {{ nil }}
+            return YES;
+            
+        case GRMustacheTagTypeSection:
+            // {{# nil }}...{{/}}
+            // {{^ nil }}...{{/}}
+            return [tag renderContentWithContext:context intoBuffer:buffer escapesHTML:escapesHTML HTMLSafe:HTMLSafe error:error];
+    }
+}
+
 @end
 
 
@@ -344,14 +454,14 @@ static BOOL GRMustacheBoolValueGeneric(id self, SEL _cmd)
     if ([self respondsToSelector:@selector(countByEnumeratingWithState:objects:count:)])
     {
         // Future invocations will use GRMustacheBoolValueNSFastEnumeration
-        [GRMustacheRendering registerRenderWithIterationSupportIMP:GRMustacheRenderWithIterationSupportNSFastEnumeration boolValueIMP:GRMustacheBoolValueNSFastEnumeration forClass:klass];
+        [GRMustacheRendering registerRenderWithIterationSupportIMP:GRMustacheRenderWithIterationSupportNSFastEnumeration renderIntoBufferIMP:GRMustacheRenderIntoBufferNSFastEnumeration boolValueIMP:GRMustacheBoolValueNSFastEnumeration forClass:klass];
         return GRMustacheBoolValueNSFastEnumeration(self, _cmd);
     }
     
     if (klass != [NSObject class])
     {
         // Future invocations will use GRMustacheRenderNSObject
-        [GRMustacheRendering registerRenderWithIterationSupportIMP:GRMustacheRenderWithIterationSupportNSObject boolValueIMP:GRMustacheBoolValueNSObject forClass:klass];
+        [GRMustacheRendering registerRenderWithIterationSupportIMP:GRMustacheRenderWithIterationSupportNSObject renderIntoBufferIMP:GRMustacheRenderIntoBufferNSObject boolValueIMP:GRMustacheBoolValueNSObject forClass:klass];
     }
     
     return GRMustacheBoolValueNSObject(self, _cmd);
@@ -370,14 +480,14 @@ static NSString *GRMustacheRenderWithIterationSupportGeneric(id self, SEL _cmd,
     if ([self respondsToSelector:@selector(countByEnumeratingWithState:objects:count:)])
     {
         // Future invocations will use GRMustacheRenderNSFastEnumeration
-        [GRMustacheRendering registerRenderWithIterationSupportIMP:GRMustacheRenderWithIterationSupportNSFastEnumeration boolValueIMP:GRMustacheBoolValueNSFastEnumeration forClass:klass];
+        [GRMustacheRendering registerRenderWithIterationSupportIMP:GRMustacheRenderWithIterationSupportNSFastEnumeration renderIntoBufferIMP:GRMustacheRenderIntoBufferNSFastEnumeration boolValueIMP:GRMustacheBoolValueNSFastEnumeration forClass:klass];
         return GRMustacheRenderWithIterationSupportNSFastEnumeration(self, _cmd, tag, enumerationItem, context, HTMLSafe, error);
     }
     
     if (klass != [NSObject class])
     {
         // Future invocations will use GRMustacheRenderWithIterationSupportNSObject
-        [GRMustacheRendering registerRenderWithIterationSupportIMP:GRMustacheRenderWithIterationSupportNSObject boolValueIMP:GRMustacheBoolValueNSObject forClass:klass];
+        [GRMustacheRendering registerRenderWithIterationSupportIMP:GRMustacheRenderWithIterationSupportNSObject renderIntoBufferIMP:GRMustacheRenderIntoBufferNSObject boolValueIMP:GRMustacheBoolValueNSObject forClass:klass];
     }
     
     return GRMustacheRenderWithIterationSupportNSObject(self, _cmd, tag, enumerationItem, context, HTMLSafe, error);
@@ -397,9 +507,9 @@ static NSString *GRMustacheRenderWithIterationSupportNSNull(NSNull *self, SEL _c
             
         case GRMustacheTagTypeSection:
             if (enumerationItem) {
-                context = [context newContextByAddingObject:self];
+                context = [context pushContextFrameWithObject:self];
                 NSString *rendering = [tag renderContentWithContext:context HTMLSafe:HTMLSafe error:error];
-                [context release];
+                [context popContextFrame];
                 return rendering;
             } else {
                 // {{^ null }}...{{/}}
@@ -427,9 +537,9 @@ static NSString *GRMustacheRenderWithIterationSupportNSNumber(NSNumber *self, SE
             
         case GRMustacheTagTypeSection:
             if (enumerationItem) {
-                context = [context newContextByAddingObject:self];
+                context = [context pushContextFrameWithObject:self];
                 NSString *rendering = [tag renderContentWithContext:context HTMLSafe:HTMLSafe error:error];
-                [context release];
+                [context popContextFrame];
                 return rendering;
             } else {
                 // {{^ number }}...{{/}}
@@ -468,9 +578,9 @@ static NSString *GRMustacheRenderWithIterationSupportNSString(NSString *self, SE
                 return [tag renderContentWithContext:context HTMLSafe:HTMLSafe error:error];
             } else {
                 // {{# string }}...{{/}}
-                context = [context newContextByAddingObject:self];
+                context = [context pushContextFrameWithObject:self];
                 NSString *rendering = [tag renderContentWithContext:context HTMLSafe:HTMLSafe error:error];
-                [context release];
+                [context popContextFrame];
                 return rendering;
             }
     }
@@ -494,9 +604,9 @@ static NSString *GRMustacheRenderWithIterationSupportNSObject(NSObject *self, SE
         case GRMustacheTagTypeSection:
             // {{# object }}...{{/}}
             // {{^ object }}...{{/}}
-            context = [context newContextByAddingObject:self];
+            context = [context pushContextFrameWithObject:self];
             NSString *rendering = [tag renderContentWithContext:context HTMLSafe:HTMLSafe error:error];
-            [context release];
+            [context popContextFrame];
             return rendering;
     }
 }
@@ -512,9 +622,9 @@ static BOOL GRMustacheBoolValueNSFastEnumeration(id<NSFastEnumeration> self, SEL
 static NSString *GRMustacheRenderWithIterationSupportNSFastEnumeration(id<NSFastEnumeration> self, SEL _cmd, GRMustacheTag *tag, BOOL enumerationItem, GRMustacheContext *context, BOOL *HTMLSafe, NSError **error)
 {
     if (enumerationItem) {
-        context = [context newContextByAddingObject:self];
+        context = [context pushContextFrameWithObject:self];
         NSString *rendering = [tag renderContentWithContext:context HTMLSafe:HTMLSafe error:error];
-        [context release];
+        [context popContextFrame];
         return rendering;
     }
     
@@ -527,10 +637,17 @@ static NSString *GRMustacheRenderWithIterationSupportNSFastEnumeration(id<NSFast
     GRMustacheBuffer buffer;
     BOOL anyItemHTMLSafe = NO;
     BOOL anyItemHTMLUnsafe = NO;
+    BOOL checksHTMLEscapingConsistency = !context.trustedData;
     
     for (id item in self) {
         if (!bufferCreated) {
-            buffer = GRMustacheBufferCreate(1024);
+            // Each item renders the content of the section.
+            GRMustacheTemplateAST *itemTemplateAST = nil;
+            if (tag.type == GRMustacheTagTypeSection) {
+                itemTemplateAST = [(GRMustacheSectionTag *)tag innerTemplateAST];
+            }
+            NSUInteger count = [(id)self respondsToSelector:@selector(count)] ? [(id)self count] : 1;
+            buffer = GRMustacheBufferCreate(GRMustacheRenderingEngineInitialCapacity(itemTemplateAST, count));
             bufferCreated = YES;
         }
         @autoreleasepool {
@@ -538,7 +655,13 @@ static NSString *GRMustacheRenderWithIterationSupportNSFastEnumeration(id<NSFast
             
             BOOL itemHTMLSafe = NO; // always assume unsafe rendering
             NSError *renderingError = nil;
-            NSString *rendering = [[GRMustacheRendering renderingObjectForObject:item] renderForMustacheTag:tag asEnumerationItem:YES context:context HTMLSafe:&itemHTMLSafe error:&renderingError];
+            id renderingObject = [GRMustacheRendering renderingObjectForObject:item];
+            GRMustacheContext *itemContext = context;
+            if (!GRMustacheRenderingObjectSupportsBuffer(renderingObject, YES)) {
+                // Custom rendering object: don't give it a context frame.
+                itemContext = [context materializedContext];
+            }
+            NSString *rendering = [renderingObject renderForMustacheTag:tag asEnumerationItem:YES context:itemContext HTMLSafe:&itemHTMLSafe error:&renderingError];
             
             if (!rendering) {
                 if (!renderingError) {
@@ -559,16 +682,16 @@ static NSString *GRMustacheRenderWithIterationSupportNSFastEnumeration(id<NSFast
                 }
             }
             
-            // check consistency of HTML escaping
+            // check consistency of HTML escaping, unless data is trusted
             
             if (itemHTMLSafe) {
                 anyItemHTMLSafe = YES;
-                if (anyItemHTMLUnsafe) {
+                if (anyItemHTMLUnsafe && checksHTMLEscapingConsistency) {
                     [NSException raise:GRMustacheRenderingException format:@"Inconsistant HTML escaping of items in enumeration"];
                 }
             } else {
                 anyItemHTMLUnsafe = YES;
-                if (anyItemHTMLSafe) {
+                if (anyItemHTMLSafe && checksHTMLEscapingConsistency) {
                     [NSException raise:GRMustacheRenderingException format:@"Inconsistant HTML escaping of items in enumeration"];
                 }
             }
@@ -606,3 +729,239 @@ static NSString *GRMustacheRenderWithIterationSupportNSFastEnumeration(id<NSFast
         }
     }
 }
+
+
+// =============================================================================
+#pragma mark - Buffer Rendering Implementations
+
+static BOOL GRMustacheRenderingObjectSupportsBuffer(id renderingObject, BOOL enumerationItem)
+{
+    if (renderingObject == nilRendering) {
+        return YES;
+    }
+    
+    // Objects which provide their own rendering (custom rendering objects,
+    // templates, etc.) must render through the string-returning API.
+    
+    Class klass = object_getClass(renderingObject);
+    if (!enumerationItem && class_getMethodImplementation(klass, @selector(renderForMustacheTag:context:HTMLSafe:error:)) != (IMP)GRMustacheRenderGeneric) {
+        return NO;
+    }
+    
+    IMP renderIMP = class_getMethodImplementation(klass, @selector(renderForMustacheTag:asEnumerationItem:context:HTMLSafe:error:));
+    return (renderIMP == (IMP)GRMustacheRenderWithIterationSupportGeneric ||
+            renderIMP == (IMP)GRMustacheRenderWithIterationSupportNSObject ||
+            renderIMP == (IMP)GRMustacheRenderWithIterationSupportNSString ||
+            renderIMP == (IMP)GRMustacheRenderWithIterationSupportNSNumber ||
+            renderIMP == (IMP)GRMustacheRenderWithIterationSupportNSNull ||
+            renderIMP == (IMP)GRMustacheRenderWithIterationSupportNSFastEnumeration);
+}
+
+static void GRMustacheBufferAppendRendering(GRMustacheBuffer *buffer, NSString *rendering, BOOL escapesHTML)
+{
+    if (escapesHTML) {
+        GRMustacheBufferAppendHTMLEscapedString(buffer, rendering);
+    } else {
+        GRMustacheBufferAppendString(buffer, rendering);
+    }
+}
+
+static BOOL GRMustacheRenderIntoBufferGeneric(id self, SEL _cmd, GRMustacheTag *tag, BOOL enumerationItem, GRMustacheContext *context, GRMustacheBuffer *buffer, BOOL escapesHTML, BOOL *HTMLSafe, NSError **error)
+{
+    // Self doesn't know (yet) how to render into a buffer
+    
+    Class klass = object_getClass(self);
+    if ([self respondsToSelector:@selector(countByEnumeratingWithState:objects:count:)])
+    {
+        // Future invocations will use GRMustacheRenderIntoBufferNSFastEnumeration
+        [GRMustacheRendering registerRenderWithIterationSupportIMP:GRMustacheRenderWithIterationSupportNSFastEnumeration renderIntoBufferIMP:GRMustacheRenderIntoBufferNSFastEnumeration boolValueIMP:GRMustacheBoolValueNSFastEnumeration forClass:klass];
+        return GRMustacheRenderIntoBufferNSFastEnumeration(self, _cmd, tag, enumerationItem, context, buffer, escapesHTML, HTMLSafe, error);
+    }
+    
+    if (klass != [NSObject class])
+    {
+        // Future invocations will use GRMustacheRenderIntoBufferNSObject
+        [GRMustacheRendering registerRenderWithIterationSupportIMP:GRMustacheRenderWithIterationSupportNSObject renderIntoBufferIMP:GRMustacheRenderIntoBufferNSObject boolValueIMP:GRMustacheBoolValueNSObject forClass:klass];
+    }
+    
+    return GRMustacheRenderIntoBufferNSObject(self, _cmd, tag, enumerationItem, context, buffer, escapesHTML, HTMLSafe, error);
+}
+
+static BOOL GRMustacheRenderIntoBufferNSNull(NSNull *self, SEL _cmd, GRMustacheTag *tag, BOOL enumerationItem, GRMustacheContext *context, GRMustacheBuffer *buffer, BOOL escapesHTML, BOOL *HTMLSafe, NSError **error)
+{
+    switch (tag.type) {
+        case GRMustacheTagTypeVariable:
+            // {{ null }}
+            return YES;
+            
+        case GRMustacheTagTypeSection:
+            if (enumerationItem) {
+                context = [context pushContextFrameWithObject:self];
+                BOOL success = [tag renderContentWithContext:context intoBuffer:buffer escapesHTML:escapesHTML HTMLSafe:HTMLSafe error:error];
+                [context popContextFrame];
+                return success;
+            } else {
+                // {{^ null }}...{{/}}
+                // {{# null }}...{{/}}
+                return [tag renderContentWithContext:context intoBuffer:buffer escapesHTML:escapesHTML HTMLSafe:HTMLSafe error:error];
+            }
+    }
+}
+
+static BOOL GRMustacheRenderIntoBufferNSNumber(NSNumber *self, SEL _cmd, GRMustacheTag *tag, BOOL enumerationItem, GRMustacheContext *context, GRMustacheBuffer *buffer, BOOL escapesHTML, BOOL *HTMLSafe, NSError **error)
+{
+    switch (tag.type) {
+        case GRMustacheTagTypeVariable:
+            // {{ number }}
+            if (HTMLSafe != NULL) {
+                *HTMLSafe = NO;
+            }
+            GRMustacheBufferAppendRendering(buffer, [self description], escapesHTML);
+            return YES;
+            
+        case GRMustacheTagTypeSection:
+            if (enumerationItem) {
+                context = [context pushContextFrameWithObject:self];
+                BOOL success = [tag renderContentWithContext:context intoBuffer:buffer escapesHTML:escapesHTML HTMLSafe:HTMLSafe error:error];
+                [context popContextFrame];
+                return success;
+            } else {
+                // {{^ number }}...{{/}}
+                // {{# number }}...{{/}}
+                //
+                // Numbers do not enter the context stack: see
+                // GRMustacheRenderWithIterationSupportNSNumber.
+                return [tag renderContentWithContext:context intoBuffer:buffer escapesHTML:escapesHTML HTMLSafe:HTMLSafe error:error];
+            }
+    }
+}
+
+static BOOL GRMustacheRenderIntoBufferNSString(NSString *self, SEL _cmd, GRMustacheTag *tag, BOOL enumerationItem, GRMustacheContext *context, GRMustacheBuffer *buffer, BOOL escapesHTML, BOOL *HTMLSafe, NSError **error)
+{
+    switch (tag.type) {
+        case GRMustacheTagTypeVariable:
+            // {{ string }}
+            if (HTMLSafe != NULL) {
+                *HTMLSafe = NO;
+            }
+            GRMustacheBufferAppendRendering(buffer, self, escapesHTML);
+            return YES;
+            
+        case GRMustacheTagTypeSection:
+            if (tag.isInverted) {
+                // {{^ string }}...{{/}}
+                return [tag renderContentWithContext:context intoBuffer:buffer escapesHTML:escapesHTML HTMLSafe:HTMLSafe error:error];
+            } else {
+                // {{# string }}...{{/}}
+                context = [context pushContextFrameWithObject:self];
+                BOOL success = [tag renderContentWithContext:context intoBuffer:buffer escapesHTML:escapesHTML HTMLSafe:HTMLSafe error:error];
+                [context popContextFrame];
+                return success;
+            }
+    }
+}
+
+static BOOL GRMustacheRenderIntoBufferNSObject(NSObject *self, SEL _cmd, GRMustacheTag *tag, BOOL enumerationItem, GRMustacheContext *context, GRMustacheBuffer *buffer, BOOL escapesHTML, BOOL *HTMLSafe, NSError **error)
+{
+    switch (tag.type) {
+        case GRMustacheTagTypeVariable:
+            // {{ object }}
+            if (HTMLSafe != NULL) {
+                *HTMLSafe = NO;
+            }
+            GRMustacheBufferAppendRendering(buffer, [self description], escapesHTML);
+            return YES;
+            
+        case GRMustacheTagTypeSection: {
+            // {{# object }}...{{/}}
+            // {{^ object }}...{{/}}
+            context = [context pushContextFrameWithObject:self];
+            BOOL success = [tag renderContentWithContext:context intoBuffer:buffer escapesHTML:escapesHTML HTMLSafe:HTMLSafe error:error];
+            [context popContextFrame];
+            return success;
+        }
+    }
+}
+
+static BOOL GRMustacheRenderIntoBufferNSFastEnumeration(id<NSFastEnumeration> self, SEL _cmd, GRMustacheTag *tag, BOOL enumerationItem, GRMustacheContext *context, GRMustacheBuffer *buffer, BOOL escapesHTML, BOOL *HTMLSafe, NSError **error)
+{
+    if (enumerationItem) {
+        context = [context pushContextFrameWithObject:self];
+        BOOL success = [tag renderContentWithContext:context intoBuffer:buffer escapesHTML:escapesHTML HTMLSafe:HTMLSafe error:error];
+        [context popContextFrame];
+        return success;
+    }
+    
+    // {{ list }}
+    // {{# list }}...{{/}}
+    // {{^ list }}...{{/}}
+    //
+    // Items are rendered in place, and escaped one after the other. This is
+    // equivalent to escaping the whole list, since all items must have the
+    // same HTML-safety.
+    
+    BOOL success = YES;
+    BOOL empty = YES;
+    BOOL anyItemHTMLSafe = NO;
+    BOOL anyItemHTMLUnsafe = NO;
+    BOOL checksHTMLEscapingConsistency = !context.trustedData;
+    
+    for (id item in self) {
+        empty = NO;
+        @autoreleasepool {
+            // Render item
+            
+            BOOL itemHTMLSafe = NO; // always assume unsafe rendering
+            NSError *renderingError = nil;
+            if (![GRMustacheRendering renderObject:[GRMustacheRendering renderingObjectForObject:item] forMustacheTag:tag asEnumerationItem:YES context:context intoBuffer:buffer escapesHTML:escapesHTML HTMLSafe:&itemHTMLSafe error:&renderingError]) {
+                if (error != NULL) {
+                    // make sure error is not released by autoreleasepool
+                    *error = renderingError;
+                    [*error retain];
+                }
+                success = NO;
+                break;
+            }
+            
+            // check consistency of HTML escaping, unless data is trusted
+            
+            if (itemHTMLSafe) {
+                anyItemHTMLSafe = YES;
+                if (anyItemHTMLUnsafe && checksHTMLEscapingConsistency) {
+                    [NSException raise:GRMustacheRenderingException format:@"Inconsistant HTML escaping of items in enumeration"];
+                }
+            } else {
+                anyItemHTMLUnsafe = YES;
+                if (anyItemHTMLSafe && checksHTMLEscapingConsistency) {
+                    [NSException raise:GRMustacheRenderingException format:@"Inconsistant HTML escaping of items in enumeration"];
+                }
+            }
+        }
+    }
+    
+    if (!success) {
+        if (error != NULL) [*error autorelease];
+        return NO;
+    }
+    
+    if (!empty) {
+        // Non-empty list
+        
+        if (HTMLSafe != NULL) {
+            *HTMLSafe = !anyItemHTMLUnsafe;
+        }
+        return YES;
+    } else {
+        // Empty list
+        
+        switch (tag.type) {
+            case GRMustacheTagTypeVariable:
+                // {{ emptyList }}
+                return YES;
+                
+            case GRMustacheTagTypeSection:
+                // {{^ emptyList }}...{{/}}
+                return [tag renderContentWithContext:context intoBuffer:buffer escapesHTML:escapesHTML HTMLSafe:HTMLSafe error:error];
+        }
+    }
+}
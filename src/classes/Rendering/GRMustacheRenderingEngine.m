@@ -20,7 +20,6 @@
 // OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
 // THE SOFTWARE.
 
-#import <pthread.h>
 #import "GRMustacheRenderingEngine_private.h"
 #import "GRMustacheTemplateASTVisitor_private.h"
 #import "GRMustacheTemplateAST_private.h"
@@ -35,36 +34,59 @@
 #import "GRMustacheInheritableSectionNode_private.h"
 #import "GRMustachePartialNode_private.h"
 #import "GRMustacheTextNode_private.h"
+#import "GRMustachePrecompiledNode_private.h"
+#import "GRMustacheTemplateProgram_private.h"
 #import "GRMustacheTagDelegate.h"
 #import "GRMustacheExpressionInvocation_private.h"
+#import "GRMustacheError.h"
+
+#if !defined(NS_BLOCK_ASSERTIONS)
+// For testing purpose
+BOOL GRMustacheRenderingEngineExecutesTemplatePrograms = YES;
+#endif
+
+/**
+ * The state of a section rendered by a template program.
+ */
+typedef struct {
+    GRMustacheContext *context;         // The context of the instructions around the section
+    GRMustacheContext *sectionContext;  // The context frame of the section content, or nil
+    NSArray *items;                     // The enumeration items (retained), or nil
+    NSUInteger itemIndex;               // The index of the next enumeration item
+    NSAutoreleasePool *pool;            // Drained after each rendering of the section content
+    BOOL anyItemHTMLSafe;
+    BOOL anyItemHTMLUnsafe;
+} GRMustacheRenderingEngineSectionFrame;
 
 @interface GRMustacheRenderingEngine() <GRMustacheTemplateASTVisitor>
 @end
 
-static pthread_key_t GRCurrentExpressionInvocationKey;
-void freeCurrentExpressionInvocation(void *object) {
-    [(GRMustacheExpressionInvocation *)object release];
-}
-#define setupCurrentExpressionInvocation() pthread_key_create(&GRCurrentExpressionInvocationKey, freeCurrentExpressionInvocation)
-#define getCurrentThreadCurrentExpressionInvocation() (GRMustacheExpressionInvocation *)pthread_getspecific(GRCurrentExpressionInvocationKey)
-#define setCurrentThreadCurrentExpressionInvocation(object) pthread_setspecific(GRCurrentExpressionInvocationKey, object)
-static inline GRMustacheExpressionInvocation *currentThreadCurrentExpressionInvocation() {
-    GRMustacheExpressionInvocation *expressionInvocation = getCurrentThreadCurrentExpressionInvocation();
-    if (!expressionInvocation) {
-        expressionInvocation = [[GRMustacheExpressionInvocation alloc] init];
-        setCurrentThreadCurrentExpressionInvocation(expressionInvocation);
-    }
-    return expressionInvocation;
-}
-
+/**
+ * The capacity of the first chunk of rendering buffers, when the template AST
+ * has no estimate of its rendering length.
+ */
+#define GRMustacheRenderingEngineDefaultCapacity 1024
 
-@implementation GRMustacheRenderingEngine
+/**
+ * The maximum capacity of the first chunk of a rendering buffer, whatever the
+ * estimate of the rendering length. Longer renderings grow their buffer.
+ */
+#define GRMustacheRenderingEngineMaximumPredictedCapacity (1024 * 1024)
 
-+ (void)initialize
+CFIndex GRMustacheRenderingEngineInitialCapacity(GRMustacheTemplateAST *templateAST, NSUInteger count)
 {
-    setupCurrentExpressionInvocation();
+    NSUInteger estimate = templateAST.renderingLengthEstimate;
+    if (estimate == 0 || count == 0) {
+        return GRMustacheRenderingEngineDefaultCapacity;
+    }
+    if (estimate > GRMustacheRenderingEngineMaximumPredictedCapacity / count) {
+        return GRMustacheRenderingEngineMaximumPredictedCapacity;
+    }
+    return estimate * count;
 }
 
+@implementation GRMustacheRenderingEngine
+
 + (instancetype)renderingEngineWithContentType:(GRMustacheContentType)contentType context:(GRMustacheContext *)context
 {
     return [[[self alloc] initWithContentType:contentType context:context] autorelease];
@@ -72,19 +94,83 @@ static inline GRMustacheExpressionInvocation *currentThreadCurrentExpressionInvo
 
 - (NSString *)renderTemplateAST:(GRMustacheTemplateAST *)templateAST HTMLSafe:(BOOL *)HTMLSafe error:(NSError **)error
 {
-    _buffer = GRMustacheBufferCreate(1024);
+    _ownBuffer = GRMustacheBufferCreate(GRMustacheRenderingEngineInitialCapacity(templateAST, 1));
+    _buffer = &_ownBuffer;
     
-    NSString *result = nil;
-    if ([self visitTemplateAST:templateAST error:error]) {
-        if (HTMLSafe) {
-            *HTMLSafe = (_contentType == GRMustacheContentTypeHTML);
-        }
-        result = GRMustacheBufferGetString(&_buffer);
+    if (![self visitTemplateAST:templateAST error:error]) {
+        GRMustacheBufferRelease(_buffer);
+        return nil;
+    }
+    
+    if (HTMLSafe) {
+        *HTMLSafe = (_contentType == GRMustacheContentTypeHTML);
+    }
+    [templateAST recordRenderingLength:_buffer->length - _buffer->referencedLength];
+    return GRMustacheBufferGetStringAndRelease(_buffer);
+}
+
+- (NSData *)renderTemplateAST:(GRMustacheTemplateAST *)templateAST encoding:(CFStringEncoding)encoding error:(NSError **)error
+{
+    _ownBuffer = GRMustacheBufferCreateWithEncoding(GRMustacheRenderingEngineInitialCapacity(templateAST, 1), encoding);
+    _buffer = &_ownBuffer;
+    
+    if (![self visitTemplateAST:templateAST error:error] || ![self checkEncodingReturningError:error]) {
+        GRMustacheBufferRelease(_buffer);
+        return nil;
     }
     
-    GRMustacheBufferRelease(&_buffer);
+    [templateAST recordRenderingLength:_buffer->length - _buffer->referencedLength];
+    return GRMustacheBufferGetDataAndRelease(_buffer);
+}
+
+- (BOOL)renderTemplateAST:(GRMustacheTemplateAST *)templateAST appendingToString:(NSMutableString *)string error:(NSError **)error
+{
+    _ownBuffer = GRMustacheBufferCreate(GRMustacheRenderingEngineInitialCapacity(templateAST, 1));
+    _buffer = &_ownBuffer;
+    
+    if (![self visitTemplateAST:templateAST error:error]) {
+        GRMustacheBufferRelease(_buffer);
+        return NO;
+    }
     
-    return result;
+    [templateAST recordRenderingLength:_buffer->length - _buffer->referencedLength];
+    GRMustacheBufferAppendToStringAndRelease(_buffer, string);
+    return YES;
+}
+
+- (BOOL)renderTemplateAST:(GRMustacheTemplateAST *)templateAST appendingToData:(NSMutableData *)data encoding:(CFStringEncoding)encoding error:(NSError **)error
+{
+    _ownBuffer = GRMustacheBufferCreateWithEncoding(GRMustacheRenderingEngineInitialCapacity(templateAST, 1), encoding);
+    _buffer = &_ownBuffer;
+    
+    if (![self visitTemplateAST:templateAST error:error] || ![self checkEncodingReturningError:error]) {
+        GRMustacheBufferRelease(_buffer);
+        return NO;
+    }
+    
+    [templateAST recordRenderingLength:_buffer->length - _buffer->referencedLength];
+    GRMustacheBufferAppendToDataAndRelease(_buffer, data);
+    return YES;
+}
+
+- (BOOL)renderTemplateAST:(GRMustacheTemplateAST *)templateAST toOutputSink:(id<GRMustacheOutputSink>)sink error:(NSError **)error
+{
+    _ownBuffer = GRMustacheBufferCreateWithOutputSink(sink);
+    _buffer = &_ownBuffer;
+    
+    BOOL success = [self visitTemplateAST:templateAST error:error] && [self checkEncodingReturningError:error] && GRMustacheBufferFlush(_buffer, error);
+    
+    GRMustacheBufferRelease(_buffer);
+    
+    return success;
+}
+
+- (BOOL)renderTemplateAST:(GRMustacheTemplateAST *)templateAST intoBuffer:(GRMustacheBuffer *)buffer error:(NSError **)error
+{
+    _buffer = buffer;
+    BOOL success = [self visitTemplateAST:templateAST error:error];
+    _buffer = NULL;
+    return success;
 }
 
 
@@ -105,29 +191,51 @@ static inline GRMustacheExpressionInvocation *currentThreadCurrentExpressionInvo
     GRMustacheContentType ASTContentType = templateAST.contentType;
     if (_contentType != ASTContentType)
     {
-        // Content-type mismatch: render separately...
+        // Content-type mismatch: render with another rendering engine...
         
         GRMustacheRenderingEngine *renderingEngine = [[[GRMustacheRenderingEngine alloc] initWithContentType:ASTContentType context:_context] autorelease];
-        BOOL HTMLSafe;
-        NSString *rendering = [renderingEngine renderTemplateAST:templateAST HTMLSafe:&HTMLSafe error:error];
-        if (!rendering) {
-            return NO;
+        if (_contentType != GRMustacheContentTypeHTML) {
+            // HTML in text: no escaping
+            return [renderingEngine renderTemplateAST:templateAST intoBuffer:_buffer error:error];
         }
         
-        // ... and escape if needed
+        // ... and escape text in HTML. The rendering is escaped into our
+        // buffer as it flushes, so that large partials are streamed into
+        // output sinks.
         
-        if (_contentType == GRMustacheContentTypeHTML && !HTMLSafe) {
-            rendering = GRMustacheTranslateHTMLCharacters(rendering);
+        GRMustacheBuffer escapedBuffer = GRMustacheBufferCreate(GRMustacheBufferFlushThreshold);
+        escapedBuffer.HTMLEscapedBuffer = _buffer;
+        BOOL success = [renderingEngine renderTemplateAST:templateAST intoBuffer:&escapedBuffer error:error];
+        if (success) {
+            GRMustacheBufferAppendHTMLEscapedBuffer(_buffer, &escapedBuffer, NO);
         }
-        GRMustacheBufferAppendString(&_buffer, rendering);
-        return YES;
+        GRMustacheBufferRelease(&escapedBuffer);
+        return success;
     }
     else
     {
         // Content-type match
         
+        GRMustacheTextNode *staticTextNode = templateAST.staticTextNode;
+        if (staticTextNode) {
+            // Text-only template: no tag can depend on the current content type
+            return [self visitTextNode:staticTextNode error:error];
+        }
+        
+        BOOL executesTemplateProgram = ![_context hasInheritedPartialNode];
+#if !defined(NS_BLOCK_ASSERTIONS)
+        executesTemplateProgram = executesTemplateProgram && GRMustacheRenderingEngineExecutesTemplatePrograms;
+#endif
+        
         [GRMustacheRendering pushCurrentContentType:ASTContentType];
-        BOOL success = [self visitTemplateASTNodes:templateAST.templateASTNodes error:error];
+        BOOL success;
+        if (executesTemplateProgram) {
+            success = [self executeTemplateProgram:templateAST.program error:error];
+        } else {
+            // Inherited partials may override any node: visit the AST, and
+            // resolve each node.
+            success = [self visitTemplateASTNodes:templateAST.templateASTNodes error:error];
+        }
         [GRMustacheRendering popCurrentContentType];
         return success;
     }
@@ -164,10 +272,16 @@ static inline GRMustacheExpressionInvocation *currentThreadCurrentExpressionInvo
 
 - (BOOL)visitTextNode:(GRMustacheTextNode *)textNode error:(NSError **)error
 {
-    GRMustacheBufferAppendString(&_buffer, textNode.text);
+    GRMustacheBufferAppendStringWithUTF8Data(_buffer, textNode.text, textNode.UTF8Data);
     return YES;
 }
 
+- (BOOL)visitPrecompiledNode:(GRMustachePrecompiledNode *)precompiledNode error:(NSError **)error
+{
+    GRMustachePrecompiledRendering rendering = { self, precompiledNode, error };
+    return precompiledNode.renderingFunction(&rendering);
+}
+
 
 #pragma mark - Private
 
@@ -183,183 +297,623 @@ static inline GRMustacheExpressionInvocation *currentThreadCurrentExpressionInvo
     return self;
 }
 
+- (BOOL)checkEncodingReturningError:(NSError **)error
+{
+    if (_buffer->encodingFailed) {
+        if (error != NULL) {
+            *error = [NSError errorWithDomain:GRMustacheErrorDomain code:GRMustacheErrorCodeRenderingError userInfo:[NSDictionary dictionaryWithObject:@"Rendering can not be encoded with the requested encoding" forKey:NSLocalizedDescriptionKey]];
+        }
+        return NO;
+    }
+    return YES;
+}
+
 - (BOOL)visitTag:(GRMustacheTag *)tag expression:(GRMustacheExpression *)expression escapesHTML:(BOOL)escapesHTML error:(NSError **)error
 {
     BOOL success = YES;
     
     @autoreleasepool {
         
-        GRMustacheContext *context = _context;
+        // Evaluate expression. Evaluation may trigger nested renderings
+        // (filters, key-value coding getters), which use their own
+        // invocations.
         
-        // Evaluate expression
+        GRMustacheExpressionInvocation *expressionInvocation = [GRMustacheExpressionInvocation newPooledExpressionInvocation];
+        id value = nil;
+        BOOL valueIsProtected = NO;
+        @try {
+            expressionInvocation.expression = expression;
+            expressionInvocation.token = tag.token;
+            expressionInvocation.keyAccessInlineCaches = tag.keyAccessInlineCaches;
+            expressionInvocation.context = _context;
+            success = [expressionInvocation invokeReturningError:error];
+            value = expressionInvocation.value;
+            valueIsProtected = expressionInvocation.valueIsProtected;
+        }
+        @finally {
+            [expressionInvocation releaseToPool];
+        }
         
-        GRMustacheExpressionInvocation *expressionInvocation = currentThreadCurrentExpressionInvocation();
-        expressionInvocation.expression = expression;
-        expressionInvocation.context = context;
-        if (![expressionInvocation invokeReturningError:error]) {
-            
-            // Error
-            
+        if (success) {
+            success = [self renderValue:value valueIsProtected:valueIsProtected forTag:tag escapesHTML:escapesHTML error:error];
+        }
+        
+        if (!success && error != NULL) {
+            [*error retain];   // retain error so that it survives the @autoreleasepool block
+        }
+    }
+    
+    if (!success && error) [*error autorelease];    // the error has been retained inside the @autoreleasepool block
+    return success;
+}
+
+/**
+ * Renders the value of a tag expression.
+ *
+ * @param value             The value of the tag expression.
+ * @param valueIsProtected  YES if the value comes from the protected context
+ *                          stack.
+ * @param tag               The rendered tag.
+ * @param escapesHTML       NO for triple mustache tags.
+ * @param error             If there is an error rendering, upon return
+ *                          contains an NSError object that describes the
+ *                          problem.
+ *
+ * @return YES if the rendering succeeded, NO otherwise.
+ */
+- (BOOL)renderValue:(id)value valueIsProtected:(BOOL)valueIsProtected forTag:(GRMustacheTag *)tag escapesHTML:(BOOL)escapesHTML error:(NSError **)error
+{
+    BOOL success = YES;
+    GRMustacheContext *context = _context;
+    
+    // Hide value if it is protected
+    if (valueIsProtected) {
+        // Object is protected: it may enter the context stack, and provide
+        // value for `.` and `.name`. However, it must not expose its keys.
+        //
+        // The goal is to have `{{ safe.name }}` and `{{#safe}}{{.name}}{{/safe}}`
+        // work, but not `{{#safe}}{{name}}{{/safe}}`.
+        //
+        // Rationale:
+        //
+        // Let's look at `{{#safe}}{{#hacker}}{{name}}{{/hacker}}{{/safe}}`:
+        //
+        // The protected context stack contains the "protected root":
+        // { safe : { name: "important } }.
+        //
+        // Since the user has used the key `safe`, he expects `name` to be
+        // safe as well, even if `hacker` has defined its own `name`.
+        //
+        // So we need to have `name` come from `safe`, not from `hacker`.
+        // We should thus start looking in `safe` first. But `safe` was
+        // not initially in the protected context stack. Only the protected
+        // root was. Hence somebody had `safe` in the protected context
+        // stack.
+        //
+        // Who has objects enter the context stack? Rendering objects do. So
+        // rendering objects have to know that values are protected or not,
+        // and choose the correct bucket accordingly.
+        //
+        // Who can write his own rendering objects? The end user does. So
+        // the end user must carefully read a documentation about safety,
+        // and then carefully code his rendering objects so that they
+        // conform to this safety notice.
+        //
+        // Of course this is not what we want. So `name` can not be
+        // protected. Since we don't want to let the user think he is data
+        // is given protected when it is not, we prevent this whole pattern, and
+        // forbid `{{#safe}}{{name}}{{/safe}}`.
+        context = [context contextByAddingHiddenObject:value];
+    }
+    
+    
+    // Rendered value hooks
+    
+    NSArray *tagDelegateStack = [context tagDelegateStack];
+    for (id<GRMustacheTagDelegate> tagDelegate in [tagDelegateStack reverseObjectEnumerator]) { // willRenderObject: from top to bottom
+        if ([tagDelegate respondsToSelector:@selector(mustacheTag:willRenderObject:)]) {
+            value = [tagDelegate mustacheTag:tag willRenderObject:value];
+        }
+    }
+    
+    
+    // Render value
+    
+    id<GRMustacheRendering> renderingObject = [GRMustacheRendering renderingObjectForObject:value];
+    
+    if (tagDelegateStack == nil)
+    {
+        // No tag delegate wants to see the rendering: render right
+        // into our buffer, which is shared with the nested sections,
+        // partials and enumeration items.
+        
+        BOOL HTMLSafe = NO;
+        NSError *renderingError = nil;
+        BOOL shouldRender = YES;
+        if (tag.type == GRMustacheTagTypeSection) {
+            // See below for the boolean value of rendering objects.
+            shouldRender = (!tag.isInverted != ![renderingObject mustacheBoolValue]);
+        }
+        if (shouldRender && ![GRMustacheRendering renderObject:renderingObject forMustacheTag:tag asEnumerationItem:NO context:context intoBuffer:_buffer escapesHTML:((_contentType == GRMustacheContentTypeHTML) && escapesHTML) HTMLSafe:&HTMLSafe error:&renderingError]) {
             if (error != NULL) {
-                [*error retain];   // retain error so that it survives the @autoreleasepool block
+                *error = renderingError;
             }
-            
             success = NO;
-            
-        } else {
-            
-            id value = expressionInvocation.value;
-            BOOL valueIsProtected = expressionInvocation.valueIsProtected;
-            
-            // Hide value if it is protected
-            if (valueIsProtected) {
-                // Object is protected: it may enter the context stack, and provide
-                // value for `.` and `.name`. However, it must not expose its keys.
-                //
-                // The goal is to have `{{ safe.name }}` and `{{#safe}}{{.name}}{{/safe}}`
-                // work, but not `{{#safe}}{{name}}{{/safe}}`.
-                //
-                // Rationale:
-                //
-                // Let's look at `{{#safe}}{{#hacker}}{{name}}{{/hacker}}{{/safe}}`:
-                //
-                // The protected context stack contains the "protected root":
-                // { safe : { name: "important } }.
-                //
-                // Since the user has used the key `safe`, he expects `name` to be
-                // safe as well, even if `hacker` has defined its own `name`.
-                //
-                // So we need to have `name` come from `safe`, not from `hacker`.
-                // We should thus start looking in `safe` first. But `safe` was
-                // not initially in the protected context stack. Only the protected
-                // root was. Hence somebody had `safe` in the protected context
-                // stack.
-                //
-                // Who has objects enter the context stack? Rendering objects do. So
-                // rendering objects have to know that values are protected or not,
-                // and choose the correct bucket accordingly.
+        }
+    }
+    else
+    {
+        NSString *rendering = nil;
+        NSError *renderingError = nil;  // Default nil, so that we can help lazy coders who return nil as a valid rendering.
+        BOOL HTMLSafe = NO;             // Default NO, so that we assume unsafe rendering from lazy coders who do not explicitly set it.
+        if ([GRMustacheRendering kindOfRenderingObject:renderingObject asEnumerationItem:NO] == GRMustacheRenderingObjectKindCustom) {
+            // User code may keep the context: don't give it a context frame.
+            context = [context materializedContext];
+        }
+        switch (tag.type) {
+            case GRMustacheTagTypeVariable:
+                rendering = [renderingObject renderForMustacheTag:tag context:context HTMLSafe:&HTMLSafe error:&renderingError];
+                break;
+                
+            case GRMustacheTagTypeSection: {
+                // Section rendering depends on the boolean value of the
+                // rendering object.
                 //
-                // Who can write his own rendering objects? The end user does. So
-                // the end user must carefully read a documentation about safety,
-                // and then carefully code his rendering objects so that they
-                // conform to this safety notice.
+                // Despite the mustacheBoolValue method being declared
+                // optional by the GRMustacheRendering protocol (for API
+                // compatibility with GRMustache <= 7.1), the method is
+                // always implemented, with YES as a default value.
                 //
-                // Of course this is not what we want. So `name` can not be
-                // protected. Since we don't want to let the user think he is data
-                // is given protected when it is not, we prevent this whole pattern, and
-                // forbid `{{#safe}}{{name}}{{/safe}}`.
-                context = [context contextByAddingHiddenObject:value];
-            }
-            
+                // See +[GRMustacheRendering initialize]
+                BOOL boolValue = [renderingObject mustacheBoolValue];
+                if (!tag.isInverted != !boolValue) {
+                    rendering = [renderingObject renderForMustacheTag:tag context:context HTMLSafe:&HTMLSafe error:&renderingError];
+                } else {
+                    rendering = @"";
+                }
+            } break;
+        }
+        
+        if (!rendering && !renderingError)
+        {
+            // Rendering is nil, but rendering error is not set.
+            //
+            // Assume a rendering object coded by a lazy programmer, whose
+            // intention is to render nothing.
             
-            // Rendered value hooks
+            rendering = @"";
+        }
+        
+        
+        // Finish
+        
+        if (rendering)
+        {
+            // Render
             
-            NSArray *tagDelegateStack = [context tagDelegateStack];
-            for (id<GRMustacheTagDelegate> tagDelegate in [tagDelegateStack reverseObjectEnumerator]) { // willRenderObject: from top to bottom
-                if ([tagDelegate respondsToSelector:@selector(mustacheTag:willRenderObject:)]) {
-                    value = [tagDelegate mustacheTag:tag willRenderObject:value];
-                }
+            if ((_contentType == GRMustacheContentTypeHTML) && !HTMLSafe && escapesHTML) {
+                rendering = GRMustacheTranslateHTMLCharacters(rendering);
             }
+            GRMustacheBufferAppendString(_buffer, rendering);
             
             
-            // Render value
+            // Post-rendering hooks
             
-            id<GRMustacheRendering> renderingObject = [GRMustacheRendering renderingObjectForObject:value];
-            NSString *rendering = nil;
-            NSError *renderingError = nil;  // Default nil, so that we can help lazy coders who return nil as a valid rendering.
-            BOOL HTMLSafe = NO;             // Default NO, so that we assume unsafe rendering from lazy coders who do not explicitly set it.
-            switch (tag.type) {
-                case GRMustacheTagTypeVariable:
-                    rendering = [renderingObject renderForMustacheTag:tag context:context HTMLSafe:&HTMLSafe error:&renderingError];
-                    break;
-                    
-                case GRMustacheTagTypeSection: {
-                    // Section rendering depends on the boolean value of the
-                    // rendering object.
-                    //
-                    // Despite the mustacheBoolValue method being declared
-                    // optional by the GRMustacheRendering protocol (for API
-                    // compatibility with GRMustache <= 7.1), the method is
-                    // always implemented, with YES as a default value.
-                    //
-                    // See +[GRMustacheRendering initialize]
-                    BOOL boolValue = [renderingObject mustacheBoolValue];
-                    if (!tag.isInverted != !boolValue) {
-                        rendering = [renderingObject renderForMustacheTag:tag context:context HTMLSafe:&HTMLSafe error:&renderingError];
-                    } else {
-                        rendering = @"";
-                    }
-                } break;
+            for (id<GRMustacheTagDelegate> tagDelegate in tagDelegateStack) { // didRenderObject: from bottom to top
+                if ([tagDelegate respondsToSelector:@selector(mustacheTag:didRenderObject:as:)]) {
+                    [tagDelegate mustacheTag:tag didRenderObject:value as:rendering];
+                }
             }
+        }
+        else
+        {
+            // Error
             
-            if (!rendering && !renderingError)
-            {
-                // Rendering is nil, but rendering error is not set.
-                //
-                // Assume a rendering object coded by a lazy programmer, whose
-                // intention is to render nothing.
-                
-                rendering = @"";
+            if (error != NULL) {
+                *error = renderingError;
             }
+            success = NO;
             
             
-            // Finish
+            // Post-error hooks
             
-            if (rendering)
-            {
-                // Render
-                
-                if ((_contentType == GRMustacheContentTypeHTML) && !HTMLSafe && escapesHTML) {
-                    rendering = GRMustacheTranslateHTMLCharacters(rendering);
+            for (id<GRMustacheTagDelegate> tagDelegate in tagDelegateStack) { // didFailRenderingObject: from bottom to top
+                if ([tagDelegate respondsToSelector:@selector(mustacheTag:didFailRenderingObject:withError:)]) {
+                    [tagDelegate mustacheTag:tag didFailRenderingObject:value withError:renderingError];
                 }
-                GRMustacheBufferAppendString(&_buffer, rendering);
+            }
+        }
+    }
+    
+    return success;
+}
+
+- (BOOL)visitTemplateASTNodes:(NSArray *)templateASTNodes error:(NSError **)error
+{
+    for (id<GRMustacheTemplateASTNode> ASTNode in templateASTNodes) {
+        ASTNode = [self resolveTemplateASTNode:ASTNode];
+        if (![ASTNode acceptTemplateASTVisitor:self error:error]) {
+            return NO;
+        }
+        if (!GRMustacheBufferFlushIfNeeded(_buffer, error)) {
+            return NO;
+        }
+    }
+    
+    return YES;
+}
+
+
+#pragma mark - Template Programs
+
+/**
+ * Renders a template program.
+ *
+ * The program is rendered the same way the visit of its template AST would
+ * render it, except for inherited partials: programs do not resolve overridden
+ * nodes.
+ *
+ * Sections are rendered in place, unless their value is protected, or needs
+ * to be processed by tag delegates, or is a custom rendering object: those
+ * are rendered the same way visited sections are.
+ */
+- (BOOL)executeTemplateProgram:(GRMustacheTemplateProgram *)program error:(NSError **)error
+{
+    const GRMustacheInstruction *instructions = program.instructions;
+    NSUInteger instructionCount = program.instructionCount;
+    GRMustacheRenderingEngineSectionFrame frames[MAX(program.maximumSectionDepth, 1)];
+    NSUInteger depth = 0;
+    NSUInteger index = 0;
+    
+    // Tags, filters and rendering objects may raise: sections that have been
+    // entered must leave the context stack and drain their autorelease pools.
+    @try {
+        while (index < instructionCount) {
+            const GRMustacheInstruction *instruction = instructions + index;
+            switch (instruction->type) {
+                case GRMustacheInstructionTypeText: {
+                    GRMustacheTextNode *textNode = instruction->node;
+                    GRMustacheBufferAppendStringWithUTF8Data(_buffer, textNode.text, textNode.UTF8Data);
+                    index += 1;
+                } break;
                 
+                case GRMustacheInstructionTypeVariable: {
+                    GRMustacheVariableTag *variableTag = instruction->node;
+                    if (![self visitTag:variableTag expression:variableTag.expression escapesHTML:variableTag.escapesHTML error:error]) {
+                        goto failure;
+                    }
+                    index += 1;
+                } break;
                 
-                // Post-rendering hooks
+                case GRMustacheInstructionTypeSection: {
+                    BOOL rendersContent;
+                    if (![self enterSectionTag:instruction->node frame:frames + depth rendersContent:&rendersContent error:error]) {
+                        goto failure;
+                    }
+                    if (rendersContent) {
+                        depth += 1;
+                        index += 1;
+                    } else {
+                        index = instruction->target;
+                    }
+                } break;
                 
-                for (id<GRMustacheTagDelegate> tagDelegate in tagDelegateStack) { // didRenderObject: from bottom to top
-                    if ([tagDelegate respondsToSelector:@selector(mustacheTag:didRenderObject:as:)]) {
-                        [tagDelegate mustacheTag:tag didRenderObject:value as:rendering];
+                case GRMustacheInstructionTypeEndSection: {
+                    BOOL rendersContent;
+                    if (![self leaveSectionTag:instruction->node frame:frames + depth - 1 rendersContent:&rendersContent error:error]) {
+                        goto failure;
                     }
-                }
-            }
-            else
-            {
-                // Error
+                    if (rendersContent) {
+                        // Next enumeration item
+                        index = instruction->target;
+                    } else {
+                        depth -= 1;
+                        index += 1;
+                    }
+                } break;
                 
-                if (error != NULL) {
-                    *error = [renderingError retain];   // retain error so that it survives the @autoreleasepool block
-                }
-                success = NO;
+                case GRMustacheInstructionTypePartial: {
+                    GRMustachePartialNode *partialNode = instruction->node;
+                    if (![self visitTemplateAST:partialNode.templateAST error:error]) {
+                        goto failure;
+                    }
+                    index += 1;
+                } break;
                 
+                case GRMustacheInstructionTypeNode:
+                    if (![instruction->node acceptTemplateASTVisitor:self error:error]) {
+                        goto failure;
+                    }
+                    index += 1;
+                    break;
+            }
+            
+            if (!GRMustacheBufferFlushIfNeeded(_buffer, error)) {
+                goto failure;
+            }
+        }
+        
+        return YES;
+        
+failure:
+        if (depth > 0) {
+            if (error != NULL) [*error retain];   // retain error so that it survives the autorelease pools of the sections
+            while (depth > 0) {
+                depth -= 1;
+                [self unwindSectionFrame:frames + depth];
+            }
+            if (error != NULL) [*error autorelease];
+        }
+        return NO;
+    }
+    @catch (NSException *exception) {
+        [exception retain];   // retain exception so that it survives the autorelease pools of the sections
+        while (depth > 0) {
+            depth -= 1;
+            [self unwindSectionFrame:frames + depth];
+        }
+        [exception autorelease];
+        @throw exception;
+    }
+}
+
+/**
+ * Evaluates a section tag, and prepares the rendering of its content.
+ *
+ * Upon return, _rendersContent_ is YES if the content of the section should
+ * be rendered with the current context, and the frame is filled. It is NO if
+ * the section has nothing left to render.
+ */
+- (BOOL)enterSectionTag:(GRMustacheSectionTag *)sectionTag frame:(GRMustacheRenderingEngineSectionFrame *)frame rendersContent:(BOOL *)rendersContent error:(NSError **)error
+{
+    NSAutoreleasePool *pool = [[NSAutoreleasePool alloc] init];
+    BOOL success = YES;
+    BOOL fillsFrame = NO;
+    *rendersContent = NO;
+    
+    // Filters and rendering objects may raise: the autorelease pool of the
+    // section must be drained, and a filled frame unwound.
+    @try {
+        // Evaluate expression
+        
+        GRMustacheExpressionInvocation *expressionInvocation = [GRMustacheExpressionInvocation newPooledExpressionInvocation];
+        id value = nil;
+        BOOL valueIsProtected = NO;
+        @try {
+            expressionInvocation.expression = sectionTag.expression;
+            expressionInvocation.token = sectionTag.token;
+            expressionInvocation.keyAccessInlineCaches = sectionTag.keyAccessInlineCaches;
+            expressionInvocation.context = _context;
+            success = [expressionInvocation invokeReturningError:error];
+            value = expressionInvocation.value;
+            valueIsProtected = expressionInvocation.valueIsProtected;
+        }
+        @finally {
+            [expressionInvocation releaseToPool];
+        }
+        
+        if (success) {
+            id renderingObject = [GRMustacheRendering renderingObjectForObject:value];
+            
+            GRMustacheRenderingObjectKind kind = GRMustacheRenderingObjectKindCustom;
+            if (!valueIsProtected && ![_context hasTagDelegate]) {
+                kind = [GRMustacheRendering kindOfRenderingObject:renderingObject asEnumerationItem:NO];
+            }
+            
+            if (kind == GRMustacheRenderingObjectKindCustom) {
+                // Render the whole section as visited sections do
+                success = [self renderValue:value valueIsProtected:valueIsProtected forTag:sectionTag escapesHTML:YES error:error];
+            } else if (!sectionTag.isInverted != ![renderingObject mustacheBoolValue]) {
+                frame->context = _context;
+                frame->sectionContext = nil;
+                frame->items = nil;
+                frame->itemIndex = 0;
+                frame->pool = pool;
+                frame->anyItemHTMLSafe = NO;
+                frame->anyItemHTMLUnsafe = NO;
+                fillsFrame = YES;
+                *rendersContent = YES;
                 
-                // Post-error hooks
+                switch (kind) {
+                    case GRMustacheRenderingObjectKindCustom:
+                    case GRMustacheRenderingObjectKindNull:
+                    case GRMustacheRenderingObjectKindNumber:
+                        // {{# null }}...{{/}}, {{^ number }}...{{/}}, etc.
+                        break;
+                        
+                    case GRMustacheRenderingObjectKindString:
+                        // {{# string }}...{{/}}
+                        if (!sectionTag.isInverted) {
+                            frame->sectionContext = [_context pushContextFrameWithObject:value];
+                            _context = frame->sectionContext;
+                        }
+                        break;
+                        
+                    case GRMustacheRenderingObjectKindObject:
+                        // {{# object }}...{{/}}
+                        frame->sectionContext = [_context pushContextFrameWithObject:value];
+                        _context = frame->sectionContext;
+                        break;
+                        
+                    case GRMustacheRenderingObjectKindEnumeration:
+                        // {{# list }}...{{/}}
+                        // {{^ emptyList }}...{{/}}
+                        if (!sectionTag.isInverted) {
+                            if ([value isKindOfClass:[NSArray class]]) {
+                                frame->items = [value retain];
+                            } else {
+                                NSMutableArray *items = [[NSMutableArray alloc] init];
+                                for (id item in value) {
+                                    [items addObject:item];
+                                }
+                                frame->items = items;
+                            }
+                            success = [self enterNextItemOfSectionTag:sectionTag frame:frame rendersContent:rendersContent error:error];
+                            if (!success || !*rendersContent) {
+                                // Don't drain the pool twice
+                                frame->pool = nil;
+                                [self unwindSectionFrame:frame];
+                                *rendersContent = NO;
+                            }
+                        }
+                        break;
+                }
                 
-                for (id<GRMustacheTagDelegate> tagDelegate in tagDelegateStack) { // didFailRenderingObject: from bottom to top
-                    if ([tagDelegate respondsToSelector:@selector(mustacheTag:didFailRenderingObject:withError:)]) {
-                        [tagDelegate mustacheTag:tag didFailRenderingObject:value withError:renderingError];
-                    }
+                if (*rendersContent) {
+                    // The pool is drained when the section leaves.
+                    return YES;
                 }
             }
         }
     }
+    @catch (NSException *exception) {
+        [exception retain];   // retain exception so that it survives the autorelease pool
+        if (fillsFrame) {
+            // Don't drain the pool twice
+            frame->pool = nil;
+            [self unwindSectionFrame:frame];
+        }
+        [pool drain];
+        [exception autorelease];
+        @throw exception;
+    }
     
-    if (!success && error) [*error autorelease];    // the error has been retained inside the @autoreleasepool block
+    if (!success && error != NULL) [*error retain];   // retain error so that it survives the autorelease pool
+    [pool drain];
+    if (!success && error != NULL) [*error autorelease];
     return success;
 }
 
-- (BOOL)visitTemplateASTNodes:(NSArray *)templateASTNodes error:(NSError **)error
+/**
+ * Ends a rendering of the content of a section, and prepares the rendering of
+ * the next enumeration item, if any.
+ *
+ * Upon return, _rendersContent_ is YES if the content of the section should
+ * be rendered again. Otherwise, the frame has been unwound.
+ */
+- (BOOL)leaveSectionTag:(GRMustacheSectionTag *)sectionTag frame:(GRMustacheRenderingEngineSectionFrame *)frame rendersContent:(BOOL *)rendersContent error:(NSError **)error
 {
-    for (id<GRMustacheTemplateASTNode> ASTNode in templateASTNodes) {
-        ASTNode = [self resolveTemplateASTNode:ASTNode];
-        if (![ASTNode acceptTemplateASTVisitor:self error:error]) {
-            return NO;
+    *rendersContent = NO;
+    
+    if (frame->items) {
+        [frame->sectionContext popContextFrame];
+        frame->sectionContext = nil;
+        _context = frame->context;
+        [frame->pool drain];
+        frame->pool = [[NSAutoreleasePool alloc] init];
+        
+        if (![self enterNextItemOfSectionTag:sectionTag frame:frame rendersContent:rendersContent error:error]) {
+            return NO;  // the frame is unwound by executeTemplateProgram:error:
+        }
+        if (*rendersContent) {
+            return YES;
+        }
+    }
+    
+    [self unwindSectionFrame:frame];
+    return YES;
+}
+
+/**
+ * Pushes the next enumeration item of a section on the context stack.
+ *
+ * Items that are custom rendering objects are rendered as visited sections
+ * render them. Upon return, _rendersContent_ is NO if there is no item left.
+ */
+- (BOOL)enterNextItemOfSectionTag:(GRMustacheSectionTag *)sectionTag frame:(GRMustacheRenderingEngineSectionFrame *)frame rendersContent:(BOOL *)rendersContent error:(NSError **)error
+{
+    BOOL HTMLContent = (_contentType == GRMustacheContentTypeHTML);
+    BOOL checksHTMLEscapingConsistency = !frame->context.trustedData;
+    NSArray *items = frame->items;
+    
+    while (frame->itemIndex < items.count) {
+        id item = [items objectAtIndex:frame->itemIndex];
+        frame->itemIndex += 1;
+        
+        id renderingObject = [GRMustacheRendering renderingObjectForObject:item];
+        BOOL itemHTMLSafe = HTMLContent;  // the HTML-safety of the section content
+        BOOL rendersItemContent = ([GRMustacheRendering kindOfRenderingObject:renderingObject asEnumerationItem:YES] != GRMustacheRenderingObjectKindCustom);
+        
+        if (!rendersItemContent) {
+            BOOL success = YES;
+            @autoreleasepool {
+                itemHTMLSafe = NO; // always assume unsafe rendering
+                success = [GRMustacheRendering renderObject:renderingObject forMustacheTag:sectionTag asEnumerationItem:YES context:frame->context intoBuffer:_buffer escapesHTML:HTMLContent HTMLSafe:&itemHTMLSafe error:error];
+                if (!success && error != NULL) {
+                    [*error retain];    // retain error so that it survives the @autoreleasepool block
+                }
+            }
+            if (!success) {
+                if (error != NULL) [*error autorelease];
+                return NO;
+            }
+        }
+        
+        // check consistency of HTML escaping
+        
+        if (itemHTMLSafe) {
+            frame->anyItemHTMLSafe = YES;
+            if (frame->anyItemHTMLUnsafe && checksHTMLEscapingConsistency) {
+                [NSException raise:GRMustacheRenderingException format:@"Inconsistant HTML escaping of items in enumeration"];
+            }
+        } else {
+            frame->anyItemHTMLUnsafe = YES;
+            if (frame->anyItemHTMLSafe && checksHTMLEscapingConsistency) {
+                [NSException raise:GRMustacheRenderingException format:@"Inconsistant HTML escaping of items in enumeration"];
+            }
+        }
+        
+        if (rendersItemContent) {
+            frame->sectionContext = [frame->context pushContextFrameWithObject:item];
+            _context = frame->sectionContext;
+            *rendersContent = YES;
+            return YES;
         }
     }
     
+    *rendersContent = NO;
     return YES;
 }
 
+- (void)unwindSectionFrame:(GRMustacheRenderingEngineSectionFrame *)frame
+{
+    _context = frame->context;
+    [frame->sectionContext popContextFrame];
+    frame->sectionContext = nil;
+    [frame->items release];
+    frame->items = nil;
+    [frame->pool drain];
+    frame->pool = nil;
+}
+
+#pragma mark - Precompiled Templates
+
+// The functions below are called by the rendering functions of precompiled
+// templates, from -visitPrecompiledNode:error:.
+
+BOOL GRMustachePrecompiledRenderText(GRMustachePrecompiledRendering *rendering, NSUInteger index)
+{
+    GRMustacheRenderingEngine *renderingEngine = rendering->renderingEngine;
+    GRMustacheTextNode *textNode = (GRMustacheTextNode *)CFArrayGetValueAtIndex((CFArrayRef)rendering->precompiledNode.textNodes, index);
+    GRMustacheBufferAppendStringWithUTF8Data(renderingEngine->_buffer, textNode.text, textNode.UTF8Data);
+    return GRMustacheBufferFlushIfNeeded(renderingEngine->_buffer, rendering->error);
+}
+
+BOOL GRMustachePrecompiledRenderTag(GRMustachePrecompiledRendering *rendering, NSUInteger index)
+{
+    GRMustacheRenderingEngine *renderingEngine = rendering->renderingEngine;
+    id<GRMustacheTemplateASTNode> tag = (id<GRMustacheTemplateASTNode>)CFArrayGetValueAtIndex((CFArrayRef)rendering->precompiledNode.tags, index);
+    return [tag acceptTemplateASTVisitor:renderingEngine error:rendering->error] && GRMustacheBufferFlushIfNeeded(renderingEngine->_buffer, rendering->error);
+}
+
+BOOL GRMustachePrecompiledRenderPartial(GRMustachePrecompiledRendering *rendering, NSUInteger index)
+{
+    GRMustacheRenderingEngine *renderingEngine = rendering->renderingEngine;
+    GRMustachePartialNode *partialNode = (GRMustachePartialNode *)CFArrayGetValueAtIndex((CFArrayRef)rendering->precompiledNode.partialNodes, index);
+    return [renderingEngine visitTemplateAST:partialNode.templateAST error:rendering->error] && GRMustacheBufferFlushIfNeeded(renderingEngine->_buffer, rendering->error);
+}
+
+
 #pragma mark - Inheritance
 
 - (id<GRMustacheTemplateASTNode>)resolveTemplateASTNode:(id<GRMustacheTemplateASTNode>)node
@@ -29,13 +29,33 @@
 @class GRMustacheSectionTag;
 @class GRMustacheExpressionInvocation;
 @class GRMustacheTemplateAST;
+@protocol GRMustacheOutputSink;
+
+#if !defined(NS_BLOCK_ASSERTIONS)
+// For testing purpose: when NO, template ASTs are always visited, and template
+// programs are not used.
+extern BOOL GRMustacheRenderingEngineExecutesTemplatePrograms GRMUSTACHE_API_INTERNAL;
+#endif
+
+/**
+ * Returns the capacity of the first chunk of a buffer that will contain
+ * _count_ renderings of a template AST, from the estimate of its rendering
+ * length. The capacity is bounded: longer renderings grow their buffer.
+ *
+ * @param templateAST  A template AST, or nil.
+ * @param count        The number of renderings of the template AST.
+ *
+ * @return A buffer capacity.
+ */
+extern CFIndex GRMustacheRenderingEngineInitialCapacity(GRMustacheTemplateAST *templateAST, NSUInteger count) GRMUSTACHE_API_INTERNAL;
 
 /**
  * TODO
  */
 @interface GRMustacheRenderingEngine : NSObject {
 @private
-    GRMustacheBuffer _buffer;
+    GRMustacheBuffer *_buffer;
+    GRMustacheBuffer _ownBuffer;
     GRMustacheContentType _contentType;
     GRMustacheContext *_context;
 }
@@ -45,6 +65,79 @@
  */
 - (NSString *)renderTemplateAST:(GRMustacheTemplateAST *)templateAST HTMLSafe:(BOOL *)HTMLSafe error:(NSError **)error GRMUSTACHE_API_INTERNAL;
 
+/**
+ * Renders a template AST into encoded bytes.
+ *
+ * Strings are encoded as they are rendered: no intermediate UTF-16 rendering
+ * is built.
+ *
+ * @param templateAST  The template AST to render.
+ * @param encoding     The encoding of the rendering.
+ * @param error        If there is an error rendering or encoding, upon return
+ *                     contains an NSError object that describes the problem.
+ *
+ * @return The encoded rendering.
+ */
+- (NSData *)renderTemplateAST:(GRMustacheTemplateAST *)templateAST encoding:(CFStringEncoding)encoding error:(NSError **)error GRMUSTACHE_API_INTERNAL;
+
+/**
+ * Renders a template AST, and appends the rendering to a mutable string.
+ *
+ * The string is left untouched if an error occurs.
+ *
+ * @param templateAST  The template AST to render.
+ * @param string       The mutable string the rendering is appended to.
+ * @param error        If there is an error rendering, upon return contains an
+ *                     NSError object that describes the problem.
+ *
+ * @return YES if the rendering succeeded, NO otherwise.
+ */
+- (BOOL)renderTemplateAST:(GRMustacheTemplateAST *)templateAST appendingToString:(NSMutableString *)string error:(NSError **)error GRMUSTACHE_API_INTERNAL;
+
+/**
+ * Renders a template AST, and appends the encoded rendering to a mutable data.
+ *
+ * The data is left untouched if an error occurs.
+ *
+ * @param templateAST  The template AST to render.
+ * @param data         The mutable data the rendering is appended to.
+ * @param encoding     The encoding of the rendering.
+ * @param error        If there is an error rendering or encoding, upon return
+ *                     contains an NSError object that describes the problem.
+ *
+ * @return YES if the rendering succeeded, NO otherwise.
+ */
+- (BOOL)renderTemplateAST:(GRMustacheTemplateAST *)templateAST appendingToData:(NSMutableData *)data encoding:(CFStringEncoding)encoding error:(NSError **)error GRMUSTACHE_API_INTERNAL;
+
+/**
+ * Renders a template AST, and writes the UTF-8 rendering into an output sink,
+ * by chunks of about GRMustacheBufferFlushThreshold bytes.
+ *
+ * @param templateAST  The template AST to render.
+ * @param sink         The output sink.
+ * @param error        If there is an error rendering or writing, upon return
+ *                     contains an NSError object that describes the problem.
+ *
+ * @return YES if the whole rendering could be written, NO otherwise.
+ */
+- (BOOL)renderTemplateAST:(GRMustacheTemplateAST *)templateAST toOutputSink:(id<GRMustacheOutputSink>)sink error:(NSError **)error GRMUSTACHE_API_INTERNAL;
+
+/**
+ * Renders a template AST into a buffer owned by the caller.
+ *
+ * This method lets sections, partials and enumeration items append their
+ * rendering right into the buffer of the enclosing rendering, instead of
+ * building intermediate strings.
+ *
+ * @param templateAST  The template AST to render.
+ * @param buffer       The buffer the rendering is appended to.
+ * @param error        If there is an error rendering, upon return contains an
+ *                     NSError object that describes the problem.
+ *
+ * @return YES if the rendering succeeded, NO otherwise.
+ */
+- (BOOL)renderTemplateAST:(GRMustacheTemplateAST *)templateAST intoBuffer:(GRMustacheBuffer *)buffer error:(NSError **)error GRMUSTACHE_API_INTERNAL;
+
 /**
  * TODO
  */
@@ -23,6 +23,7 @@
 #import <Foundation/Foundation.h>
 #import "GRMustacheAvailabilityMacros_private.h"
 #import "GRMustacheContentType.h"
+#import "GRMustacheBuffer_private.h"
 
 // prevent GRMustacheFilter.h to load
 #define GRMUSTACHE_RENDERING
@@ -133,6 +134,107 @@
 
 
 
+// =============================================================================
+#pragma mark - <GRMustacheRenderingWithBufferSupport>
+
+/**
+ * The GRMustacheRenderingWithBufferSupport protocol is a private extension to
+ * the GRMustacheRenderingWithIterationSupport protocol.
+ *
+ * Objects conforming to this protocol append their rendering to a buffer
+ * instead of returning a string. This lets sections, partials and enumeration
+ * items render in place, in the buffer of the template that contains them.
+ *
+ * Built-in types (NSNull, NSNumber, NSString, NSDictionary, collections and
+ * other objects) conform to this protocol. Custom rendering objects render
+ * through the string-returning GRMustacheRendering API: see
+ * +[GRMustacheRendering renderObject:forMustacheTag:asEnumerationItem:context:intoBuffer:escapesHTML:HTMLSafe:error:].
+ */
+@protocol GRMustacheRenderingWithBufferSupport <GRMustacheRenderingWithIterationSupport>
+@required
+
+/**
+ * This method is invoked when the receiver should be rendered by a Mustache
+ * tag into a buffer.
+ *
+ * The rendering is HTML-escaped before it is appended, if _escapesHTML_ is YES
+ * and the rendering is not HTML-safe.
+ *
+ * @param tag              The tag to be rendered
+ * @param enumerationItem  YES if the receiver renders as an enumeration item.
+ * @param context          A context for rendering inner tags.
+ * @param buffer           The buffer the rendering is appended to.
+ * @param escapesHTML      YES if HTML-unsafe renderings should be escaped.
+ * @param HTMLSafe         Upon return contains YES if the rendering is
+ *                         HTML-safe.
+ * @param error            If there is an error performing the rendering, upon
+ *                         return contains an NSError object that describes the
+ *                         problem.
+ *
+ * @return YES if the rendering could be appended.
+ */
+- (BOOL)renderForMustacheTag:(GRMustacheTag *)tag
+           asEnumerationItem:(BOOL)enumerationItem
+                     context:(GRMustacheContext *)context
+                  intoBuffer:(GRMustacheBuffer *)buffer
+                 escapesHTML:(BOOL)escapesHTML
+                    HTMLSafe:(BOOL *)HTMLSafe
+                       error:(NSError **)error GRMUSTACHE_API_INTERNAL;
+
+@end
+
+
+// =============================================================================
+#pragma mark - GRMustacheRenderingObjectKind
+
+/**
+ * The built-in behaviors of rendering objects in sections.
+ *
+ * GRMustacheRenderingEngine uses them in order to render sections without
+ * invoking rendering objects.
+ *
+ * @see +[GRMustacheRendering kindOfRenderingObject:asEnumerationItem:]
+ */
+typedef NS_ENUM(NSInteger, GRMustacheRenderingObjectKind) {
+    /**
+     * The object provides its own rendering, or its class has not rendered
+     * yet: it must be rendered through the GRMustacheRendering protocols.
+     */
+    GRMustacheRenderingObjectKindCustom,
+    
+    /**
+     * nil and NSNull: sections render their content with an unmodified
+     * context, unless the object is an enumeration item.
+     */
+    GRMustacheRenderingObjectKindNull,
+    
+    /**
+     * NSNumber: sections render their content with an unmodified context,
+     * unless the number is an enumeration item.
+     */
+    GRMustacheRenderingObjectKindNumber,
+    
+    /**
+     * NSString: regular sections push the string on the context stack,
+     * inverted sections do not.
+     */
+    GRMustacheRenderingObjectKindString,
+    
+    /**
+     * NSDictionary and other objects: sections push the object on the context
+     * stack.
+     */
+    GRMustacheRenderingObjectKindObject,
+    
+    /**
+     * Objects conforming to NSFastEnumeration: regular sections render their
+     * content once for each item, inverted sections render their content with
+     * an unmodified context.
+     */
+    GRMustacheRenderingObjectKindEnumeration,
+};
+
+
 // =============================================================================
 #pragma mark - GRMustacheRendering
 
@@ -145,6 +247,45 @@
 // Documented in GRMustacheRendering.h
 + (id<GRMustacheRenderingWithIterationSupport>)renderingObjectWithBlock:(NSString *(^)(GRMustacheTag *tag, GRMustacheContext *context, BOOL *HTMLSafe, NSError **error))renderingBlock GRMUSTACHE_API_PUBLIC;
 
+/**
+ * Renders a rendering object into a buffer.
+ *
+ * Objects that conform to the GRMustacheRenderingWithBufferSupport protocol
+ * append their rendering in place. Other rendering objects are rendered
+ * through the string-returning GRMustacheRendering API, and their rendering
+ * is appended to the buffer.
+ *
+ * @param renderingObject  A rendering object, as returned by
+ *                         renderingObjectForObject:.
+ * @param tag              The tag to be rendered
+ * @param enumerationItem  YES if the object renders as an enumeration item.
+ * @param context          A context for rendering inner tags.
+ * @param buffer           The buffer the rendering is appended to.
+ * @param escapesHTML      YES if HTML-unsafe renderings should be escaped.
+ * @param HTMLSafe         Upon return contains YES if the rendering is
+ *                         HTML-safe.
+ * @param error            If there is an error performing the rendering, upon
+ *                         return contains an NSError object that describes the
+ *                         problem.
+ *
+ * @return YES if the rendering could be appended.
+ */
++ (BOOL)renderObject:(id)renderingObject forMustacheTag:(GRMustacheTag *)tag asEnumerationItem:(BOOL)enumerationItem context:(GRMustacheContext *)context intoBuffer:(GRMustacheBuffer *)buffer escapesHTML:(BOOL)escapesHTML HTMLSafe:(BOOL *)HTMLSafe error:(NSError **)error GRMUSTACHE_API_INTERNAL;
+
+/**
+ * Returns the built-in behavior of a rendering object.
+ *
+ * Whatever its kind, an enumeration item that is not a custom rendering
+ * object enters the context stack when it renders a section.
+ *
+ * @param renderingObject  A rendering object, as returned by
+ *                         renderingObjectForObject:.
+ * @param enumerationItem  YES if the object renders as an enumeration item.
+ *
+ * @return The kind of the rendering object.
+ */
++ (GRMustacheRenderingObjectKind)kindOfRenderingObject:(id)renderingObject asEnumerationItem:(BOOL)enumerationItem GRMUSTACHE_API_INTERNAL;
+
 + (void)pushCurrentTemplateRepository:(GRMustacheTemplateRepository *)templateRepository GRMUSTACHE_API_INTERNAL;
 + (void)popCurrentTemplateRepository GRMUSTACHE_API_INTERNAL;
 + (GRMustacheTemplateRepository *)currentTemplateRepository GRMUSTACHE_API_INTERNAL;
@@ -0,0 +1,425 @@
+// The MIT License
+//
+// Copyright (c) 2014 Gwendal Roué
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#import "GRMustacheSourceGenerator_private.h"
+#import "GRMustacheExpressionGenerator_private.h"
+#import "GRMustacheTemplateASTVisitor_private.h"
+#import "GRMustacheTemplateRepository_private.h"
+#import "GRMustacheTemplateAST_private.h"
+#import "GRMustacheInheritedPartialNode_private.h"
+#import "GRMustacheInheritableSectionNode_private.h"
+#import "GRMustachePartialNode_private.h"
+#import "GRMustacheVariableTag_private.h"
+#import "GRMustacheSectionTag_private.h"
+#import "GRMustacheTextNode_private.h"
+#import "GRMustachePrecompiledNode_private.h"
+#import "GRMustacheExpression_private.h"
+#import "GRMustacheToken_private.h"
+#import "GRMustacheError.h"
+
+static NSString *GRMustacheSourceStringLiteral(NSString *string);
+
+@interface GRMustacheSourceGenerator() <GRMustacheTemplateASTVisitor>
+@end
+
+@implementation GRMustacheSourceGenerator
+@synthesize templateRepository=_templateRepository;
+
+- (void)dealloc
+{
+    [_templateRepository release];
+    [_expressionGenerator release];
+    [_templateNameForTemplateAST release];
+    [super dealloc];
+}
+
++ (instancetype)sourceGeneratorWithTemplateRepository:(GRMustacheTemplateRepository *)templateRepository
+{
+    return [[[self alloc] initWithTemplateRepository:templateRepository] autorelease];
+}
+
+- (NSString *)sourceWithTemplateNames:(NSArray *)templateNames registrationFunctionName:(NSString *)registrationFunctionName error:(NSError **)error
+{
+    // Load all templates first, so that partials can be identified by the
+    // name of their template.
+    
+    NSMutableArray *templateASTs = [NSMutableArray arrayWithCapacity:templateNames.count];
+    NSMutableArray *templateStrings = [NSMutableArray arrayWithCapacity:templateNames.count];
+    [_templateNameForTemplateAST removeAllObjects];
+    for (NSString *templateName in templateNames) {
+        GRMustacheTemplateAST *templateAST = [_templateRepository templateASTNamed:templateName relativeToTemplateID:nil error:error];
+        if (!templateAST) {
+            return nil;
+        }
+        NSString *templateString = [self templateStringNamed:templateName error:error];
+        if (!templateString) {
+            return nil;
+        }
+        [templateASTs addObject:templateAST];
+        [templateStrings addObject:templateString];
+        [_templateNameForTemplateAST setObject:templateName forKey:[NSValue valueWithNonretainedObject:templateAST]];
+    }
+    
+    
+    // Generate
+    
+    NSMutableString *registrationStatements = [NSMutableString string];
+    _source = [NSMutableString string];
+    [_source appendString:@"// Generated by grmustache-precompile. Do not edit.\n\n"];
+    [_source appendString:@"#import \"GRMustache.h\"\n\n"];
+    [_source appendFormat:@"void %@(GRMustacheTemplateRepository *templateRepository);\n", registrationFunctionName];
+    
+    for (_templateIndex = 0; _templateIndex < templateNames.count; ++_templateIndex) {
+        NSString *templateName = [templateNames objectAtIndex:_templateIndex];
+        GRMustacheTemplateAST *templateAST = [templateASTs objectAtIndex:_templateIndex];
+        NSString *templateString = [templateStrings objectAtIndex:_templateIndex];
+        _blockCount = 0;
+        
+        [_source appendFormat:@"\n\n// =============================================================================\n#pragma mark - %@\n", templateName];
+        
+        NSString *blockIdentifier;
+        if ([self templateASTUsesInheritance:templateAST visitedTemplateASTs:[NSMutableSet set]]) {
+            // Inherited partials may override any node of the template
+            // and its partials: the template is compiled when it is loaded.
+            blockIdentifier = [self appendBlockWithTemplateString:templateString];
+        } else {
+            blockIdentifier = [self appendBlockWithTemplateAST:templateAST templateString:templateString error:error];
+            if (!blockIdentifier) {
+                _source = nil;
+                return nil;
+            }
+        }
+        
+        NSString *templateIdentifier = [NSString stringWithFormat:@"template_%lu", (unsigned long)_templateIndex];
+        NSString *contentType = (templateAST.contentType == GRMustacheContentTypeText) ? @"GRMustacheContentTypeText" : @"GRMustacheContentTypeHTML";
+        [_source appendFormat:@"\nstatic const GRMustachePrecompiledTemplate %@ = {\n    %@,\n    %@,\n    &%@,\n};\n", templateIdentifier, GRMustacheSourceStringLiteral(templateName), contentType, blockIdentifier];
+        [registrationStatements appendFormat:@"    [templateRepository registerPrecompiledTemplate:&%@];\n", templateIdentifier];
+    }
+    
+    [_source appendString:@"\n\n// =============================================================================\n#pragma mark - Registration\n\n"];
+    [_source appendFormat:@"void %@(GRMustacheTemplateRepository *templateRepository)\n{\n%@}\n", registrationFunctionName, registrationStatements];
+    
+    NSString *source = _source;
+    _source = nil;
+    return source;
+}
+
+
+#pragma mark - <GRMustacheTemplateASTVisitor>
+
+- (BOOL)visitTemplateAST:(GRMustacheTemplateAST *)templateAST error:(NSError **)error
+{
+    for (id<GRMustacheTemplateASTNode> ASTNode in templateAST.templateASTNodes) {
+        if (![ASTNode acceptTemplateASTVisitor:self error:error]) {
+            return NO;
+        }
+    }
+    return YES;
+}
+
+- (BOOL)visitInheritedPartialNode:(GRMustacheInheritedPartialNode *)inheritedPartialNode error:(NSError **)error
+{
+    NSAssert(NO, @"Templates that use inheritance are not precompiled");
+    return NO;
+}
+
+- (BOOL)visitInheritableSectionNode:(GRMustacheInheritableSectionNode *)inheritableSectionNode error:(NSError **)error
+{
+    NSAssert(NO, @"Templates that use inheritance are not precompiled");
+    return NO;
+}
+
+- (BOOL)visitPartialNode:(GRMustachePartialNode *)partialNode error:(NSError **)error
+{
+    NSString *partialTemplateName = [_templateNameForTemplateAST objectForKey:[NSValue valueWithNonretainedObject:partialNode.templateAST]];
+    if (partialTemplateName == nil) {
+        if (error != NULL) {
+            *error = [NSError errorWithDomain:GRMustacheErrorDomain
+                                         code:GRMustacheErrorCodeTemplateNotFound
+                                     userInfo:[NSDictionary dictionaryWithObject:[NSString stringWithFormat:@"Partial `%@` is not among the precompiled templates", partialNode.name]
+                                                                          forKey:NSLocalizedDescriptionKey]];
+        }
+        return NO;
+    }
+    
+    [_statements addObject:[NSString stringWithFormat:@"GRMustachePrecompiledRenderPartial(rendering, %lu)", (unsigned long)_partialNames.count]];
+    [_partialNames addObject:partialTemplateName];
+    return YES;
+}
+
+- (BOOL)visitVariableTag:(GRMustacheVariableTag *)variableTag error:(NSError **)error
+{
+    NSString *tagType = variableTag.escapesHTML ? @"GRMustachePrecompiledTagTypeEscapedVariable" : @"GRMustachePrecompiledTagTypeUnescapedVariable";
+    NSString *expressionString = [_expressionGenerator stringWithExpression:variableTag.expression];
+    
+    [_statements addObject:[NSString stringWithFormat:@"GRMustachePrecompiledRenderTag(rendering, %lu)", (unsigned long)_tags.count]];
+    [_tags addObject:[NSString stringWithFormat:@"{ %@, %@, %lu, NULL }", tagType, GRMustacheSourceStringLiteral(expressionString), (unsigned long)variableTag.token.line]];
+    return YES;
+}
+
+- (BOOL)visitSectionTag:(GRMustacheSectionTag *)sectionTag error:(NSError **)error
+{
+    NSString *contentIdentifier = [self appendBlockWithTemplateAST:sectionTag.innerTemplateAST templateString:sectionTag.innerTemplateString error:error];
+    if (!contentIdentifier) {
+        return NO;
+    }
+    
+    NSString *tagType = sectionTag.isInverted ? @"GRMustachePrecompiledTagTypeInvertedSection" : @"GRMustachePrecompiledTagTypeSection";
+    NSString *expressionString = [_expressionGenerator stringWithExpression:sectionTag.expression];
+    
+    [_statements addObject:[NSString stringWithFormat:@"GRMustachePrecompiledRenderTag(rendering, %lu)", (unsigned long)_tags.count]];
+    [_tags addObject:[NSString stringWithFormat:@"{ %@, %@, %lu, &%@ }", tagType, GRMustacheSourceStringLiteral(expressionString), (unsigned long)sectionTag.token.line, contentIdentifier]];
+    return YES;
+}
+
+- (BOOL)visitTextNode:(GRMustacheTextNode *)textNode error:(NSError **)error
+{
+    [_statements addObject:[NSString stringWithFormat:@"GRMustachePrecompiledRenderText(rendering, %lu)", (unsigned long)_texts.count]];
+    [_texts addObject:[NSString stringWithFormat:@"{ %@, %lu }", GRMustacheSourceStringLiteral(textNode.text), (unsigned long)textNode.UTF8Data.length]];
+    return YES;
+}
+
+- (BOOL)visitPrecompiledNode:(GRMustachePrecompiledNode *)precompiledNode error:(NSError **)error
+{
+    if (error != NULL) {
+        *error = [NSError errorWithDomain:GRMustacheErrorDomain
+                                     code:GRMustacheErrorCodeTemplateNotFound
+                                 userInfo:[NSDictionary dictionaryWithObject:@"Precompiled templates can not be precompiled again"
+                                                                      forKey:NSLocalizedDescriptionKey]];
+    }
+    return NO;
+}
+
+
+#pragma mark - Private
+
+- (instancetype)initWithTemplateRepository:(GRMustacheTemplateRepository *)templateRepository
+{
+    self = [super init];
+    if (self) {
+        _templateRepository = [templateRepository retain];
+        _expressionGenerator = [[GRMustacheExpressionGenerator alloc] init];
+        _templateNameForTemplateAST = [[NSMutableDictionary alloc] init];
+    }
+    return self;
+}
+
+/**
+ * Returns the source of a template, as provided by the data source of the
+ * template repository.
+ */
+- (NSString *)templateStringNamed:(NSString *)templateName error:(NSError **)error
+{
+    id<GRMustacheTemplateRepositoryDataSource> dataSource = _templateRepository.dataSource;
+    id templateID = [dataSource templateRepository:_templateRepository templateIDForName:templateName relativeToTemplateID:nil];
+    NSError *templateStringError = nil;
+    NSString *templateString = nil;
+    if (templateID) {
+        templateString = [dataSource templateRepository:_templateRepository templateStringForTemplateID:templateID error:&templateStringError];
+    }
+    if (!templateString) {
+        if (templateStringError == nil) {
+            templateStringError = [NSError errorWithDomain:GRMustacheErrorDomain
+                                                      code:GRMustacheErrorCodeTemplateNotFound
+                                                  userInfo:[NSDictionary dictionaryWithObject:[NSString stringWithFormat:@"No such template: `%@`", templateName]
+                                                                                       forKey:NSLocalizedDescriptionKey]];
+        }
+        if (error != NULL) {
+            *error = templateStringError;
+        }
+        return nil;
+    }
+    return templateString;
+}
+
+/**
+ * Returns YES if the template, or one of its partials, contains inherited
+ * partials or inheritable sections.
+ */
+- (BOOL)templateASTUsesInheritance:(GRMustacheTemplateAST *)templateAST visitedTemplateASTs:(NSMutableSet *)visitedTemplateASTs
+{
+    NSValue *templateASTValue = [NSValue valueWithNonretainedObject:templateAST];
+    if ([visitedTemplateASTs containsObject:templateASTValue]) {
+        return NO;
+    }
+    [visitedTemplateASTs addObject:templateASTValue];
+    
+    for (id<GRMustacheTemplateASTNode> ASTNode in templateAST.templateASTNodes) {
+        if ([ASTNode isKindOfClass:[GRMustacheInheritedPartialNode class]] || [ASTNode isKindOfClass:[GRMustacheInheritableSectionNode class]]) {
+            return YES;
+        }
+        if ([ASTNode isKindOfClass:[GRMustacheSectionTag class]]) {
+            if ([self templateASTUsesInheritance:((GRMustacheSectionTag *)ASTNode).innerTemplateAST visitedTemplateASTs:visitedTemplateASTs]) {
+                return YES;
+            }
+        }
+        if ([ASTNode isKindOfClass:[GRMustachePartialNode class]]) {
+            if ([self templateASTUsesInheritance:((GRMustachePartialNode *)ASTNode).templateAST visitedTemplateASTs:visitedTemplateASTs]) {
+                return YES;
+            }
+        }
+    }
+    return NO;
+}
+
+/**
+ * Appends the function and the tables of a precompiled block, and returns the
+ * identifier of the block.
+ */
+- (NSString *)appendBlockWithTemplateAST:(GRMustacheTemplateAST *)templateAST templateString:(NSString *)templateString error:(NSError **)error
+{
+    NSString *identifier = [NSString stringWithFormat:@"%lu_%lu", (unsigned long)_templateIndex, (unsigned long)_blockCount++];
+    
+    // Save the state of the enclosing block
+    NSMutableArray *enclosingStatements = _statements;
+    NSMutableArray *enclosingTexts = _texts;
+    NSMutableArray *enclosingTags = _tags;
+    NSMutableArray *enclosingPartialNames = _partialNames;
+    
+    _statements = [NSMutableArray array];
+    _texts = [NSMutableArray array];
+    _tags = [NSMutableArray array];
+    _partialNames = [NSMutableArray array];
+    
+    BOOL success = [self visitTemplateAST:templateAST error:error];
+    if (success) {
+        // Rendering function
+        [_source appendFormat:@"\nstatic BOOL render_%@(GRMustachePrecompiledRendering *rendering)\n{\n", identifier];
+        if (_statements.count == 0) {
+            [_source appendString:@"    return YES;\n"];
+        } else {
+            [_source appendFormat:@"    return %@;\n", [_statements componentsJoinedByString:@"\n        && "]];
+        }
+        [_source appendString:@"}\n"];
+        
+        // Tables
+        NSString *texts = [self appendTableWithType:@"GRMustachePrecompiledText" name:[@"texts_" stringByAppendingString:identifier] entries:_texts];
+        NSString *tags = [self appendTableWithType:@"GRMustachePrecompiledTag" name:[@"tags_" stringByAppendingString:identifier] entries:_tags];
+        NSMutableArray *partialNameLiterals = [NSMutableArray arrayWithCapacity:_partialNames.count];
+        for (NSString *partialName in _partialNames) {
+            [partialNameLiterals addObject:GRMustacheSourceStringLiteral(partialName)];
+        }
+        NSString *partialNames = [self appendTableWithType:@"char * const" name:[@"partials_" stringByAppendingString:identifier] entries:partialNameLiterals];
+        
+        // Block
+        [_source appendFormat:@"\nstatic const GRMustachePrecompiledBlock block_%@ = {\n    render_%@,\n    %@,\n    %@, %lu,\n    %@, %lu,\n    %@, %lu,\n};\n",
+         identifier,
+         identifier,
+         GRMustacheSourceStringLiteral(templateString),
+         texts, (unsigned long)_texts.count,
+         tags, (unsigned long)_tags.count,
+         partialNames, (unsigned long)_partialNames.count];
+    }
+    
+    // Restore the state of the enclosing block
+    _statements = enclosingStatements;
+    _texts = enclosingTexts;
+    _tags = enclosingTags;
+    _partialNames = enclosingPartialNames;
+    
+    return success ? [@"block_" stringByAppendingString:identifier] : nil;
+}
+
+/**
+ * Appends a block without rendering function, which is compiled from its
+ * template string when it is loaded, and returns the identifier of the block.
+ */
+- (NSString *)appendBlockWithTemplateString:(NSString *)templateString
+{
+    NSString *identifier = [NSString stringWithFormat:@"%lu_%lu", (unsigned long)_templateIndex, (unsigned long)_blockCount++];
+    [_source appendFormat:@"\nstatic const GRMustachePrecompiledBlock block_%@ = {\n    NULL,\n    %@,\n    NULL, 0,\n    NULL, 0,\n    NULL, 0,\n};\n",
+     identifier,
+     GRMustacheSourceStringLiteral(templateString)];
+    return [@"block_" stringByAppendingString:identifier];
+}
+
+/**
+ * Appends a static array, and returns the expression that refers to it: the
+ * name of the array, or NULL for empty arrays.
+ */
+- (NSString *)appendTableWithType:(NSString *)type name:(NSString *)name entries:(NSArray *)entries
+{
+    if (entries.count == 0) {
+        return @"NULL";
+    }
+    [_source appendFormat:@"\nstatic const %@ %@[] = {\n", type, name];
+    for (NSString *entry in entries) {
+        [_source appendFormat:@"    %@,\n", entry];
+    }
+    [_source appendString:@"};\n"];
+    return name;
+}
+
+@end
+
+/**
+ * Returns a C string literal of the UTF-8 encoding of _string_.
+ *
+ * Non-ASCII bytes are written as octal escape sequences, which, unlike
+ * hexadecimal ones, can not absorb the following characters. Literals are
+ * split after newlines.
+ */
+static NSString *GRMustacheSourceStringLiteral(NSString *string)
+{
+    NSData *UTF8Data = [string dataUsingEncoding:NSUTF8StringEncoding];
+    const unsigned char *bytes = UTF8Data.bytes;
+    NSUInteger length = UTF8Data.length;
+    
+    NSMutableString *literal = [NSMutableString stringWithCapacity:length + 2];
+    [literal appendString:@"\""];
+    for (NSUInteger i = 0; i < length; ++i) {
+        unsigned char c = bytes[i];
+        switch (c) {
+            case '"':
+                [literal appendString:@"\\\""];
+                break;
+            case '\\':
+                [literal appendString:@"\\\\"];
+                break;
+            case '?':
+                // Avoid trigraphs
+                [literal appendString:@"\\?"];
+                break;
+            case '\t':
+                [literal appendString:@"\\t"];
+                break;
+            case '\r':
+                [literal appendString:@"\\r"];
+                break;
+            case '\n':
+                [literal appendString:@"\\n"];
+                if (i + 1 < length) {
+                    [literal appendString:@"\"\n        \""];
+                }
+                break;
+            default:
+                if (c >= 0x20 && c < 0x7F) {
+                    [literal appendFormat:@"%c", c];
+                } else {
+                    [literal appendFormat:@"\\%03o", c];
+                }
+                break;
+        }
+    }
+    [literal appendString:@"\""];
+    return literal;
+}
@@ -0,0 +1,80 @@
+// The MIT License
+//
+// Copyright (c) 2014 Gwendal Roué
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#import <Foundation/Foundation.h>
+#import "GRMustacheAvailabilityMacros_private.h"
+
+@class GRMustacheTemplateRepository;
+@class GRMustacheExpressionGenerator;
+
+/**
+ * The GRMustacheSourceGenerator generates the Objective-C source code of
+ * precompiled templates.
+ *
+ * The generated source contains a rendering function for each template and
+ * each section, static tables of texts, tags and partial names, and a
+ * registration function that registers the templates into a repository.
+ *
+ * Templates that use inheritance, directly or through their partials, are not
+ * precompiled: their source is compiled when they are loaded.
+ *
+ * @see GRMustachePrecompiledTemplate
+ * @see -[GRMustacheTemplateRepository registerPrecompiledTemplate:]
+ */
+@interface GRMustacheSourceGenerator : NSObject {
+@private
+    GRMustacheTemplateRepository *_templateRepository;
+    GRMustacheExpressionGenerator *_expressionGenerator;
+    NSMutableDictionary *_templateNameForTemplateAST;
+    NSMutableString *_source;
+    NSUInteger _templateIndex;
+    NSUInteger _blockCount;
+    NSMutableArray *_statements;
+    NSMutableArray *_texts;
+    NSMutableArray *_tags;
+    NSMutableArray *_partialNames;
+}
+
+@property (nonatomic, retain, readonly) GRMustacheTemplateRepository *templateRepository GRMUSTACHE_API_INTERNAL;
+
+/**
+ * Returns a source generator that generates the source of templates loaded
+ * from _templateRepository_.
+ */
++ (instancetype)sourceGeneratorWithTemplateRepository:(GRMustacheTemplateRepository *)templateRepository GRMUSTACHE_API_INTERNAL;
+
+/**
+ * Returns the Objective-C source code of precompiled templates.
+ *
+ * @param templateNames             The names of the templates. Partials must
+ *                                  be included.
+ * @param registrationFunctionName  The name of the generated function that
+ *                                  registers the templates into a repository.
+ * @param error                     If there is an error loading a template or
+ *                                  a partial, upon return contains an NSError
+ *                                  object that describes the problem.
+ *
+ * @return The source code, or nil if an error occurred.
+ */
+- (NSString *)sourceWithTemplateNames:(NSArray *)templateNames registrationFunctionName:(NSString *)registrationFunctionName error:(NSError **)error GRMUSTACHE_API_INTERNAL;
+
+@end
@@ -0,0 +1,304 @@
+// The MIT License
+// 
+// Copyright (c) 2014 Gwendal Roué
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#import <libkern/OSByteOrder.h>
+#import "GRMustacheTemplateArchiveGenerator_private.h"
+#import "GRMustacheTemplateArchive_private.h"
+#import "GRMustacheExpressionGenerator_private.h"
+#import "GRMustacheTemplateASTVisitor_private.h"
+#import "GRMustacheTemplateRepository_private.h"
+#import "GRMustacheTemplateAST_private.h"
+#import "GRMustacheInheritedPartialNode_private.h"
+#import "GRMustacheInheritableSectionNode_private.h"
+#import "GRMustachePartialNode_private.h"
+#import "GRMustacheVariableTag_private.h"
+#import "GRMustacheSectionTag_private.h"
+#import "GRMustacheTextNode_private.h"
+#import "GRMustachePrecompiledNode_private.h"
+#import "GRMustacheToken_private.h"
+#import "GRMustacheError.h"
+
+@interface GRMustacheTemplateArchiveGenerator() <GRMustacheTemplateASTVisitor>
+@end
+
+@implementation GRMustacheTemplateArchiveGenerator
+@synthesize templateRepository=_templateRepository;
+
+- (void)dealloc
+{
+    [_templateRepository release];
+    [_expressionGenerator release];
+    [_templateNameForTemplateAST release];
+    [super dealloc];
+}
+
++ (instancetype)templateArchiveGeneratorWithTemplateRepository:(GRMustacheTemplateRepository *)templateRepository
+{
+    return [[[self alloc] initWithTemplateRepository:templateRepository] autorelease];
+}
+
+- (NSData *)archiveDataWithTemplateNames:(NSArray *)templateNames error:(NSError **)error
+{
+    // Load all templates first, so that partials can be identified by the
+    // name of their template.
+    
+    NSMutableArray *templateASTs = [NSMutableArray arrayWithCapacity:templateNames.count];
+    [_templateNameForTemplateAST removeAllObjects];
+    for (NSString *templateName in templateNames) {
+        GRMustacheTemplateAST *templateAST = [_templateRepository templateASTNamed:templateName relativeToTemplateID:nil error:error];
+        if (!templateAST) {
+            return nil;
+        }
+        [templateASTs addObject:templateAST];
+        [_templateNameForTemplateAST setObject:templateName forKey:[NSValue valueWithNonretainedObject:templateAST]];
+    }
+    
+    
+    // Encode ASTs
+    
+    NSMutableData *templates = [NSMutableData dataWithCapacity:templateNames.count * sizeof(GRMustacheTemplateArchiveTemplate)];
+    _words = [NSMutableData data];
+    _strings = [NSMutableData data];
+    _stringOffsetForString = [NSMutableDictionary dictionary];
+    
+    BOOL success = YES;
+    for (NSUInteger templateIndex = 0; templateIndex < templateNames.count; ++templateIndex) {
+        NSString *templateName = [templateNames objectAtIndex:templateIndex];
+        GRMustacheTemplateAST *templateAST = [templateASTs objectAtIndex:templateIndex];
+        
+        // The template string is the one of the tag tokens. Templates
+        // without any tag do not need any.
+        _templateString = nil;
+        uint32_t ASTWordIndex = (uint32_t)(_words.length / sizeof(uint32_t));
+        if (![self visitTemplateAST:templateAST error:error]) {
+            success = NO;
+            break;
+        }
+        
+        GRMustacheTemplateArchiveTemplate archivedTemplate;
+        [self getOffset:&archivedTemplate.nameOffset length:&archivedTemplate.nameLength ofString:templateName];
+        [self getOffset:&archivedTemplate.templateStringOffset length:&archivedTemplate.templateStringLength ofString:(_templateString ?: @"")];
+        archivedTemplate.contentType = OSSwapHostToLittleInt32((uint32_t)templateAST.contentType);
+        archivedTemplate.ASTWordIndex = OSSwapHostToLittleInt32(ASTWordIndex);
+        [templates appendBytes:&archivedTemplate length:sizeof(GRMustacheTemplateArchiveTemplate)];
+    }
+    
+    
+    // Archive: header, templates, words, strings
+    
+    NSMutableData *archiveData = nil;
+    if (success) {
+        GRMustacheTemplateArchiveHeader header;
+        memcpy(header.magic, "GRMUSTAR", sizeof(header.magic));
+        header.version = OSSwapHostToLittleInt32(GRMustacheTemplateArchiveVersion);
+        header.templateCount = OSSwapHostToLittleInt32((uint32_t)templateNames.count);
+        header.templatesOffset = OSSwapHostToLittleInt32((uint32_t)sizeof(GRMustacheTemplateArchiveHeader));
+        header.wordsOffset = OSSwapHostToLittleInt32((uint32_t)(sizeof(GRMustacheTemplateArchiveHeader) + templates.length));
+        header.wordCount = OSSwapHostToLittleInt32((uint32_t)(_words.length / sizeof(uint32_t)));
+        header.stringsOffset = OSSwapHostToLittleInt32((uint32_t)(sizeof(GRMustacheTemplateArchiveHeader) + templates.length + _words.length));
+        header.stringsLength = OSSwapHostToLittleInt32((uint32_t)_strings.length);
+        
+        archiveData = [NSMutableData dataWithCapacity:sizeof(GRMustacheTemplateArchiveHeader) + templates.length + _words.length + _strings.length];
+        [archiveData appendBytes:&header length:sizeof(GRMustacheTemplateArchiveHeader)];
+        [archiveData appendData:templates];
+        [archiveData appendData:_words];
+        [archiveData appendData:_strings];
+    }
+    
+    _words = nil;
+    _strings = nil;
+    _stringOffsetForString = nil;
+    _templateString = nil;
+    return archiveData;
+}
+
+
+#pragma mark - <GRMustacheTemplateASTVisitor>
+
+- (BOOL)visitTemplateAST:(GRMustacheTemplateAST *)templateAST error:(NSError **)error
+{
+    NSArray *templateASTNodes = templateAST.templateASTNodes;
+    [self appendWord:(uint32_t)templateASTNodes.count];
+    for (id<GRMustacheTemplateASTNode> ASTNode in templateASTNodes) {
+        if (![ASTNode acceptTemplateASTVisitor:self error:error]) {
+            return NO;
+        }
+    }
+    return YES;
+}
+
+- (BOOL)visitInheritedPartialNode:(GRMustacheInheritedPartialNode *)inheritedPartialNode error:(NSError **)error
+{
+    GRMustachePartialNode *parentPartialNode = inheritedPartialNode.parentPartialNode;
+    NSString *partialTemplateName = [self templateNameForPartialNode:parentPartialNode error:error];
+    if (partialTemplateName == nil) {
+        return NO;
+    }
+    
+    [self appendWord:GRMustacheTemplateArchiveNodeTypeInheritedPartial];
+    [self appendString:partialTemplateName];
+    return [self visitTemplateAST:inheritedPartialNode.overridingTemplateAST error:error];
+}
+
+- (BOOL)visitInheritableSectionNode:(GRMustacheInheritableSectionNode *)inheritableSectionNode error:(NSError **)error
+{
+    [self appendWord:GRMustacheTemplateArchiveNodeTypeInheritableSection];
+    [self appendString:inheritableSectionNode.name];
+    return [self visitTemplateAST:inheritableSectionNode.innerTemplateAST error:error];
+}
+
+- (BOOL)visitPartialNode:(GRMustachePartialNode *)partialNode error:(NSError **)error
+{
+    NSString *partialTemplateName = [self templateNameForPartialNode:partialNode error:error];
+    if (partialTemplateName == nil) {
+        return NO;
+    }
+    
+    [self appendWord:GRMustacheTemplateArchiveNodeTypePartial];
+    [self appendString:partialTemplateName];
+    return YES;
+}
+
+- (BOOL)visitVariableTag:(GRMustacheVariableTag *)variableTag error:(NSError **)error
+{
+    [self appendWord:GRMustacheTemplateArchiveNodeTypeVariableTag];
+    [self appendToken:variableTag.token];
+    [self appendString:[_expressionGenerator stringWithExpression:variableTag.expression]];
+    return YES;
+}
+
+- (BOOL)visitSectionTag:(GRMustacheSectionTag *)sectionTag error:(NSError **)error
+{
+    NSRange innerRange = sectionTag.innerRange;
+    [self appendWord:GRMustacheTemplateArchiveNodeTypeSectionTag];
+    [self appendToken:sectionTag.token];
+    [self appendString:[_expressionGenerator stringWithExpression:sectionTag.expression]];
+    [self appendWord:(uint32_t)innerRange.location];
+    [self appendWord:(uint32_t)innerRange.length];
+    return [self visitTemplateAST:sectionTag.innerTemplateAST error:error];
+}
+
+- (BOOL)visitTextNode:(GRMustacheTextNode *)textNode error:(NSError **)error
+{
+    [self appendWord:GRMustacheTemplateArchiveNodeTypeText];
+    [self appendString:textNode.text];
+    return YES;
+}
+
+- (BOOL)visitPrecompiledNode:(GRMustachePrecompiledNode *)precompiledNode error:(NSError **)error
+{
+    if (error != NULL) {
+        *error = [NSError errorWithDomain:GRMustacheErrorDomain
+                                     code:GRMustacheErrorCodeTemplateNotFound
+                                 userInfo:[NSDictionary dictionaryWithObject:@"Precompiled templates can not be archived"
+                                                                      forKey:NSLocalizedDescriptionKey]];
+    }
+    return NO;
+}
+
+
+#pragma mark - Private
+
+- (instancetype)initWithTemplateRepository:(GRMustacheTemplateRepository *)templateRepository
+{
+    self = [super init];
+    if (self) {
+        _templateRepository = [templateRepository retain];
+        _expressionGenerator = [[GRMustacheExpressionGenerator alloc] init];
+        _templateNameForTemplateAST = [[NSMutableDictionary alloc] init];
+    }
+    return self;
+}
+
+/**
+ * Returns the name of the archived template loaded by a partial node.
+ */
+- (NSString *)templateNameForPartialNode:(GRMustachePartialNode *)partialNode error:(NSError **)error
+{
+    NSString *partialTemplateName = [_templateNameForTemplateAST objectForKey:[NSValue valueWithNonretainedObject:partialNode.templateAST]];
+    if (partialTemplateName == nil) {
+        if (error != NULL) {
+            *error = [NSError errorWithDomain:GRMustacheErrorDomain
+                                         code:GRMustacheErrorCodeTemplateNotFound
+                                     userInfo:[NSDictionary dictionaryWithObject:[NSString stringWithFormat:@"Partial `%@` is not among the archived templates", partialNode.name]
+                                                                          forKey:NSLocalizedDescriptionKey]];
+        }
+        return nil;
+    }
+    return partialTemplateName;
+}
+
+- (void)appendWord:(uint32_t)word
+{
+    uint32_t littleEndianWord = OSSwapHostToLittleInt32(word);
+    [_words appendBytes:&littleEndianWord length:sizeof(uint32_t)];
+}
+
+/**
+ * Appends a string reference to the words, and the string to the string pool
+ * unless it is already there.
+ */
+- (void)appendString:(NSString *)string
+{
+    uint32_t offset;
+    uint32_t length;
+    [self getOffset:&offset length:&length ofString:string];
+    [_words appendBytes:&offset length:sizeof(uint32_t)];
+    [_words appendBytes:&length length:sizeof(uint32_t)];
+}
+
+/**
+ * Returns the little-endian offset and length of a string in the string
+ * pool.
+ */
+- (void)getOffset:(uint32_t *)offset length:(uint32_t *)length ofString:(NSString *)string
+{
+    NSData *UTF8Data = [string dataUsingEncoding:NSUTF8StringEncoding];
+    NSNumber *stringOffset = [_stringOffsetForString objectForKey:string];
+    if (stringOffset == nil) {
+        stringOffset = [NSNumber numberWithUnsignedInteger:_strings.length];
+        [_strings appendData:UTF8Data];
+        [_stringOffsetForString setObject:stringOffset forKey:string];
+    }
+    *offset = OSSwapHostToLittleInt32((uint32_t)[stringOffset unsignedIntegerValue]);
+    *length = OSSwapHostToLittleInt32((uint32_t)UTF8Data.length);
+}
+
+- (void)appendToken:(GRMustacheToken *)token
+{
+    // All tags of a template come from the same template string.
+    if (_templateString == nil) {
+        _templateString = token.templateString;
+    }
+    NSAssert([token.templateString isEqualToString:_templateString], @"WTF tokens from different template strings");
+    
+    NSRange range = token.range;
+    NSRange tagInnerRange = token.tagInnerRange;
+    [self appendWord:(uint32_t)token.type];
+    [self appendWord:(uint32_t)token.line];
+    [self appendWord:(uint32_t)range.location];
+    [self appendWord:(uint32_t)range.length];
+    [self appendWord:(uint32_t)tagInnerRange.location];
+    [self appendWord:(uint32_t)tagInnerRange.length];
+}
+
+@end
@@ -0,0 +1,67 @@
+// The MIT License
+// 
+// Copyright (c) 2014 Gwendal Roué
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#import <Foundation/Foundation.h>
+#import "GRMustacheAvailabilityMacros_private.h"
+
+@class GRMustacheTemplateRepository;
+@class GRMustacheExpressionGenerator;
+
+/**
+ * The GRMustacheTemplateArchiveGenerator generates template archives.
+ *
+ * @see GRMustacheTemplateArchive
+ * @see -[GRMustacheTemplateRepository registerTemplateArchiveAtPath:error:]
+ */
+@interface GRMustacheTemplateArchiveGenerator : NSObject {
+@private
+    GRMustacheTemplateRepository *_templateRepository;
+    GRMustacheExpressionGenerator *_expressionGenerator;
+    NSMutableDictionary *_templateNameForTemplateAST;
+    NSMutableData *_words;
+    NSMutableData *_strings;
+    NSMutableDictionary *_stringOffsetForString;
+    NSString *_templateString;
+}
+
+@property (nonatomic, retain, readonly) GRMustacheTemplateRepository *templateRepository GRMUSTACHE_API_INTERNAL;
+
+/**
+ * Returns an archive generator that archives templates loaded from
+ * _templateRepository_.
+ */
++ (instancetype)templateArchiveGeneratorWithTemplateRepository:(GRMustacheTemplateRepository *)templateRepository GRMUSTACHE_API_INTERNAL;
+
+/**
+ * Returns the content of a template archive.
+ *
+ * @param templateNames  The names of the templates. Partials must be
+ *                       included.
+ * @param error          If there is an error loading a template or a
+ *                       partial, upon return contains an NSError object that
+ *                       describes the problem.
+ *
+ * @return The archive data, or nil if an error occurred.
+ */
+- (NSData *)archiveDataWithTemplateNames:(NSArray *)templateNames error:(NSError **)error GRMUSTACHE_API_INTERNAL;
+
+@end
@@ -33,6 +33,7 @@
 #import "GRMustacheVariableTag_private.h"
 #import "GRMustacheSectionTag_private.h"
 #import "GRMustacheTextNode_private.h"
+#import "GRMustachePrecompiledNode_private.h"
 
 
 @interface GRMustacheTemplateGenerator() <GRMustacheTemplateASTVisitor>
@@ -152,6 +153,12 @@
     return YES;
 }
 
+- (BOOL)visitPrecompiledNode:(GRMustachePrecompiledNode *)precompiledNode error:(NSError **)error
+{
+    [_templateString appendString:precompiledNode.templateString];
+    return YES;
+}
+
 
 #pragma mark - Private
 
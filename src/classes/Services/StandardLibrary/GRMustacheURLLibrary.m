@@ -113,29 +113,33 @@
     
     string = [string stringByAddingPercentEscapesUsingEncoding:NSUTF8StringEncoding];
     
-    static const NSString *escapeForCharacter[] = {
-        ['$'] = @"%24",
-        ['&'] = @"%26",
-        ['+'] = @"%2B",
-        [','] = @"%2C",
-        ['/'] = @"%2F",
-        [':'] = @"%3A",
-        [';'] = @"%3B",
-        ['='] = @"%3D",
-        ['?'] = @"%3F",
-        ['@'] = @"%40",
-        [' '] = @"%20",
-        ['\t'] = @"%09",
-        ['#'] = @"%23",
-        ['<'] = @"%3C",
-        ['>'] = @"%3E",
-        ['\"'] = @"%22",
-        ['\n'] = @"%0A",
-        ['\r'] = @"%0D",
-    };
-    static const int escapeForCharacterLength = sizeof(escapeForCharacter) / sizeof(NSString *);
-    NSUInteger capacity = ([string length] + 20) * 1.2;
-    return GRMustacheTranslateCharacters(string, escapeForCharacter, escapeForCharacterLength, capacity);
+    static GRMustacheEscapeTable *escapeTable;
+    static dispatch_once_t onceToken;
+    dispatch_once(&onceToken, ^{
+        static const char *escapeForCharacter[] = {
+            ['$'] = "%24",
+            ['&'] = "%26",
+            ['+'] = "%2B",
+            [','] = "%2C",
+            ['/'] = "%2F",
+            [':'] = "%3A",
+            [';'] = "%3B",
+            ['='] = "%3D",
+            ['?'] = "%3F",
+            ['@'] = "%40",
+            [' '] = "%20",
+            ['\t'] = "%09",
+            ['#'] = "%23",
+            ['<'] = "%3C",
+            ['>'] = "%3E",
+            ['\"'] = "%22",
+            ['\n'] = "%0A",
+            ['\r'] = "%0D",
+        };
+        static const size_t escapeForCharacterLength = sizeof(escapeForCharacter) / sizeof(const char *);
+        escapeTable = GRMustacheEscapeTableCreate(escapeForCharacter, escapeForCharacterLength, NULL, NULL, 0);
+    });
+    return GRMustacheTranslateCharacters(string, escapeTable);
 }
 
 @end
@@ -32,6 +32,7 @@
 #define GRMUSTACHE_VERSION_7_1  7010
 #define GRMUSTACHE_VERSION_7_2  7020
 #define GRMUSTACHE_VERSION_7_3  7030
+#define GRMUSTACHE_VERSION_7_4  7040
 
 
 
@@ -39,10 +40,10 @@
 
 
 /* 
- * If max GRMustacheVersion not specified, assume 7.3
+ * If max GRMustacheVersion not specified, assume 7.4
  */
 #ifndef GRMUSTACHE_VERSION_MAX_ALLOWED
-#define GRMUSTACHE_VERSION_MAX_ALLOWED    GRMUSTACHE_VERSION_7_3
+#define GRMUSTACHE_VERSION_MAX_ALLOWED    GRMUSTACHE_VERSION_7_4
 #endif
 
 /*
@@ -283,3 +284,98 @@
 #else
 #define DEPRECATED_IN_GRMUSTACHE_VERSION_7_3_AND_LATER
 #endif
+
+
+
+
+
+
+/*
+ * AVAILABLE_GRMUSTACHE_VERSION_7_4_AND_LATER
+ * 
+ * Used on declarations introduced in GRMustache 7.4
+ */
+#if GRMUSTACHE_VERSION_MAX_ALLOWED < GRMUSTACHE_VERSION_7_4
+#define AVAILABLE_GRMUSTACHE_VERSION_7_4_AND_LATER    UNAVAILABLE_ATTRIBUTE
+#elif GRMUSTACHE_VERSION_MIN_REQUIRED < GRMUSTACHE_VERSION_7_4
+#define AVAILABLE_GRMUSTACHE_VERSION_7_4_AND_LATER    WEAK_IMPORT_ATTRIBUTE
+#else
+#define AVAILABLE_GRMUSTACHE_VERSION_7_4_AND_LATER
+#endif
+
+/*
+ * AVAILABLE_GRMUSTACHE_VERSION_7_4_AND_LATER_BUT_DEPRECATED
+ * 
+ * Used on declarations introduced in GRMustache 7.4,
+ * and deprecated in GRMustache 7.4
+ */
+#if GRMUSTACHE_VERSION_MIN_REQUIRED >= GRMUSTACHE_VERSION_7_4
+#define AVAILABLE_GRMUSTACHE_VERSION_7_4_AND_LATER_BUT_DEPRECATED    DEPRECATED_ATTRIBUTE
+#else
+#define AVAILABLE_GRMUSTACHE_VERSION_7_4_AND_LATER_BUT_DEPRECATED    AVAILABLE_GRMUSTACHE_VERSION_7_4_AND_LATER
+#endif
+
+/*
+ * AVAILABLE_GRMUSTACHE_VERSION_7_0_AND_LATER_BUT_DEPRECATED_IN_GRMUSTACHE_VERSION_7_4
+ * 
+ * Used on declarations introduced in GRMustache 7.0,
+ * but later deprecated in GRMustache 7.4
+ */
+#if GRMUSTACHE_VERSION_MIN_REQUIRED >= GRMUSTACHE_VERSION_7_4
+#define AVAILABLE_GRMUSTACHE_VERSION_7_0_AND_LATER_BUT_DEPRECATED_IN_GRMUSTACHE_VERSION_7_4    DEPRECATED_ATTRIBUTE
+#else
+#define AVAILABLE_GRMUSTACHE_VERSION_7_0_AND_LATER_BUT_DEPRECATED_IN_GRMUSTACHE_VERSION_7_4    AVAILABLE_GRMUSTACHE_VERSION_7_0_AND_LATER
+#endif
+
+/*
+ * AVAILABLE_GRMUSTACHE_VERSION_7_1_AND_LATER_BUT_DEPRECATED_IN_GRMUSTACHE_VERSION_7_4
+ * 
+ * Used on declarations introduced in GRMustache 7.1,
+ * but later deprecated in GRMustache 7.4
+ */
+#if GRMUSTACHE_VERSION_MIN_REQUIRED >= GRMUSTACHE_VERSION_7_4
+#define AVAILABLE_GRMUSTACHE_VERSION_7_1_AND_LATER_BUT_DEPRECATED_IN_GRMUSTACHE_VERSION_7_4    DEPRECATED_ATTRIBUTE
+#else
+#define AVAILABLE_GRMUSTACHE_VERSION_7_1_AND_LATER_BUT_DEPRECATED_IN_GRMUSTACHE_VERSION_7_4    AVAILABLE_GRMUSTACHE_VERSION_7_1_AND_LATER
+#endif
+
+/*
+ * AVAILABLE_GRMUSTACHE_VERSION_7_2_AND_LATER_BUT_DEPRECATED_IN_GRMUSTACHE_VERSION_7_4
+ * 
+ * Used on declarations introduced in GRMustache 7.2,
+ * but later deprecated in GRMustache 7.4
+ */
+#if GRMUSTACHE_VERSION_MIN_REQUIRED >= GRMUSTACHE_VERSION_7_4
+#define AVAILABLE_GRMUSTACHE_VERSION_7_2_AND_LATER_BUT_DEPRECATED_IN_GRMUSTACHE_VERSION_7_4    DEPRECATED_ATTRIBUTE
+#else
+#define AVAILABLE_GRMUSTACHE_VERSION_7_2_AND_LATER_BUT_DEPRECATED_IN_GRMUSTACHE_VERSION_7_4    AVAILABLE_GRMUSTACHE_VERSION_7_2_AND_LATER
+#endif
+
+/*
+ * AVAILABLE_GRMUSTACHE_VERSION_7_3_AND_LATER_BUT_DEPRECATED_IN_GRMUSTACHE_VERSION_7_4
+ * 
+ * Used on declarations introduced in GRMustache 7.3,
+ * but later deprecated in GRMustache 7.4
+ */
+#if GRMUSTACHE_VERSION_MIN_REQUIRED >= GRMUSTACHE_VERSION_7_4
+#define AVAILABLE_GRMUSTACHE_VERSION_7_3_AND_LATER_BUT_DEPRECATED_IN_GRMUSTACHE_VERSION_7_4    DEPRECATED_ATTRIBUTE
+#else
+#define AVAILABLE_GRMUSTACHE_VERSION_7_3_AND_LATER_BUT_DEPRECATED_IN_GRMUSTACHE_VERSION_7_4    AVAILABLE_GRMUSTACHE_VERSION_7_3_AND_LATER
+#endif
+
+/*
+ * DEPRECATED_IN_GRMUSTACHE_VERSION_7_4_AND_LATER
+ * 
+ * Used on types deprecated in GRMustache 7.4
+ */
+#if GRMUSTACHE_VERSION_MIN_REQUIRED >= GRMUSTACHE_VERSION_7_4
+#define DEPRECATED_IN_GRMUSTACHE_VERSION_7_4_AND_LATER    DEPRECATED_ATTRIBUTE
+#else
+#define DEPRECATED_IN_GRMUSTACHE_VERSION_7_4_AND_LATER
+#endif
+
+
+
+
+
+
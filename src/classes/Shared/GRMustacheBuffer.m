@@ -0,0 +1,618 @@
+// The MIT License
+//
+// Copyright (c) 2014 Gwendal Roué
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#import <pthread.h>
+#import "GRMustacheBuffer_private.h"
+#import "GRMustacheTranslateCharacters_private.h"
+
+#if !defined(NS_BLOCK_ASSERTIONS)
+// For testing purpose
+GRMustacheBufferStatistics GRMustacheBufferCurrentStatistics;
+#endif
+
+#define GRMustacheBufferUnitSize(buffer) ((buffer)->stringBuffer ? sizeof(UniChar) : 1)
+
+static void GRMustacheBufferFreeChunksBefore(GRMustacheBuffer *buffer, GRMustacheBufferChunk *chunk);
+
+
+// =============================================================================
+#pragma mark - Per-thread pool
+
+/**
+ * The chunks and the segment storage left by released buffers, ready for
+ * future buffers of the same thread.
+ *
+ * Pooled chunks have their capacity expressed in bytes, since they may be
+ * reused by string buffers as well as by byte buffers.
+ */
+typedef struct {
+    GRMustacheBufferChunk *chunks;
+    NSUInteger byteCount;
+    GRMustacheBufferSegment *segments;
+    NSUInteger segmentCapacity;
+} GRMustacheBufferPool;
+
+static void GRMustacheBufferPoolDrain(GRMustacheBufferPool *pool)
+{
+    while (pool->chunks) {
+        GRMustacheBufferChunk *next = pool->chunks->next;
+        free(pool->chunks->bytes);
+        free(pool->chunks);
+        pool->chunks = next;
+    }
+    pool->byteCount = 0;
+    free(pool->segments);
+    pool->segments = NULL;
+    pool->segmentCapacity = 0;
+}
+
+static pthread_key_t GRCurrentBufferPoolKey;
+static void freeCurrentBufferPool(void *pool) {
+    GRMustacheBufferPoolDrain(pool);
+    free(pool);
+}
+#define getCurrentThreadCurrentBufferPool() (GRMustacheBufferPool *)pthread_getspecific(GRCurrentBufferPoolKey)
+#define setCurrentThreadCurrentBufferPool(pool) pthread_setspecific(GRCurrentBufferPoolKey, pool)
+static GRMustacheBufferPool *currentThreadCurrentBufferPool(void) {
+    static dispatch_once_t onceToken;
+    dispatch_once(&onceToken, ^{
+        pthread_key_create(&GRCurrentBufferPoolKey, freeCurrentBufferPool);
+    });
+    GRMustacheBufferPool *pool = getCurrentThreadCurrentBufferPool();
+    if (!pool) {
+        pool = calloc(1, sizeof(GRMustacheBufferPool));
+        setCurrentThreadCurrentBufferPool(pool);
+    }
+    return pool;
+}
+
+/**
+ * Returns a pooled chunk that can hold _byteCount_ bytes, or NULL.
+ */
+static GRMustacheBufferChunk *GRMustacheBufferPoolTakeChunk(GRMustacheBufferPool *pool, NSUInteger byteCount)
+{
+    for (GRMustacheBufferChunk **link = &pool->chunks; *link; link = &(*link)->next) {
+        GRMustacheBufferChunk *chunk = *link;
+        if (chunk->capacity >= byteCount) {
+            *link = chunk->next;
+            pool->byteCount -= chunk->capacity;
+            chunk->next = NULL;
+            chunk->length = 0;
+            return chunk;
+        }
+    }
+    return NULL;
+}
+
+static BOOL GRMustacheBufferPoolCanKeepChunk(GRMustacheBufferPool *pool, GRMustacheBufferChunk *chunk, size_t unitSize)
+{
+    return pool->byteCount + chunk->capacity * unitSize <= GRMustacheBufferPoolMaximumByteCount;
+}
+
+/**
+ * Gives a chunk back to the pool of the current thread, or frees it when the
+ * pool is full.
+ */
+static void GRMustacheBufferRecycleChunk(GRMustacheBuffer *buffer, GRMustacheBufferChunk *chunk)
+{
+    size_t unitSize = GRMustacheBufferUnitSize(buffer);
+    GRMustacheBufferPool *pool = currentThreadCurrentBufferPool();
+    if (chunk->bytes && GRMustacheBufferPoolCanKeepChunk(pool, chunk, unitSize)) {
+        chunk->capacity *= unitSize;
+        chunk->next = pool->chunks;
+        pool->chunks = chunk;
+        pool->byteCount += chunk->capacity;
+    } else {
+        free(chunk->bytes);
+        free(chunk);
+    }
+}
+
+void GRMustacheBufferDrainCurrentThreadPool(void)
+{
+    GRMustacheBufferPoolDrain(currentThreadCurrentBufferPool());
+}
+
+
+// =============================================================================
+#pragma mark - Appending
+
+void *GRMustacheBufferReserveChunk(GRMustacheBuffer *buffer, NSUInteger length)
+{
+    size_t unitSize = GRMustacheBufferUnitSize(buffer);
+    NSUInteger capacity = MAX(buffer->chunkCapacity, length);
+    GRMustacheBufferChunk *chunk = GRMustacheBufferPoolTakeChunk(currentThreadCurrentBufferPool(), capacity * unitSize);
+    if (chunk) {
+        chunk->capacity /= unitSize;
+#if !defined(NS_BLOCK_ASSERTIONS)
+        ++GRMustacheBufferCurrentStatistics.pooledChunkCount;
+#endif
+    } else {
+        chunk = malloc(sizeof(GRMustacheBufferChunk));
+        chunk->next = NULL;
+        chunk->bytes = malloc(capacity * unitSize);
+        chunk->length = 0;
+        chunk->capacity = capacity;
+#if !defined(NS_BLOCK_ASSERTIONS)
+        ++GRMustacheBufferCurrentStatistics.chunkAllocationCount;
+#endif
+    }
+    
+    if (buffer->lastChunk) {
+        buffer->lastChunk->next = chunk;
+    } else {
+        buffer->firstChunk = chunk;
+    }
+    buffer->lastChunk = chunk;
+    
+    // Grow chunks, so that large renderings do not allocate too many of them.
+    buffer->chunkCapacity = MIN(buffer->chunkCapacity * 2, GRMustacheBufferMaximumChunkCapacity);
+    
+    return chunk->bytes;
+}
+
+void GRMustacheBufferAppendSegment(GRMustacheBuffer *buffer, const UInt8 *bytes, NSUInteger length)
+{
+    if (buffer->segments == NULL) {
+        // Reuse the segment storage of the current thread pool
+        GRMustacheBufferPool *pool = currentThreadCurrentBufferPool();
+        buffer->segments = pool->segments;
+        buffer->segmentCapacity = pool->segmentCapacity;
+        pool->segments = NULL;
+        pool->segmentCapacity = 0;
+    }
+    if (buffer->segmentCount == buffer->segmentCapacity) {
+        buffer->segmentCapacity = MAX(buffer->segmentCapacity * 2, 16);
+        buffer->segments = reallocf(buffer->segments, buffer->segmentCapacity * sizeof(GRMustacheBufferSegment));
+    }
+    buffer->segments[buffer->segmentCount++] = (GRMustacheBufferSegment){
+        .bytes = bytes,
+        .length = length,
+    };
+}
+
+void GRMustacheBufferAppendReference(GRMustacheBuffer *buffer, CFTypeRef owner, const UInt8 *bytes, NSUInteger length)
+{
+    GRMustacheBufferAppendSegment(buffer, bytes, length);
+    buffer->segments[buffer->segmentCount - 1].owner = CFRetain(owner);
+    buffer->length += length;
+    buffer->referencedLength += length;
+    
+#if !defined(NS_BLOCK_ASSERTIONS)
+    ++GRMustacheBufferCurrentStatistics.referenceCount;
+#endif
+}
+
+void GRMustacheBufferAppendChunkedBytes(GRMustacheBuffer *buffer, const void *bytes, NSUInteger length)
+{
+    // Fill the last chunk, and copy the remaining content in a new one.
+    
+    size_t unitSize = GRMustacheBufferUnitSize(buffer);
+    GRMustacheBufferChunk *chunk = buffer->lastChunk;
+    if (chunk) {
+        NSUInteger available = chunk->capacity - chunk->length;
+        if (available > 0) {
+            memcpy(chunk->bytes + chunk->length * unitSize, bytes, available * unitSize);
+            GRMustacheBufferCommit(buffer, available);
+            bytes = (const UInt8 *)bytes + available * unitSize;
+            length -= available;
+        }
+    }
+    
+    void *storage = GRMustacheBufferReserveChunk(buffer, length);
+    memcpy(storage, bytes, length * unitSize);
+    GRMustacheBufferCommit(buffer, length);
+}
+
+void GRMustacheBufferAppendChunkedString(GRMustacheBuffer *buffer, CFStringRef string, CFIndex length)
+{
+    NSCAssert(buffer->stringBuffer, @"Not a string buffer");
+    
+    // Fill the last chunk, and copy the remaining characters in a new one.
+    
+    CFIndex location = 0;
+    GRMustacheBufferChunk *chunk = buffer->lastChunk;
+    if (chunk) {
+        CFIndex available = chunk->capacity - chunk->length;
+        if (available > 0) {
+            CFStringGetCharacters(string, CFRangeMake(0, available), (UniChar *)chunk->bytes + chunk->length);
+            GRMustacheBufferCommit(buffer, available);
+            location = available;
+        }
+    }
+    
+    void *storage = GRMustacheBufferReserveChunk(buffer, length - location);
+    CFStringGetCharacters(string, CFRangeMake(location, length - location), storage);
+    GRMustacheBufferCommit(buffer, length - location);
+}
+
+void GRMustacheBufferAppendChunkedASCIIBytes(GRMustacheBuffer *buffer, const char *bytes, NSUInteger length)
+{
+    if (!buffer->stringBuffer) {
+        CFStringRef string = CFStringCreateWithBytesNoCopy(NULL, (const UInt8 *)bytes, length, kCFStringEncodingASCII, false, kCFAllocatorNull);
+        GRMustacheBufferEncodeString(buffer, string, length);
+        CFRelease(string);
+        return;
+    }
+    
+    // Widen characters into the last chunk, and a new one if needed.
+    
+    while (length > 0) {
+        GRMustacheBufferChunk *chunk = buffer->lastChunk;
+        NSUInteger available = chunk ? (chunk->capacity - chunk->length) : 0;
+        UniChar *storage;
+        if (available == 0) {
+            storage = GRMustacheBufferReserveChunk(buffer, length);
+            available = length;
+        } else {
+            storage = (UniChar *)chunk->bytes + chunk->length;
+        }
+        NSUInteger count = MIN(available, length);
+        for (NSUInteger i = 0; i < count; ++i) {
+            storage[i] = (UInt8)bytes[i];
+        }
+        GRMustacheBufferCommit(buffer, count);
+        bytes += count;
+        length -= count;
+    }
+}
+
+void GRMustacheBufferEncodeString(GRMustacheBuffer *buffer, CFStringRef string, CFIndex length)
+{
+    NSCAssert(!buffer->stringBuffer, @"Not a byte buffer");
+    
+    // Fast path for ASCII strings stored as 8-bit characters
+    if (buffer->encoding == kCFStringEncodingUTF8 || buffer->encoding == kCFStringEncodingASCII) {
+        const char *cString = CFStringGetCStringPtr(string, buffer->encoding);
+        if (cString) {
+            if (length >= GRMustacheBufferReferenceThreshold && buffer->sink == nil) {
+                CFStringRef copy = CFStringCreateCopy(NULL, string);   // retains immutable strings
+                const char *copyCString = CFStringGetCStringPtr(copy, buffer->encoding);
+                if (copyCString) {
+                    GRMustacheBufferAppendReference(buffer, copy, (const UInt8 *)copyCString, length);
+                    CFRelease(copy);
+                    return;
+                }
+                CFRelease(copy);
+            }
+            GRMustacheBufferAppendBytes(buffer, (const UInt8 *)cString, length);
+            return;
+        }
+    }
+    
+    // Encode straight into chunks, without splitting surrogate pairs.
+    CFIndex maxCharacterLength = CFStringGetMaximumSizeForEncoding(1, buffer->encoding);
+    CFIndex location = 0;
+    while (location < length) {
+        GRMustacheBufferChunk *chunk = buffer->lastChunk;
+        CFIndex available = chunk ? (chunk->capacity - chunk->length) : 0;
+        if (available < maxCharacterLength * 2) {
+            GRMustacheBufferReserveChunk(buffer, MAX(MIN(CFStringGetMaximumSizeForEncoding(length - location, buffer->encoding), GRMustacheBufferMaximumChunkCapacity), maxCharacterLength * 2));
+            chunk = buffer->lastChunk;
+            available = chunk->capacity;
+        }
+        
+        CFIndex count = MIN(length - location, available / maxCharacterLength);
+        if (location + count < length && CFStringIsSurrogateHighCharacter(CFStringGetCharacterAtIndex(string, location + count - 1))) {
+            --count;
+        }
+        
+        CFIndex usedLength = 0;
+        CFIndex convertedLength = CFStringGetBytes(string, CFRangeMake(location, count), buffer->encoding, 0, false, chunk->bytes + chunk->length, available, &usedLength);
+        if (usedLength > 0) {
+            GRMustacheBufferCommit(buffer, usedLength);
+        }
+        if (convertedLength < count) {
+            buffer->encodingFailed = YES;
+            return;
+        }
+        location += count;
+    }
+}
+
+void GRMustacheBufferEncodeCharacters(GRMustacheBuffer *buffer, const UniChar *characters, NSUInteger length)
+{
+    NSCAssert(!buffer->stringBuffer, @"Not a byte buffer");
+    
+    if (buffer->encoding != kCFStringEncodingUTF8) {
+        CFStringRef string = CFStringCreateWithCharactersNoCopy(NULL, characters, length, kCFAllocatorNull);
+        GRMustacheBufferEncodeString(buffer, string, length);
+        CFRelease(string);
+        return;
+    }
+    
+    // Encode UTF-8 straight into chunks, without any intermediate string.
+    
+    NSUInteger i = 0;
+    while (i < length) {
+        GRMustacheBufferChunk *chunk = buffer->lastChunk;
+        NSUInteger available = chunk ? (chunk->capacity - chunk->length) : 0;
+        if (available < 4) {
+            GRMustacheBufferReserveChunk(buffer, MAX(MIN((length - i) * 3, GRMustacheBufferMaximumChunkCapacity), 4));
+            chunk = buffer->lastChunk;
+            available = chunk->capacity;
+        }
+        
+        UInt8 *start = chunk->bytes + chunk->length;
+        UInt8 *bytes = start;
+        UInt8 *end = start + available - 3; // room for at least four bytes
+        while (i < length && bytes < end) {
+            UniChar character = characters[i];
+            if (character < 0x80) {
+                *bytes++ = character;
+                ++i;
+            } else if (character < 0x800) {
+                *bytes++ = 0xC0 | (character >> 6);
+                *bytes++ = 0x80 | (character & 0x3F);
+                ++i;
+            } else if (CFStringIsSurrogateHighCharacter(character) && i + 1 < length && CFStringIsSurrogateLowCharacter(characters[i + 1])) {
+                UTF32Char longCharacter = CFStringGetLongCharacterForSurrogatePair(character, characters[i + 1]);
+                *bytes++ = 0xF0 | (longCharacter >> 18);
+                *bytes++ = 0x80 | ((longCharacter >> 12) & 0x3F);
+                *bytes++ = 0x80 | ((longCharacter >> 6) & 0x3F);
+                *bytes++ = 0x80 | (longCharacter & 0x3F);
+                i += 2;
+            } else if (CFStringIsSurrogateHighCharacter(character) || CFStringIsSurrogateLowCharacter(character)) {
+                // Unpaired surrogate
+                if (bytes > start) {
+                    GRMustacheBufferCommit(buffer, bytes - start);
+                }
+                buffer->encodingFailed = YES;
+                return;
+            } else {
+                *bytes++ = 0xE0 | (character >> 12);
+                *bytes++ = 0x80 | ((character >> 6) & 0x3F);
+                *bytes++ = 0x80 | (character & 0x3F);
+                ++i;
+            }
+        }
+        if (bytes > start) {
+            GRMustacheBufferCommit(buffer, bytes - start);
+        }
+    }
+}
+
+
+// =============================================================================
+#pragma mark - Flushing
+
+BOOL GRMustacheBufferFlush(GRMustacheBuffer *buffer, NSError **error)
+{
+    if (buffer->length == 0) {
+        return YES;
+    }
+    
+    if (buffer->HTMLEscapedBuffer) {
+        GRMustacheBufferAppendHTMLEscapedBuffer(buffer->HTMLEscapedBuffer, buffer, YES);
+        return GRMustacheBufferFlushIfNeeded(buffer->HTMLEscapedBuffer, error);
+    }
+    
+    if (buffer->sink == nil) {
+        return YES;
+    }
+    
+    for (NSUInteger i = 0; i < buffer->segmentCount; ++i) {
+        GRMustacheBufferSegment *segment = buffer->segments + i;
+        if (![buffer->sink writeBytes:segment->bytes length:segment->length error:error]) {
+            return NO;
+        }
+    }
+    GRMustacheBufferEmpty(buffer);
+    return YES;
+}
+
+void GRMustacheBufferEmpty(GRMustacheBuffer *buffer)
+{
+    for (NSUInteger i = 0; i < buffer->segmentCount; ++i) {
+        if (buffer->segments[i].owner) {
+            CFRelease(buffer->segments[i].owner);
+        }
+    }
+    
+    // Recycle the last chunk
+    GRMustacheBufferFreeChunksBefore(buffer, buffer->lastChunk);
+    if (buffer->lastChunk) {
+        buffer->lastChunk->length = 0;
+    }
+    buffer->segmentCount = 0;
+    buffer->length = 0;
+    buffer->referencedLength = 0;
+}
+
+
+// =============================================================================
+#pragma mark - Linearization
+
+static void GRMustacheBufferFreeChunksBefore(GRMustacheBuffer *buffer, GRMustacheBufferChunk *chunk)
+{
+    while (buffer->firstChunk != chunk) {
+        GRMustacheBufferChunk *next = buffer->firstChunk->next;
+        GRMustacheBufferRecycleChunk(buffer, buffer->firstChunk);
+        buffer->firstChunk = next;
+    }
+    if (chunk == NULL) {
+        buffer->lastChunk = NULL;
+    }
+}
+
+static BOOL GRMustacheBufferChunkContainsBytes(GRMustacheBufferChunk *chunk, const UInt8 *bytes, size_t unitSize)
+{
+    return bytes >= chunk->bytes && bytes < chunk->bytes + chunk->capacity * unitSize;
+}
+
+/**
+ * Returns the content of the buffer in a single malloc'ed storage, and
+ * releases the buffer.
+ *
+ * A buffer made of a single chunk gives away the chunk storage. Otherwise,
+ * segments are copied in the returned storage, and chunks are freed as soon
+ * as they have been copied, so that memory usage does not double.
+ */
+static void *GRMustacheBufferLinearizeAndRelease(GRMustacheBuffer *buffer)
+{
+    size_t unitSize = GRMustacheBufferUnitSize(buffer);
+    void *storage = NULL;
+    
+    GRMustacheBufferChunk *chunk = buffer->firstChunk;
+    if (buffer->segmentCount == 1 && buffer->segments[0].owner == NULL && chunk->next == NULL && buffer->segments[0].bytes == chunk->bytes) {
+        if (GRMustacheBufferPoolCanKeepChunk(currentThreadCurrentBufferPool(), chunk, unitSize)) {
+            // Keep the chunk for future buffers: one copy of the exact
+            // length costs no more than shrinking the chunk.
+            storage = malloc(MAX(buffer->length, 1) * unitSize);
+            memcpy(storage, chunk->bytes, buffer->length * unitSize);
+        } else {
+            // Give away the storage of the single chunk
+            storage = chunk->bytes;
+            if (chunk->capacity > buffer->length) {
+                storage = reallocf(storage, MAX(buffer->length, 1) * unitSize);
+            }
+            chunk->bytes = NULL;
+        }
+    } else {
+        storage = malloc(MAX(buffer->length, 1) * unitSize);
+        UInt8 *cursor = storage;
+        for (NSUInteger i = 0; i < buffer->segmentCount; ++i) {
+            GRMustacheBufferSegment *segment = buffer->segments + i;
+            if (segment->owner) {
+                if (segment->bytes) {
+                    memcpy(cursor, segment->bytes, segment->length * unitSize);
+                } else {
+                    CFStringGetCharacters((CFStringRef)segment->owner, CFRangeMake(0, segment->length), (UniChar *)cursor);
+                }
+                CFRelease(segment->owner);
+                segment->owner = NULL;
+            } else {
+                // Chunks that precede the chunk of the segment have been
+                // fully copied: free them.
+                while (!GRMustacheBufferChunkContainsBytes(buffer->firstChunk, segment->bytes, unitSize)) {
+                    GRMustacheBufferChunk *next = buffer->firstChunk->next;
+                    GRMustacheBufferRecycleChunk(buffer, buffer->firstChunk);
+                    buffer->firstChunk = next;
+                }
+                memcpy(cursor, segment->bytes, segment->length * unitSize);
+            }
+            cursor += segment->length * unitSize;
+        }
+        
+#if !defined(NS_BLOCK_ASSERTIONS)
+        ++GRMustacheBufferCurrentStatistics.linearizationCount;
+        GRMustacheBufferCurrentStatistics.linearizedLength += buffer->length;
+#endif
+    }
+    
+    buffer->segmentCount = 0;
+    GRMustacheBufferRelease(buffer);
+    return storage;
+}
+
+NSString *GRMustacheBufferGetStringAndRelease(GRMustacheBuffer *buffer)
+{
+    NSCAssert(buffer->stringBuffer, @"Not a string buffer");
+    
+    if (buffer->length == 0) {
+        GRMustacheBufferRelease(buffer);
+        return @"";
+    }
+    
+    if (buffer->segmentCount == 1 && buffer->segments[0].owner) {
+        // A single referenced string
+        NSString *string = [[(NSString *)buffer->segments[0].owner retain] autorelease];
+        GRMustacheBufferRelease(buffer);
+        return string;
+    }
+    
+    NSUInteger length = buffer->length;
+    UniChar *characters = GRMustacheBufferLinearizeAndRelease(buffer);
+    return [(NSString *)CFStringCreateWithCharactersNoCopy(NULL, characters, length, kCFAllocatorMalloc) autorelease];
+}
+
+NSData *GRMustacheBufferGetDataAndRelease(GRMustacheBuffer *buffer)
+{
+    NSCAssert(!buffer->stringBuffer, @"Not a byte buffer");
+    
+    if (buffer->length == 0) {
+        GRMustacheBufferRelease(buffer);
+        return [NSData data];
+    }
+    
+    if (buffer->segmentCount == 1 && buffer->segments[0].owner && CFGetTypeID(buffer->segments[0].owner) == CFDataGetTypeID()) {
+        // A single referenced data
+        NSData *data = [[(NSData *)buffer->segments[0].owner retain] autorelease];
+        GRMustacheBufferRelease(buffer);
+        return data;
+    }
+    
+    NSUInteger length = buffer->length;
+    void *bytes = GRMustacheBufferLinearizeAndRelease(buffer);
+    return [[[NSData alloc] initWithBytesNoCopy:bytes length:length freeWhenDone:YES] autorelease];
+}
+
+void GRMustacheBufferAppendToStringAndRelease(GRMustacheBuffer *buffer, NSMutableString *string)
+{
+    NSCAssert(buffer->stringBuffer, @"Not a string buffer");
+    
+    for (NSUInteger i = 0; i < buffer->segmentCount; ++i) {
+        GRMustacheBufferSegment *segment = buffer->segments + i;
+        if (segment->bytes) {
+            CFStringAppendCharacters((CFMutableStringRef)string, (const UniChar *)segment->bytes, segment->length);
+        } else {
+            CFStringAppend((CFMutableStringRef)string, (CFStringRef)segment->owner);
+        }
+    }
+    GRMustacheBufferRelease(buffer);
+}
+
+void GRMustacheBufferAppendToDataAndRelease(GRMustacheBuffer *buffer, NSMutableData *data)
+{
+    NSCAssert(!buffer->stringBuffer, @"Not a byte buffer");
+    
+    for (NSUInteger i = 0; i < buffer->segmentCount; ++i) {
+        GRMustacheBufferSegment *segment = buffer->segments + i;
+        [data appendBytes:segment->bytes length:segment->length];
+    }
+    GRMustacheBufferRelease(buffer);
+}
+
+void GRMustacheBufferRelease(GRMustacheBuffer *buffer)
+{
+    for (NSUInteger i = 0; i < buffer->segmentCount; ++i) {
+        if (buffer->segments[i].owner) {
+            CFRelease(buffer->segments[i].owner);
+        }
+    }
+    
+    // Keep the larger segment storage for future buffers
+    GRMustacheBufferPool *pool = currentThreadCurrentBufferPool();
+    if (buffer->segmentCapacity > pool->segmentCapacity && buffer->segmentCapacity * sizeof(GRMustacheBufferSegment) <= GRMustacheBufferPoolMaximumByteCount) {
+        free(pool->segments);
+        pool->segments = buffer->segments;
+        pool->segmentCapacity = buffer->segmentCapacity;
+    } else {
+        free(buffer->segments);
+    }
+    buffer->segments = NULL;
+    buffer->segmentCount = 0;
+    buffer->segmentCapacity = 0;
+    GRMustacheBufferFreeChunksBefore(buffer, NULL);
+    buffer->length = 0;
+    buffer->referencedLength = 0;
+}
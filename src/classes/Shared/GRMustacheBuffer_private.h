@@ -22,67 +22,349 @@
 
 #import <Foundation/Foundation.h>
 #import "GRMustacheAvailabilityMacros_private.h"
+#import "GRMustacheOutputSink_private.h"
 
 // Inspired by https://github.com/fotonauts/handlebars-objc/blob/master/src/handlebars-objc/astVisitors/HBAstEvaluationVisitor.m
 
+/**
+ * A chunk of storage allocated by a GRMustacheBuffer.
+ */
+typedef struct GRMustacheBufferChunk {
+    struct GRMustacheBufferChunk *next;
+    UInt8 *bytes;           // characters for string buffers, bytes for byte buffers
+    NSUInteger length;      // in characters for string buffers, in bytes for byte buffers
+    NSUInteger capacity;    // in characters for string buffers, in bytes for byte buffers
+} GRMustacheBufferChunk;
+
+/**
+ * A segment of the content of a GRMustacheBuffer.
+ *
+ * A segment is either a view on a chunk, or a reference to the storage of an
+ * immutable object (a string or a data), which is retained by the segment.
+ *
+ * Referenced strings which do not provide direct access to their characters
+ * have NULL bytes.
+ */
 typedef struct {
-    NSUInteger capacity;
-    NSMutableString *string;
+    const UInt8 *bytes;
+    NSUInteger length;      // in characters for string buffers, in bytes for byte buffers
+    CFTypeRef owner;        // references only
+} GRMustacheBufferSegment;
+
+/**
+ * A GRMustacheBuffer accumulates a rendering.
+ *
+ * The rendering is stored as a list of segments, and is linearized only once,
+ * when the buffer is turned into a string or a data. Growing a buffer
+ * allocates new chunks, and never copies its previous content.
+ *
+ * String buffers accumulate UTF-16 characters.
+ *
+ * Byte buffers accumulate encoded bytes. Strings are encoded as they are
+ * appended, so that no intermediate UTF-16 rendering is ever built.
+ *
+ * Buffers with an output sink are UTF-8 byte buffers, which write their
+ * content into the sink whenever it grows past
+ * GRMustacheBufferFlushThreshold bytes. They do not reference objects, and
+ * recycle their last chunk after each flush.
+ */
+typedef struct GRMustacheBuffer {
+    GRMustacheBufferSegment *segments;
+    NSUInteger segmentCount;
+    NSUInteger segmentCapacity;
+    GRMustacheBufferChunk *firstChunk;
+    GRMustacheBufferChunk *lastChunk;   // receives copied content
+    NSUInteger chunkCapacity;           // capacity of the next allocated chunk
+    NSUInteger length;          // in characters for string buffers, in bytes for byte buffers
+    NSUInteger referencedLength;    // the part of length which is stored in referenced objects, not in chunks
+    BOOL stringBuffer;
+    CFStringEncoding encoding;  // byte buffers only
+    BOOL ASCIICompatible;       // byte buffers only: YES if ASCII characters are encoded as themselves
+    BOOL encodingFailed;        // byte buffers only
+    id<GRMustacheOutputSink> sink;  // not retained
+    struct GRMustacheBuffer *HTMLEscapedBuffer; // string buffers only: flushing HTML-escapes the content into this buffer
 } GRMustacheBuffer;
 
+/**
+ * The length, in bytes, above which a buffer with an output sink flushes its
+ * content.
+ *
+ * @see GRMustacheBufferFlushIfNeeded
+ */
+#define GRMustacheBufferFlushThreshold 8192
+
+/**
+ * The minimum length, in characters or bytes, of strings and data which are
+ * referenced instead of being copied. Shorter ones are cheaper to copy than
+ * to reference.
+ */
+#define GRMustacheBufferReferenceThreshold 64
+
+/**
+ * The maximum capacity of a chunk, in characters or bytes. Buffers double the
+ * capacity of their chunks until they reach this value.
+ */
+#define GRMustacheBufferMaximumChunkCapacity 65536
+
+/**
+ * The maximum number of bytes of chunk storage that each thread keeps for
+ * future buffers, once buffers have been released.
+ *
+ * Chunks are recycled through a per-thread pool, so that renderings performed
+ * in a loop, such as in a request handler, stop allocating memory once the
+ * pool has been warmed up.
+ */
+#define GRMustacheBufferPoolMaximumByteCount (256 * 1024)
+
+#if !defined(NS_BLOCK_ASSERTIONS)
+// For testing purpose
+typedef struct {
+    NSUInteger chunkAllocationCount;    // number of allocated chunks
+    NSUInteger referenceCount;          // number of referenced strings and data
+    NSUInteger linearizationCount;      // number of buffers whose segments were copied into a single string or data
+    NSUInteger linearizedLength;        // number of characters or bytes copied by linearizations
+    NSUInteger pooledChunkCount;        // number of chunks reused from the current thread pool
+} GRMustacheBufferStatistics;
+extern GRMustacheBufferStatistics GRMustacheBufferCurrentStatistics GRMUSTACHE_API_INTERNAL;
+#endif
+
+// Out-of-line helpers, implemented in GRMustacheBuffer.m
+extern void *GRMustacheBufferReserveChunk(GRMustacheBuffer *buffer, NSUInteger length) GRMUSTACHE_API_INTERNAL;
+extern void GRMustacheBufferAppendSegment(GRMustacheBuffer *buffer, const UInt8 *bytes, NSUInteger length) GRMUSTACHE_API_INTERNAL;
+extern void GRMustacheBufferAppendChunkedBytes(GRMustacheBuffer *buffer, const void *bytes, NSUInteger length) GRMUSTACHE_API_INTERNAL;
+extern void GRMustacheBufferAppendChunkedString(GRMustacheBuffer *buffer, CFStringRef string, CFIndex length) GRMUSTACHE_API_INTERNAL;
+extern void GRMustacheBufferAppendReference(GRMustacheBuffer *buffer, CFTypeRef owner, const UInt8 *bytes, NSUInteger length) GRMUSTACHE_API_INTERNAL;
+extern void GRMustacheBufferAppendChunkedASCIIBytes(GRMustacheBuffer *buffer, const char *bytes, NSUInteger length) GRMUSTACHE_API_INTERNAL;
+extern void GRMustacheBufferEncodeString(GRMustacheBuffer *buffer, CFStringRef string, CFIndex length) GRMUSTACHE_API_INTERNAL;
+extern void GRMustacheBufferEncodeCharacters(GRMustacheBuffer *buffer, const UniChar *characters, NSUInteger length) GRMUSTACHE_API_INTERNAL;
+
 static inline GRMustacheBuffer GRMustacheBufferCreate(CFIndex capacity)
 {
     return (GRMustacheBuffer){
-        .capacity = capacity,
-        .string = (NSMutableString *)CFStringCreateMutable(0, capacity),
+        .chunkCapacity = MAX(capacity, 1),
+        .stringBuffer = YES,
     };
 } GRMUSTACHE_API_INTERNAL
 
-static inline void GRMustacheBufferAdjustCapacityForLength(GRMustacheBuffer *buffer, NSUInteger length)
+static inline GRMustacheBuffer GRMustacheBufferCreateWithEncoding(CFIndex capacity, CFStringEncoding encoding)
+{
+    return (GRMustacheBuffer){
+        .chunkCapacity = MAX(capacity, 1),
+        .encoding = encoding,
+        .ASCIICompatible = (encoding == kCFStringEncodingUTF8 ||
+                            encoding == kCFStringEncodingASCII ||
+                            encoding == kCFStringEncodingISOLatin1 ||
+                            encoding == kCFStringEncodingWindowsLatin1 ||
+                            encoding == kCFStringEncodingMacRoman),
+    };
+} GRMUSTACHE_API_INTERNAL
+
+static inline GRMustacheBuffer GRMustacheBufferCreateWithOutputSink(id<GRMustacheOutputSink> sink)
+{
+    GRMustacheBuffer buffer = GRMustacheBufferCreateWithEncoding(GRMustacheBufferFlushThreshold * 2, kCFStringEncodingUTF8);
+    buffer.sink = sink;
+    return buffer;
+} GRMUSTACHE_API_INTERNAL
+
+/**
+ * Returns a pointer to the free storage of the last chunk of the buffer, if
+ * it can hold _length_ more characters or bytes, and NULL otherwise.
+ */
+static inline void *GRMustacheBufferTailStorage(GRMustacheBuffer *buffer, NSUInteger length)
+{
+    GRMustacheBufferChunk *chunk = buffer->lastChunk;
+    if (chunk == NULL || chunk->capacity - chunk->length < length) {
+        return NULL;
+    }
+    return chunk->bytes + chunk->length * (buffer->stringBuffer ? sizeof(UniChar) : 1);
+} GRMUSTACHE_API_INTERNAL
+
+/**
+ * Records that _length_ characters or bytes have been written in the free
+ * storage of the last chunk, as returned by GRMustacheBufferTailStorage or
+ * GRMustacheBufferReserveChunk.
+ */
+static inline void GRMustacheBufferCommit(GRMustacheBuffer *buffer, NSUInteger length)
 {
-// Maximum CFIndex value based on http://www.fefe.de/intof.html
-#define CFINDEX_HALF_MAX ((CFIndex)1 << (sizeof(CFIndex)*8-2))
-#define CFINDEX_MAX (CFINDEX_HALF_MAX - 1 + CFINDEX_HALF_MAX)
-    if (length > buffer->capacity) {
-        CFIndex newCapacity = (buffer->capacity >= CFINDEX_MAX / 2) ? CFINDEX_MAX : MAX(length, buffer->capacity * 2); // Avoid CFIndex overflow
-        NSMutableString *newString = (NSMutableString *)CFStringCreateMutableCopy(NULL, newCapacity, (CFStringRef)buffer->string);
-        [buffer->string release];
-        buffer->string = newString;
-        buffer->capacity = newCapacity;
+    GRMustacheBufferChunk *chunk = buffer->lastChunk;
+    const UInt8 *bytes = chunk->bytes + chunk->length * (buffer->stringBuffer ? sizeof(UniChar) : 1);
+    chunk->length += length;
+    buffer->length += length;
+    
+    // Extend the last segment when it ends right where the new content begins.
+    if (buffer->segmentCount > 0) {
+        GRMustacheBufferSegment *segment = buffer->segments + buffer->segmentCount - 1;
+        if (segment->owner == NULL && segment->bytes + segment->length * (buffer->stringBuffer ? sizeof(UniChar) : 1) == bytes) {
+            segment->length += length;
+            return;
+        }
+    }
+    GRMustacheBufferAppendSegment(buffer, bytes, length);
+} GRMUSTACHE_API_INTERNAL
+
+static inline void GRMustacheBufferAppendBytes(GRMustacheBuffer *buffer, const UInt8 *bytes, NSUInteger length)
+{
+    NSCAssert(!buffer->stringBuffer, @"Not a byte buffer");
+    if (length) {
+        void *storage = GRMustacheBufferTailStorage(buffer, length);
+        if (storage) {
+            memcpy(storage, bytes, length);
+            GRMustacheBufferCommit(buffer, length);
+        } else {
+            GRMustacheBufferAppendChunkedBytes(buffer, bytes, length);
+        }
     }
 } GRMUSTACHE_API_INTERNAL
 
 static inline void GRMustacheBufferAppendString(GRMustacheBuffer *buffer, NSString *string)
 {
-    NSUInteger length = [string length];
+    CFIndex length = CFStringGetLength((CFStringRef)string);
     if (length) {
-        CFIndex newLength = [buffer->string length] + length;
-        GRMustacheBufferAdjustCapacityForLength(buffer, newLength);
-        CFStringAppend((CFMutableStringRef)buffer->string, (CFStringRef)string);
+        if (buffer->stringBuffer) {
+            if (length >= GRMustacheBufferReferenceThreshold) {
+                CFStringRef copy = CFStringCreateCopy(NULL, (CFStringRef)string);   // retains immutable strings
+                GRMustacheBufferAppendReference(buffer, copy, (const UInt8 *)CFStringGetCharactersPtr(copy), length);
+                CFRelease(copy);
+            } else {
+                void *storage = GRMustacheBufferTailStorage(buffer, length);
+                if (storage) {
+                    CFStringGetCharacters((CFStringRef)string, CFRangeMake(0, length), storage);
+                    GRMustacheBufferCommit(buffer, length);
+                } else {
+                    GRMustacheBufferAppendChunkedString(buffer, (CFStringRef)string, length);
+                }
+            }
+        } else {
+            GRMustacheBufferEncodeString(buffer, (CFStringRef)string, length);
+        }
     }
 } GRMUSTACHE_API_INTERNAL
 
-static inline void GRMustacheBufferAppendCharacters(GRMustacheBuffer *buffer, const UniChar *chars, NSUInteger numChars)
+/**
+ * Appends a string whose UTF-8 encoding is already known: UTF-8 byte buffers
+ * use the bytes, without encoding the string again.
+ *
+ * Long strings and data are referenced, not copied.
+ */
+static inline void GRMustacheBufferAppendStringWithUTF8Data(GRMustacheBuffer *buffer, NSString *string, NSData *UTF8Data)
 {
-    if (numChars) {
-        CFIndex newLength = [buffer->string length] + numChars;
-        GRMustacheBufferAdjustCapacityForLength(buffer, newLength);
-        CFStringAppendCharacters((CFMutableStringRef)buffer->string, chars, numChars);
+    if (!buffer->stringBuffer && buffer->encoding == kCFStringEncodingUTF8) {
+        NSUInteger length = [UTF8Data length];
+        if (length >= GRMustacheBufferReferenceThreshold && buffer->sink == nil) {
+            GRMustacheBufferAppendReference(buffer, (CFTypeRef)UTF8Data, [UTF8Data bytes], length);
+        } else {
+            GRMustacheBufferAppendBytes(buffer, [UTF8Data bytes], length);
+        }
+    } else {
+        GRMustacheBufferAppendString(buffer, string);
     }
 } GRMUSTACHE_API_INTERNAL
 
-static inline NSString *GRMustacheBufferGetString(GRMustacheBuffer *buffer)
+static inline void GRMustacheBufferAppendCharacters(GRMustacheBuffer *buffer, const UniChar *chars, NSUInteger numChars)
 {
-    return [[buffer->string retain] autorelease];
+    if (numChars) {
+        if (buffer->stringBuffer) {
+            void *storage = GRMustacheBufferTailStorage(buffer, numChars);
+            if (storage) {
+                memcpy(storage, chars, numChars * sizeof(UniChar));
+                GRMustacheBufferCommit(buffer, numChars);
+            } else {
+                GRMustacheBufferAppendChunkedBytes(buffer, chars, numChars);
+            }
+        } else {
+            GRMustacheBufferEncodeCharacters(buffer, chars, numChars);
+        }
+    }
 } GRMUSTACHE_API_INTERNAL
 
-static inline NSString *GRMustacheBufferGetStringAndRelease(GRMustacheBuffer *buffer)
+/**
+ * Appends ASCII characters, such as escape sequences, without building any
+ * string.
+ */
+static inline void GRMustacheBufferAppendASCIIBytes(GRMustacheBuffer *buffer, const char *bytes, NSUInteger length)
 {
-    return [buffer->string autorelease];
+    if (length) {
+        if (buffer->stringBuffer) {
+            UniChar *storage = GRMustacheBufferTailStorage(buffer, length);
+            if (storage) {
+                for (NSUInteger i = 0; i < length; ++i) {
+                    storage[i] = (UInt8)bytes[i];
+                }
+                GRMustacheBufferCommit(buffer, length);
+            } else {
+                GRMustacheBufferAppendChunkedASCIIBytes(buffer, bytes, length);
+            }
+        } else if (buffer->ASCIICompatible) {
+            GRMustacheBufferAppendBytes(buffer, (const UInt8 *)bytes, length);
+        } else {
+            GRMustacheBufferAppendChunkedASCIIBytes(buffer, bytes, length);
+        }
+    }
 } GRMUSTACHE_API_INTERNAL
 
-static inline void GRMustacheBufferRelease(GRMustacheBuffer *buffer)
+/**
+ * Writes the content of a buffer with an output sink into the sink, or
+ * appends the content of a buffer with an HTML-escaped buffer to this buffer,
+ * HTML-escaped, and flushes it in turn. Then empties the buffer.
+ */
+extern BOOL GRMustacheBufferFlush(GRMustacheBuffer *buffer, NSError **error) GRMUSTACHE_API_INTERNAL;
+
+/**
+ * Flushes the buffer when it has an output sink or an HTML-escaped buffer,
+ * and its length has reached GRMustacheBufferFlushThreshold.
+ */
+static inline BOOL GRMustacheBufferFlushIfNeeded(GRMustacheBuffer *buffer, NSError **error)
 {
-    [buffer->string release];
+    if ((buffer->sink == nil && buffer->HTMLEscapedBuffer == NULL) || buffer->length < GRMustacheBufferFlushThreshold) {
+        return YES;
+    }
+    return GRMustacheBufferFlush(buffer, error);
 } GRMUSTACHE_API_INTERNAL
 
+/**
+ * Returns the content of a string buffer, and releases the buffer.
+ *
+ * The segments are copied once into the returned string, and freed as soon as
+ * they are copied. A buffer made of a single segment is returned without any
+ * copy.
+ */
+extern NSString *GRMustacheBufferGetStringAndRelease(GRMustacheBuffer *buffer) GRMUSTACHE_API_INTERNAL;
+
+/**
+ * Returns the content of a byte buffer, and releases the buffer.
+ *
+ * @see GRMustacheBufferGetStringAndRelease
+ */
+extern NSData *GRMustacheBufferGetDataAndRelease(GRMustacheBuffer *buffer) GRMUSTACHE_API_INTERNAL;
+
+/**
+ * Appends the content of a string buffer to a mutable string, and releases
+ * the buffer.
+ *
+ * The segments are appended one after the other: no intermediate string is
+ * built.
+ */
+extern void GRMustacheBufferAppendToStringAndRelease(GRMustacheBuffer *buffer, NSMutableString *string) GRMUSTACHE_API_INTERNAL;
+
+/**
+ * Appends the content of a byte buffer to a mutable data, and releases the
+ * buffer.
+ *
+ * @see GRMustacheBufferAppendToStringAndRelease
+ */
+extern void GRMustacheBufferAppendToDataAndRelease(GRMustacheBuffer *buffer, NSMutableData *data) GRMUSTACHE_API_INTERNAL;
+
+/**
+ * Empties a buffer, and keeps its last chunk for further content.
+ */
+extern void GRMustacheBufferEmpty(GRMustacheBuffer *buffer) GRMUSTACHE_API_INTERNAL;
+
+/**
+ * Releases a buffer. Its chunks go back to the pool of the current thread.
+ */
+extern void GRMustacheBufferRelease(GRMustacheBuffer *buffer) GRMUSTACHE_API_INTERNAL;
+
+/**
+ * Frees all chunks kept by the pool of the current thread.
+ */
+extern void GRMustacheBufferDrainCurrentThreadPool(void) GRMUSTACHE_API_INTERNAL;
@@ -20,74 +20,536 @@
 // OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
 // THE SOFTWARE.
 
+#if defined(__SSE2__)
+#import <immintrin.h>
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+#import <arm_neon.h>
+#endif
 #import "GRMustacheTranslateCharacters_private.h"
-#import "GRMustacheBuffer_private.h"
 
-NSString *GRMustacheTranslateCharacters(NSString *string, NSString **escapeForCharacter, size_t escapeForCharacterLength, NSUInteger capacity)
+#if !defined(NS_BLOCK_ASSERTIONS)
+// For testing purpose
+BOOL GRMustacheEscapeTableDisableSIMD = NO;
+#endif
+
+#if defined(__SSE2__)
+static BOOL GRMustacheEscapeTableUsesAVX2 = NO;
+#endif
+
+
+// =============================================================================
+#pragma mark - Escape tables
+
+GRMustacheEscapeTable *GRMustacheEscapeTableCreate(const char **escapeForASCIICharacter, size_t length, const UniChar *nonASCIICharacters, const char **escapeForNonASCIICharacter, size_t nonASCIICharacterCount)
 {
-    NSUInteger length = [string length];
-    if (length == 0) {
-        return string;
+#if defined(__SSE2__)
+    static dispatch_once_t onceToken;
+    dispatch_once(&onceToken, ^{
+        // The check covers both the CPU and the OS support of AVX registers
+        // (cpuid and xgetbv). The hw.optional.avx2_0 sysctl does not exist
+        // on all systems.
+        __builtin_cpu_init();
+        GRMustacheEscapeTableUsesAVX2 = (__builtin_cpu_supports("avx2") != 0);
+    });
+#endif
+    
+    NSCAssert(length <= 128, @"Invalid escape table length");
+    NSCAssert(nonASCIICharacterCount <= 2, @"Too many non-ASCII characters");
+    
+    GRMustacheEscapeTable *table = calloc(1, sizeof(GRMustacheEscapeTable));
+    for (size_t i = 0; i < length; ++i) {
+        if (escapeForASCIICharacter[i]) {
+            table->escapeForASCIICharacter[i] = escapeForASCIICharacter[i];
+            table->escapeLengthForASCIICharacter[i] = strlen(escapeForASCIICharacter[i]);
+        }
     }
+    for (size_t i = 0; i < nonASCIICharacterCount; ++i) {
+        NSCAssert(nonASCIICharacters[i] > 0x7F, @"Not a non-ASCII character");
+        table->nonASCIICharacters[i] = nonASCIICharacters[i];
+        table->escapeForNonASCIICharacter[i] = escapeForNonASCIICharacter[i];
+    }
+    table->nonASCIICharacterCount = nonASCIICharacterCount;
     
-    // Assume most strings don't need escaping, and help performances: avoid
-    // creating a NSMutableData instance if escaping in uncessary.
+    // Prepare the scan: control characters are looked for as a range when
+    // they are all escaped. Other characters are looked for one by one.
     
-    BOOL needsEscaping = NO;
-    for (NSUInteger i=0; i<length; ++i) {
-        unichar character = [string characterAtIndex:i];
-        if (character < escapeForCharacterLength && escapeForCharacter[character]) {
-            needsEscaping = YES;
+    table->escapesControlCharacters = YES;
+    for (UniChar c = 0; c < 0x20; ++c) {
+        if (!table->escapeForASCIICharacter[c]) {
+            table->escapesControlCharacters = NO;
             break;
         }
     }
+    for (UniChar c = (table->escapesControlCharacters ? 0x20 : 0); c < 128; ++c) {
+        if (table->escapeForASCIICharacter[c]) {
+            NSCAssert(table->scannedCharacterCount < GRMustacheEscapeTableMaximumCharacterCount, @"Too many escaped characters");
+            table->scannedCharacters[table->scannedCharacterCount++] = c;
+        }
+    }
+    for (size_t i = 0; i < nonASCIICharacterCount; ++i) {
+        NSCAssert(table->scannedCharacterCount < GRMustacheEscapeTableMaximumCharacterCount, @"Too many escaped characters");
+        table->scannedCharacters[table->scannedCharacterCount++] = nonASCIICharacters[i];
+    }
     
-    if (!needsEscaping) {
-        return string;
+    return table;
+}
+
+const GRMustacheEscapeTable *GRMustacheHTMLEscapeTable(void)
+{
+    static GRMustacheEscapeTable *table;
+    static dispatch_once_t onceToken;
+    dispatch_once(&onceToken, ^{
+        static const char *escapeForCharacter[] = {
+            ['&'] = "&amp;",
+            ['<'] = "&lt;",
+            ['>'] = "&gt;",
+            ['"'] = "&quot;",
+            ['\''] = "&apos;",
+        };
+        static const size_t escapeForCharacterLength = sizeof(escapeForCharacter) / sizeof(const char *);
+        table = GRMustacheEscapeTableCreate(escapeForCharacter, escapeForCharacterLength, NULL, NULL, 0);
+    });
+    return table;
+}
+
+static inline const char *GRMustacheEscapeTableEscapeForCharacter(const GRMustacheEscapeTable *table, UniChar character, size_t *length)
+{
+    if (character < 128) {
+        *length = table->escapeLengthForASCIICharacter[character];
+        return table->escapeForASCIICharacter[character];
+    }
+    for (size_t i = 0; i < table->nonASCIICharacterCount; ++i) {
+        if (character == table->nonASCIICharacters[i]) {
+            const char *escape = table->escapeForNonASCIICharacter[i];
+            *length = strlen(escape);
+            return escape;
+        }
+    }
+    *length = 0;
+    return NULL;
+}
+
+
+// =============================================================================
+#pragma mark - Scanning
+
+static NSUInteger GRMustacheEscapeTableFindCharacterScalar(const GRMustacheEscapeTable *table, const UniChar *characters, NSUInteger length)
+{
+    for (NSUInteger i = 0; i < length; ++i) {
+        UniChar character = characters[i];
+        if (character < 128) {
+            if (table->escapeForASCIICharacter[character]) {
+                return i;
+            }
+        } else {
+            for (size_t j = 0; j < table->nonASCIICharacterCount; ++j) {
+                if (character == table->nonASCIICharacters[j]) {
+                    return i;
+                }
+            }
+        }
+    }
+    return length;
+}
+
+static NSUInteger GRMustacheEscapeTableFindASCIICharacterScalar(const GRMustacheEscapeTable *table, const char *characters, NSUInteger length)
+{
+    for (NSUInteger i = 0; i < length; ++i) {
+        UInt8 character = characters[i];
+        if (character < 128 && table->escapeForASCIICharacter[character]) {
+            return i;
+        }
     }
+    return length;
+}
+
+#if defined(__SSE2__)
+
+static NSUInteger GRMustacheEscapeTableFindCharacterSSE2(const GRMustacheEscapeTable *table, const UniChar *characters, NSUInteger length)
+{
+    size_t count = table->scannedCharacterCount;
+    __m128i scanned[GRMustacheEscapeTableMaximumCharacterCount];
+    for (size_t j = 0; j < count; ++j) {
+        scanned[j] = _mm_set1_epi16((short)table->scannedCharacters[j]);
+    }
+    const BOOL controls = table->escapesControlCharacters;
+    const __m128i controlLimit = _mm_set1_epi16(0x1F);
+    const __m128i zero = _mm_setzero_si128();
     
+    NSUInteger i = 0;
+    for (; i + 8 <= length; i += 8) {
+        __m128i vector = _mm_loadu_si128((const __m128i *)(characters + i));
+        // Unsigned saturated subtraction yields zero for characters <= 0x1F
+        __m128i match = controls ? _mm_cmpeq_epi16(_mm_subs_epu16(vector, controlLimit), zero) : zero;
+        for (size_t j = 0; j < count; ++j) {
+            match = _mm_or_si128(match, _mm_cmpeq_epi16(vector, scanned[j]));
+        }
+        int mask = _mm_movemask_epi8(match);
+        if (mask) {
+            return i + __builtin_ctz(mask) / 2;
+        }
+    }
+    return i + GRMustacheEscapeTableFindCharacterScalar(table, characters + i, length - i);
+}
+
+static NSUInteger GRMustacheEscapeTableFindASCIICharacterSSE2(const GRMustacheEscapeTable *table, const char *characters, NSUInteger length)
+{
+    size_t count = 0;
+    __m128i scanned[GRMustacheEscapeTableMaximumCharacterCount];
+    for (size_t j = 0; j < table->scannedCharacterCount; ++j) {
+        if (table->scannedCharacters[j] < 128) {
+            scanned[count++] = _mm_set1_epi8((char)table->scannedCharacters[j]);
+        }
+    }
+    const BOOL controls = table->escapesControlCharacters;
+    const __m128i controlLimit = _mm_set1_epi8(0x1F);
+    const __m128i zero = _mm_setzero_si128();
     
-    // Escape
+    NSUInteger i = 0;
+    for (; i + 16 <= length; i += 16) {
+        __m128i vector = _mm_loadu_si128((const __m128i *)(characters + i));
+        __m128i match = controls ? _mm_cmpeq_epi8(_mm_subs_epu8(vector, controlLimit), zero) : zero;
+        for (size_t j = 0; j < count; ++j) {
+            match = _mm_or_si128(match, _mm_cmpeq_epi8(vector, scanned[j]));
+        }
+        int mask = _mm_movemask_epi8(match);
+        if (mask) {
+            return i + __builtin_ctz(mask);
+        }
+    }
+    return i + GRMustacheEscapeTableFindASCIICharacterScalar(table, characters + i, length - i);
+}
+
+__attribute__((target("avx2")))
+static NSUInteger GRMustacheEscapeTableFindCharacterAVX2(const GRMustacheEscapeTable *table, const UniChar *characters, NSUInteger length)
+{
+    size_t count = table->scannedCharacterCount;
+    __m256i scanned[GRMustacheEscapeTableMaximumCharacterCount];
+    for (size_t j = 0; j < count; ++j) {
+        scanned[j] = _mm256_set1_epi16((short)table->scannedCharacters[j]);
+    }
+    const BOOL controls = table->escapesControlCharacters;
+    const __m256i controlLimit = _mm256_set1_epi16(0x1F);
+    const __m256i zero = _mm256_setzero_si256();
+    
+    NSUInteger i = 0;
+    for (; i + 16 <= length; i += 16) {
+        __m256i vector = _mm256_loadu_si256((const __m256i *)(characters + i));
+        __m256i match = controls ? _mm256_cmpeq_epi16(_mm256_subs_epu16(vector, controlLimit), zero) : zero;
+        for (size_t j = 0; j < count; ++j) {
+            match = _mm256_or_si256(match, _mm256_cmpeq_epi16(vector, scanned[j]));
+        }
+        unsigned int mask = (unsigned int)_mm256_movemask_epi8(match);
+        if (mask) {
+            return i + __builtin_ctz(mask) / 2;
+        }
+    }
+    return i + GRMustacheEscapeTableFindCharacterSSE2(table, characters + i, length - i);
+}
+
+__attribute__((target("avx2")))
+static NSUInteger GRMustacheEscapeTableFindASCIICharacterAVX2(const GRMustacheEscapeTable *table, const char *characters, NSUInteger length)
+{
+    size_t count = 0;
+    __m256i scanned[GRMustacheEscapeTableMaximumCharacterCount];
+    for (size_t j = 0; j < table->scannedCharacterCount; ++j) {
+        if (table->scannedCharacters[j] < 128) {
+            scanned[count++] = _mm256_set1_epi8((char)table->scannedCharacters[j]);
+        }
+    }
+    const BOOL controls = table->escapesControlCharacters;
+    const __m256i controlLimit = _mm256_set1_epi8(0x1F);
+    const __m256i zero = _mm256_setzero_si256();
+    
+    NSUInteger i = 0;
+    for (; i + 32 <= length; i += 32) {
+        __m256i vector = _mm256_loadu_si256((const __m256i *)(characters + i));
+        __m256i match = controls ? _mm256_cmpeq_epi8(_mm256_subs_epu8(vector, controlLimit), zero) : zero;
+        for (size_t j = 0; j < count; ++j) {
+            match = _mm256_or_si256(match, _mm256_cmpeq_epi8(vector, scanned[j]));
+        }
+        unsigned int mask = (unsigned int)_mm256_movemask_epi8(match);
+        if (mask) {
+            return i + __builtin_ctz(mask);
+        }
+    }
+    return i + GRMustacheEscapeTableFindASCIICharacterSSE2(table, characters + i, length - i);
+}
+
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+
+static NSUInteger GRMustacheEscapeTableFindCharacterNEON(const GRMustacheEscapeTable *table, const UniChar *characters, NSUInteger length)
+{
+    size_t count = table->scannedCharacterCount;
+    uint16x8_t scanned[GRMustacheEscapeTableMaximumCharacterCount];
+    for (size_t j = 0; j < count; ++j) {
+        scanned[j] = vdupq_n_u16(table->scannedCharacters[j]);
+    }
+    const BOOL controls = table->escapesControlCharacters;
+    const uint16x8_t controlLimit = vdupq_n_u16(0x1F);
+    const uint16x8_t zero = vdupq_n_u16(0);
+    
+    NSUInteger i = 0;
+    for (; i + 8 <= length; i += 8) {
+        uint16x8_t vector = vld1q_u16(characters + i);
+        uint16x8_t match = controls ? vcleq_u16(vector, controlLimit) : zero;
+        for (size_t j = 0; j < count; ++j) {
+            match = vorrq_u16(match, vceqq_u16(vector, scanned[j]));
+        }
+        if (vmaxvq_u16(match)) {
+            return i + GRMustacheEscapeTableFindCharacterScalar(table, characters + i, 8);
+        }
+    }
+    return i + GRMustacheEscapeTableFindCharacterScalar(table, characters + i, length - i);
+}
+
+static NSUInteger GRMustacheEscapeTableFindASCIICharacterNEON(const GRMustacheEscapeTable *table, const char *characters, NSUInteger length)
+{
+    size_t count = 0;
+    uint8x16_t scanned[GRMustacheEscapeTableMaximumCharacterCount];
+    for (size_t j = 0; j < table->scannedCharacterCount; ++j) {
+        if (table->scannedCharacters[j] < 128) {
+            scanned[count++] = vdupq_n_u8((uint8_t)table->scannedCharacters[j]);
+        }
+    }
+    const BOOL controls = table->escapesControlCharacters;
+    const uint8x16_t controlLimit = vdupq_n_u8(0x1F);
+    const uint8x16_t zero = vdupq_n_u8(0);
+    
+    NSUInteger i = 0;
+    for (; i + 16 <= length; i += 16) {
+        uint8x16_t vector = vld1q_u8((const uint8_t *)characters + i);
+        uint8x16_t match = controls ? vcleq_u8(vector, controlLimit) : zero;
+        for (size_t j = 0; j < count; ++j) {
+            match = vorrq_u8(match, vceqq_u8(vector, scanned[j]));
+        }
+        if (vmaxvq_u8(match)) {
+            return i + GRMustacheEscapeTableFindASCIICharacterScalar(table, characters + i, 16);
+        }
+    }
+    return i + GRMustacheEscapeTableFindASCIICharacterScalar(table, characters + i, length - i);
+}
+
+#endif
+
+NSUInteger GRMustacheEscapeTableFindCharacter(const GRMustacheEscapeTable *table, const UniChar *characters, NSUInteger length)
+{
+#if !defined(NS_BLOCK_ASSERTIONS)
+    if (GRMustacheEscapeTableDisableSIMD) {
+        return GRMustacheEscapeTableFindCharacterScalar(table, characters, length);
+    }
+#endif
+    
+    // Short strings are not worth the setup of vector registers
+    if (length < 8) {
+        return GRMustacheEscapeTableFindCharacterScalar(table, characters, length);
+    }
+    
+#if defined(__SSE2__)
+    if (GRMustacheEscapeTableUsesAVX2 && length >= 16) {
+        return GRMustacheEscapeTableFindCharacterAVX2(table, characters, length);
+    }
+    return GRMustacheEscapeTableFindCharacterSSE2(table, characters, length);
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+    return GRMustacheEscapeTableFindCharacterNEON(table, characters, length);
+#else
+    return GRMustacheEscapeTableFindCharacterScalar(table, characters, length);
+#endif
+}
+
+NSUInteger GRMustacheEscapeTableFindASCIICharacter(const GRMustacheEscapeTable *table, const char *characters, NSUInteger length)
+{
+#if !defined(NS_BLOCK_ASSERTIONS)
+    if (GRMustacheEscapeTableDisableSIMD) {
+        return GRMustacheEscapeTableFindASCIICharacterScalar(table, characters, length);
+    }
+#endif
+    
+    // Short strings are not worth the setup of vector registers
+    if (length < 16) {
+        return GRMustacheEscapeTableFindASCIICharacterScalar(table, characters, length);
+    }
+    
+#if defined(__SSE2__)
+    if (GRMustacheEscapeTableUsesAVX2 && length >= 32) {
+        return GRMustacheEscapeTableFindASCIICharacterAVX2(table, characters, length);
+    }
+    return GRMustacheEscapeTableFindASCIICharacterSSE2(table, characters, length);
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+    return GRMustacheEscapeTableFindASCIICharacterNEON(table, characters, length);
+#else
+    return GRMustacheEscapeTableFindASCIICharacterScalar(table, characters, length);
+#endif
+}
+
+
+// =============================================================================
+#pragma mark - Escaping
+
+/**
+ * Appends characters, escaping them from _index_, the index of the first
+ * character that needs escaping.
+ */
+static void GRMustacheBufferAppendEscapedCharacters(GRMustacheBuffer *buffer, const UniChar *characters, NSUInteger length, NSUInteger index, const GRMustacheEscapeTable *table)
+{
+    NSUInteger start = 0;
+    while (index < length) {
+        GRMustacheBufferAppendCharacters(buffer, characters + start, index - start);
+        size_t escapeLength;
+        const char *escape = GRMustacheEscapeTableEscapeForCharacter(table, characters[index], &escapeLength);
+        GRMustacheBufferAppendASCIIBytes(buffer, escape, escapeLength);
+        start = index + 1;
+        index = start + GRMustacheEscapeTableFindCharacter(table, characters + start, length - start);
+    }
+    GRMustacheBufferAppendCharacters(buffer, characters + start, length - start);
+}
+
+void GRMustacheBufferAppendEscapedString(GRMustacheBuffer *buffer, NSString *string, const GRMustacheEscapeTable *table)
+{
+    CFIndex length = CFStringGetLength((CFStringRef)string);
+    if (length == 0) {
+        return;
+    }
+    
+    // ASCII strings stored as 8-bit characters
+    
+    const char *ASCIICharacters = CFStringGetCStringPtr((CFStringRef)string, kCFStringEncodingASCII);
+    if (ASCIICharacters) {
+        NSUInteger index = GRMustacheEscapeTableFindASCIICharacter(table, ASCIICharacters, length);
+        if (index == length) {
+            GRMustacheBufferAppendString(buffer, string);
+            return;
+        }
+        NSUInteger start = 0;
+        while (index < length) {
+            GRMustacheBufferAppendASCIIBytes(buffer, ASCIICharacters + start, index - start);
+            UInt8 character = ASCIICharacters[index];
+            GRMustacheBufferAppendASCIIBytes(buffer, table->escapeForASCIICharacter[character], table->escapeLengthForASCIICharacter[character]);
+            start = index + 1;
+            index = start + GRMustacheEscapeTableFindASCIICharacter(table, ASCIICharacters + start, length - start);
+        }
+        GRMustacheBufferAppendASCIIBytes(buffer, ASCIICharacters + start, length - start);
+        return;
+    }
+    
+    // Strings stored as UTF-16 characters
     
     const UniChar *characters = CFStringGetCharactersPtr((CFStringRef)string);
-    if (!characters) {
-        NSMutableData *data = [NSMutableData dataWithLength:length * sizeof(UniChar)];
-        [string getCharacters:[data mutableBytes] range:(NSRange){ .location = 0, .length = length }];
-        characters = [data bytes];
-    }
-    
-    GRMustacheBuffer buffer = GRMustacheBufferCreate(capacity);
-    const UniChar *unescapedStart = characters;
-    CFIndex unescapedLength = 0;
-    for (NSUInteger i=0; i<length; ++i, ++characters) {
-        NSString *escape = (*characters < escapeForCharacterLength) ? escapeForCharacter[*characters] : nil;
-        if (escape) {
-            GRMustacheBufferAppendCharacters(&buffer, unescapedStart, unescapedLength);
-            GRMustacheBufferAppendString(&buffer, escape);
-            unescapedStart = characters+1;
-            unescapedLength = 0;
+    if (characters) {
+        NSUInteger index = GRMustacheEscapeTableFindCharacter(table, characters, length);
+        if (index == length) {
+            GRMustacheBufferAppendString(buffer, string);
         } else {
-            ++unescapedLength;
+            GRMustacheBufferAppendEscapedCharacters(buffer, characters, length, index, table);
         }
+        return;
+    }
+    
+    // Other strings: process characters by blocks, without splitting
+    // surrogate pairs.
+    
+    UniChar block[256];
+    CFIndex location = 0;
+    BOOL needsEscaping = NO;
+    while (location < length && !needsEscaping) {
+        CFIndex blockLength = MIN(length - location, 256);
+        CFStringGetCharacters((CFStringRef)string, CFRangeMake(location, blockLength), block);
+        needsEscaping = (GRMustacheEscapeTableFindCharacter(table, block, blockLength) < blockLength);
+        location += blockLength;
     }
-    if (unescapedLength > 0) {
-        GRMustacheBufferAppendCharacters(&buffer, unescapedStart, unescapedLength);
+    if (!needsEscaping) {
+        GRMustacheBufferAppendString(buffer, string);
+        return;
+    }
+    location = 0;
+    while (location < length) {
+        CFIndex blockLength = MIN(length - location, 256);
+        CFStringGetCharacters((CFStringRef)string, CFRangeMake(location, blockLength), block);
+        if (location + blockLength < length && CFStringIsSurrogateHighCharacter(block[blockLength - 1])) {
+            --blockLength;
+        }
+        GRMustacheBufferAppendEscapedCharacters(buffer, block, blockLength, GRMustacheEscapeTableFindCharacter(table, block, blockLength), table);
+        location += blockLength;
     }
+}
+
+void GRMustacheBufferAppendHTMLEscapedString(GRMustacheBuffer *buffer, NSString *string)
+{
+    GRMustacheBufferAppendEscapedString(buffer, string, GRMustacheHTMLEscapeTable());
+}
 
+void GRMustacheBufferAppendHTMLEscapedBuffer(GRMustacheBuffer *buffer, GRMustacheBuffer *source, BOOL keepsTrailingHighSurrogate)
+{
+    NSCAssert(source->stringBuffer, @"Not a string buffer");
+    
+    const GRMustacheEscapeTable *table = GRMustacheHTMLEscapeTable();
+    UniChar highSurrogate = 0;  // A high surrogate that ends the previous segment
+    for (NSUInteger i = 0; i < source->segmentCount; ++i) {
+        GRMustacheBufferSegment *segment = source->segments + i;
+        if (highSurrogate) {
+            // Surrogates are never escaped. Append the pair at once, so that
+            // byte buffers encode it as a single character.
+            UniChar surrogatePair[2] = { highSurrogate, 0 };
+            NSUInteger surrogateCount = 1;
+            if (segment->bytes && CFStringIsSurrogateLowCharacter(*(const UniChar *)segment->bytes)) {
+                surrogatePair[1] = *(const UniChar *)segment->bytes;
+                surrogateCount = 2;
+                segment->bytes += sizeof(UniChar);
+                segment->length -= 1;
+            }
+            GRMustacheBufferAppendCharacters(buffer, surrogatePair, surrogateCount);
+            highSurrogate = 0;
+        }
+        
+        if (segment->bytes == NULL) {
+            // Referenced string
+            GRMustacheBufferAppendEscapedString(buffer, (NSString *)segment->owner, table);
+            continue;
+        }
+        
+        const UniChar *characters = (const UniChar *)segment->bytes;
+        NSUInteger length = segment->length;
+        if (length > 0 && CFStringIsSurrogateHighCharacter(characters[length - 1]) && (keepsTrailingHighSurrogate || i + 1 < source->segmentCount)) {
+            highSurrogate = characters[length - 1];
+            length -= 1;
+        }
+        GRMustacheBufferAppendEscapedCharacters(buffer, characters, length, GRMustacheEscapeTableFindCharacter(table, characters, length), table);
+    }
+    
+    GRMustacheBufferEmpty(source);
+    if (highSurrogate) {
+        GRMustacheBufferAppendCharacters(source, &highSurrogate, 1);
+    }
+}
+
+NSString *GRMustacheTranslateCharacters(NSString *string, const GRMustacheEscapeTable *table)
+{
+    NSUInteger length = [string length];
+    if (length == 0) {
+        return string;
+    }
+    
+    // Assume most strings don't need escaping, and help performances: avoid
+    // creating a buffer if escaping in uncessary.
+    
+    const char *ASCIICharacters = CFStringGetCStringPtr((CFStringRef)string, kCFStringEncodingASCII);
+    if (ASCIICharacters) {
+        if (GRMustacheEscapeTableFindASCIICharacter(table, ASCIICharacters, length) == length) {
+            return string;
+        }
+    } else {
+        const UniChar *characters = CFStringGetCharactersPtr((CFStringRef)string);
+        if (characters && GRMustacheEscapeTableFindCharacter(table, characters, length) == length) {
+            return string;
+        }
+    }
+    
+    GRMustacheBuffer buffer = GRMustacheBufferCreate((length + 20) * 1.2);
+    GRMustacheBufferAppendEscapedString(&buffer, string, table);
     return GRMustacheBufferGetStringAndRelease(&buffer);
 }
 
 NSString *GRMustacheTranslateHTMLCharacters(NSString *string)
 {
-    static const NSString *escapeForCharacter[] = {
-        ['&'] = @"&amp;",
-        ['<'] = @"&lt;",
-        ['>'] = @"&gt;",
-        ['"'] = @"&quot;",
-        ['\''] = @"&apos;",
-    };
-    static const size_t escapeForCharacterLength = sizeof(escapeForCharacter) / sizeof(NSString *);
-    
-    NSUInteger capacity = ([string length] + 20) * 1.2;
-    return GRMustacheTranslateCharacters(string, escapeForCharacter, escapeForCharacterLength, capacity);
+    return GRMustacheTranslateCharacters(string, GRMustacheHTMLEscapeTable());
 }
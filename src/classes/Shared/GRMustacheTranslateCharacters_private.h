@@ -22,6 +22,95 @@
 
 #import <Foundation/Foundation.h>
 #import "GRMustacheAvailabilityMacros_private.h"
+#import "GRMustacheBuffer_private.h"
 
-extern NSString *GRMustacheTranslateCharacters(NSString *string, NSString **escapeForCharacter, size_t escapeForCharacterLength, NSUInteger capacity) GRMUSTACHE_API_INTERNAL;
+/**
+ * The maximum number of distinct characters an escape table can look for,
+ * besides control characters.
+ */
+#define GRMustacheEscapeTableMaximumCharacterCount 32
+
+/**
+ * An escape table describes how characters are escaped.
+ *
+ * Escape tables are built once, and then used for scanning strings with SIMD
+ * instructions when available, and for escaping strings right into
+ * destination buffers.
+ *
+ * @see GRMustacheEscapeTableCreate
+ */
+typedef struct {
+    const char *escapeForASCIICharacter[128];
+    size_t escapeLengthForASCIICharacter[128];
+    UniChar nonASCIICharacters[2];          // escaped characters above 0x7F
+    const char *escapeForNonASCIICharacter[2];
+    size_t nonASCIICharacterCount;
+    BOOL escapesControlCharacters;          // YES if all characters from 0x00 to 0x1F are escaped
+    UniChar scannedCharacters[GRMustacheEscapeTableMaximumCharacterCount];  // escaped characters that are not control characters
+    size_t scannedCharacterCount;
+} GRMustacheEscapeTable;
+
+/**
+ * Returns a new escape table, that must be freed with free().
+ *
+ * @param escapeForASCIICharacter  A table of ASCII C strings, indexed by
+ *                                 escaped ASCII characters. NULL entries are
+ *                                 not escaped.
+ * @param length                   The length of escapeForASCIICharacter, at
+ *                                 most 128.
+ * @param nonASCIICharacters       An array of escaped non-ASCII characters
+ *                                 (at most two).
+ * @param escapeForNonASCIICharacter  The escapes for nonASCIICharacters.
+ * @param nonASCIICharacterCount   The number of non-ASCII characters.
+ */
+extern GRMustacheEscapeTable *GRMustacheEscapeTableCreate(const char **escapeForASCIICharacter, size_t length, const UniChar *nonASCIICharacters, const char **escapeForNonASCIICharacter, size_t nonASCIICharacterCount) GRMUSTACHE_API_INTERNAL;
+
+/**
+ * Returns the index of the first character that needs escaping, or _length_
+ * if there is none.
+ *
+ * The scan uses AVX2 or SSE2 instructions when they are available.
+ */
+extern NSUInteger GRMustacheEscapeTableFindCharacter(const GRMustacheEscapeTable *table, const UniChar *characters, NSUInteger length) GRMUSTACHE_API_INTERNAL;
+
+/**
+ * Returns the index of the first ASCII character that needs escaping, or
+ * _length_ if there is none.
+ *
+ * @see GRMustacheEscapeTableFindCharacter
+ */
+extern NSUInteger GRMustacheEscapeTableFindASCIICharacter(const GRMustacheEscapeTable *table, const char *characters, NSUInteger length) GRMUSTACHE_API_INTERNAL;
+
+#if !defined(NS_BLOCK_ASSERTIONS)
+// For testing purpose
+extern BOOL GRMustacheEscapeTableDisableSIMD GRMUSTACHE_API_INTERNAL;
+#endif
+
+/**
+ * Returns the HTML escape table.
+ */
+extern const GRMustacheEscapeTable *GRMustacheHTMLEscapeTable(void) GRMUSTACHE_API_INTERNAL;
+
+/**
+ * Returns an escaped string, or _string_ itself if it does not need any
+ * escaping.
+ */
+extern NSString *GRMustacheTranslateCharacters(NSString *string, const GRMustacheEscapeTable *table) GRMUSTACHE_API_INTERNAL;
 extern NSString *GRMustacheTranslateHTMLCharacters(NSString *string) GRMUSTACHE_API_INTERNAL;
+
+/**
+ * Appends an escaped string to a buffer, without building any intermediate
+ * string. Strings that do not need any escaping are appended as is.
+ */
+extern void GRMustacheBufferAppendEscapedString(GRMustacheBuffer *buffer, NSString *string, const GRMustacheEscapeTable *table) GRMUSTACHE_API_INTERNAL;
+extern void GRMustacheBufferAppendHTMLEscapedString(GRMustacheBuffer *buffer, NSString *string) GRMUSTACHE_API_INTERNAL;
+
+/**
+ * Appends the HTML-escaped content of the string buffer _source_ to a buffer,
+ * and empties _source_.
+ *
+ * When _keepsTrailingHighSurrogate_ is YES, a high surrogate that ends
+ * _source_ is left in _source_, so that it is appended along with the rest of
+ * its surrogate pair.
+ */
+extern void GRMustacheBufferAppendHTMLEscapedBuffer(GRMustacheBuffer *buffer, GRMustacheBuffer *source, BOOL keepsTrailingHighSurrogate) GRMUSTACHE_API_INTERNAL;
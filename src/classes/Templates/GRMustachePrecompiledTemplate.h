@@ -0,0 +1,206 @@
+// The MIT License
+//
+// Copyright (c) 2014 Gwendal Roué
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#import <Foundation/Foundation.h>
+#import "GRMustacheAvailabilityMacros.h"
+#import "GRMustacheContentType.h"
+
+/**
+ * The state of the rendering of a precompiled template.
+ *
+ * Precompiled rendering functions receive a pointer to this opaque structure,
+ * and pass it to the GRMustachePrecompiledRender* functions.
+ *
+ * @since v7.4
+ */
+typedef struct GRMustachePrecompiledRendering GRMustachePrecompiledRendering;
+
+/**
+ * The type of the functions that render a precompiled template, or the
+ * content of one of its sections.
+ *
+ * @return YES if the rendering succeeded, NO otherwise.
+ *
+ * @since v7.4
+ */
+typedef BOOL (*GRMustachePrecompiledRenderingFunction)(GRMustachePrecompiledRendering *rendering);
+
+/**
+ * The kinds of precompiled tags.
+ *
+ * @since v7.4
+ */
+typedef NS_ENUM(NSInteger, GRMustachePrecompiledTagType) {
+    /**
+     * The type of escaped variable tags such as `{{name}}`.
+     *
+     * @since v7.4
+     */
+    GRMustachePrecompiledTagTypeEscapedVariable AVAILABLE_GRMUSTACHE_VERSION_7_4_AND_LATER,
+    
+    /**
+     * The type of unescaped variable tags such as `{{{name}}}`.
+     *
+     * @since v7.4
+     */
+    GRMustachePrecompiledTagTypeUnescapedVariable AVAILABLE_GRMUSTACHE_VERSION_7_4_AND_LATER,
+    
+    /**
+     * The type of section tags such as `{{#name}}...{{/name}}`.
+     *
+     * @since v7.4
+     */
+    GRMustachePrecompiledTagTypeSection AVAILABLE_GRMUSTACHE_VERSION_7_4_AND_LATER,
+    
+    /**
+     * The type of inverted section tags such as `{{^name}}...{{/name}}`.
+     *
+     * @since v7.4
+     */
+    GRMustachePrecompiledTagTypeInvertedSection AVAILABLE_GRMUSTACHE_VERSION_7_4_AND_LATER,
+} AVAILABLE_GRMUSTACHE_VERSION_7_4_AND_LATER;
+
+typedef struct GRMustachePrecompiledBlock GRMustachePrecompiledBlock;
+
+/**
+ * A static text of a precompiled template, encoded in UTF-8.
+ *
+ * @since v7.4
+ */
+typedef struct {
+    const char *bytes;
+    NSUInteger length;
+} GRMustachePrecompiledText;
+
+/**
+ * A tag of a precompiled template.
+ *
+ * @since v7.4
+ */
+typedef struct {
+    /** The type of the tag. */
+    GRMustachePrecompiledTagType type;
+    
+    /** The expression of the tag, such as `user.name`, encoded in UTF-8. */
+    const char *expression;
+    
+    /** The line of the tag in its template. */
+    NSUInteger line;
+    
+    /** The content of a section tag, or NULL for variable tags. */
+    const GRMustachePrecompiledBlock *content;
+} GRMustachePrecompiledTag;
+
+/**
+ * The compiled form of a template, or of the content of a section.
+ *
+ * The rendering function renders the texts, tags and partials of the block
+ * with the GRMustachePrecompiledRenderText, GRMustachePrecompiledRenderTag,
+ * and GRMustachePrecompiledRenderPartial functions, which identify them by
+ * their index in the tables of the block.
+ *
+ * @since v7.4
+ */
+struct GRMustachePrecompiledBlock {
+    /**
+     * The rendering function, or NULL if the template must be compiled from
+     * its template string.
+     */
+    GRMustachePrecompiledRenderingFunction renderingFunction;
+    
+    /**
+     * The source of the block, encoded in UTF-8: this string is the inner
+     * template string of section tags, and is compiled when there is no
+     * rendering function.
+     */
+    const char *templateString;
+    
+    const GRMustachePrecompiledText *texts;
+    NSUInteger textCount;
+    const GRMustachePrecompiledTag *tags;
+    NSUInteger tagCount;
+    
+    /**
+     * The names of the partial templates, as registered in the template
+     * repository.
+     */
+    const char * const *partialNames;
+    NSUInteger partialCount;
+};
+
+/**
+ * A precompiled template.
+ *
+ * Precompiled templates are generated by the `grmustache-precompile` tool,
+ * and registered into template repositories.
+ *
+ * @see -[GRMustacheTemplateRepository registerPrecompiledTemplate:]
+ *
+ * @since v7.4
+ */
+typedef struct {
+    /** The name of the template, encoded in UTF-8. */
+    const char *name;
+    
+    /** The content type of the template. */
+    GRMustacheContentType contentType;
+    
+    /** The body of the template. */
+    const GRMustachePrecompiledBlock *block;
+} GRMustachePrecompiledTemplate;
+
+
+/**
+ * Renders a static text of the current block.
+ *
+ * @param rendering  The current rendering.
+ * @param index      The index of a text in the block.
+ *
+ * @return YES if the rendering succeeded, NO otherwise.
+ *
+ * @since v7.4
+ */
+extern BOOL GRMustachePrecompiledRenderText(GRMustachePrecompiledRendering *rendering, NSUInteger index) AVAILABLE_GRMUSTACHE_VERSION_7_4_AND_LATER;
+
+/**
+ * Renders a tag of the current block.
+ *
+ * @param rendering  The current rendering.
+ * @param index      The index of a tag in the block.
+ *
+ * @return YES if the rendering succeeded, NO otherwise.
+ *
+ * @since v7.4
+ */
+extern BOOL GRMustachePrecompiledRenderTag(GRMustachePrecompiledRendering *rendering, NSUInteger index) AVAILABLE_GRMUSTACHE_VERSION_7_4_AND_LATER;
+
+/**
+ * Renders a partial of the current block.
+ *
+ * @param rendering  The current rendering.
+ * @param index      The index of a partial name in the block.
+ *
+ * @return YES if the rendering succeeded, NO otherwise.
+ *
+ * @since v7.4
+ */
+extern BOOL GRMustachePrecompiledRenderPartial(GRMustachePrecompiledRendering *rendering, NSUInteger index) AVAILABLE_GRMUSTACHE_VERSION_7_4_AND_LATER;
@@ -27,6 +27,7 @@
 @class GRMustacheContext;
 @class GRMustacheTemplateRepository;
 @protocol GRMustacheTagDelegate;
+@protocol GRMustacheOutputSink;
 
 /**
  * The GRMustacheTemplate class provides with Mustache template rendering
@@ -338,6 +339,155 @@
  */
 - (NSString *)renderContentWithContext:(GRMustacheContext *)context HTMLSafe:(BOOL *)HTMLSafe error:(NSError **)error AVAILABLE_GRMUSTACHE_VERSION_7_0_AND_LATER;
 
+
+////////////////////////////////////////////////////////////////////////////////
+/// @name Rendering Templates Into Bytes
+////////////////////////////////////////////////////////////////////////////////
+
+/**
+ * Renders a template with a context stack initialized with the provided object
+ * on top of the base context, and returns the encoded rendering.
+ *
+ * The rendering is encoded while it is built: no intermediate string is
+ * created. When the encoding is NSUTF8StringEncoding, the static text of the
+ * template is copied straight into the output.
+ *
+ * @param object    An object used for interpreting Mustache tags.
+ * @param encoding  The encoding of the rendering.
+ * @param error     If there is an error rendering the template and its
+ *                  partials, or if the rendering can not be represented in the
+ *                  requested encoding, upon return contains an NSError object
+ *                  that describes the problem.
+ *
+ * @return The encoded rendering.
+ *
+ * @since v7.4
+ */
+- (NSData *)renderDataWithObject:(id)object encoding:(NSStringEncoding)encoding error:(NSError **)error AVAILABLE_GRMUSTACHE_VERSION_7_4_AND_LATER;
+
+
+////////////////////////////////////////////////////////////////////////////////
+/// @name Rendering Templates Into Reusable Buffers
+////////////////////////////////////////////////////////////////////////////////
+
+/**
+ * Renders a template with a context stack initialized with the provided object
+ * on top of the base context, and appends the rendering to a mutable string.
+ *
+ * The string can be reused for several renderings: empty it with
+ * `setString:@""`, and it will keep its storage. Together with the buffers
+ * GRMustache recycles internally, this lets a loop of renderings run without
+ * allocating any rendering buffer once it has been warmed up.
+ *
+ * @param object  An object used for interpreting Mustache tags.
+ * @param string  A mutable string.
+ * @param error   If there is an error rendering the template and its
+ *                partials, upon return contains an NSError object that
+ *                describes the problem.
+ *
+ * @return YES if the rendering could be appended, NO otherwise. The string is
+ *         left untouched if an error occurs.
+ *
+ * @since v7.4
+ */
+- (BOOL)renderObject:(id)object appendingToString:(NSMutableString *)string error:(NSError **)error AVAILABLE_GRMUSTACHE_VERSION_7_4_AND_LATER;
+
+/**
+ * Renders a template with a context stack initialized with the provided object
+ * on top of the base context, and appends the encoded rendering to a mutable
+ * data.
+ *
+ * The data can be reused for several renderings: empty it with
+ * `setLength:0`, and it will keep its storage.
+ *
+ * @param object    An object used for interpreting Mustache tags.
+ * @param data      A mutable data.
+ * @param encoding  The encoding of the rendering.
+ * @param error     If there is an error rendering the template and its
+ *                  partials, or if the rendering can not be represented in the
+ *                  requested encoding, upon return contains an NSError object
+ *                  that describes the problem.
+ *
+ * @return YES if the rendering could be appended, NO otherwise. The data is
+ *         left untouched if an error occurs.
+ *
+ * @see renderObject:appendingToString:error:
+ *
+ * @since v7.4
+ */
+- (BOOL)renderObject:(id)object appendingToData:(NSMutableData *)data encoding:(NSStringEncoding)encoding error:(NSError **)error AVAILABLE_GRMUSTACHE_VERSION_7_4_AND_LATER;
+
+
+////////////////////////////////////////////////////////////////////////////////
+/// @name Rendering Templates Into Output Sinks
+////////////////////////////////////////////////////////////////////////////////
+
+/**
+ * Renders a template with a context stack initialized with the provided object
+ * on top of the base context, and writes the UTF-8 encoded rendering into an
+ * output sink.
+ *
+ * The rendering is written by chunks, while the template is rendering: the
+ * whole rendering is never held in memory.
+ *
+ * Should an error occur, some bytes may have already been written.
+ *
+ * @param object  An object used for interpreting Mustache tags.
+ * @param sink    An output sink.
+ * @param error   If there is an error rendering the template and its
+ *                partials, or writing in the sink, upon return contains an
+ *                NSError object that describes the problem.
+ *
+ * @return YES if the whole rendering could be written, NO otherwise.
+ *
+ * @see GRMustacheOutputSink
+ *
+ * @since v7.4
+ */
+- (BOOL)renderObject:(id)object toSink:(id<GRMustacheOutputSink>)sink error:(NSError **)error AVAILABLE_GRMUSTACHE_VERSION_7_4_AND_LATER;
+
+/**
+ * Renders a template with a context stack initialized with the provided objects
+ * on top of the base context, and writes the UTF-8 encoded rendering into an
+ * output sink.
+ *
+ * The rendering is written by chunks, while the template is rendering: the
+ * whole rendering is never held in memory.
+ *
+ * Should an error occur, some bytes may have already been written.
+ *
+ * @param objects  An array of context objects for interpreting Mustache tags.
+ * @param sink     An output sink.
+ * @param error    If there is an error rendering the template and its
+ *                 partials, or writing in the sink, upon return contains an
+ *                 NSError object that describes the problem.
+ *
+ * @return YES if the whole rendering could be written, NO otherwise.
+ *
+ * @see GRMustacheOutputSink
+ *
+ * @since v7.4
+ */
+- (BOOL)renderObjectsFromArray:(NSArray *)objects toSink:(id<GRMustacheOutputSink>)sink error:(NSError **)error AVAILABLE_GRMUSTACHE_VERSION_7_4_AND_LATER;
+
+/**
+ * Renders the receiver, given a rendering context, and writes the UTF-8
+ * encoded rendering into an output sink.
+ *
+ * @param context  A rendering context.
+ * @param sink     An output sink.
+ * @param error    If there is an error rendering the template and its
+ *                 partials, or writing in the sink, upon return contains an
+ *                 NSError object that describes the problem.
+ *
+ * @return YES if the whole rendering could be written, NO otherwise.
+ *
+ * @see GRMustacheOutputSink
+ *
+ * @since v7.4
+ */
+- (BOOL)renderContentWithContext:(GRMustacheContext *)context toSink:(id<GRMustacheOutputSink>)sink error:(NSError **)error AVAILABLE_GRMUSTACHE_VERSION_7_4_AND_LATER;
+
 ////////////////////////////////////////////////////////////////////////////////
 /// @name Accessing Sibling Templates
 ////////////////////////////////////////////////////////////////////////////////
@@ -127,6 +127,94 @@
     return rendering;
 }
 
+- (NSData *)renderDataWithObject:(id)object encoding:(NSStringEncoding)encoding error:(NSError **)error
+{
+    CFStringEncoding CFEncoding = CFStringConvertNSStringEncodingToEncoding(encoding);
+    if (CFEncoding == kCFStringEncodingInvalidId) {
+        [NSException raise:NSInvalidArgumentException format:@"Invalid encoding:%lu", (unsigned long)encoding];
+        return nil;
+    }
+    
+    GRMustacheContext *context = [self.baseContext contextByAddingObject:object];
+    
+    [GRMustacheRendering pushCurrentTemplateRepository:self.templateRepository];
+    GRMustacheRenderingEngine *renderingEngine = [GRMustacheRenderingEngine renderingEngineWithContentType:_templateAST.contentType context:context];
+    NSData *data = [renderingEngine renderTemplateAST:_templateAST encoding:CFEncoding error:error];
+    [GRMustacheRendering popCurrentTemplateRepository];
+    
+    return data;
+}
+
+- (BOOL)renderObject:(id)object appendingToString:(NSMutableString *)string error:(NSError **)error
+{
+    if (string == nil) {
+        [NSException raise:NSInvalidArgumentException format:@"Invalid string:nil"];
+        return NO;
+    }
+    
+    GRMustacheContext *context = [self.baseContext contextByAddingObject:object];
+    
+    [GRMustacheRendering pushCurrentTemplateRepository:self.templateRepository];
+    GRMustacheRenderingEngine *renderingEngine = [GRMustacheRenderingEngine renderingEngineWithContentType:_templateAST.contentType context:context];
+    BOOL success = [renderingEngine renderTemplateAST:_templateAST appendingToString:string error:error];
+    [GRMustacheRendering popCurrentTemplateRepository];
+    
+    return success;
+}
+
+- (BOOL)renderObject:(id)object appendingToData:(NSMutableData *)data encoding:(NSStringEncoding)encoding error:(NSError **)error
+{
+    if (data == nil) {
+        [NSException raise:NSInvalidArgumentException format:@"Invalid data:nil"];
+        return NO;
+    }
+    
+    CFStringEncoding CFEncoding = CFStringConvertNSStringEncodingToEncoding(encoding);
+    if (CFEncoding == kCFStringEncodingInvalidId) {
+        [NSException raise:NSInvalidArgumentException format:@"Invalid encoding:%lu", (unsigned long)encoding];
+        return NO;
+    }
+    
+    GRMustacheContext *context = [self.baseContext contextByAddingObject:object];
+    
+    [GRMustacheRendering pushCurrentTemplateRepository:self.templateRepository];
+    GRMustacheRenderingEngine *renderingEngine = [GRMustacheRenderingEngine renderingEngineWithContentType:_templateAST.contentType context:context];
+    BOOL success = [renderingEngine renderTemplateAST:_templateAST appendingToData:data encoding:CFEncoding error:error];
+    [GRMustacheRendering popCurrentTemplateRepository];
+    
+    return success;
+}
+
+- (BOOL)renderObject:(id)object toSink:(id<GRMustacheOutputSink>)sink error:(NSError **)error
+{
+    GRMustacheContext *context = [self.baseContext contextByAddingObject:object];
+    return [self renderContentWithContext:context toSink:sink error:error];
+}
+
+- (BOOL)renderObjectsFromArray:(NSArray *)objects toSink:(id<GRMustacheOutputSink>)sink error:(NSError **)error
+{
+    GRMustacheContext *context = self.baseContext;
+    for (id object in objects) {
+        context = [context contextByAddingObject:object];
+    }
+    return [self renderContentWithContext:context toSink:sink error:error];
+}
+
+- (BOOL)renderContentWithContext:(GRMustacheContext *)context toSink:(id<GRMustacheOutputSink>)sink error:(NSError **)error
+{
+    if (sink == nil) {
+        [NSException raise:NSInvalidArgumentException format:@"Invalid sink:nil"];
+        return NO;
+    }
+    
+    [GRMustacheRendering pushCurrentTemplateRepository:self.templateRepository];
+    GRMustacheRenderingEngine *renderingEngine = [GRMustacheRenderingEngine renderingEngineWithContentType:_templateAST.contentType context:context];
+    BOOL success = [renderingEngine renderTemplateAST:_templateAST toOutputSink:sink error:error];
+    [GRMustacheRendering popCurrentTemplateRepository];
+    
+    return success;
+}
+
 - (void)setBaseContext:(GRMustacheContext *)baseContext
 {
     if (!baseContext) {
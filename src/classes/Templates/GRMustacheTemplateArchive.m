@@ -0,0 +1,475 @@
+// The MIT License
+// 
+// Copyright (c) 2014 Gwendal Roué
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#import <libkern/OSByteOrder.h>
+#import "GRMustacheTemplateArchive_private.h"
+#import "GRMustacheTemplateRepository_private.h"
+#import "GRMustacheConfiguration_private.h"
+#import "GRMustacheTemplateASTOptimizer_private.h"
+#import "GRMustacheTemplateAST_private.h"
+#import "GRMustacheTextNode_private.h"
+#import "GRMustacheVariableTag_private.h"
+#import "GRMustacheSectionTag_private.h"
+#import "GRMustachePartialNode_private.h"
+#import "GRMustacheInheritedPartialNode_private.h"
+#import "GRMustacheInheritableSectionNode_private.h"
+#import "GRMustacheExpressionParser_private.h"
+#import "GRMustacheExpression_private.h"
+#import "GRMustacheToken_private.h"
+#import "GRMustacheError.h"
+
+static const char GRMustacheTemplateArchiveMagic[8] = { 'G', 'R', 'M', 'U', 'S', 'T', 'A', 'R' };
+
+/**
+ * The state of the decoding of a template.
+ */
+typedef struct {
+    const uint32_t *words;
+    uint32_t wordCount;
+    uint32_t wordIndex;
+    const char *strings;
+    uint32_t stringsLength;
+    NSString *templateName;
+    NSString *templateString;
+    GRMustacheContentType contentType;
+    BOOL predictsRenderingLength;
+    GRMustacheTemplateRepository *templateRepository;
+    GRMustacheExpressionParser *expressionParser;
+} GRMustacheTemplateArchiveDecoding;
+
+static BOOL GRMustacheTemplateArchiveRangeIsValid(uint64_t location, uint64_t length, uint64_t totalLength);
+static BOOL GRMustacheTemplateArchiveReadWord(GRMustacheTemplateArchiveDecoding *decoding, uint32_t *word);
+static BOOL GRMustacheTemplateArchiveReadBytes(GRMustacheTemplateArchiveDecoding *decoding, const char **bytes, uint32_t *length);
+static NSString *GRMustacheTemplateArchiveReadString(GRMustacheTemplateArchiveDecoding *decoding);
+static void *GRMustacheTemplateArchiveAllocate(CFIndex size, CFOptionFlags hint, void *info);
+static void GRMustacheTemplateArchiveDeallocate(void *ptr, void *info);
+
+@implementation GRMustacheTemplateArchive
+
+- (void)dealloc
+{
+    [_data release];
+    [_templateIndexForName release];
+    if (_bytesDeallocator) {
+        CFRelease(_bytesDeallocator);
+    }
+    [super dealloc];
+}
+
++ (instancetype)templateArchiveWithData:(NSData *)data error:(NSError **)error
+{
+    return [[[self alloc] initWithData:data error:error] autorelease];
+}
+
+- (NSArray *)templateNames
+{
+    return [_templateIndexForName allKeys];
+}
+
+- (GRMustacheTemplateAST *)templateASTNamed:(NSString *)name templateRepository:(GRMustacheTemplateRepository *)templateRepository error:(NSError **)error
+{
+    NSNumber *templateIndex = [_templateIndexForName objectForKey:name];
+    if (templateIndex == nil) {
+        if (error != NULL) {
+            *error = [NSError errorWithDomain:GRMustacheErrorDomain
+                                         code:GRMustacheErrorCodeTemplateNotFound
+                                     userInfo:[NSDictionary dictionaryWithObject:[NSString stringWithFormat:@"No such template: `%@`", name]
+                                                                          forKey:NSLocalizedDescriptionKey]];
+        }
+        return nil;
+    }
+    const GRMustacheTemplateArchiveTemplate *archivedTemplate = _templates + [templateIndex unsignedIntValue];
+    
+    // Ranges have been checked when the archive was loaded.
+    const char *templateStringBytes = _strings + OSSwapLittleToHostInt32(archivedTemplate->templateStringOffset);
+    NSUInteger templateStringLength = OSSwapLittleToHostInt32(archivedTemplate->templateStringLength);
+    NSString *templateString = [self stringWithArchiveBytes:templateStringBytes length:templateStringLength];
+    if (templateString == nil) {
+        return [self invalidArchiveWithDescription:[NSString stringWithFormat:@"template `%@` is not valid UTF-8", name] error:error];
+    }
+    
+    GRMustacheTemplateArchiveDecoding decoding = {
+        .words = _words,
+        .wordCount = _wordCount,
+        .wordIndex = OSSwapLittleToHostInt32(archivedTemplate->ASTWordIndex),
+        .strings = _strings,
+        .stringsLength = _stringsLength,
+        .templateName = name,
+        .templateString = templateString,
+        .contentType = OSSwapLittleToHostInt32(archivedTemplate->contentType),
+        .predictsRenderingLength = templateRepository.configuration.predictsRenderingLength,
+        .templateRepository = templateRepository,
+        .expressionParser = [[[GRMustacheExpressionParser alloc] init] autorelease],
+    };
+    GRMustacheTemplateAST *templateAST = [self templateASTWithDecoding:&decoding error:error];
+    
+    // Optimize before the AST gets cached and rendered
+    if (templateAST) {
+        [[GRMustacheTemplateASTOptimizer templateASTOptimizer] optimizeTemplateAST:templateAST];
+    }
+    return templateAST;
+}
+
+
+#pragma mark - Private
+
+- (instancetype)initWithData:(NSData *)data error:(NSError **)error
+{
+    self = [super init];
+    if (self) {
+        _data = [data retain];
+        if (![self loadReturningError:error]) {
+            [self release];
+            return nil;
+        }
+    }
+    return self;
+}
+
+/**
+ * Checks the header and the template table, and indexes templates by name.
+ *
+ * Nodes are checked when templates are decoded.
+ */
+- (BOOL)loadReturningError:(NSError **)error
+{
+    const char *bytes = [_data bytes];
+    NSUInteger length = [_data length];
+    
+    if (length < sizeof(GRMustacheTemplateArchiveHeader) || memcmp(bytes, GRMustacheTemplateArchiveMagic, sizeof(GRMustacheTemplateArchiveMagic)) != 0) {
+        [self invalidArchiveWithDescription:@"bad header" error:error];
+        return NO;
+    }
+    
+    const GRMustacheTemplateArchiveHeader *header = (const GRMustacheTemplateArchiveHeader *)bytes;
+    uint32_t version = OSSwapLittleToHostInt32(header->version);
+    if (version != GRMustacheTemplateArchiveVersion) {
+        [self invalidArchiveWithDescription:[NSString stringWithFormat:@"unsupported version %u", version] error:error];
+        return NO;
+    }
+    
+    uint32_t templatesOffset = OSSwapLittleToHostInt32(header->templatesOffset);
+    uint32_t wordsOffset = OSSwapLittleToHostInt32(header->wordsOffset);
+    uint32_t stringsOffset = OSSwapLittleToHostInt32(header->stringsOffset);
+    _templateCount = OSSwapLittleToHostInt32(header->templateCount);
+    _wordCount = OSSwapLittleToHostInt32(header->wordCount);
+    _stringsLength = OSSwapLittleToHostInt32(header->stringsLength);
+    if (templatesOffset % sizeof(uint32_t) != 0 ||
+        wordsOffset % sizeof(uint32_t) != 0 ||
+        !GRMustacheTemplateArchiveRangeIsValid(templatesOffset, (uint64_t)_templateCount * sizeof(GRMustacheTemplateArchiveTemplate), length) ||
+        !GRMustacheTemplateArchiveRangeIsValid(wordsOffset, (uint64_t)_wordCount * sizeof(uint32_t), length) ||
+        !GRMustacheTemplateArchiveRangeIsValid(stringsOffset, _stringsLength, length))
+    {
+        [self invalidArchiveWithDescription:@"truncated data" error:error];
+        return NO;
+    }
+    _templates = (const GRMustacheTemplateArchiveTemplate *)(bytes + templatesOffset);
+    _words = (const uint32_t *)(bytes + wordsOffset);
+    _strings = bytes + stringsOffset;
+    
+    NSMutableDictionary *templateIndexForName = [NSMutableDictionary dictionaryWithCapacity:_templateCount];
+    for (uint32_t templateIndex = 0; templateIndex < _templateCount; ++templateIndex) {
+        const GRMustacheTemplateArchiveTemplate *archivedTemplate = _templates + templateIndex;
+        uint32_t nameOffset = OSSwapLittleToHostInt32(archivedTemplate->nameOffset);
+        uint32_t nameLength = OSSwapLittleToHostInt32(archivedTemplate->nameLength);
+        NSString *name = nil;
+        if (GRMustacheTemplateArchiveRangeIsValid(nameOffset, nameLength, _stringsLength)) {
+            name = [[[NSString alloc] initWithBytes:_strings + nameOffset length:nameLength encoding:NSUTF8StringEncoding] autorelease];
+        }
+        GRMustacheContentType contentType = OSSwapLittleToHostInt32(archivedTemplate->contentType);
+        if (name == nil ||
+            [templateIndexForName objectForKey:name] != nil ||
+            !GRMustacheTemplateArchiveRangeIsValid(OSSwapLittleToHostInt32(archivedTemplate->templateStringOffset), OSSwapLittleToHostInt32(archivedTemplate->templateStringLength), _stringsLength) ||
+            (contentType != GRMustacheContentTypeHTML && contentType != GRMustacheContentTypeText) ||
+            OSSwapLittleToHostInt32(archivedTemplate->ASTWordIndex) >= _wordCount)
+        {
+            [self invalidArchiveWithDescription:[NSString stringWithFormat:@"bad template #%u", templateIndex] error:error];
+            return NO;
+        }
+        [templateIndexForName setObject:[NSNumber numberWithUnsignedInt:templateIndex] forKey:name];
+    }
+    _templateIndexForName = [templateIndexForName copy];
+    
+    // Strings and data that reference the archive bytes retain this
+    // allocator, which retains the archive data.
+    CFAllocatorContext allocatorContext = {
+        .version = 0,
+        .info = (void *)_data,
+        .retain = CFRetain,
+        .release = CFRelease,
+        .allocate = GRMustacheTemplateArchiveAllocate,
+        .deallocate = GRMustacheTemplateArchiveDeallocate,
+    };
+    _bytesDeallocator = CFAllocatorCreate(NULL, &allocatorContext);
+    
+    return YES;
+}
+
+/**
+ * Returns a string that references bytes of the archive data, and keeps this
+ * data alive.
+ *
+ * Renderings may return such a string as is: it must remain valid after the
+ * archive and its repository have been deallocated.
+ */
+- (NSString *)stringWithArchiveBytes:(const char *)bytes length:(NSUInteger)length
+{
+    return [(NSString *)CFStringCreateWithBytesNoCopy(NULL, (const UInt8 *)bytes, length, kCFStringEncodingUTF8, false, _bytesDeallocator) autorelease];
+}
+
+/**
+ * Returns a data that references bytes of the archive data, and keeps this
+ * data alive.
+ *
+ * @see stringWithArchiveBytes:length:
+ */
+- (NSData *)dataWithArchiveBytes:(const char *)bytes length:(NSUInteger)length
+{
+    return [(NSData *)CFDataCreateWithBytesNoCopy(NULL, (const UInt8 *)bytes, length, _bytesDeallocator) autorelease];
+}
+
+- (id)invalidArchiveWithDescription:(NSString *)description error:(NSError **)error
+{
+    if (error != NULL) {
+        *error = [NSError errorWithDomain:GRMustacheErrorDomain
+                                     code:GRMustacheErrorCodeParseError
+                                 userInfo:[NSDictionary dictionaryWithObject:[NSString stringWithFormat:@"Invalid template archive: %@", description]
+                                                                      forKey:NSLocalizedDescriptionKey]];
+    }
+    return nil;
+}
+
+- (id)invalidArchiveWithDecoding:(GRMustacheTemplateArchiveDecoding *)decoding error:(NSError **)error
+{
+    return [self invalidArchiveWithDescription:[NSString stringWithFormat:@"bad node at word %u of template `%@`", decoding->wordIndex, decoding->templateName] error:error];
+}
+
+- (GRMustacheTemplateAST *)templateASTWithDecoding:(GRMustacheTemplateArchiveDecoding *)decoding error:(NSError **)error
+{
+    uint32_t nodeCount;
+    if (!GRMustacheTemplateArchiveReadWord(decoding, &nodeCount) || nodeCount > decoding->wordCount - decoding->wordIndex) {
+        return [self invalidArchiveWithDecoding:decoding error:error];
+    }
+    
+    NSMutableArray *templateASTNodes = [NSMutableArray arrayWithCapacity:nodeCount];
+    for (uint32_t i = 0; i < nodeCount; ++i) {
+        id<GRMustacheTemplateASTNode> templateASTNode = [self templateASTNodeWithDecoding:decoding error:error];
+        if (templateASTNode == nil) {
+            return nil;
+        }
+        [templateASTNodes addObject:templateASTNode];
+    }
+    
+    GRMustacheTemplateAST *templateAST = [GRMustacheTemplateAST templateASTWithASTNodes:templateASTNodes contentType:decoding->contentType];
+    templateAST.predictsRenderingLength = decoding->predictsRenderingLength;
+    return templateAST;
+}
+
+- (id<GRMustacheTemplateASTNode>)templateASTNodeWithDecoding:(GRMustacheTemplateArchiveDecoding *)decoding error:(NSError **)error
+{
+    uint32_t nodeType;
+    if (!GRMustacheTemplateArchiveReadWord(decoding, &nodeType)) {
+        return [self invalidArchiveWithDecoding:decoding error:error];
+    }
+    
+    switch (nodeType) {
+        case GRMustacheTemplateArchiveNodeTypeText: {
+            // Texts are not copied
+            const char *bytes;
+            uint32_t length;
+            if (!GRMustacheTemplateArchiveReadBytes(decoding, &bytes, &length)) {
+                return [self invalidArchiveWithDecoding:decoding error:error];
+            }
+            NSString *text = [self stringWithArchiveBytes:bytes length:length];
+            if (text == nil) {
+                return [self invalidArchiveWithDecoding:decoding error:error];
+            }
+            NSData *UTF8Data = [self dataWithArchiveBytes:bytes length:length];
+            return [GRMustacheTextNode textNodeWithText:text UTF8Data:UTF8Data];
+        }
+            
+        case GRMustacheTemplateArchiveNodeTypeVariableTag:
+        case GRMustacheTemplateArchiveNodeTypeSectionTag: {
+            GRMustacheToken *token = [self tokenWithDecoding:decoding];
+            NSString *expressionString = GRMustacheTemplateArchiveReadString(decoding);
+            if (token == nil || expressionString == nil) {
+                return [self invalidArchiveWithDecoding:decoding error:error];
+            }
+            
+            NSError *expressionError;
+            GRMustacheExpression *expression = [decoding->expressionParser parseExpression:expressionString empty:NULL error:&expressionError];
+            if (expression == nil) {
+                if (error != NULL) {
+                    *error = [NSError errorWithDomain:GRMustacheErrorDomain
+                                                 code:GRMustacheErrorCodeParseError
+                                             userInfo:[NSDictionary dictionaryWithObject:[NSString stringWithFormat:@"Parse error at line %lu of template %@: %@", (unsigned long)token.line, decoding->templateName, expressionError.localizedDescription]
+                                                                                  forKey:NSLocalizedDescriptionKey]];
+                }
+                return nil;
+            }
+            expression = [expression internedExpression];
+            
+            if (nodeType == GRMustacheTemplateArchiveNodeTypeVariableTag) {
+                if (token.type != GRMustacheTokenTypeEscapedVariable && token.type != GRMustacheTokenTypeUnescapedVariable) {
+                    return [self invalidArchiveWithDecoding:decoding error:error];
+                }
+                return [GRMustacheVariableTag variableTagWithExpression:expression
+                                                            escapesHTML:(token.type == GRMustacheTokenTypeEscapedVariable)
+                                                            contentType:decoding->contentType
+                                                                  token:token];
+            }
+            
+            uint32_t innerLocation;
+            uint32_t innerLength;
+            if ((token.type != GRMustacheTokenTypeSectionOpening && token.type != GRMustacheTokenTypeInvertedSectionOpening) ||
+                !GRMustacheTemplateArchiveReadWord(decoding, &innerLocation) ||
+                !GRMustacheTemplateArchiveReadWord(decoding, &innerLength) ||
+                !GRMustacheTemplateArchiveRangeIsValid(innerLocation, innerLength, decoding->templateString.length))
+            {
+                return [self invalidArchiveWithDecoding:decoding error:error];
+            }
+            GRMustacheTemplateAST *innerTemplateAST = [self templateASTWithDecoding:decoding error:error];
+            if (innerTemplateAST == nil) {
+                return nil;
+            }
+            return [GRMustacheSectionTag sectionTagWithExpression:expression
+                                                         inverted:(token.type == GRMustacheTokenTypeInvertedSectionOpening)
+                                                   templateString:decoding->templateString
+                                                       innerRange:NSMakeRange(innerLocation, innerLength)
+                                                 innerTemplateAST:innerTemplateAST
+                                                            token:token];
+        }
+            
+        case GRMustacheTemplateArchiveNodeTypePartial:
+            return [self partialNodeWithDecoding:decoding error:error];
+            
+        case GRMustacheTemplateArchiveNodeTypeInheritedPartial: {
+            GRMustachePartialNode *parentPartialNode = [self partialNodeWithDecoding:decoding error:error];
+            if (parentPartialNode == nil) {
+                return nil;
+            }
+            GRMustacheTemplateAST *overridingTemplateAST = [self templateASTWithDecoding:decoding error:error];
+            if (overridingTemplateAST == nil) {
+                return nil;
+            }
+            return [GRMustacheInheritedPartialNode inheritedPartialNodeWithParentPartialNode:parentPartialNode overridingTemplateAST:overridingTemplateAST];
+        }
+            
+        case GRMustacheTemplateArchiveNodeTypeInheritableSection: {
+            NSString *name = GRMustacheTemplateArchiveReadString(decoding);
+            if (name == nil) {
+                return [self invalidArchiveWithDecoding:decoding error:error];
+            }
+            GRMustacheTemplateAST *innerTemplateAST = [self templateASTWithDecoding:decoding error:error];
+            if (innerTemplateAST == nil) {
+                return nil;
+            }
+            return [GRMustacheInheritableSectionNode inheritableSectionNodeWithName:name innerTemplateAST:innerTemplateAST];
+        }
+            
+        default:
+            return [self invalidArchiveWithDecoding:decoding error:error];
+    }
+}
+
+- (GRMustacheToken *)tokenWithDecoding:(GRMustacheTemplateArchiveDecoding *)decoding
+{
+    uint32_t type, line, location, length, innerLocation, innerLength;
+    if (!GRMustacheTemplateArchiveReadWord(decoding, &type) ||
+        !GRMustacheTemplateArchiveReadWord(decoding, &line) ||
+        !GRMustacheTemplateArchiveReadWord(decoding, &location) ||
+        !GRMustacheTemplateArchiveReadWord(decoding, &length) ||
+        !GRMustacheTemplateArchiveReadWord(decoding, &innerLocation) ||
+        !GRMustacheTemplateArchiveReadWord(decoding, &innerLength) ||
+        !GRMustacheTemplateArchiveRangeIsValid(location, length, decoding->templateString.length) ||
+        !GRMustacheTemplateArchiveRangeIsValid(innerLocation, innerLength, decoding->templateString.length))
+    {
+        return nil;
+    }
+    GRMustacheToken *token = [GRMustacheToken tokenWithType:type templateString:decoding->templateString templateID:decoding->templateName line:line range:NSMakeRange(location, length)];
+    token.tagInnerRange = NSMakeRange(innerLocation, innerLength);
+    return token;
+}
+
+- (GRMustachePartialNode *)partialNodeWithDecoding:(GRMustacheTemplateArchiveDecoding *)decoding error:(NSError **)error
+{
+    // Partial names have been resolved by GRMustacheTemplateArchiveGenerator
+    NSString *partialName = GRMustacheTemplateArchiveReadString(decoding);
+    if (partialName == nil) {
+        return [self invalidArchiveWithDecoding:decoding error:error];
+    }
+    GRMustacheTemplateAST *partialTemplateAST = [decoding->templateRepository templateASTNamed:partialName relativeToTemplateID:nil error:error];
+    if (partialTemplateAST == nil) {
+        return nil;
+    }
+    return [GRMustachePartialNode partialNodeWithTemplateAST:partialTemplateAST name:partialName];
+}
+
+@end
+
+static BOOL GRMustacheTemplateArchiveRangeIsValid(uint64_t location, uint64_t length, uint64_t totalLength)
+{
+    return location <= totalLength && length <= totalLength - location;
+}
+
+static BOOL GRMustacheTemplateArchiveReadWord(GRMustacheTemplateArchiveDecoding *decoding, uint32_t *word)
+{
+    if (decoding->wordIndex >= decoding->wordCount) {
+        return NO;
+    }
+    *word = OSSwapLittleToHostInt32(decoding->words[decoding->wordIndex++]);
+    return YES;
+}
+
+static BOOL GRMustacheTemplateArchiveReadBytes(GRMustacheTemplateArchiveDecoding *decoding, const char **bytes, uint32_t *length)
+{
+    uint32_t offset;
+    if (!GRMustacheTemplateArchiveReadWord(decoding, &offset) ||
+        !GRMustacheTemplateArchiveReadWord(decoding, length) ||
+        !GRMustacheTemplateArchiveRangeIsValid(offset, *length, decoding->stringsLength))
+    {
+        return NO;
+    }
+    *bytes = decoding->strings + offset;
+    return YES;
+}
+
+static NSString *GRMustacheTemplateArchiveReadString(GRMustacheTemplateArchiveDecoding *decoding)
+{
+    const char *bytes;
+    uint32_t length;
+    if (!GRMustacheTemplateArchiveReadBytes(decoding, &bytes, &length)) {
+        return nil;
+    }
+    return [[[NSString alloc] initWithBytes:bytes length:length encoding:NSUTF8StringEncoding] autorelease];
+}
+
+static void *GRMustacheTemplateArchiveAllocate(CFIndex size, CFOptionFlags hint, void *info)
+{
+    // The allocator is only used as a deallocator
+    return NULL;
+}
+
+static void GRMustacheTemplateArchiveDeallocate(void *ptr, void *info)
+{
+    // The archive bytes are released with the allocator
+}
@@ -0,0 +1,158 @@
+// The MIT License
+// 
+// Copyright (c) 2014 Gwendal Roué
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#import <Foundation/Foundation.h>
+#import "GRMustacheAvailabilityMacros_private.h"
+
+@class GRMustacheTemplateAST;
+@class GRMustacheTemplateRepository;
+
+/**
+ * The version of the template archive format. Archives of other versions are
+ * rejected.
+ */
+#define GRMustacheTemplateArchiveVersion 1
+
+/**
+ * A template archive stores the ASTs of a set of templates, so that they can
+ * be loaded without being parsed.
+ *
+ * All integers are 32-bit little-endian words. An archive is made of:
+ *
+ * - a GRMustacheTemplateArchiveHeader;
+ * - a table of GRMustacheTemplateArchiveTemplate;
+ * - the words that encode the template ASTs;
+ * - a pool of UTF-8 strings.
+ *
+ * A string is encoded as two words: its offset in the string pool, and its
+ * length in bytes.
+ *
+ * An AST is encoded as its number of nodes, followed by its nodes. Each node
+ * starts with its GRMustacheTemplateArchiveNodeType:
+ *
+ * - text: the text string.
+ * - variable tag: the token, the expression string.
+ * - section tag: the token, the expression string, the inner range location
+ *   and length, the inner AST.
+ * - partial: the template name.
+ * - inherited partial: the parent template name, the overriding AST.
+ * - inheritable section: the name string, the inner AST.
+ *
+ * A token is encoded as its GRMustacheTokenType, line, range location and
+ * length, and tag inner range location and length. Ranges are expressed in
+ * the template string.
+ *
+ * Partial names are the names of templates of the archive.
+ *
+ * @see GRMustacheTemplateArchive
+ * @see GRMustacheTemplateArchiveGenerator
+ */
+typedef struct {
+    char magic[8];              // "GRMUSTAR"
+    uint32_t version;           // GRMustacheTemplateArchiveVersion
+    uint32_t templateCount;
+    uint32_t templatesOffset;   // Offset of the template table
+    uint32_t wordsOffset;       // Offset of the AST words
+    uint32_t wordCount;
+    uint32_t stringsOffset;     // Offset of the string pool
+    uint32_t stringsLength;
+} GRMustacheTemplateArchiveHeader;
+
+typedef struct {
+    uint32_t nameOffset;
+    uint32_t nameLength;
+    uint32_t templateStringOffset;
+    uint32_t templateStringLength;
+    uint32_t contentType;       // GRMustacheContentType
+    uint32_t ASTWordIndex;      // Index of the AST in the AST words
+} GRMustacheTemplateArchiveTemplate;
+
+typedef NS_ENUM(uint32_t, GRMustacheTemplateArchiveNodeType) {
+    GRMustacheTemplateArchiveNodeTypeText = 1,
+    GRMustacheTemplateArchiveNodeTypeVariableTag,
+    GRMustacheTemplateArchiveNodeTypeSectionTag,
+    GRMustacheTemplateArchiveNodeTypePartial,
+    GRMustacheTemplateArchiveNodeTypeInheritedPartial,
+    GRMustacheTemplateArchiveNodeTypeInheritableSection,
+} GRMUSTACHE_API_INTERNAL;
+
+/**
+ * A GRMustacheTemplateArchive reads the templates of a template archive.
+ *
+ * Archives are usually memory-mapped: texts and template strings reference
+ * the archive bytes instead of copying them, and templates are decoded when
+ * they are loaded for the first time. Those strings keep the archive data
+ * alive, so that renderings that return them can outlive the archive. Loading an archive is thus
+ * proportional to the number of its templates, not to their size.
+ *
+ * Archives are immutable, and can be read from several threads.
+ *
+ * @see -[GRMustacheTemplateRepository registerTemplateArchiveAtPath:error:]
+ */
+@interface GRMustacheTemplateArchive : NSObject {
+@private
+    NSData *_data;
+    const GRMustacheTemplateArchiveTemplate *_templates;
+    uint32_t _templateCount;
+    const uint32_t *_words;
+    uint32_t _wordCount;
+    const char *_strings;
+    uint32_t _stringsLength;
+    NSDictionary *_templateIndexForName;
+    CFAllocatorRef _bytesDeallocator;   // Retains _data as long as strings and data reference it
+}
+
+/**
+ * The names of the templates of the archive.
+ */
+@property (nonatomic, readonly) NSArray *templateNames GRMUSTACHE_API_INTERNAL;
+
+/**
+ * Returns a template archive that reads _data_, or nil if the data is not a
+ * valid archive.
+ *
+ * The archive retains _data_, which must not change.
+ *
+ * @param data   The content of an archive.
+ * @param error  If the data is not a valid archive, upon return contains an
+ *               NSError object that describes the problem.
+ *
+ * @return A GRMustacheTemplateArchive
+ */
++ (instancetype)templateArchiveWithData:(NSData *)data error:(NSError **)error GRMUSTACHE_API_INTERNAL;
+
+/**
+ * Decodes and returns the AST of a template.
+ *
+ * Partials are loaded from _templateRepository_.
+ *
+ * @param name                The name of a template of the archive.
+ * @param templateRepository  The repository that loads the template.
+ * @param error               If the template can not be decoded, upon return
+ *                            contains an NSError object that describes the
+ *                            problem.
+ *
+ * @return A GRMustacheTemplateAST
+ */
+- (GRMustacheTemplateAST *)templateASTNamed:(NSString *)name templateRepository:(GRMustacheTemplateRepository *)templateRepository error:(NSError **)error GRMUSTACHE_API_INTERNAL;
+
+@end
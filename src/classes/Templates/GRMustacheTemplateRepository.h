@@ -22,11 +22,59 @@
 
 #import <Foundation/Foundation.h>
 #import "GRMustacheAvailabilityMacros.h"
+#import "GRMustachePrecompiledTemplate.h"
 
 @class GRMustacheTemplate;
 @class GRMustacheTemplateRepository;
 @class GRMustacheConfiguration;
 
+/**
+ * A C struct that holds the statistics of the template cache of a
+ * GRMustacheTemplateRepository.
+ *
+ * @see -[GRMustacheTemplateRepository cacheStatistics]
+ *
+ * @since v7.4
+ */
+typedef struct {
+    NSUInteger hitCount;        /**< The number of templates found in the cache. */
+    NSUInteger missCount;       /**< The number of templates that were not found in the cache. */
+    NSUInteger evictionCount;   /**< The number of templates evicted from the cache. */
+    NSUInteger templateCount;   /**< The number of templates in the cache. */
+    NSUInteger memorySize;      /**< The estimated number of bytes used by the templates in the cache. */
+} GRMustacheTemplateRepositoryCacheStatistics;
+
+/**
+ * A GRMustacheTemplateRepositoryPrecompilationReport tells how long it took
+ * to load templates into the cache of a repository.
+ *
+ * @see -[GRMustacheTemplateRepository precompileTemplatesNamed:concurrently:error:]
+ *
+ * @since v7.4
+ */
+@interface GRMustacheTemplateRepositoryPrecompilationReport : NSObject
+
+/**
+ * A dictionary whose keys are template names, and values NSNumber objects
+ * that contain the time, in seconds, it took to load each template.
+ *
+ * The time of a template includes the time spent loading its partials, or
+ * waiting for other threads to load them. It is close to zero for templates
+ * that were already cached.
+ *
+ * @since v7.4
+ */
+@property (nonatomic, readonly) NSDictionary *templateDurations AVAILABLE_GRMUSTACHE_VERSION_7_4_AND_LATER;
+
+/**
+ * The wall-clock time, in seconds, it took to load all templates.
+ *
+ * @since v7.4
+ */
+@property (nonatomic, readonly) NSTimeInterval duration AVAILABLE_GRMUSTACHE_VERSION_7_4_AND_LATER;
+
+@end
+
 /**
  * The protocol for a GRMustacheTemplateRepository's dataSource.
  * 
@@ -507,6 +555,78 @@
 @property (nonatomic, assign) id<GRMustacheTemplateRepositoryDataSource> dataSource AVAILABLE_GRMUSTACHE_VERSION_7_0_AND_LATER;
 
 
+////////////////////////////////////////////////////////////////////////////////
+/// @name Registering Precompiled Templates
+////////////////////////////////////////////////////////////////////////////////
+
+/**
+ * Registers a precompiled template.
+ *
+ * Precompiled templates are generated by the `grmustache-precompile` tool,
+ * which outputs Objective-C source code that you compile into your
+ * application. This source defines a function that registers all generated
+ * templates into a repository:
+ *
+ * ```
+ * // Generated by `grmustache-precompile -f RegisterTemplates templates`
+ * extern void RegisterTemplates(GRMustacheTemplateRepository *repository);
+ *
+ * GRMustacheTemplateRepository *repository = [GRMustacheTemplateRepository templateRepository];
+ * RegisterTemplates(repository);
+ * GRMustacheTemplate *template = [repository templateNamed:@"profile" error:NULL];
+ * ```
+ *
+ * Registered templates are returned by the templateNamed:error: method before
+ * any template provided by the data source, and do not need to be parsed.
+ *
+ * Partial names in registered templates are resolved among registered
+ * templates first, the same way a repository created with
+ * templateRepositoryWithDirectory: resolves them. Partials that are not
+ * registered are loaded from the data source.
+ *
+ * @param precompiledTemplate  A precompiled template. It is not copied, and
+ *                             must remain valid as long as the repository.
+ *
+ * @see GRMustachePrecompiledTemplate
+ *
+ * @since v7.4
+ */
+- (void)registerPrecompiledTemplate:(const GRMustachePrecompiledTemplate *)precompiledTemplate AVAILABLE_GRMUSTACHE_VERSION_7_4_AND_LATER;
+
+/**
+ * Registers the templates of a template archive.
+ *
+ * Template archives are generated by the `grmustache-archive` tool, which
+ * stores the parsed templates of a directory in a single file that you ship
+ * with your application:
+ *
+ * ```
+ * // Generated by `grmustache-archive -o templates.grmustachearchive templates`
+ * NSString *path = [[NSBundle mainBundle] pathForResource:@"templates" ofType:@"grmustachearchive"];
+ *
+ * GRMustacheTemplateRepository *repository = [GRMustacheTemplateRepository templateRepository];
+ * [repository registerTemplateArchiveAtPath:path error:NULL];
+ * GRMustacheTemplate *template = [repository templateNamed:@"profile" error:NULL];
+ * ```
+ *
+ * The archive is memory-mapped: templates are not parsed, and are only
+ * decoded when they are loaded for the first time. Their texts are not
+ * copied.
+ *
+ * Archived templates are registered the same way as precompiled templates
+ * (see registerPrecompiledTemplate:).
+ *
+ * @param path   The path to a template archive.
+ * @param error  If there is an error reading the archive, upon return
+ *               contains an NSError object that describes the problem.
+ *
+ * @return YES if the archive could be registered.
+ *
+ * @since v7.4
+ */
+- (BOOL)registerTemplateArchiveAtPath:(NSString *)path error:(NSError **)error AVAILABLE_GRMUSTACHE_VERSION_7_4_AND_LATER;
+
+
 ////////////////////////////////////////////////////////////////////////////////
 /// @name Getting Templates out of a Repository
 ////////////////////////////////////////////////////////////////////////////////
@@ -573,4 +693,184 @@
  */
 - (void)reloadTemplates AVAILABLE_GRMUSTACHE_VERSION_7_0_AND_LATER;
 
+/**
+ * Have the template repository reload the templates whose template string has
+ * changed, and the templates that embed them as partials.
+ *
+ * Unlike reloadTemplates, this method does not empty the cache: unchanged
+ * templates are not parsed again. Changed templates are parsed on the current
+ * thread, while other threads keep on loading their previous versions from the
+ * cache. The new versions are then published all
+ * at once, so that no template is loaded with stale partials.
+ *
+ * Repositories that load templates from files, such as the ones created with
+ * templateRepositoryWithDirectory: or templateRepositoryWithBundle:, only
+ * read the files whose modification date has changed. Other repositories
+ * load all template strings from their data source, and compare them to the
+ * cached ones.
+ *
+ * Templates that can no longer be loaded are removed from the cache: the
+ * error is reported the next time they are loaded.
+ *
+ * @warning Previously created instances of GRMustacheTemplate are not reloaded.
+ *          Precompiled templates are not reloaded either.
+ *
+ * @see reloadTemplates
+ *
+ * @since v7.4
+ */
+- (void)reloadChangedTemplates AVAILABLE_GRMUSTACHE_VERSION_7_4_AND_LATER;
+
+
+////////////////////////////////////////////////////////////////////////////////
+/// @name Managing the Template Cache
+////////////////////////////////////////////////////////////////////////////////
+
+/**
+ * The maximum number of bytes used by the templates cached by the repository,
+ * or zero for an unlimited cache.
+ *
+ * When the estimated memory size of cached templates exceeds this limit, the
+ * least recently used templates are evicted from the cache, until the cache
+ * size drops under 90% of the limit. Evicted templates are parsed again the
+ * next time they are needed.
+ *
+ * Eviction does not affect existing GRMustacheTemplate instances, which keep
+ * on rendering evicted templates and partials.
+ *
+ * Memory sizes are estimates: they include the nodes, strings and UTF-8
+ * encodings of parsed templates, but not the memory shared by several
+ * templates, and not the memory allocated by the first rendering of a
+ * template. Precompiled templates are not accounted, and never evicted.
+ *
+ * The default value is zero: the cache is only emptied by the
+ * reloadTemplates method.
+ *
+ * @see pinTemplateNamed:error:
+ * @see cacheStatistics
+ *
+ * @since v7.4
+ */
+@property (nonatomic) NSUInteger cacheMemoryLimit AVAILABLE_GRMUSTACHE_VERSION_7_4_AND_LATER;
+
+/**
+ * Loads a template, and prevents it from being evicted from the cache by the
+ * cacheMemoryLimit.
+ *
+ * Only the named template is pinned, not its partials. Pinned templates still
+ * count in the memory size of the cache, and are still emptied by
+ * reloadTemplates: they are then pinned again when they are loaded again.
+ *
+ * @param name   The template name
+ * @param error  If there is an error loading or parsing template and
+ *               partials, upon return contains an NSError object that
+ *               describes the problem.
+ *
+ * @return YES if the template could be loaded.
+ *
+ * @see unpinTemplateNamed:
+ * @see cacheMemoryLimit
+ *
+ * @since v7.4
+ */
+- (BOOL)pinTemplateNamed:(NSString *)name error:(NSError **)error AVAILABLE_GRMUSTACHE_VERSION_7_4_AND_LATER;
+
+/**
+ * Lets a template pinned by pinTemplateNamed:error: be evicted from the cache
+ * again.
+ *
+ * @param name  The template name
+ *
+ * @see pinTemplateNamed:error:
+ *
+ * @since v7.4
+ */
+- (void)unpinTemplateNamed:(NSString *)name AVAILABLE_GRMUSTACHE_VERSION_7_4_AND_LATER;
+
+/**
+ * Returns the statistics of the template cache: hits, misses, and evictions
+ * since the creation of the repository, and the current number of cached
+ * templates and their estimated memory size.
+ *
+ * Partials count as templates: loading a template that embeds three partials
+ * counts four cache hits or misses.
+ *
+ * @see cacheMemoryLimit
+ *
+ * @since v7.4
+ */
+- (GRMustacheTemplateRepositoryCacheStatistics)cacheStatistics AVAILABLE_GRMUSTACHE_VERSION_7_4_AND_LATER;
+
+
+////////////////////////////////////////////////////////////////////////////////
+/// @name Warming up the Template Cache
+////////////////////////////////////////////////////////////////////////////////
+
+/**
+ * Loads and parses templates, so that they are cached before they are
+ * rendered.
+ *
+ * Templates are otherwise parsed the first time they are loaded: call this
+ * method at startup, so that the first renderings do not pay for parsing:
+ *
+ * ```
+ * GRMustacheTemplateRepositoryPrecompilationReport *report = [repository precompileTemplatesNamed:@[@"document", @"profile"] concurrently:YES error:&error];
+ * NSLog(@"Templates loaded in %f seconds", report.duration);
+ * ```
+ *
+ * When _concurrently_ is YES, templates are parsed in parallel on the global
+ * dispatch queue. Partials shared by several templates are parsed only once.
+ * Repositories whose data source is not thread-safe still load template
+ * strings one after the other.
+ *
+ * All templates are loaded, even when some of them fail.
+ *
+ * Cached templates may still be evicted by the cacheMemoryLimit. Use
+ * pinTemplateNamed:error: for templates that must stay in the cache.
+ *
+ * @param names         An array of template names.
+ * @param concurrently  YES if templates should be parsed in parallel.
+ * @param error         If there is an error loading or parsing a template,
+ *                      upon return contains an NSError object that describes
+ *                      the problem with the first failing template in
+ *                      _names_.
+ *
+ * @return A report of the loading times, or nil if a template could not be
+ *         loaded.
+ *
+ * @see precompileAllTemplatesConcurrently:error:
+ *
+ * @since v7.4
+ */
+- (GRMustacheTemplateRepositoryPrecompilationReport *)precompileTemplatesNamed:(NSArray *)names concurrently:(BOOL)concurrently error:(NSError **)error AVAILABLE_GRMUSTACHE_VERSION_7_4_AND_LATER;
+
+/**
+ * Loads and parses all the templates the repository knows about, so that they
+ * are cached before they are rendered.
+ *
+ * Those templates are the precompiled and archived templates, and:
+ *
+ * - for repositories created with templateRepositoryWithDirectory: or
+ *   templateRepositoryWithBaseURL: with a file URL, all files of the
+ *   directory and its subdirectories that have the template extension.
+ * - for repositories created with templateRepositoryWithDictionary:, all
+ *   templates of the dictionary.
+ *
+ * Other repositories, or repositories whose data source has been replaced,
+ * only load their precompiled and archived templates.
+ *
+ * @param concurrently  YES if templates should be parsed in parallel.
+ * @param error         If there is an error loading or parsing a template,
+ *                      upon return contains an NSError object that describes
+ *                      the problem.
+ *
+ * @return A report of the loading times, or nil if a template could not be
+ *         loaded.
+ *
+ * @see precompileTemplatesNamed:concurrently:error:
+ *
+ * @since v7.4
+ */
+- (GRMustacheTemplateRepositoryPrecompilationReport *)precompileAllTemplatesConcurrently:(BOOL)concurrently error:(NSError **)error AVAILABLE_GRMUSTACHE_VERSION_7_4_AND_LATER;
+
 @end
@@ -20,16 +20,87 @@
 // OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
 // THE SOFTWARE.
 
+#import <stdatomic.h>
 #import "GRMustacheTemplateRepository_private.h"
 #import "GRMustacheTemplate_private.h"
 #import "GRMustacheCompiler_private.h"
+#import "GRMustacheTemplateASTOptimizer_private.h"
+#import "GRMustacheTemplateASTMemoryEstimator_private.h"
+#import "GRMustacheTemplateArchive_private.h"
 #import "GRMustacheError.h"
 #import "GRMustacheConfiguration_private.h"
 #import "GRMustachePartialNode_private.h"
 #import "GRMustacheTemplateAST_private.h"
+#import "GRMustachePrecompiledNode_private.h"
+#import "GRMustacheTextNode_private.h"
+#import "GRMustacheVariableTag_private.h"
+#import "GRMustacheSectionTag_private.h"
+#import "GRMustacheExpressionParser_private.h"
+#import "GRMustacheExpression_private.h"
+#import "GRMustacheToken_private.h"
 
 static NSString* const GRMustacheDefaultExtension = @"mustache";
 
+/**
+ * Returns the 64-bit FNV-1a hash of the characters of a template string.
+ *
+ * Unlike -[NSString hash], which only looks at a few characters of long
+ * strings, all characters contribute to the fingerprint.
+ */
+static uint64_t GRMustacheTemplateStringFingerprint(NSString *templateString)
+{
+    uint64_t fingerprint = 14695981039346656037ULL;
+    unichar characters[256];
+    NSUInteger length = templateString.length;
+    for (NSUInteger location = 0; location < length; location += 256) {
+        NSUInteger count = MIN(256, length - location);
+        [templateString getCharacters:characters range:NSMakeRange(location, count)];
+        for (NSUInteger i = 0; i < count; ++i) {
+            fingerprint ^= characters[i];
+            fingerprint *= 1099511628211ULL;
+        }
+    }
+    return fingerprint;
+}
+
+/**
+ * Returns the modification date, unless it is too recent to be trusted.
+ *
+ * File systems store modification dates with a limited precision: a file
+ * that is modified twice within the same second may keep the same
+ * modification date. Recently modified templates are thus compared by
+ * fingerprint by reloadChangedTemplates.
+ */
+static NSDate *GRMustacheStableModificationDate(NSDate *modificationDate)
+{
+    if ([modificationDate timeIntervalSinceNow] > -2.0) {
+        return nil;
+    }
+    return modificationDate;
+}
+
+/**
+ * Returns the names of the templates of a directory and its subdirectories,
+ * as resolved by GRMustacheTemplateRepositoryDirectory: relative paths,
+ * without extension.
+ */
+static NSArray *GRMustacheTemplateNamesInDirectory(NSString *directoryPath, NSString *templateExtension)
+{
+    NSMutableArray *templateNames = [NSMutableArray array];
+    NSDirectoryEnumerator *enumerator = [[NSFileManager defaultManager] enumeratorAtPath:directoryPath];
+    for (NSString *relativePath in enumerator) {
+        if ([[enumerator fileAttributes] fileType] != NSFileTypeRegular) {
+            continue;
+        }
+        if (templateExtension.length == 0) {
+            [templateNames addObject:relativePath];
+        } else if ([relativePath.pathExtension isEqualToString:templateExtension]) {
+            [templateNames addObject:[relativePath stringByDeletingPathExtension]];
+        }
+    }
+    return templateNames;
+}
+
 
 // =============================================================================
 #pragma mark - Private concrete class GRMustacheTemplateRepositoryBaseURL
@@ -97,12 +168,133 @@ static NSString* const GRMustacheDefaultExtension = @"mustache";
 @end
 
 
+// =============================================================================
+#pragma mark - GRMustacheTemplateRepository
+
+// =============================================================================
+#pragma mark - GRMustacheTemplateCompilation
+
+/**
+ * A template compilation in progress.
+ *
+ * Compilations let concurrent requests for the same template wait for a single
+ * compilation, and let recursive partials refer to the AST being compiled.
+ */
+@interface GRMustacheTemplateCompilation : NSObject {
+@public
+    GRMustacheTemplateAST *_templateAST;    // A placeholder AST, filled on success
+    id _key;                                // The key of the compiled template
+    pthread_t _thread;                      // The compiling thread
+    NSUInteger _cacheGeneration;            // The cache generation at the beginning of the compilation
+    NSError *_error;                        // The compilation error, if compilation has failed
+    BOOL _finished;
+}
+@end
+
+@implementation GRMustacheTemplateCompilation
+
+- (void)dealloc
+{
+    [_templateAST release];
+    [_key release];
+    [_error release];
+    [super dealloc];
+}
+
+@end
+
+
+// =============================================================================
+#pragma mark - GRMustacheTemplateVersion
+
+/**
+ * The version of a template string that was compiled.
+ *
+ * Versions let reloadChangedTemplates find the templates that need to be
+ * compiled again. They outlive cache entries, because the ASTs of evicted
+ * partials remain embedded in the ASTs of their cached dependents.
+ */
+@interface GRMustacheTemplateVersion : NSObject {
+@public
+    NSDate *_modificationDate;              // The modification date of the template string, or nil
+    uint64_t _fingerprint;                  // The fingerprint of the template string
+}
+@end
+
+@implementation GRMustacheTemplateVersion
+
+- (void)dealloc
+{
+    [_modificationDate release];
+    [super dealloc];
+}
+
+@end
+
+
+// =============================================================================
+#pragma mark - GRMustacheTemplateCacheEntry
+
+/**
+ * A compiled template in the cache of a repository.
+ *
+ * The version and partial template IDs let reloadChangedTemplates find the
+ * templates that need to be compiled again.
+ */
+@interface GRMustacheTemplateCacheEntry : NSObject {
+@public
+    GRMustacheTemplateAST *_templateAST;
+    NSUInteger _memorySize;                 // The estimated memory size of the AST
+    _Atomic int64_t _lastAccess;            // The repository cache clock at the last access
+    GRMustacheTemplateVersion *_version;    // The version of the template string, or nil for precompiled templates
+    NSSet *_partialTemplateIDs;             // The IDs of the partials loaded from the data source
+}
+@end
+
+@implementation GRMustacheTemplateCacheEntry
+
+- (void)dealloc
+{
+    [_templateAST release];
+    [_version release];
+    [_partialTemplateIDs release];
+    [super dealloc];
+}
+
+@end
+
+
+// =============================================================================
+#pragma mark - GRMustacheTemplateRepositoryPrecompilationReport
+
+@implementation GRMustacheTemplateRepositoryPrecompilationReport
+@synthesize templateDurations=_templateDurations;
+@synthesize duration=_duration;
+
++ (instancetype)precompilationReportWithTemplateDurations:(NSDictionary *)templateDurations duration:(NSTimeInterval)duration
+{
+    GRMustacheTemplateRepositoryPrecompilationReport *report = [[[self alloc] init] autorelease];
+    report->_templateDurations = [templateDurations copy];
+    report->_duration = duration;
+    return report;
+}
+
+- (void)dealloc
+{
+    [_templateDurations release];
+    [super dealloc];
+}
+
+@end
+
+
 // =============================================================================
 #pragma mark - GRMustacheTemplateRepository
 
 @implementation GRMustacheTemplateRepository
 @synthesize dataSource=_dataSource;
 @synthesize configuration=_configuration;
+@synthesize cacheMemoryLimit=_cacheMemoryLimit;
 
 + (instancetype)templateRepositoryWithBaseURL:(NSURL *)URL
 {
@@ -148,7 +340,22 @@ static NSString* const GRMustacheDefaultExtension = @"mustache";
 {
     self = [super init];
     if (self) {
+        pthread_mutex_init(&_dataSourceMutex, NULL);
+        pthread_rwlock_init(&_cacheLock, NULL);
         _templateASTForTemplateID = [[NSMutableDictionary alloc] init];
+        _templateVersionForTemplateID = [[NSMutableDictionary alloc] init];
+        _precompiledTemplateForName = [[NSMutableDictionary alloc] init];
+        _precompiledTemplateASTForName = [[NSMutableDictionary alloc] init];
+        _templateArchives = [[NSMutableArray alloc] init];
+        _pinnedTemplateIDs = [[NSMutableSet alloc] init];
+        pthread_mutex_init(&_reloadMutex, NULL);
+        _reloadedTemplateASTForTemplateID = [[NSMutableDictionary alloc] init];
+        _reloadCompilationForTemplateID = [[NSMutableDictionary alloc] init];
+        _compilationCondition = [[NSCondition alloc] init];
+        _compilationForTemplateID = [[NSMutableDictionary alloc] init];
+        _compilationForPrecompiledTemplateName = [[NSMutableDictionary alloc] init];
+        _waitedCompilationForThread = CFDictionaryCreateMutable(NULL, 0, NULL, NULL);
+        _borrowedCompilationsForThread = CFDictionaryCreateMutable(NULL, 0, NULL, &kCFTypeDictionaryValueCallBacks);
         _configuration = [[GRMustacheConfiguration defaultConfiguration] copy];
     }
     return self;
@@ -156,11 +363,59 @@ static NSString* const GRMustacheDefaultExtension = @"mustache";
 
 - (void)dealloc
 {
+    pthread_mutex_destroy(&_dataSourceMutex);
+    pthread_rwlock_destroy(&_cacheLock);
     [_templateASTForTemplateID release];
+    [_templateVersionForTemplateID release];
+    [_precompiledTemplateForName release];
+    [_precompiledTemplateASTForName release];
+    [_templateArchives release];
+    [_pinnedTemplateIDs release];
+    pthread_mutex_destroy(&_reloadMutex);
+    [_reloadedTemplateASTForTemplateID release];
+    [_reloadCompilationForTemplateID release];
+    [_compilationCondition release];
+    [_compilationForTemplateID release];
+    [_compilationForPrecompiledTemplateName release];
+    CFRelease(_waitedCompilationForThread);
+    CFRelease(_borrowedCompilationsForThread);
     [_configuration release];
     [super dealloc];
 }
 
+- (void)registerPrecompiledTemplate:(const GRMustachePrecompiledTemplate *)precompiledTemplate
+{
+    NSAssert(precompiledTemplate, @"WTF");
+    NSString *name = [NSString stringWithUTF8String:precompiledTemplate->name];
+    pthread_rwlock_wrlock(&_cacheLock);
+    [_precompiledTemplateForName setObject:[NSValue valueWithPointer:precompiledTemplate] forKey:name];
+    [_precompiledTemplateASTForName removeObjectForKey:name];
+    pthread_rwlock_unlock(&_cacheLock);
+}
+
+- (BOOL)registerTemplateArchiveAtPath:(NSString *)path error:(NSError **)error
+{
+    NSData *data = [NSData dataWithContentsOfFile:path options:NSDataReadingMappedAlways error:error];
+    if (data == nil) {
+        return NO;
+    }
+    GRMustacheTemplateArchive *templateArchive = [GRMustacheTemplateArchive templateArchiveWithData:data error:error];
+    if (templateArchive == nil) {
+        return NO;
+    }
+    
+    // Archived templates reference the mapped data: keep the archive alive as
+    // long as the repository, even when its templates get replaced.
+    pthread_rwlock_wrlock(&_cacheLock);
+    [_templateArchives addObject:templateArchive];
+    for (NSString *name in templateArchive.templateNames) {
+        [_precompiledTemplateForName setObject:templateArchive forKey:name];
+        [_precompiledTemplateASTForName removeObjectForKey:name];
+    }
+    pthread_rwlock_unlock(&_cacheLock);
+    return YES;
+}
+
 - (GRMustacheTemplate *)templateNamed:(NSString *)name error:(NSError **)error
 {
     GRMustacheTemplateAST *templateAST = [self templateASTNamed:name relativeToTemplateID:nil error:error];
@@ -171,7 +426,7 @@ static NSString* const GRMustacheDefaultExtension = @"mustache";
     GRMustacheTemplate *template = [[[GRMustacheTemplate alloc] init] autorelease];
     template.templateRepository = self;
     template.templateAST = templateAST;
-    template.baseContext = _configuration.baseContext;
+    template.baseContext = _configuration.renderingBaseContext;
     return template;
 }
 
@@ -182,7 +437,7 @@ static NSString* const GRMustacheDefaultExtension = @"mustache";
 
 - (GRMustacheTemplate *)templateFromString:(NSString *)templateString contentType:(GRMustacheContentType)contentType error:(NSError **)error
 {
-    GRMustacheTemplateAST *templateAST = [self templateASTFromString:templateString contentType:contentType templateID:nil error:error];
+    GRMustacheTemplateAST *templateAST = [self templateASTFromString:templateString contentType:contentType templateID:nil partialTemplateIDs:NULL error:error];
     if (!templateAST) {
         return nil;
     }
@@ -190,15 +445,254 @@ static NSString* const GRMustacheDefaultExtension = @"mustache";
     GRMustacheTemplate *template = [[[GRMustacheTemplate alloc] init] autorelease];
     template.templateRepository = self;
     template.templateAST = templateAST;
-    template.baseContext = _configuration.baseContext;
+    template.baseContext = _configuration.renderingBaseContext;
     return template;
 }
 
 - (void)reloadTemplates
 {
-    @synchronized(self) {
-        [_templateASTForTemplateID removeAllObjects];
+    // Templates being compiled will not enter the cache.
+    pthread_rwlock_wrlock(&_cacheLock);
+    [_templateASTForTemplateID removeAllObjects];
+    [_templateVersionForTemplateID removeAllObjects];
+    [_precompiledTemplateASTForName removeAllObjects];
+    _cacheMemorySize = 0;
+    ++_cacheGeneration;
+    pthread_rwlock_unlock(&_cacheLock);
+}
+
+- (void)reloadChangedTemplates
+{
+    pthread_mutex_lock(&_reloadMutex);
+    
+    pthread_rwlock_rdlock(&_cacheLock);
+    NSDictionary *entryForTemplateID = [[_templateASTForTemplateID copy] autorelease];
+    NSDictionary *versionForTemplateID = [[_templateVersionForTemplateID copy] autorelease];
+    NSUInteger cacheGeneration = _cacheGeneration;
+    pthread_rwlock_unlock(&_cacheLock);
+    
+    
+    // Find changed templates, and the templates that embed them.
+    //
+    // Partials that have been evicted from the cache are checked as well:
+    // their ASTs are still embedded in the ASTs of cached templates.
+    
+    NSMutableSet *checkedTemplateIDs = [NSMutableSet setWithArray:[entryForTemplateID allKeys]];
+    NSMutableDictionary *dependentTemplateIDsForTemplateID = [NSMutableDictionary dictionary];
+    for (id templateID in entryForTemplateID) {
+        GRMustacheTemplateCacheEntry *entry = [entryForTemplateID objectForKey:templateID];
+        for (id partialTemplateID in entry->_partialTemplateIDs) {
+            [checkedTemplateIDs addObject:partialTemplateID];
+            NSMutableSet *dependentTemplateIDs = [dependentTemplateIDsForTemplateID objectForKey:partialTemplateID];
+            if (dependentTemplateIDs == nil) {
+                dependentTemplateIDs = [NSMutableSet set];
+                [dependentTemplateIDsForTemplateID setObject:dependentTemplateIDs forKey:partialTemplateID];
+            }
+            [dependentTemplateIDs addObject:templateID];
+        }
+    }
+    NSMutableSet *reloadedTemplateIDs = [NSMutableSet set];
+    for (id templateID in checkedTemplateIDs) {
+        GRMustacheTemplateVersion *version = [versionForTemplateID objectForKey:templateID];
+        if (version == nil || [self templateID:templateID hasChangedSinceVersion:version]) {
+            [reloadedTemplateIDs addObject:templateID];
+        }
+    }
+    NSMutableArray *pendingTemplateIDs = [NSMutableArray arrayWithArray:[reloadedTemplateIDs allObjects]];
+    while (pendingTemplateIDs.count > 0) {
+        id templateID = [pendingTemplateIDs lastObject];
+        [pendingTemplateIDs removeLastObject];
+        for (id dependentTemplateID in [dependentTemplateIDsForTemplateID objectForKey:templateID]) {
+            if (![reloadedTemplateIDs containsObject:dependentTemplateID]) {
+                [reloadedTemplateIDs addObject:dependentTemplateID];
+                [pendingTemplateIDs addObject:dependentTemplateID];
+            }
+        }
+    }
+    
+    if (reloadedTemplateIDs.count == 0) {
+        pthread_mutex_unlock(&_reloadMutex);
+        return;
+    }
+    
+    
+    // Compile reloaded templates aside, while other threads keep on using
+    // the cached ones.
+    
+    pthread_rwlock_wrlock(&_cacheLock);
+    _reloadedTemplateIDs = [reloadedTemplateIDs retain];
+    _reloadThread = pthread_self();
+    pthread_rwlock_unlock(&_cacheLock);
+    
+    for (id templateID in reloadedTemplateIDs) {
+        @autoreleasepool {
+            [self templateASTWithTemplateID:templateID name:[templateID description] error:NULL];
+        }
+    }
+    
+    
+    // Publish
+    
+    pthread_rwlock_wrlock(&_cacheLock);
+    if (_cacheGeneration == cacheGeneration) {
+        for (id templateID in reloadedTemplateIDs) {
+            GRMustacheTemplateCacheEntry *entry = [_templateASTForTemplateID objectForKey:templateID];
+            if (entry) {
+                _cacheMemorySize -= entry->_memorySize;
+            }
+            entry = [_reloadedTemplateASTForTemplateID objectForKey:templateID];
+            if (entry) {
+                _cacheMemorySize += entry->_memorySize;
+                [_templateASTForTemplateID setObject:entry forKey:templateID];
+                [_templateVersionForTemplateID setObject:entry->_version forKey:templateID];
+            } else {
+                // Missing or invalid template: the error will be reported
+                // the next time it is loaded.
+                [_templateASTForTemplateID removeObjectForKey:templateID];
+                [_templateVersionForTemplateID removeObjectForKey:templateID];
+            }
+        }
+        [self removeTemplatesDependingOnTemplateIDs:reloadedTemplateIDs fromCache:_templateASTForTemplateID];
+        [self evictTemplatesIfNeeded];
+        [self removeUnusedTemplateVersions];
+    }
+    [_reloadedTemplateASTForTemplateID removeAllObjects];
+    [_reloadedTemplateIDs release];
+    _reloadedTemplateIDs = nil;
+    pthread_rwlock_unlock(&_cacheLock);
+    
+    pthread_mutex_unlock(&_reloadMutex);
+}
+
+- (void)setCacheMemoryLimit:(NSUInteger)cacheMemoryLimit
+{
+    pthread_rwlock_wrlock(&_cacheLock);
+    _cacheMemoryLimit = cacheMemoryLimit;
+    [self evictTemplatesIfNeeded];
+    pthread_rwlock_unlock(&_cacheLock);
+}
+
+- (BOOL)pinTemplateNamed:(NSString *)name error:(NSError **)error
+{
+    // Precompiled templates are never evicted
+    id templateID = nil;
+    if (name && ![self precompiledTemplateNameForName:name relativeToTemplateID:nil]) {
+        templateID = [self templateIDForName:name relativeToTemplateID:nil];
+    }
+    
+    // Pin before loading, so that the template is not evicted as soon as it
+    // enters the cache.
+    if (templateID) {
+        pthread_rwlock_wrlock(&_cacheLock);
+        [_pinnedTemplateIDs addObject:templateID];
+        pthread_rwlock_unlock(&_cacheLock);
+    }
+    
+    if ([self templateASTNamed:name relativeToTemplateID:nil error:error] == nil) {
+        if (templateID) {
+            pthread_rwlock_wrlock(&_cacheLock);
+            [_pinnedTemplateIDs removeObject:templateID];
+            pthread_rwlock_unlock(&_cacheLock);
+        }
+        return NO;
+    }
+    return YES;
+}
+
+- (void)unpinTemplateNamed:(NSString *)name
+{
+    if (name == nil || [self precompiledTemplateNameForName:name relativeToTemplateID:nil]) {
+        return;
+    }
+    id templateID = [self templateIDForName:name relativeToTemplateID:nil];
+    if (templateID == nil) {
+        return;
+    }
+    
+    pthread_rwlock_wrlock(&_cacheLock);
+    [_pinnedTemplateIDs removeObject:templateID];
+    [self evictTemplatesIfNeeded];
+    pthread_rwlock_unlock(&_cacheLock);
+}
+
+- (GRMustacheTemplateRepositoryCacheStatistics)cacheStatistics
+{
+    GRMustacheTemplateRepositoryCacheStatistics statistics;
+    pthread_rwlock_rdlock(&_cacheLock);
+    statistics.hitCount = (NSUInteger)atomic_load_explicit(&_cacheHitCount, memory_order_relaxed);
+    statistics.missCount = (NSUInteger)atomic_load_explicit(&_cacheMissCount, memory_order_relaxed);
+    statistics.evictionCount = _cacheEvictionCount;
+    statistics.templateCount = _templateASTForTemplateID.count + _precompiledTemplateASTForName.count;
+    statistics.memorySize = _cacheMemorySize;
+    pthread_rwlock_unlock(&_cacheLock);
+    return statistics;
+}
+
+- (GRMustacheTemplateRepositoryPrecompilationReport *)precompileTemplatesNamed:(NSArray *)names concurrently:(BOOL)concurrently error:(NSError **)error
+{
+    NSArray *templateNames = [[names copy] autorelease];
+    size_t templateCount = templateNames.count;
+    NSTimeInterval *templateDurations = calloc(MAX(templateCount, 1), sizeof(NSTimeInterval));
+    NSError **templateErrors = calloc(MAX(templateCount, 1), sizeof(NSError *));
+    NSProcessInfo *processInfo = [NSProcessInfo processInfo];
+    NSTimeInterval start = processInfo.systemUptime;
+    
+    // Each iteration writes in its own slot of templateDurations and
+    // templateErrors: no locking is needed.
+    void (^precompileTemplate)(size_t) = ^(size_t templateIndex) {
+        @autoreleasepool {
+            NSTimeInterval templateStart = processInfo.systemUptime;
+            NSError *templateError = nil;
+            if (![self templateASTNamed:[templateNames objectAtIndex:templateIndex] relativeToTemplateID:nil error:&templateError]) {
+                templateErrors[templateIndex] = [templateError retain];  // make sure error is not released by autoreleasepool
+            }
+            templateDurations[templateIndex] = processInfo.systemUptime - templateStart;
+        }
+    };
+    
+    if (concurrently) {
+        // Templates that need a partial compiled by another thread wait for
+        // it: shared partials are compiled once.
+        dispatch_apply(templateCount, dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT, 0), precompileTemplate);
+    } else {
+        for (size_t templateIndex = 0; templateIndex < templateCount; ++templateIndex) {
+            precompileTemplate(templateIndex);
+        }
+    }
+    NSTimeInterval duration = processInfo.systemUptime - start;
+    
+    NSError *firstError = nil;
+    NSMutableDictionary *durationForTemplateName = [NSMutableDictionary dictionaryWithCapacity:templateCount];
+    for (size_t templateIndex = 0; templateIndex < templateCount; ++templateIndex) {
+        if (templateErrors[templateIndex]) {
+            if (firstError == nil) {
+                firstError = [templateErrors[templateIndex] autorelease];
+            } else {
+                [templateErrors[templateIndex] release];
+            }
+        }
+        [durationForTemplateName setObject:[NSNumber numberWithDouble:templateDurations[templateIndex]] forKey:[templateNames objectAtIndex:templateIndex]];
+    }
+    free(templateDurations);
+    free(templateErrors);
+    
+    if (firstError) {
+        if (error != NULL) {
+            *error = firstError;
+        }
+        return nil;
     }
+    return [GRMustacheTemplateRepositoryPrecompilationReport precompilationReportWithTemplateDurations:durationForTemplateName duration:duration];
+}
+
+- (GRMustacheTemplateRepositoryPrecompilationReport *)precompileAllTemplatesConcurrently:(BOOL)concurrently error:(NSError **)error
+{
+    NSMutableSet *templateNames = [NSMutableSet setWithArray:[self dataSourceTemplateNames]];
+    pthread_rwlock_rdlock(&_cacheLock);
+    [templateNames addObjectsFromArray:[_precompiledTemplateForName allKeys]];
+    pthread_rwlock_unlock(&_cacheLock);
+    NSArray *sortedTemplateNames = [[templateNames allObjects] sortedArrayUsingSelector:@selector(compare:)];
+    return [self precompileTemplatesNamed:sortedTemplateNames concurrently:concurrently error:error];
 }
 
 - (void)setConfiguration:(GRMustacheConfiguration *)configuration
@@ -220,18 +714,21 @@ static NSString* const GRMustacheDefaultExtension = @"mustache";
 /**
  * Parses templateString and returns an abstract syntax tree.
  *
- * @param templateString  A Mustache template string.
- * @param contentType     The content type of the returned AST.
- * @param templateID      The template ID of the template, or nil if the
- *                        template string is not tied to any identified template.
- * @param error           If there is an error, upon return contains an NSError
- *                        object that describes the problem.
+ * @param templateString      A Mustache template string.
+ * @param contentType         The content type of the returned AST.
+ * @param templateID          The template ID of the template, or nil if the
+ *                            template string is not tied to any identified
+ *                            template.
+ * @param partialTemplateIDs  Upon return, contains the IDs of the partials
+ *                            loaded from the data source. May be NULL.
+ * @param error               If there is an error, upon return contains an
+ *                            NSError object that describes the problem.
  *
  * @return a GRMustacheTemplateAST instance.
  *
  * @see GRMustacheTemplateRepository
  */
-- (GRMustacheTemplateAST *)templateASTFromString:(NSString *)templateString contentType:(GRMustacheContentType)contentType templateID:(id)templateID error:(NSError **)error
+- (GRMustacheTemplateAST *)templateASTFromString:(NSString *)templateString contentType:(GRMustacheContentType)contentType templateID:(id)templateID partialTemplateIDs:(NSSet **)partialTemplateIDs error:(NSError **)error
 {
     GRMustacheTemplateAST *templateAST = nil;
     @autoreleasepool {
@@ -242,6 +739,7 @@ static NSString* const GRMustacheDefaultExtension = @"mustache";
         GRMustacheCompiler *compiler = [[[GRMustacheCompiler alloc] initWithContentType:contentType] autorelease];
         compiler.templateRepository = self;
         compiler.baseTemplateID = templateID;
+        compiler.predictsRenderingLength = _configuration.predictsRenderingLength;
         
         // Create a Mustache parser that feeds the compiler
         GRMustacheTemplateParser *parser = [[[GRMustacheTemplateParser alloc] initWithConfiguration:_configuration] autorelease];
@@ -251,81 +749,758 @@ static NSString* const GRMustacheDefaultExtension = @"mustache";
         [parser parseTemplateString:templateString templateID:templateID];
         templateAST = [[compiler templateASTReturningError:error] retain];  // make sure AST is not released by autoreleasepool
         
+        // Optimize before the AST gets cached and rendered
+        if (templateAST) {
+            [[GRMustacheTemplateASTOptimizer templateASTOptimizer] optimizeTemplateAST:templateAST];
+            if (partialTemplateIDs != NULL) {
+                *partialTemplateIDs = [compiler.partialTemplateIDs copy];  // make sure set is not released by autoreleasepool
+            }
+        }
+        
         // make sure error is not released by autoreleasepool
         if (!templateAST && error != NULL) [*error retain];
     }
+    if (templateAST && partialTemplateIDs != NULL) [*partialTemplateIDs autorelease];
     if (!templateAST && error != NULL) [*error autorelease];
     return [templateAST autorelease];
 }
 
 - (GRMustacheTemplateAST *)templateASTNamed:(NSString *)name relativeToTemplateID:(id)baseTemplateID error:(NSError **)error
 {
-    // Protect our _templateASTForTemplateID dictionary, and our dataSource
-    @synchronized(self) {
+    return [self templateASTNamed:name relativeToTemplateID:baseTemplateID templateID:NULL error:error];
+}
+
+- (GRMustacheTemplateAST *)templateASTNamed:(NSString *)name relativeToTemplateID:(id)baseTemplateID templateID:(id *)outTemplateID error:(NSError **)error
+{
+    // Registered precompiled templates come first
+    
+    NSString *precompiledTemplateName = [self precompiledTemplateNameForName:name relativeToTemplateID:baseTemplateID];
+    if (precompiledTemplateName) {
+        return [self precompiledTemplateASTNamed:precompiledTemplateName error:error];
+    }
+    if ([self isPrecompiledTemplateID:baseTemplateID]) {
+        // The data source does not know about precompiled templates
+        baseTemplateID = nil;
+    }
+    
+    id templateID = nil;
+    if (name) {
+        templateID = [self templateIDForName:name relativeToTemplateID:baseTemplateID];
+    }
+    if (templateID == nil) {
+        NSError *missingTemplateError = [NSError errorWithDomain:GRMustacheErrorDomain
+                                                            code:GRMustacheErrorCodeTemplateNotFound
+                                                        userInfo:[NSDictionary dictionaryWithObject:[NSString stringWithFormat:@"No such template: `%@`", name, nil]
+                                                                                             forKey:NSLocalizedDescriptionKey]];
+        if (error != NULL) {
+            *error = missingTemplateError;
+        }
+        return nil;
+    }
+    
+    if (outTemplateID != NULL) {
+        *outTemplateID = templateID;
+    }
+    return [self templateASTWithTemplateID:templateID name:name error:error];
+}
+
+/**
+ * Returns the AST of a template provided by the data source.
+ *
+ * @param templateID  The template ID
+ * @param name        The name of the template, for error messages
+ * @param error       If there is an error loading or parsing template and
+ *                    partials, upon return contains an NSError object that
+ *                    describes the problem.
+ */
+- (GRMustacheTemplateAST *)templateASTWithTemplateID:(id)templateID name:(NSString *)name error:(NSError **)error
+{
+    return [self templateASTForKey:templateID cache:_templateASTForTemplateID compilations:_compilationForTemplateID error:error compilationBlock:^GRMustacheTemplateAST *(GRMustacheTemplateCacheEntry *entry, NSError **compilationError) {
+        // Read the modification date before the template string, so that
+        // a concurrent change is detected by the next reload.
+        NSDate *modificationDate = [self modificationDateForTemplateID:templateID];
         
-        id templateID = nil;
-        if (name) {
-           templateID = [self.dataSource templateRepository:self templateIDForName:name relativeToTemplateID:baseTemplateID];
-        }
-        if (templateID == nil) {
-            NSError *missingTemplateError = [NSError errorWithDomain:GRMustacheErrorDomain
-                                                                code:GRMustacheErrorCodeTemplateNotFound
-                                                            userInfo:[NSDictionary dictionaryWithObject:[NSString stringWithFormat:@"No such template: `%@`", name, nil]
-                                                                                                 forKey:NSLocalizedDescriptionKey]];
-            if (error != NULL) {
-                *error = missingTemplateError;
+        // templateRepository:templateStringForTemplateID:error: is a dataSource method.
+        // We are not sure the dataSource will set error when not returning any templateString.
+        // We thus have to take extra care of error handling here.
+        NSError *templateStringError = nil;
+        NSString *templateString = [self templateStringForTemplateID:templateID error:&templateStringError];
+        if (!templateString) {
+            if (templateStringError == nil) {
+                templateStringError = [NSError errorWithDomain:GRMustacheErrorDomain
+                                                          code:GRMustacheErrorCodeTemplateNotFound
+                                                      userInfo:[NSDictionary dictionaryWithObject:[NSString stringWithFormat:@"No such template: `%@`", name, nil]
+                                                                                           forKey:NSLocalizedDescriptionKey]];
+            }
+            if (compilationError != NULL) {
+                *compilationError = templateStringError;
             }
             return nil;
         }
         
-        GRMustacheTemplateAST *templateAST = [_templateASTForTemplateID objectForKey:templateID];
+        NSSet *partialTemplateIDs = nil;
+        GRMustacheTemplateAST *templateAST = [self templateASTFromString:templateString contentType:_configuration.contentType templateID:templateID partialTemplateIDs:&partialTemplateIDs error:compilationError];
+        if (templateAST) {
+            GRMustacheTemplateVersion *version = [[GRMustacheTemplateVersion alloc] init];
+            version->_modificationDate = [GRMustacheStableModificationDate(modificationDate) retain];
+            version->_fingerprint = GRMustacheTemplateStringFingerprint(templateString);
+            entry->_version = version;
+            entry->_partialTemplateIDs = [partialTemplateIDs retain];
+        }
+        return templateAST;
+    }];
+}
+
+
+#pragma mark Data Source
+
+/**
+ * Returns the modification date of the template string, or nil if it is
+ * unknown.
+ *
+ * The default implementation returns nil: reloadChangedTemplates then
+ * compares template strings. Repositories that load templates from files
+ * return their modification dates, so that unmodified files are not read.
+ */
+- (NSDate *)modificationDateForTemplateID:(id)templateID
+{
+    return nil;
+}
+
+/**
+ * Returns the names of the templates provided by the data source, for
+ * precompileAllTemplatesConcurrently:error:.
+ *
+ * The default implementation returns nil: only repositories that are their
+ * own data source know their templates.
+ */
+- (NSArray *)dataSourceTemplateNames
+{
+    return nil;
+}
+
+/**
+ * Returns YES if the template string for _templateID_ is no longer the one
+ * described by _version_, or can no longer be loaded.
+ *
+ * Unchanged modification dates spare the loading of template strings.
+ * Templates that were touched without being modified are not reported as
+ * changed.
+ */
+- (BOOL)templateID:(id)templateID hasChangedSinceVersion:(GRMustacheTemplateVersion *)version
+{
+    NSDate *modificationDate = [self modificationDateForTemplateID:templateID];
+    if (modificationDate && [modificationDate isEqualToDate:version->_modificationDate]) {
+        return NO;
+    }
+    
+    NSString *templateString = [self templateStringForTemplateID:templateID error:NULL];
+    if (templateString == nil || GRMustacheTemplateStringFingerprint(templateString) != version->_fingerprint) {
+        return YES;
+    }
+    
+    // Only reloadChangedTemplates reads and writes modification dates of
+    // versions, and it is serialized.
+    [version->_modificationDate release];
+    version->_modificationDate = [GRMustacheStableModificationDate(modificationDate) retain];
+    return NO;
+}
+
+/**
+ * Data sources are not required to be thread-safe: unless the receiver is its
+ * own data source, calls to the data source are serialized.
+ */
+- (id)templateIDForName:(NSString *)name relativeToTemplateID:(id)baseTemplateID
+{
+    id<GRMustacheTemplateRepositoryDataSource> dataSource = _dataSource;
+    if (_dataSourceIsThreadSafe && dataSource == self) {
+        return [dataSource templateRepository:self templateIDForName:name relativeToTemplateID:baseTemplateID];
+    }
+    
+    pthread_mutex_lock(&_dataSourceMutex);
+    id templateID = [[dataSource templateRepository:self templateIDForName:name relativeToTemplateID:baseTemplateID] retain];
+    pthread_mutex_unlock(&_dataSourceMutex);
+    return [templateID autorelease];
+}
+
+- (NSString *)templateStringForTemplateID:(id)templateID error:(NSError **)error
+{
+    id<GRMustacheTemplateRepositoryDataSource> dataSource = _dataSource;
+    if (_dataSourceIsThreadSafe && dataSource == self) {
+        return [dataSource templateRepository:self templateStringForTemplateID:templateID error:error];
+    }
+    
+    pthread_mutex_lock(&_dataSourceMutex);
+    NSString *templateString = [[dataSource templateRepository:self templateStringForTemplateID:templateID error:error] retain];
+    if (!templateString && error != NULL) [*error retain];
+    pthread_mutex_unlock(&_dataSourceMutex);
+    if (!templateString && error != NULL) [*error autorelease];
+    return [templateString autorelease];
+}
+
+
+#pragma mark Compilation
+
+/**
+ * Returns the AST stored in _cache_ for _key_, or compiles it with _block_.
+ *
+ * The cache contains GRMustacheTemplateCacheEntry instances. Entries of the
+ * template cache are accounted in the cache memory size, and evicted when it
+ * exceeds the cacheMemoryLimit.
+ *
+ * When the current thread runs reloadChangedTemplates, templates being reloaded
+ * are looked up, and compiled, in a separate cache, and published later.
+ *
+ * Concurrent requests for the same key wait for a single compilation, which is
+ * registered in _compilations_ while it runs. Nested requests from the
+ * compiling thread (recursive partials) get the placeholder AST of the
+ * compilation, which is filled when compilation succeeds.
+ *
+ * Two threads that compile templates that refer to each other would wait for
+ * each other forever: such cycles are detected, and the waiting thread gets the
+ * placeholder AST as well. It then waits for this placeholder to be completed
+ * before returning from its outermost compilation, and fails with the same
+ * error if the placeholder could not be completed. The outermost template and
+ * the templates that embed the failed placeholder are then removed from the
+ * cache.
+ *
+ * Templates that embed the placeholder AST of a failed compilation are removed
+ * from the cache.
+ */
+- (GRMustacheTemplateAST *)templateASTForKey:(id)key cache:(NSMutableDictionary *)cache compilations:(NSMutableDictionary *)compilations error:(NSError **)error compilationBlock:(GRMustacheTemplateAST *(^)(GRMustacheTemplateCacheEntry *entry, NSError **error))block
+{
+    // Cache hit
+    
+    GRMustacheTemplateAST *templateAST = nil;
+    pthread_rwlock_rdlock(&_cacheLock);
+    if (cache == _templateASTForTemplateID && _reloadedTemplateIDs && pthread_equal(_reloadThread, pthread_self()) && [_reloadedTemplateIDs containsObject:key]) {
+        cache = _reloadedTemplateASTForTemplateID;
+        compilations = _reloadCompilationForTemplateID;
+    }
+    GRMustacheTemplateCacheEntry *entry = [cache objectForKey:key];
+    if (entry) {
+        // Concurrent readers may update the access time: the last one wins.
+        atomic_store_explicit(&entry->_lastAccess, atomic_fetch_add_explicit(&_cacheClock, 1, memory_order_relaxed) + 1, memory_order_relaxed);
+        templateAST = [entry->_templateAST retain];
+    }
+    pthread_rwlock_unlock(&_cacheLock);
+    if (templateAST) {
+        atomic_fetch_add_explicit(&_cacheHitCount, 1, memory_order_relaxed);
+        return [templateAST autorelease];
+    }
+    atomic_fetch_add_explicit(&_cacheMissCount, 1, memory_order_relaxed);
+    
+    
+    // Wait for a compilation by another thread, or start our own
+    
+    pthread_t thread = pthread_self();
+    GRMustacheTemplateCompilation *compilation = nil;
+    [_compilationCondition lock];
+    while (YES) {
+        pthread_rwlock_rdlock(&_cacheLock);
+        entry = [cache objectForKey:key];
+        templateAST = (entry ? [entry->_templateAST retain] : nil);
+        NSUInteger cacheGeneration = _cacheGeneration;
+        pthread_rwlock_unlock(&_cacheLock);
+        if (templateAST) {
+            [_compilationCondition unlock];
+            return [templateAST autorelease];
+        }
+        
+        GRMustacheTemplateCompilation *pendingCompilation = [compilations objectForKey:key];
+        if (pendingCompilation == nil) {
+            compilation = [[GRMustacheTemplateCompilation alloc] init];
+            compilation->_templateAST = [[GRMustacheTemplateAST placeholderAST] retain];
+            compilation->_key = [key retain];
+            compilation->_thread = thread;
+            compilation->_cacheGeneration = cacheGeneration;
+            [compilations setObject:compilation forKey:key];
+            [compilation release];
+            break;
+        }
         
-        if (templateAST == nil) {
-            // templateRepository:templateStringForTemplateID:error: is a dataSource method.
-            // We are not sure the dataSource will set error when not returning any templateString.
-            // We thus have to take extra care of error handling here.
-            NSError *templateStringError = nil;
-            NSString *templateString = [self.dataSource templateRepository:self templateStringForTemplateID:templateID error:&templateStringError];
-            if (!templateString) {
-                if (templateStringError == nil) {
-                    templateStringError = [NSError errorWithDomain:GRMustacheErrorDomain
-                                                              code:GRMustacheErrorCodeTemplateNotFound
-                                                          userInfo:[NSDictionary dictionaryWithObject:[NSString stringWithFormat:@"No such template: `%@`", name, nil]
-                                                                                               forKey:NSLocalizedDescriptionKey]];
-                }
-                if (error != NULL) {
-                    *error = templateStringError;
+        if (pthread_equal(pendingCompilation->_thread, thread)) {
+            // Recursive partial
+            templateAST = [pendingCompilation->_templateAST retain];
+            [_compilationCondition unlock];
+            return [templateAST autorelease];
+        }
+        
+        if ([self compilationWaitsForCurrentThread:pendingCompilation]) {
+            // Recursive partial across threads
+            CFMutableArrayRef borrowedCompilations = (CFMutableArrayRef)CFDictionaryGetValue(_borrowedCompilationsForThread, thread);
+            if (borrowedCompilations == NULL) {
+                borrowedCompilations = CFArrayCreateMutable(NULL, 0, &kCFTypeArrayCallBacks);
+                CFDictionarySetValue(_borrowedCompilationsForThread, thread, borrowedCompilations);
+                CFRelease(borrowedCompilations);
+            }
+            CFArrayAppendValue(borrowedCompilations, pendingCompilation);
+            templateAST = [pendingCompilation->_templateAST retain];
+            [_compilationCondition unlock];
+            return [templateAST autorelease];
+        }
+        
+        [pendingCompilation retain];
+        CFDictionarySetValue(_waitedCompilationForThread, thread, pendingCompilation);
+        while (!pendingCompilation->_finished) {
+            [_compilationCondition wait];
+        }
+        CFDictionaryRemoveValue(_waitedCompilationForThread, thread);
+        [pendingCompilation release];
+        
+        // Look in the cache again. It does not contain the AST if compilation
+        // has failed, or if templates were reloaded: we'll then compile.
+    }
+    [_compilationCondition unlock];
+    
+    
+    // Compile
+    
+    entry = [[GRMustacheTemplateCacheEntry alloc] init];
+    BOOL published = NO;
+    NSError *compilationError = nil;
+    GRMustacheTemplateAST *compiledAST = block(entry, &compilationError);
+    if (compiledAST) {
+        // update placeholder AST
+        templateAST = compilation->_templateAST;
+        templateAST.templateASTNodes = compiledAST.templateASTNodes;
+        templateAST.contentType = compiledAST.contentType;
+        templateAST.staticTextNode = compiledAST.staticTextNode;
+        templateAST.predictsRenderingLength = compiledAST.predictsRenderingLength;
+        
+        entry->_templateAST = [templateAST retain];
+        
+        // Precompiled templates are not accounted
+        if (cache != _precompiledTemplateASTForName) {
+            entry->_memorySize = [GRMustacheTemplateASTMemoryEstimator memorySizeOfTemplateAST:templateAST];
+        }
+        
+        pthread_rwlock_wrlock(&_cacheLock);
+        if (compilation->_cacheGeneration == _cacheGeneration) {
+            atomic_store_explicit(&entry->_lastAccess, atomic_fetch_add_explicit(&_cacheClock, 1, memory_order_relaxed) + 1, memory_order_relaxed);
+            [cache setObject:entry forKey:key];
+            published = YES;
+            if (cache == _templateASTForTemplateID) {
+                [_templateVersionForTemplateID setObject:entry->_version forKey:key];
+                _cacheMemorySize += entry->_memorySize;
+                [self evictTemplatesIfNeeded];
+            }
+        }
+        pthread_rwlock_unlock(&_cacheLock);
+    } else {
+        // forget invalid empty AST, and the templates that embed it
+        templateAST = nil;
+        compilation->_error = [compilationError retain];
+        pthread_rwlock_wrlock(&_cacheLock);
+        [self removeTemplatesDependingOnTemplateIDs:[NSSet setWithObject:key] fromCache:cache];
+        pthread_rwlock_unlock(&_cacheLock);
+    }
+    
+    
+    // Compiling done
+    
+    [_compilationCondition lock];
+    [templateAST retain];
+    compilation->_finished = YES;
+    [compilations removeObjectForKey:key];  // releases compilation
+    [_compilationCondition broadcast];
+    if (![self currentThreadHasPendingCompilation]) {
+        NSSet *failedKeys = nil;
+        NSError *borrowedCompilationError = [self waitForBorrowedCompilationsReturningFailedKeys:&failedKeys];
+        if (borrowedCompilationError && templateAST) {
+            // Our AST, and maybe some of our partials, embed an empty
+            // placeholder AST: forget them.
+            pthread_rwlock_wrlock(&_cacheLock);
+            if (published && [cache objectForKey:key] == entry) {
+                [cache removeObjectForKey:key];
+                if (cache == _templateASTForTemplateID) {
+                    _cacheMemorySize -= entry->_memorySize;
                 }
-                return nil;
             }
+            [self removeTemplatesDependingOnTemplateIDs:[failedKeys setByAddingObject:key] fromCache:cache];
+            if (cache == _templateASTForTemplateID) {
+                [self removeUnusedTemplateVersions];
+            }
+            pthread_rwlock_unlock(&_cacheLock);
             
-            
-            // Store a placeholder AST before compiling, so that we support
-            // recursive partials
-            templateAST = [GRMustacheTemplateAST placeholderAST];
-            [_templateASTForTemplateID setObject:templateAST forKey:templateID];
-            
-            
-            // Compile
-            
-            GRMustacheTemplateAST *compiledAST = [self templateASTFromString:templateString contentType:_configuration.contentType templateID:templateID error:error];
-            
-            
-            // compiling done
-            
-            if (compiledAST) {
-                // update stored AST
-                templateAST.templateASTNodes = compiledAST.templateASTNodes;
-                templateAST.contentType = compiledAST.contentType;
-            } else {
-                // forget invalid empty AST
-                [_templateASTForTemplateID removeObjectForKey:templateID];
-                templateAST = nil;
+            [templateAST release];
+            templateAST = nil;
+            compilationError = borrowedCompilationError;
+        }
+    }
+    [_compilationCondition unlock];
+    [entry release];
+    
+    if (!templateAST && error != NULL) {
+        *error = compilationError;
+    }
+    return [templateAST autorelease];
+}
+
+/**
+ * Removes from _cache_ the templates that embed, directly or not, the
+ * templates identified by _templateIDs_:
+ *
+ * - reloaded templates that have been compiled by other threads during the
+ *   reload, with the previous versions of their partials.
+ * - templates that embed the placeholder AST of a failed compilation.
+ *
+ * Must be called with _cacheLock locked for writing.
+ */
+- (void)removeTemplatesDependingOnTemplateIDs:(NSSet *)templateIDs fromCache:(NSMutableDictionary *)cache
+{
+    NSMutableSet *staleTemplateIDs = [NSMutableSet setWithSet:templateIDs];
+    BOOL removed;
+    do {
+        removed = NO;
+        for (id templateID in [cache allKeys]) {
+            if ([staleTemplateIDs containsObject:templateID]) {
+                continue;
+            }
+            GRMustacheTemplateCacheEntry *entry = [cache objectForKey:templateID];
+            if ([entry->_partialTemplateIDs intersectsSet:staleTemplateIDs]) {
+                if (cache == _templateASTForTemplateID) {
+                    _cacheMemorySize -= entry->_memorySize;
+                }
+                [cache removeObjectForKey:templateID];
+                [staleTemplateIDs addObject:templateID];
+                removed = YES;
+            }
+        }
+    } while (removed);
+}
+
+/**
+ * Forgets the versions of the templates that are neither cached, nor embedded
+ * in cached templates: they will be recorded again when those templates are
+ * compiled.
+ *
+ * Must be called with _cacheLock locked for writing.
+ */
+- (void)removeUnusedTemplateVersions
+{
+    NSMutableSet *usedTemplateIDs = [NSMutableSet setWithArray:[_templateASTForTemplateID allKeys]];
+    for (GRMustacheTemplateCacheEntry *entry in [_templateASTForTemplateID objectEnumerator]) {
+        [usedTemplateIDs unionSet:entry->_partialTemplateIDs];
+    }
+    for (id templateID in [_templateVersionForTemplateID allKeys]) {
+        if (![usedTemplateIDs containsObject:templateID]) {
+            [_templateVersionForTemplateID removeObjectForKey:templateID];
+        }
+    }
+}
+
+/**
+ * Evicts the least recently used templates that are not pinned, until the
+ * memory size of the cache drops under 90% of cacheMemoryLimit.
+ *
+ * Evicted ASTs are only released by the cache: templates and ASTs that refer
+ * to them keep them alive.
+ *
+ * Must be called with _cacheLock locked for writing.
+ */
+- (void)evictTemplatesIfNeeded
+{
+    if (_cacheMemoryLimit == 0 || _cacheMemorySize <= _cacheMemoryLimit) {
+        return;
+    }
+    
+    NSUInteger targetMemorySize = _cacheMemoryLimit - _cacheMemoryLimit / 10;
+    NSArray *templateIDs = [_templateASTForTemplateID keysSortedByValueUsingComparator:^NSComparisonResult(GRMustacheTemplateCacheEntry *entry1, GRMustacheTemplateCacheEntry *entry2) {
+        int64_t lastAccess1 = atomic_load_explicit(&entry1->_lastAccess, memory_order_relaxed);
+        int64_t lastAccess2 = atomic_load_explicit(&entry2->_lastAccess, memory_order_relaxed);
+        if (lastAccess1 < lastAccess2) {
+            return NSOrderedAscending;
+        } else if (lastAccess1 > lastAccess2) {
+            return NSOrderedDescending;
+        }
+        return NSOrderedSame;
+    }];
+    for (id templateID in templateIDs) {
+        if (_cacheMemorySize <= targetMemorySize) {
+            break;
+        }
+        if ([_pinnedTemplateIDs containsObject:templateID]) {
+            continue;
+        }
+        GRMustacheTemplateCacheEntry *entry = [_templateASTForTemplateID objectForKey:templateID];
+        _cacheMemorySize -= entry->_memorySize;
+        ++_cacheEvictionCount;
+        [_templateASTForTemplateID removeObjectForKey:templateID];
+    }
+}
+
+/**
+ * Returns YES if the thread that runs _compilation_ waits, directly or not,
+ * for a compilation run by the current thread.
+ *
+ * Must be called with _compilationCondition locked.
+ */
+- (BOOL)compilationWaitsForCurrentThread:(GRMustacheTemplateCompilation *)compilation
+{
+    pthread_t thread = pthread_self();
+    while (compilation) {
+        if (pthread_equal(compilation->_thread, thread)) {
+            return YES;
+        }
+        compilation = (GRMustacheTemplateCompilation *)CFDictionaryGetValue(_waitedCompilationForThread, compilation->_thread);
+    }
+    return NO;
+}
+
+/**
+ * Returns YES if the current thread is compiling a template.
+ *
+ * Must be called with _compilationCondition locked.
+ */
+- (BOOL)currentThreadHasPendingCompilation
+{
+    pthread_t thread = pthread_self();
+    for (NSDictionary *compilations in @[_compilationForTemplateID, _compilationForPrecompiledTemplateName, _reloadCompilationForTemplateID]) {
+        for (id key in compilations) {
+            GRMustacheTemplateCompilation *compilation = [compilations objectForKey:key];
+            if (pthread_equal(compilation->_thread, thread)) {
+                return YES;
             }
         }
+    }
+    return NO;
+}
+
+/**
+ * Waits until the compilations whose placeholder ASTs were given to the
+ * current thread, in order to break a cycle, are finished.
+ *
+ * Must be called with _compilationCondition locked, when the current thread
+ * does not compile any template: no other thread waits for it.
+ *
+ * @param failedKeys  Upon return, contains the keys of the borrowed
+ *                    compilations that have failed.
+ *
+ * @return The error of the first borrowed compilation that has failed, or nil.
+ */
+- (NSError *)waitForBorrowedCompilationsReturningFailedKeys:(NSSet **)failedKeys
+{
+    *failedKeys = nil;
+    pthread_t thread = pthread_self();
+    CFArrayRef borrowedCompilations = CFDictionaryGetValue(_borrowedCompilationsForThread, thread);
+    if (borrowedCompilations == NULL) {
+        return nil;
+    }
+    
+    CFRetain(borrowedCompilations);
+    CFDictionaryRemoveValue(_borrowedCompilationsForThread, thread);
+    NSMutableSet *keys = [NSMutableSet set];
+    NSError *error = nil;
+    CFIndex count = CFArrayGetCount(borrowedCompilations);
+    for (CFIndex i = 0; i < count; ++i) {
+        GRMustacheTemplateCompilation *compilation = (GRMustacheTemplateCompilation *)CFArrayGetValueAtIndex(borrowedCompilations, i);
+        while (!compilation->_finished) {
+            [_compilationCondition wait];
+        }
+        if (!compilation->_templateAST.placeholder) {
+            continue;
+        }
+        [keys addObject:compilation->_key];
+        if (error == nil) {
+            error = [[compilation->_error retain] autorelease];
+            if (error == nil) {
+                error = [NSError errorWithDomain:GRMustacheErrorDomain
+                                            code:GRMustacheErrorCodeTemplateNotFound
+                                        userInfo:[NSDictionary dictionaryWithObject:@"Partial compilation has failed"
+                                                                             forKey:NSLocalizedDescriptionKey]];
+            }
+        }
+    }
+    CFRelease(borrowedCompilations);
+    *failedKeys = keys;
+    return error;
+}
+
+
+#pragma mark Precompiled Templates
+
+/**
+ * Precompiled templates are identified by their name.
+ */
+- (BOOL)isPrecompiledTemplateID:(id)templateID
+{
+    if (![templateID isKindOfClass:[NSString class]]) {
+        return NO;
+    }
+    pthread_rwlock_rdlock(&_cacheLock);
+    BOOL isPrecompiledTemplateID = ([_precompiledTemplateForName objectForKey:templateID] != nil);
+    pthread_rwlock_unlock(&_cacheLock);
+    return isPrecompiledTemplateID;
+}
+
+/**
+ * Returns the name of a registered precompiled template, or nil.
+ *
+ * Names are resolved relative to precompiled base templates, the same way
+ * GRMustacheTemplateRepositoryDirectory resolves them.
+ */
+- (NSString *)precompiledTemplateNameForName:(NSString *)name relativeToTemplateID:(id)baseTemplateID
+{
+    pthread_rwlock_rdlock(&_cacheLock);
+    NSUInteger precompiledTemplateCount = _precompiledTemplateForName.count;
+    pthread_rwlock_unlock(&_cacheLock);
+    if (name.length == 0 || precompiledTemplateCount == 0) {
+        return nil;
+    }
+    
+    NSString *path;
+    if ([name characterAtIndex:0] == '/') {
+        path = name;
+    } else if ([self isPrecompiledTemplateID:baseTemplateID]) {
+        path = [[@"/" stringByAppendingPathComponent:[(NSString *)baseTemplateID stringByDeletingLastPathComponent]] stringByAppendingPathComponent:name];
+    } else {
+        path = [@"/" stringByAppendingString:name];
+    }
+    NSString *precompiledTemplateName = [[path stringByStandardizingPath] substringFromIndex:1];
+    if (![self isPrecompiledTemplateID:precompiledTemplateName]) {
+        return nil;
+    }
+    return precompiledTemplateName;
+}
+
+- (GRMustacheTemplateAST *)precompiledTemplateASTNamed:(NSString *)name error:(NSError **)error
+{
+    return [self templateASTForKey:name cache:_precompiledTemplateASTForName compilations:_compilationForPrecompiledTemplateName error:error compilationBlock:^GRMustacheTemplateAST *(GRMustacheTemplateCacheEntry *entry, NSError **compilationError) {
+        pthread_rwlock_rdlock(&_cacheLock);
+        id registeredTemplate = [[[_precompiledTemplateForName objectForKey:name] retain] autorelease];
+        pthread_rwlock_unlock(&_cacheLock);
+        
+        if ([registeredTemplate isKindOfClass:[GRMustacheTemplateArchive class]]) {
+            // It's time to lock the configuration.
+            [_configuration lock];
+            return [(GRMustacheTemplateArchive *)registeredTemplate templateASTNamed:name templateRepository:self error:compilationError];
+        }
         
-        return templateAST;
+        const GRMustachePrecompiledTemplate *precompiledTemplate = [registeredTemplate pointerValue];
+        if (precompiledTemplate->block->renderingFunction) {
+            return [self templateASTWithPrecompiledBlock:precompiledTemplate->block contentType:precompiledTemplate->contentType templateID:name error:compilationError];
+        } else {
+            // Templates that use inheritance are not precompiled
+            NSString *templateString = [NSString stringWithUTF8String:precompiledTemplate->block->templateString];
+            return [self templateASTFromString:templateString contentType:precompiledTemplate->contentType templateID:name partialTemplateIDs:NULL error:compilationError];
+        }
+    }];
+}
+
+/**
+ * Returns an AST made of a single GRMustachePrecompiledNode.
+ *
+ * Only tag expressions are parsed: texts are not copied, and sections and
+ * partials are loaded from their precompiled blocks.
+ */
+- (GRMustacheTemplateAST *)templateASTWithPrecompiledBlock:(const GRMustachePrecompiledBlock *)block contentType:(GRMustacheContentType)contentType templateID:(id)templateID error:(NSError **)error
+{
+    // It's time to lock the configuration.
+    [_configuration lock];
+    
+    NSMutableArray *textNodes = [NSMutableArray arrayWithCapacity:block->textCount];
+    for (NSUInteger i = 0; i < block->textCount; ++i) {
+        const GRMustachePrecompiledText *text = block->texts + i;
+        NSString *string = [[[NSString alloc] initWithBytesNoCopy:(void *)text->bytes length:text->length encoding:NSUTF8StringEncoding freeWhenDone:NO] autorelease];
+        NSData *UTF8Data = [NSData dataWithBytesNoCopy:(void *)text->bytes length:text->length freeWhenDone:NO];
+        [textNodes addObject:[GRMustacheTextNode textNodeWithText:string UTF8Data:UTF8Data]];
+    }
+    
+    NSMutableArray *tags = [NSMutableArray arrayWithCapacity:block->tagCount];
+    GRMustacheExpressionParser *expressionParser = [[[GRMustacheExpressionParser alloc] init] autorelease];
+    for (NSUInteger i = 0; i < block->tagCount; ++i) {
+        const GRMustachePrecompiledTag *precompiledTag = block->tags + i;
+        
+        GRMustacheTokenType tokenType;
+        switch (precompiledTag->type) {
+            case GRMustachePrecompiledTagTypeEscapedVariable:
+                tokenType = GRMustacheTokenTypeEscapedVariable;
+                break;
+            case GRMustachePrecompiledTagTypeUnescapedVariable:
+                tokenType = GRMustacheTokenTypeUnescapedVariable;
+                break;
+            case GRMustachePrecompiledTagTypeSection:
+                tokenType = GRMustacheTokenTypeSectionOpening;
+                break;
+            case GRMustachePrecompiledTagTypeInvertedSection:
+                tokenType = GRMustacheTokenTypeInvertedSectionOpening;
+                break;
+        }
+        NSString *expressionString = [NSString stringWithUTF8String:precompiledTag->expression];
+        NSRange expressionRange = NSMakeRange(0, expressionString.length);
+        GRMustacheToken *token = [GRMustacheToken tokenWithType:tokenType templateString:expressionString templateID:templateID line:precompiledTag->line range:expressionRange];
+        token.tagInnerRange = expressionRange;
+        
+        NSError *expressionError;
+        GRMustacheExpression *expression = [expressionParser parseExpression:expressionString empty:NULL error:&expressionError];
+        if (expression == nil) {
+            if (error != NULL) {
+                *error = [NSError errorWithDomain:GRMustacheErrorDomain
+                                             code:GRMustacheErrorCodeParseError
+                                         userInfo:[NSDictionary dictionaryWithObject:[NSString stringWithFormat:@"Parse error at line %lu of template %@: %@", (unsigned long)token.line, templateID, expressionError.localizedDescription]
+                                                                              forKey:NSLocalizedDescriptionKey]];
+            }
+            return nil;
+        }
+        expression = [expression internedExpression];
+        
+        switch (precompiledTag->type) {
+            case GRMustachePrecompiledTagTypeEscapedVariable:
+            case GRMustachePrecompiledTagTypeUnescapedVariable:
+                [tags addObject:[GRMustacheVariableTag variableTagWithExpression:expression escapesHTML:(precompiledTag->type == GRMustachePrecompiledTagTypeEscapedVariable) contentType:contentType token:token]];
+                break;
+                
+            case GRMustachePrecompiledTagTypeSection:
+            case GRMustachePrecompiledTagTypeInvertedSection: {
+                GRMustacheTemplateAST *innerTemplateAST = [self templateASTWithPrecompiledBlock:precompiledTag->content contentType:contentType templateID:templateID error:error];
+                if (innerTemplateAST == nil) {
+                    return nil;
+                }
+                NSString *innerTemplateString = [NSString stringWithUTF8String:precompiledTag->content->templateString];
+                [tags addObject:[GRMustacheSectionTag sectionTagWithExpression:expression
+                                                                      inverted:(precompiledTag->type == GRMustachePrecompiledTagTypeInvertedSection)
+                                                                templateString:innerTemplateString
+                                                                    innerRange:NSMakeRange(0, innerTemplateString.length)
+                                                              innerTemplateAST:innerTemplateAST
+                                                                         token:token]];
+            } break;
+        }
+    }
+    
+    NSMutableArray *partialNodes = [NSMutableArray arrayWithCapacity:block->partialCount];
+    for (NSUInteger i = 0; i < block->partialCount; ++i) {
+        // Partial names have been resolved by grmustache-precompile
+        NSString *partialName = [NSString stringWithUTF8String:block->partialNames[i]];
+        GRMustacheTemplateAST *partialTemplateAST = [self templateASTNamed:partialName relativeToTemplateID:nil error:error];
+        if (partialTemplateAST == nil) {
+            return nil;
+        }
+        [partialNodes addObject:[GRMustachePartialNode partialNodeWithTemplateAST:partialTemplateAST name:partialName]];
     }
+    
+    GRMustachePrecompiledNode *precompiledNode = [GRMustachePrecompiledNode precompiledNodeWithRenderingFunction:block->renderingFunction
+                                                                                                  templateString:[NSString stringWithUTF8String:block->templateString]
+                                                                                                       textNodes:textNodes
+                                                                                                            tags:tags
+                                                                                                    partialNodes:partialNodes];
+    GRMustacheTemplateAST *templateAST = [GRMustacheTemplateAST templateASTWithASTNodes:[NSArray arrayWithObject:precompiledNode] contentType:contentType];
+    templateAST.predictsRenderingLength = _configuration.predictsRenderingLength;
+    
+    // Blocks that contain only text render without calling the rendering
+    // function.
+    if (tags.count == 0 && partialNodes.count == 0) {
+        switch (textNodes.count) {
+            case 0:
+                templateAST.staticTextNode = [GRMustacheTextNode textNodeWithText:@""];
+                break;
+            case 1:
+                templateAST.staticTextNode = [textNodes objectAtIndex:0];
+                break;
+        }
+    }
+    
+    return templateAST;
 }
 
 @end
@@ -347,6 +1522,7 @@ static NSString* const GRMustacheDefaultExtension = @"mustache";
         _templateExtension = [templateExtension retain];
         _encoding = encoding;
         self.dataSource = self;
+        _dataSourceIsThreadSafe = YES;
     }
     return self;
 }
@@ -391,6 +1567,25 @@ static NSString* const GRMustacheDefaultExtension = @"mustache";
     return [NSString stringWithContentsOfURL:(NSURL *)templateID encoding:_encoding error:error];
 }
 
+
+#pragma mark GRMustacheTemplateRepository
+
+- (NSDate *)modificationDateForTemplateID:(id)templateID
+{
+    if (self.dataSource != self || ![(NSURL *)templateID isFileURL]) {
+        return nil;
+    }
+    return [[[NSFileManager defaultManager] attributesOfItemAtPath:[(NSURL *)templateID path] error:NULL] fileModificationDate];
+}
+
+- (NSArray *)dataSourceTemplateNames
+{
+    if (self.dataSource != self || ![_baseURL isFileURL]) {
+        return nil;
+    }
+    return GRMustacheTemplateNamesInDirectory([_baseURL path], _templateExtension);
+}
+
 @end
 
 
@@ -410,6 +1605,7 @@ static NSString* const GRMustacheDefaultExtension = @"mustache";
         _templateExtension = [templateExtension retain];
         _encoding = encoding;
         self.dataSource = self;
+        _dataSourceIsThreadSafe = YES;
     }
     return self;
 }
@@ -455,6 +1651,25 @@ static NSString* const GRMustacheDefaultExtension = @"mustache";
     return [NSString stringWithContentsOfFile:(NSString *)templateID encoding:_encoding error:error];
 }
 
+
+#pragma mark GRMustacheTemplateRepository
+
+- (NSDate *)modificationDateForTemplateID:(id)templateID
+{
+    if (self.dataSource != self) {
+        return nil;
+    }
+    return [[[NSFileManager defaultManager] attributesOfItemAtPath:(NSString *)templateID error:NULL] fileModificationDate];
+}
+
+- (NSArray *)dataSourceTemplateNames
+{
+    if (self.dataSource != self) {
+        return nil;
+    }
+    return GRMustacheTemplateNamesInDirectory(_directoryPath, _templateExtension);
+}
+
 @end
 
 
@@ -477,6 +1692,7 @@ static NSString* const GRMustacheDefaultExtension = @"mustache";
         _templateExtension = [templateExtension retain];
         _encoding = encoding;
         self.dataSource = self;
+        _dataSourceIsThreadSafe = YES;
     }
     return self;
 }
@@ -514,6 +1730,17 @@ static NSString* const GRMustacheDefaultExtension = @"mustache";
     return [NSString stringWithContentsOfFile:(NSString *)templateID encoding:_encoding error:error];
 }
 
+
+#pragma mark GRMustacheTemplateRepository
+
+- (NSDate *)modificationDateForTemplateID:(id)templateID
+{
+    if (self.dataSource != self) {
+        return nil;
+    }
+    return [[[NSFileManager defaultManager] attributesOfItemAtPath:(NSString *)templateID error:NULL] fileModificationDate];
+}
+
 @end
 
 
@@ -531,6 +1758,7 @@ static NSString* const GRMustacheDefaultExtension = @"mustache";
     if (self) {
         _partialsDictionary = [partialsDictionary retain];
         self.dataSource = self;
+        _dataSourceIsThreadSafe = YES;
     }
     return self;
 }
@@ -553,6 +1781,17 @@ static NSString* const GRMustacheDefaultExtension = @"mustache";
     return [_partialsDictionary objectForKey:templateID];
 }
 
+
+#pragma mark GRMustacheTemplateRepository
+
+- (NSArray *)dataSourceTemplateNames
+{
+    if (self.dataSource != self) {
+        return nil;
+    }
+    return [_partialsDictionary allKeys];
+}
+
 @end
 
 
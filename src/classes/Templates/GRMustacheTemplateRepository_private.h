@@ -21,14 +21,46 @@
 // THE SOFTWARE.
 
 #import <Foundation/Foundation.h>
+#import <pthread.h>
+#import <stdatomic.h>
 #import "GRMustacheAvailabilityMacros_private.h"
 #import "GRMustacheContentType.h"
+#import "GRMustachePrecompiledTemplate.h"
 
 @class GRMustacheTemplateAST;
 @class GRMustacheTemplate;
 @class GRMustacheTemplateRepository;
 @class GRMustacheConfiguration;
 
+// Documented in GRMustacheTemplateRepository.h
+typedef struct {
+    NSUInteger hitCount;
+    NSUInteger missCount;
+    NSUInteger evictionCount;
+    NSUInteger templateCount;
+    NSUInteger memorySize;
+} GRMustacheTemplateRepositoryCacheStatistics;
+
+// Documented in GRMustacheTemplateRepository.h
+@interface GRMustacheTemplateRepositoryPrecompilationReport : NSObject {
+@private
+    NSDictionary *_templateDurations;
+    NSTimeInterval _duration;
+}
+
+// Documented in GRMustacheTemplateRepository.h
+@property (nonatomic, readonly) NSDictionary *templateDurations GRMUSTACHE_API_PUBLIC;
+
+// Documented in GRMustacheTemplateRepository.h
+@property (nonatomic, readonly) NSTimeInterval duration GRMUSTACHE_API_PUBLIC;
+
+/**
+ * Returns a new report.
+ */
++ (instancetype)precompilationReportWithTemplateDurations:(NSDictionary *)templateDurations duration:(NSTimeInterval)duration GRMUSTACHE_API_INTERNAL;
+
+@end
+
 // Documented in GRMustacheTemplateRepository.h
 @protocol GRMustacheTemplateRepositoryDataSource <NSObject>
 
@@ -43,7 +75,41 @@
 @interface GRMustacheTemplateRepository : NSObject {
 @private
     id<GRMustacheTemplateRepositoryDataSource> _dataSource;
+    BOOL _dataSourceIsThreadSafe;
+    pthread_mutex_t _dataSourceMutex;           // Serializes calls to thread-unsafe data sources
+    
+    // Compiled templates
+    pthread_rwlock_t _cacheLock;                // Guards the dictionaries below, and _cacheGeneration
     NSMutableDictionary *_templateASTForTemplateID;
+    NSMutableDictionary *_templateVersionForTemplateID;  // Versions of the cached templates and of the partials they embed
+    NSMutableDictionary *_precompiledTemplateForName;  // NSValue of GRMustachePrecompiledTemplate pointers, or GRMustacheTemplateArchive
+    NSMutableDictionary *_precompiledTemplateASTForName;
+    NSMutableArray *_templateArchives;          // Registered archives, which own the texts of archived templates
+    NSUInteger _cacheGeneration;                // Incremented by reloadTemplates
+    
+    // Template cache accounting
+    NSUInteger _cacheMemoryLimit;               // Zero for an unlimited cache
+    NSUInteger _cacheMemorySize;                // Guarded by _cacheLock
+    NSUInteger _cacheEvictionCount;             // Guarded by _cacheLock
+    NSMutableSet *_pinnedTemplateIDs;           // Guarded by _cacheLock
+    _Atomic int64_t _cacheClock;                // Incremented on each access to the template cache
+    _Atomic int64_t _cacheHitCount;
+    _Atomic int64_t _cacheMissCount;
+    
+    // Incremental reloading
+    pthread_mutex_t _reloadMutex;               // Serializes reloadChangedTemplates
+    NSSet *_reloadedTemplateIDs;                // Guarded by _cacheLock, nil unless templates are being reloaded
+    pthread_t _reloadThread;                    // Guarded by _cacheLock
+    NSMutableDictionary *_reloadedTemplateASTForTemplateID;
+    NSMutableDictionary *_reloadCompilationForTemplateID;
+    
+    // Templates being compiled
+    NSCondition *_compilationCondition;         // Guards the dictionaries below
+    NSMutableDictionary *_compilationForTemplateID;
+    NSMutableDictionary *_compilationForPrecompiledTemplateName;
+    CFMutableDictionaryRef _waitedCompilationForThread;
+    CFMutableDictionaryRef _borrowedCompilationsForThread;
+    
     GRMustacheConfiguration *_configuration;
 }
 
@@ -77,6 +143,12 @@
 // Documented in GRMustacheTemplateRepository.h
 + (instancetype)templateRepository GRMUSTACHE_API_PUBLIC;
 
+// Documented in GRMustacheTemplateRepository.h
+- (void)registerPrecompiledTemplate:(const GRMustachePrecompiledTemplate *)precompiledTemplate GRMUSTACHE_API_PUBLIC;
+
+// Documented in GRMustacheTemplateRepository.h
+- (BOOL)registerTemplateArchiveAtPath:(NSString *)path error:(NSError **)error GRMUSTACHE_API_PUBLIC;
+
 // Documented in GRMustacheTemplateRepository.h
 - (GRMustacheTemplate *)templateNamed:(NSString *)name error:(NSError **)error GRMUSTACHE_API_PUBLIC;
 
@@ -86,6 +158,27 @@
 // Documented in GRMustacheTemplateRepository.h
 - (void)reloadTemplates GRMUSTACHE_API_PUBLIC;
 
+// Documented in GRMustacheTemplateRepository.h
+- (void)reloadChangedTemplates GRMUSTACHE_API_PUBLIC;
+
+// Documented in GRMustacheTemplateRepository.h
+@property (nonatomic) NSUInteger cacheMemoryLimit GRMUSTACHE_API_PUBLIC;
+
+// Documented in GRMustacheTemplateRepository.h
+- (BOOL)pinTemplateNamed:(NSString *)name error:(NSError **)error GRMUSTACHE_API_PUBLIC;
+
+// Documented in GRMustacheTemplateRepository.h
+- (void)unpinTemplateNamed:(NSString *)name GRMUSTACHE_API_PUBLIC;
+
+// Documented in GRMustacheTemplateRepository.h
+- (GRMustacheTemplateRepositoryCacheStatistics)cacheStatistics GRMUSTACHE_API_PUBLIC;
+
+// Documented in GRMustacheTemplateRepository.h
+- (GRMustacheTemplateRepositoryPrecompilationReport *)precompileTemplatesNamed:(NSArray *)names concurrently:(BOOL)concurrently error:(NSError **)error GRMUSTACHE_API_PUBLIC;
+
+// Documented in GRMustacheTemplateRepository.h
+- (GRMustacheTemplateRepositoryPrecompilationReport *)precompileAllTemplatesConcurrently:(BOOL)concurrently error:(NSError **)error GRMUSTACHE_API_PUBLIC;
+
 /**
  * TODO
  */
@@ -101,7 +194,32 @@
  *                        describes the problem.
  *
  * @return an AST
+ *
+ * This method is thread-safe. Cache hits only take a read lock. A template is
+ * compiled once, even when several threads ask for it concurrently: they wait
+ * for this template only, not for the compilation of other templates.
+ *
+ * Recursive partials get the AST of the template being compiled, which is
+ * completed when compilation ends.
  */
 - (GRMustacheTemplateAST *)templateASTNamed:(NSString *)name relativeToTemplateID:(id)baseTemplateID error:(NSError **)error GRMUSTACHE_API_INTERNAL;
 
+/**
+ * Returns an AST, given its name, and the ID of the template.
+ *
+ * @param name            The name of the template
+ * @param baseTemplateID  The template ID of the enclosing template, or nil.
+ * @param templateID      Upon return, contains the ID of the template in the
+ *                        data source, or nil for precompiled templates. May
+ *                        be NULL.
+ * @param error           If there is an error loading or parsing template and
+ *                        partials, upon return contains an NSError object that
+ *                        describes the problem.
+ *
+ * @return an AST
+ *
+ * @see templateASTNamed:relativeToTemplateID:error:
+ */
+- (GRMustacheTemplateAST *)templateASTNamed:(NSString *)name relativeToTemplateID:(id)baseTemplateID templateID:(id *)templateID error:(NSError **)error GRMUSTACHE_API_INTERNAL;
+
 @end
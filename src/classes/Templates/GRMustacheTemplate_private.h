@@ -28,6 +28,7 @@
 @class GRMustacheTemplateAST;
 @class GRMustacheTemplateRepository;
 @protocol GRMustacheTagDelegate;
+@protocol GRMustacheOutputSink;
 
 // Documented in GRMustacheTemplate.h
 @interface GRMustacheTemplate: NSObject<GRMustacheRendering> {
@@ -81,4 +82,22 @@
 // Documented in GRMustacheTemplate.h
 - (NSString *)renderContentWithContext:(GRMustacheContext *)context HTMLSafe:(BOOL *)HTMLSafe error:(NSError **)error GRMUSTACHE_API_PUBLIC;
 
+// Documented in GRMustacheTemplate.h
+- (NSData *)renderDataWithObject:(id)object encoding:(NSStringEncoding)encoding error:(NSError **)error GRMUSTACHE_API_PUBLIC;
+
+// Documented in GRMustacheTemplate.h
+- (BOOL)renderObject:(id)object appendingToString:(NSMutableString *)string error:(NSError **)error GRMUSTACHE_API_PUBLIC;
+
+// Documented in GRMustacheTemplate.h
+- (BOOL)renderObject:(id)object appendingToData:(NSMutableData *)data encoding:(NSStringEncoding)encoding error:(NSError **)error GRMUSTACHE_API_PUBLIC;
+
+// Documented in GRMustacheTemplate.h
+- (BOOL)renderObject:(id)object toSink:(id<GRMustacheOutputSink>)sink error:(NSError **)error GRMUSTACHE_API_PUBLIC;
+
+// Documented in GRMustacheTemplate.h
+- (BOOL)renderObjectsFromArray:(NSArray *)objects toSink:(id<GRMustacheOutputSink>)sink error:(NSError **)error GRMUSTACHE_API_PUBLIC;
+
+// Documented in GRMustacheTemplate.h
+- (BOOL)renderContentWithContext:(GRMustacheContext *)context toSink:(id<GRMustacheOutputSink>)sink error:(NSError **)error GRMUSTACHE_API_PUBLIC;
+
 @end
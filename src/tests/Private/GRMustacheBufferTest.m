@@ -0,0 +1,282 @@
+// The MIT License
+//
+// Copyright (c) 2014 Gwendal Roué
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#import "GRMustachePrivateAPITest.h"
+#import "GRMustacheBuffer_private.h"
+#import "GRMustacheTemplate_private.h"
+#import "GRMustacheTemplateAST_private.h"
+#import "GRMustacheRenderingEngine_private.h"
+
+@interface GRMustacheBufferTest : GRMustachePrivateAPITest
+@end
+
+@implementation GRMustacheBufferTest
+
+- (void)setUp
+{
+    [super setUp];
+    GRMustacheBufferDrainCurrentThreadPool();
+    GRMustacheBufferCurrentStatistics = (GRMustacheBufferStatistics){ 0 };
+}
+
+- (NSString *)largePageWithLength:(NSUInteger)length
+{
+    NSMutableString *page = [NSMutableString string];
+    while (page.length < length) {
+        [page appendFormat:@"<tr><td>%lu</td><td>Crème brûlée 🍮</td></tr>\n", (unsigned long)page.length];
+    }
+    return [[page copy] autorelease];
+}
+
+- (void)testSmallStringRenderingIsNotCopied
+{
+    GRMustacheBuffer buffer = GRMustacheBufferCreate(1024);
+    GRMustacheBufferAppendString(&buffer, @"foo");
+    GRMustacheBufferAppendString(&buffer, @"bar");
+    NSString *string = GRMustacheBufferGetStringAndRelease(&buffer);
+    XCTAssertEqualObjects(string, @"foobar", @"");
+    XCTAssertEqual(GRMustacheBufferCurrentStatistics.chunkAllocationCount, (NSUInteger)1, @"");
+    XCTAssertEqual(GRMustacheBufferCurrentStatistics.linearizationCount, (NSUInteger)0, @"");
+}
+
+- (void)testLongStringsAreReferenced
+{
+    NSString *text = [self largePageWithLength:1000];
+    GRMustacheBuffer buffer = GRMustacheBufferCreate(1024);
+    GRMustacheBufferAppendString(&buffer, text);
+    NSString *string = GRMustacheBufferGetStringAndRelease(&buffer);
+    XCTAssertTrue(string == text, @"");
+    XCTAssertEqual(GRMustacheBufferCurrentStatistics.chunkAllocationCount, (NSUInteger)0, @"");
+    XCTAssertEqual(GRMustacheBufferCurrentStatistics.referenceCount, (NSUInteger)1, @"");
+}
+
+- (void)testLargeStringRenderingIsLinearizedOnce
+{
+    NSString *expected = [self largePageWithLength:1024 * 1024];
+    NSUInteger length = expected.length;
+    
+    GRMustacheBuffer buffer = GRMustacheBufferCreate(1024);
+    NSRange range = { .location = 0 };
+    while (range.location < length) {
+        range.length = MIN(length - range.location, range.location % 100);
+        GRMustacheBufferAppendString(&buffer, [expected substringWithRange:range]);
+        range.location += range.length;
+        range.length = MIN(length - range.location, 1);
+        GRMustacheBufferAppendString(&buffer, [expected substringWithRange:range]);
+        range.location += range.length;
+    }
+    NSString *string = GRMustacheBufferGetStringAndRelease(&buffer);
+    
+    XCTAssertEqualObjects(string, expected, @"");
+    XCTAssertEqual(GRMustacheBufferCurrentStatistics.linearizationCount, (NSUInteger)1, @"");
+    XCTAssertEqual(GRMustacheBufferCurrentStatistics.linearizedLength, length, @"");
+    XCTAssertTrue(GRMustacheBufferCurrentStatistics.chunkAllocationCount < length / GRMustacheBufferMaximumChunkCapacity + 8, @"");
+}
+
+- (void)testByteBufferEncodesAcrossChunks
+{
+    NSString *expected = [self largePageWithLength:256 * 1024];
+    NSArray *lines = [expected componentsSeparatedByString:@"\n"];
+    
+    NSStringEncoding encodings[] = { NSUTF8StringEncoding, NSUTF16LittleEndianStringEncoding };
+    for (size_t i = 0; i < sizeof(encodings) / sizeof(NSStringEncoding); ++i) {
+        CFStringEncoding encoding = CFStringConvertNSStringEncodingToEncoding(encodings[i]);
+        GRMustacheBuffer buffer = GRMustacheBufferCreateWithEncoding(1024, encoding);
+        for (NSUInteger j = 0; j < lines.count; ++j) {
+            if (j > 0) {
+                GRMustacheBufferAppendString(&buffer, @"\n");
+            }
+            GRMustacheBufferAppendString(&buffer, lines[j]);
+        }
+        XCTAssertFalse(buffer.encodingFailed, @"");
+        NSData *data = GRMustacheBufferGetDataAndRelease(&buffer);
+        XCTAssertEqualObjects(data, [expected dataUsingEncoding:encodings[i]], @"");
+    }
+}
+
+- (void)testByteBufferReferencesUTF8Data
+{
+    NSString *text = [self largePageWithLength:1000];
+    NSData *UTF8Data = [text dataUsingEncoding:NSUTF8StringEncoding];
+    GRMustacheBuffer buffer = GRMustacheBufferCreateWithEncoding(1024, kCFStringEncodingUTF8);
+    GRMustacheBufferAppendStringWithUTF8Data(&buffer, text, UTF8Data);
+    NSData *data = GRMustacheBufferGetDataAndRelease(&buffer);
+    XCTAssertTrue(data == UTF8Data, @"");
+}
+
+- (void)testReleasedChunksAreReusedByTheSameThread
+{
+    NSString *expected = [self largePageWithLength:100 * 1024];
+    NSArray *lines = [expected componentsSeparatedByString:@"\n"];
+    
+    for (NSUInteger pass = 0; pass < 2; ++pass) {
+        GRMustacheBufferCurrentStatistics = (GRMustacheBufferStatistics){ 0 };
+        GRMustacheBuffer buffer = GRMustacheBufferCreate(1024);
+        for (NSUInteger j = 0; j < lines.count; ++j) {
+            if (j > 0) {
+                GRMustacheBufferAppendString(&buffer, @"\n");
+            }
+            GRMustacheBufferAppendString(&buffer, lines[j]);
+        }
+        XCTAssertEqualObjects(GRMustacheBufferGetStringAndRelease(&buffer), expected, @"");
+        if (pass == 0) {
+            XCTAssertTrue(GRMustacheBufferCurrentStatistics.chunkAllocationCount > 0, @"");
+        } else {
+            XCTAssertEqual(GRMustacheBufferCurrentStatistics.chunkAllocationCount, (NSUInteger)0, @"");
+            XCTAssertTrue(GRMustacheBufferCurrentStatistics.pooledChunkCount > 0, @"");
+        }
+    }
+}
+
+- (void)testReusableStringRenderingAllocatesNoChunkOnceWarmedUp
+{
+    GRMustacheTemplate *template = [GRMustacheTemplate templateFromString:@"<ul>{{#items}}<li>{{name}}</li>{{/items}}</ul>" error:NULL];
+    NSMutableArray *items = [NSMutableArray array];
+    for (NSUInteger i = 0; i < 1000; ++i) {
+        [items addObject:@{ @"name": [NSString stringWithFormat:@"Item #%lu & co", (unsigned long)i] }];
+    }
+    id data = @{ @"items": items };
+    NSString *expected = [template renderObject:data error:NULL];
+    
+    NSMutableString *rendering = [NSMutableString string];
+    XCTAssertTrue([template renderObject:data appendingToString:rendering error:NULL], @"");
+    XCTAssertEqualObjects(rendering, expected, @"");
+    
+    GRMustacheBufferCurrentStatistics = (GRMustacheBufferStatistics){ 0 };
+    [rendering setString:@""];
+    XCTAssertTrue([template renderObject:data appendingToString:rendering error:NULL], @"");
+    XCTAssertEqualObjects(rendering, expected, @"");
+    XCTAssertEqual(GRMustacheBufferCurrentStatistics.chunkAllocationCount, (NSUInteger)0, @"");
+    XCTAssertEqual(GRMustacheBufferCurrentStatistics.linearizationCount, (NSUInteger)0, @"");
+}
+
+- (GRMustacheTemplate *)largePageTemplateFromRepository:(GRMustacheTemplateRepository *)repository data:(id *)data
+{
+    NSMutableArray *rows = [NSMutableArray array];
+    for (NSUInteger i = 0; i < 20000; ++i) {
+        [rows addObject:@{ @"index": @(i), @"name": @"Crème brûlée 🍮" }];
+    }
+    *data = @{ @"rows": rows };
+    return [repository templateFromString:@"<table>{{#rows}}<tr><td class=\"index\">{{index}}</td><td class=\"name\">{{name}}</td></tr>\n{{/rows}}</table>" error:NULL];
+}
+
+- (void)testRenderingLengthPredictionAvoidsBufferGrowth
+{
+    id data;
+    GRMustacheTemplate *template = [self largePageTemplateFromRepository:[GRMustacheTemplateRepository templateRepository] data:&data];
+    NSString *expected = [template renderObject:data error:NULL];
+    XCTAssertEqual(template.templateAST.renderingLengthEstimate, expected.length, @"");
+    
+    // The second rendering fits in a single chunk, and is not copied.
+    GRMustacheBufferDrainCurrentThreadPool();
+    GRMustacheBufferCurrentStatistics = (GRMustacheBufferStatistics){ 0 };
+    XCTAssertEqualObjects([template renderObject:data error:NULL], expected, @"");
+    XCTAssertEqual(GRMustacheBufferCurrentStatistics.chunkAllocationCount, (NSUInteger)1, @"");
+    XCTAssertEqual(GRMustacheBufferCurrentStatistics.linearizationCount, (NSUInteger)0, @"");
+}
+
+- (void)testRenderingLengthEstimateIsAMovingAverage
+{
+    GRMustacheTemplate *template = [GRMustacheTemplate templateFromString:@"{{#items}}{{.}}{{/items}}" error:NULL];
+    [template renderObject:@{ @"items": @[@"123456789", @"123456789", @"123456789", @"123456789"] } error:NULL];
+    XCTAssertEqual(template.templateAST.renderingLengthEstimate, (NSUInteger)36, @"");
+    [template renderObject:@{ @"items": @[@"123456789"] } error:NULL];
+    XCTAssertEqual(template.templateAST.renderingLengthEstimate, (NSUInteger)29, @"");
+    [template renderObject:@{ @"items": @[@"123456789", @"123456789", @"123456789", @"123456789", @"123456789"] } error:NULL];
+    XCTAssertEqual(template.templateAST.renderingLengthEstimate, (NSUInteger)33, @"");
+}
+
+- (void)testRenderingLengthEstimateIsNotStuckOnASingleLongRendering
+{
+    NSMutableArray *items = [NSMutableArray array];
+    for (NSUInteger i = 0; i < 1000; ++i) {
+        [items addObject:@"12345678"];
+    }
+    GRMustacheTemplate *template = [GRMustacheTemplate templateFromString:@"{{#items}}{{.}}{{/items}}" error:NULL];
+    [template renderObject:@{ @"items": @[@"12345678"] } error:NULL];
+    [template renderObject:@{ @"items": items } error:NULL];
+    XCTAssertEqual(template.templateAST.renderingLengthEstimate, (NSUInteger)2006, @"");
+    for (NSUInteger i = 0; i < 30; ++i) {
+        [template renderObject:@{ @"items": @[@"12345678"] } error:NULL];
+    }
+    XCTAssertTrue(template.templateAST.renderingLengthEstimate < 16, @"");
+}
+
+- (void)testInitialCapacityScalesWithTheNumberOfRenderings
+{
+    GRMustacheTemplate *template = [GRMustacheTemplate templateFromString:@"{{#items}}{{.}}{{/items}}" error:NULL];
+    XCTAssertEqual(GRMustacheRenderingEngineInitialCapacity(template.templateAST, 10), (CFIndex)1024, @"");
+    [template renderObject:@{ @"items": @[@"123456789", @"123456789", @"123456789", @"123456789"] } error:NULL];
+    XCTAssertEqual(GRMustacheRenderingEngineInitialCapacity(template.templateAST, 1), (CFIndex)36, @"");
+    XCTAssertEqual(GRMustacheRenderingEngineInitialCapacity(template.templateAST, 10), (CFIndex)360, @"");
+    XCTAssertEqual(GRMustacheRenderingEngineInitialCapacity(template.templateAST, NSUIntegerMax), (CFIndex)(1024 * 1024), @"");
+    XCTAssertEqual(GRMustacheRenderingEngineInitialCapacity(nil, 10), (CFIndex)1024, @"");
+}
+
+- (void)testRenderingLengthPredictionCanBeDisabled
+{
+    GRMustacheTemplateRepository *repository = [GRMustacheTemplateRepository templateRepository];
+    repository.configuration.predictsRenderingLength = NO;
+    id data;
+    GRMustacheTemplate *template = [self largePageTemplateFromRepository:repository data:&data];
+    NSString *expected = [template renderObject:data error:NULL];
+    XCTAssertEqual(template.templateAST.renderingLengthEstimate, (NSUInteger)0, @"");
+    
+    GRMustacheBufferDrainCurrentThreadPool();
+    GRMustacheBufferCurrentStatistics = (GRMustacheBufferStatistics){ 0 };
+    XCTAssertEqualObjects([template renderObject:data error:NULL], expected, @"");
+    XCTAssertTrue(GRMustacheBufferCurrentStatistics.chunkAllocationCount > 1, @"");
+    XCTAssertEqual(GRMustacheBufferCurrentStatistics.linearizationCount, (NSUInteger)1, @"");
+}
+
+- (void)testLargePageRenderingBenchmark
+{
+    // The rendering of a page of more than 1 MB must allocate a few large
+    // chunks, and copy its content only once.
+    
+    NSMutableArray *rows = [NSMutableArray array];
+    for (NSUInteger i = 0; i < 20000; ++i) {
+        [rows addObject:@{ @"index": @(i), @"name": @"Crème brûlée 🍮" }];
+    }
+    GRMustacheTemplate *template = [GRMustacheTemplate templateFromString:@"<table>{{#rows}}<tr><td class=\"index\">{{index}}</td><td class=\"name\">{{name}}</td></tr>\n{{/rows}}</table>" error:NULL];
+    id data = @{ @"rows": rows };
+    
+    GRMustacheBufferCurrentStatistics = (GRMustacheBufferStatistics){ 0 };
+    NSString *rendering = [template renderObject:data error:NULL];
+    XCTAssertTrue(rendering.length > 1024 * 1024, @"");
+    XCTAssertEqual(GRMustacheBufferCurrentStatistics.linearizationCount, (NSUInteger)1, @"");
+    XCTAssertEqual(GRMustacheBufferCurrentStatistics.linearizedLength, rendering.length, @"");
+    XCTAssertTrue(GRMustacheBufferCurrentStatistics.chunkAllocationCount < rendering.length / GRMustacheBufferMaximumChunkCapacity + 8, @"");
+    NSLog(@"%@: %lu characters, %lu chunk allocations, %lu characters copied", NSStringFromSelector(_cmd), (unsigned long)rendering.length, (unsigned long)GRMustacheBufferCurrentStatistics.chunkAllocationCount, (unsigned long)GRMustacheBufferCurrentStatistics.linearizedLength);
+    
+    [self measureBlock:^{
+        @autoreleasepool {
+            [template renderObject:data error:NULL];
+        }
+    }];
+    
+    GRMustacheBufferCurrentStatistics = (GRMustacheBufferStatistics){ 0 };
+    [template renderObject:data error:NULL];
+    NSLog(@"%@: %lu characters predicted, %lu chunk allocations, %lu pooled chunks, %lu characters copied", NSStringFromSelector(_cmd), (unsigned long)template.templateAST.renderingLengthEstimate, (unsigned long)GRMustacheBufferCurrentStatistics.chunkAllocationCount, (unsigned long)GRMustacheBufferCurrentStatistics.pooledChunkCount, (unsigned long)GRMustacheBufferCurrentStatistics.linearizedLength);
+}
+
+@end
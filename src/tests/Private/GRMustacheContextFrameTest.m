@@ -0,0 +1,283 @@
+// The MIT License
+//
+// Copyright (c) 2014 Gwendal Roué
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#import "GRMustachePrivateAPITest.h"
+#import "GRMustacheContext_private.h"
+
+@interface GRMustacheContextFrameTest : GRMustachePrivateAPITest
+@end
+
+@implementation GRMustacheContextFrameTest
+
+- (void)testContextFramesLookUpKeysLikeContexts
+{
+    GRMustacheContext *context = [GRMustacheContext contextWithObject:@{ @"name": @"root", @"other": @"other" }];
+    GRMustacheContext *frame = [context pushContextFrameWithObject:@{ @"name": @"frame" }];
+    XCTAssertTrue(frame.isContextFrame);
+    XCTAssertFalse(context.isContextFrame);
+    XCTAssertEqualObjects([frame valueForMustacheKey:@"name"], @"frame");
+    XCTAssertEqualObjects([frame valueForMustacheKey:@"other"], @"other");
+    XCTAssertEqualObjects(frame.topMustacheObject, @{ @"name": @"frame" });
+    [frame popContextFrame];
+}
+
+- (void)testMaterializedContextsOutliveTheirFrames
+{
+    GRMustacheContext *context = [GRMustacheContext contextWithObject:@{ @"name": @"root", @"other": @"other" }];
+    GRMustacheContext *frame1 = [context pushContextFrameWithObject:@{ @"name": @"frame1" }];
+    GRMustacheContext *frame2 = [frame1 pushContextFrameWithObject:@{ @"count": @2 }];
+    GRMustacheContext *materializedContext = [frame2 materializedContext];
+    XCTAssertFalse(materializedContext.isContextFrame);
+    XCTAssertEqual([frame2 materializedContext], materializedContext);
+    XCTAssertEqual([context materializedContext], context);
+    [materializedContext retain];
+    [frame2 popContextFrame];
+    [frame1 popContextFrame];
+    
+    XCTAssertEqualObjects([materializedContext valueForMustacheKey:@"name"], @"frame1");
+    XCTAssertEqualObjects([materializedContext valueForMustacheKey:@"count"], @2);
+    XCTAssertEqualObjects([materializedContext valueForMustacheKey:@"other"], @"other");
+    [materializedContext release];
+}
+
+- (void)testContextsDerivedFromFramesAreNotFrames
+{
+    GRMustacheContext *context = [GRMustacheContext contextWithObject:@{ @"name": @"root" }];
+    GRMustacheContext *frame = [context pushContextFrameWithObject:@{ @"name": @"frame" }];
+    GRMustacheContext *derivedContext = [[frame contextByAddingObject:@{ @"other": @"other" }] retain];
+    GRMustacheContext *hiddenContext = [[frame contextByAddingHiddenObject:frame.topMustacheObject] retain];
+    XCTAssertFalse(derivedContext.isContextFrame);
+    XCTAssertFalse(hiddenContext.isContextFrame);
+    [frame popContextFrame];
+    
+    XCTAssertEqualObjects([derivedContext valueForMustacheKey:@"name"], @"frame");
+    XCTAssertEqualObjects([derivedContext valueForMustacheKey:@"other"], @"other");
+    XCTAssertEqualObjects([hiddenContext valueForMustacheKey:@"name"], @"root");
+    [derivedContext release];
+    [hiddenContext release];
+}
+
+- (void)testDeepContextFrames
+{
+    GRMustacheContext *context = [GRMustacheContext contextWithObject:@{ @"root": @"root" }];
+    NSMutableArray *frames = [NSMutableArray array];
+    for (NSUInteger i = 0; i < 1000; ++i) {
+        context = [context pushContextFrameWithObject:@{ @"index": @(i) }];
+        [frames addObject:[NSValue valueWithPointer:context]];
+    }
+    XCTAssertEqualObjects([context valueForMustacheKey:@"index"], @999);
+    XCTAssertEqualObjects([context valueForMustacheKey:@"root"], @"root");
+    for (NSValue *frame in [frames reverseObjectEnumerator]) {
+        [(GRMustacheContext *)[frame pointerValue] popContextFrame];
+    }
+    
+    // The arena is still usable
+    context = [[GRMustacheContext contextWithObject:@{ @"root": @"root" }] pushContextFrameWithObject:@{ @"index": @0 }];
+    XCTAssertEqualObjects([context valueForMustacheKey:@"index"], @0);
+    [context popContextFrame];
+}
+
+- (void)testEscapedContextFramesOutliveTheirPop
+{
+    GRMustacheContext *context = [GRMustacheContext contextWithObject:@{ @"name": @"root", @"other": @"other" }];
+    GRMustacheContext *frame1 = [context pushContextFrameWithObject:@{ @"name": @"frame1" }];
+    GRMustacheContext *frame2 = [frame1 pushContextFrameWithObject:[NSMutableDictionary dictionaryWithObject:@2 forKey:@"count"]];
+    [frame2 retain];
+    [frame2 popContextFrame];
+    XCTAssertFalse(frame2.isContextFrame);
+    
+    // The memory of the escaped frame is not reused
+    GRMustacheContext *frame3 = [frame1 pushContextFrameWithObject:@{ @"count": @3 }];
+    XCTAssertTrue(frame3 != frame2);
+    XCTAssertEqualObjects([frame3 valueForMustacheKey:@"count"], @3);
+    [frame3 popContextFrame];
+    [frame1 popContextFrame];
+    
+    XCTAssertEqualObjects([frame2 valueForMustacheKey:@"count"], @2);
+    XCTAssertEqualObjects([frame2 valueForMustacheKey:@"name"], @"frame1");
+    XCTAssertEqualObjects([frame2 valueForMustacheKey:@"other"], @"other");
+    [frame2 release];
+    
+    // The arena is still usable
+    GRMustacheContext *frame = [context pushContextFrameWithObject:@{ @"name": @"frame" }];
+    XCTAssertEqualObjects([frame valueForMustacheKey:@"name"], @"frame");
+    [frame popContextFrame];
+}
+
+- (void)testRenderingObjectsAreNotGivenContextFrames
+{
+    __block GRMustacheContext *renderingContext = nil;
+    id renderingObject = [GRMustacheRendering renderingObjectWithBlock:^NSString *(GRMustacheTag *tag, GRMustacheContext *context, BOOL *HTMLSafe, NSError **error) {
+        [renderingContext release];
+        renderingContext = [context retain];
+        return [context valueForMustacheKey:@"name"];
+    }];
+    id data = @{ @"items": @[@{ @"name": @"a" }, @{ @"name": @"b" }], @"custom": renderingObject };
+    NSString *rendering = [[GRMustacheTemplate templateFromString:@"{{#items}}{{custom}}{{/items}}" error:NULL] renderObject:data error:NULL];
+    XCTAssertEqualObjects(rendering, @"ab");
+    XCTAssertFalse(renderingContext.isContextFrame);
+    XCTAssertEqualObjects([renderingContext valueForMustacheKey:@"name"], @"b");
+    [renderingContext release];
+}
+
+- (void)testHiddenObjectsAreSkippedByContextFrames
+{
+    id a = @{ @"name": @"a" };
+    id b = @{ @"name": @"b" };
+    id c = @{ @"name": @"c" };
+    GRMustacheContext *context = [GRMustacheContext contextWithObject:@{ @"name": @"root" }];
+    context = [context contextByAddingObject:a];
+    context = [context contextByAddingObject:b];
+    context = [context contextByAddingObject:c];
+    context = [context contextByAddingHiddenObject:a];
+    context = [context contextByAddingHiddenObject:b];
+    context = [context contextByAddingHiddenObject:c];
+    GRMustacheContext *frame1 = [context pushContextFrameWithObject:@{ @"other": @"other" }];
+    GRMustacheContext *frame2 = [frame1 pushContextFrameWithObject:@{ @"other": @"other" }];
+    XCTAssertEqualObjects([frame2 valueForMustacheKey:@"name"], @"root");
+    XCTAssertEqualObjects([frame2 valueForMustacheKey:@"name"], @"root");
+    [frame2 popContextFrame];
+    [frame1 popContextFrame];
+}
+
+- (void)testContextFramesForgetEntriesThatNoLongerProvideKeys
+{
+    NSMutableDictionary *object = [NSMutableDictionary dictionaryWithObject:@"frame" forKey:@"name"];
+    GRMustacheContext *context = [GRMustacheContext contextWithObject:@{ @"name": @"root" }];
+    GRMustacheContext *frame = [context pushContextFrameWithObject:object];
+    
+    GRMustacheContext *itemFrame = [frame pushContextFrameWithObject:@{ @"other": @"other" }];
+    XCTAssertEqualObjects([itemFrame valueForMustacheKey:@"name"], @"frame");
+    [itemFrame popContextFrame];
+    
+    [object setObject:@"frame2" forKey:@"name"];
+    itemFrame = [frame pushContextFrameWithObject:@{ @"other": @"other" }];
+    XCTAssertEqualObjects([itemFrame valueForMustacheKey:@"name"], @"frame2");
+    [itemFrame popContextFrame];
+    
+    [object removeObjectForKey:@"name"];
+    itemFrame = [frame pushContextFrameWithObject:@{ @"other": @"other" }];
+    XCTAssertEqualObjects([itemFrame valueForMustacheKey:@"name"], @"root");
+    [itemFrame popContextFrame];
+    
+    [frame popContextFrame];
+}
+
+- (void)testContextFramesSeeKeysAddedToMutableObjects
+{
+    NSMutableDictionary *object = [NSMutableDictionary dictionary];
+    GRMustacheContext *context = [GRMustacheContext contextWithObject:@{ @"name": @"root" }];
+    GRMustacheContext *mutableFrame = [context pushContextFrameWithObject:object];
+    GRMustacheContext *immutableFrame = [mutableFrame pushContextFrameWithObject:@{ @"other": @"other" }];
+    
+    GRMustacheContext *itemFrame = [immutableFrame pushContextFrameWithObject:@{ @"item": @"item" }];
+    XCTAssertEqualObjects([itemFrame valueForMustacheKey:@"name"], @"root");
+    XCTAssertNil([itemFrame valueForMustacheKey:@"missing"]);
+    [itemFrame popContextFrame];
+    
+    [object setObject:@"frame" forKey:@"name"];
+    [object setObject:@"found" forKey:@"missing"];
+    itemFrame = [immutableFrame pushContextFrameWithObject:@{ @"item": @"item" }];
+    XCTAssertEqualObjects([itemFrame valueForMustacheKey:@"name"], @"frame");
+    XCTAssertEqualObjects([itemFrame valueForMustacheKey:@"missing"], @"found");
+    XCTAssertEqualObjects([itemFrame valueForMustacheKey:@"other"], @"other");
+    [itemFrame popContextFrame];
+    
+    [immutableFrame popContextFrame];
+    [mutableFrame popContextFrame];
+}
+
+/**
+ * Returns the number of objects asked for a key by the lookups of enumeration
+ * items rendered in a section at depth _depth_.
+ */
+- (NSUInteger)keyProbeCountOfItemLookupsAtDepth:(NSUInteger)depth
+{
+    GRMustacheContext *context = [GRMustacheContext contextWithObject:@{ @"root": @"root" }];
+    NSMutableArray *frames = [NSMutableArray array];
+    for (NSUInteger i = 0; i < depth; ++i) {
+        context = [context pushContextFrameWithObject:@{ @"depth": @(i) }];
+        [frames addObject:[NSValue valueWithPointer:context]];
+    }
+    
+    NSUInteger keyProbeCount = 0;
+    for (NSUInteger i = 0; i < 100; ++i) {
+        GRMustacheContext *itemFrame = [context pushContextFrameWithObject:@{ @"name": @"item" }];
+        GRMustacheContextCurrentStatistics = (GRMustacheContextStatistics){ 0 };
+        XCTAssertEqualObjects([itemFrame valueForMustacheKey:@"name"], @"item");
+        XCTAssertEqualObjects([itemFrame valueForMustacheKey:@"root"], @"root");
+        XCTAssertNil([itemFrame valueForMustacheKey:@"missing"]);
+        if (i > 0) {
+            // The first item fills the memos
+            keyProbeCount += GRMustacheContextCurrentStatistics.keyProbeCount;
+        }
+        [itemFrame popContextFrame];
+    }
+    
+    for (NSValue *frame in [frames reverseObjectEnumerator]) {
+        [(GRMustacheContext *)[frame pointerValue] popContextFrame];
+    }
+    return keyProbeCount;
+}
+
+- (void)testKeyLookupCostIsFlatInStackDepth
+{
+    NSUInteger shallowKeyProbeCount = [self keyProbeCountOfItemLookupsAtDepth:2];
+    NSUInteger deepKeyProbeCount = [self keyProbeCountOfItemLookupsAtDepth:200];
+    XCTAssertEqual(deepKeyProbeCount, shallowKeyProbeCount);
+    XCTAssertEqual(deepKeyProbeCount, (NSUInteger)(99 * 4));   // name: 1, root: 2, missing: 1
+}
+
+- (void)testDeepStackRenderingBenchmark
+{
+    // 50 nested string sections push 50 context frames above the standard
+    // library, where `uppercase` is found.
+    
+    NSMutableArray *items = [NSMutableArray array];
+    for (NSUInteger i = 0; i < 10000; ++i) {
+        [items addObject:@{ @"name": @"item" }];
+    }
+    NSMutableString *templateString = [NSMutableString string];
+    for (NSUInteger i = 0; i < 50; ++i) {
+        [templateString appendString:@"{{#level}}"];
+    }
+    [templateString appendString:@"{{#items}}{{uppercase(name)}}{{missing}}{{/items}}"];
+    for (NSUInteger i = 0; i < 50; ++i) {
+        [templateString appendString:@"{{/level}}"];
+    }
+    GRMustacheTemplate *template = [GRMustacheTemplate templateFromString:templateString error:NULL];
+    id data = @{ @"level": @"level", @"items": items };
+    
+    GRMustacheContextCurrentStatistics = (GRMustacheContextStatistics){ 0 };
+    NSString *rendering = [template renderObject:data error:NULL];
+    XCTAssertEqual(rendering.length, (NSUInteger)(4 * 10000));
+    XCTAssertTrue(GRMustacheContextCurrentStatistics.keyProbeCount < 5 * items.count + 1000);
+    NSLog(@"%@: %lu key probes, %lu memo hits", NSStringFromSelector(_cmd), (unsigned long)GRMustacheContextCurrentStatistics.keyProbeCount, (unsigned long)GRMustacheContextCurrentStatistics.memoHitCount);
+    
+    [self measureBlock:^{
+        @autoreleasepool {
+            [template renderObject:data error:NULL];
+        }
+    }];
+}
+
+@end
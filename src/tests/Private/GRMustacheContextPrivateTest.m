@@ -23,6 +23,7 @@
 #import "GRMustachePrivateAPITest.h"
 #import "GRMustacheContext_private.h"
 #import "GRMustacheTemplate_private.h"
+#import "GRMustacheConfiguration_private.h"
 #import "GRMustacheSafeKeyAccess.h"
 
 @interface GRMustacheContextPrivateTest : GRMustachePrivateAPITest
@@ -359,4 +360,167 @@
     XCTAssertEqualObjects([context valueForMustacheKey:@"fragile" protected:NULL], @"B", @"");
 }
 
+- (void)testContextByFlatteningProtectedContextStack
+{
+    GRKVCRecorder *recorder = [GRKVCRecorder recorderWithRecognizedKey:@"root"];
+    GRMustacheContext *context = [GRMustacheContext contextWithProtectedObject:recorder];
+    context = [context contextByAddingProtectedObject:@{ @"a": @"a1", @"b": @"b1" }];
+    context = [context contextByAddingProtectedObject:@{ @"b": @"b2" }];
+    context = [context contextByAddingObject:@{ @"a": @"hack", @"c": @"c" }];
+    context = [context contextByFlatteningProtectedContextStack];
+    
+    BOOL protected;
+    XCTAssertEqualObjects([context valueForMustacheKey:@"a" protected:&protected], @"a1", @"");
+    XCTAssertTrue(protected, @"");
+    XCTAssertEqualObjects([context valueForMustacheKey:@"b" protected:&protected], @"b2", @"");
+    XCTAssertTrue(protected, @"");
+    XCTAssertEqualObjects([context valueForMustacheKey:@"root" protected:&protected], @"root", @"");
+    XCTAssertTrue(protected, @"");
+    XCTAssertEqualObjects([context valueForMustacheKey:@"c" protected:&protected], @"c", @"");
+    XCTAssertFalse(protected, @"");
+}
+
+- (void)testContextByFlatteningProtectedContextStackKeepsMutableDictionaries
+{
+    NSMutableDictionary *mutableDictionary = [NSMutableDictionary dictionaryWithObject:@"a1" forKey:@"a"];
+    GRMustacheContext *context = [GRMustacheContext contextWithProtectedObject:@{ @"a": @"a0", @"b": @"b0" }];
+    context = [context contextByAddingProtectedObject:mutableDictionary];
+    context = [context contextByFlatteningProtectedContextStack];
+    
+    [mutableDictionary setObject:@"a2" forKey:@"a"];
+    [mutableDictionary setObject:@"b2" forKey:@"b"];
+    XCTAssertEqualObjects([context valueForMustacheKey:@"a" protected:NULL], @"a2", @"");
+    XCTAssertEqualObjects([context valueForMustacheKey:@"b" protected:NULL], @"b2", @"");
+}
+
+- (void)testLockedConfigurationFlattensImmutableProtectedDictionaries
+{
+    NSMutableDictionary *helpers = [NSMutableDictionary dictionaryWithObject:@"helper" forKey:@"helper"];
+    GRMustacheConfiguration *configuration = [GRMustacheConfiguration configuration];
+    [configuration extendBaseContextWithProtectedObject:helpers];
+    [configuration extendBaseContextWithProtectedObject:@{ @"safe": @"important" }];
+    [configuration extendBaseContextWithProtectedObject:@{ @"other": @"other" }];
+    XCTAssertEqual(configuration.renderingBaseContext, configuration.baseContext, @"");
+    
+    [configuration lock];
+    [helpers setObject:@"mutated" forKey:@"helper"];
+    GRMustacheContext *context = [configuration.renderingBaseContext contextByAddingObject:@{ @"name": @"Arthur" }];
+    
+    // Immutable dictionaries cost a single probe, the mutable one the second
+    // one, and top-level data the third one.
+    GRMustacheContextCurrentStatistics = (GRMustacheContextStatistics){ 0 };
+    XCTAssertEqualObjects([context valueForMustacheKey:@"name"], @"Arthur", @"");
+    XCTAssertEqual(atomic_load(&GRMustacheContextCurrentStatistics.keyProbeCount), (NSUInteger)3, @"");
+    XCTAssertEqualObjects([context valueForMustacheKey:@"safe"], @"important", @"");
+    XCTAssertEqualObjects([context valueForMustacheKey:@"other"], @"other", @"");
+    
+    // Templates see the mutations of the objects of the base context, just
+    // as the base context does.
+    XCTAssertEqualObjects([context valueForMustacheKey:@"helper"], @"mutated", @"");
+    XCTAssertEqualObjects([configuration.baseContext valueForMustacheKey:@"helper"], @"mutated", @"");
+}
+
+- (void)testHasValueForMustacheExpressionParsesEachExpressionOnce
+{
+    GRMustacheContext *context = [GRMustacheContext contextWithObject:@{ @"user": @{ @"name": @"Arthur" } }];
+    NSMutableString *string = [NSMutableString stringWithString:@"user.name"];
+    id value;
+    
+    GRMustacheContextCurrentStatistics = (GRMustacheContextStatistics){ 0 };
+    XCTAssertTrue([context hasValue:&value forMustacheExpression:string error:NULL]);
+    XCTAssertEqualObjects(value, @"Arthur");
+    XCTAssertTrue([context hasValue:&value forMustacheExpression:@"user.name" error:NULL]);
+    XCTAssertEqualObjects(value, @"Arthur");
+    XCTAssertTrue(GRMustacheContextCurrentStatistics.expressionCacheHitCount >= 1);
+    
+    // Mutating the string does not alter the cache
+    [string setString:@"user"];
+    XCTAssertTrue([context hasValue:&value forMustacheExpression:string error:NULL]);
+    XCTAssertEqualObjects(value, @{ @"name": @"Arthur" });
+    XCTAssertTrue([context hasValue:&value forMustacheExpression:@"user.name" error:NULL]);
+    XCTAssertEqualObjects(value, @"Arthur");
+}
+
+- (void)testHasValueForMustacheExpressionDoesNotCacheInvalidExpressions
+{
+    GRMustacheContext *context = [GRMustacheContext contextWithObject:@{ @"a": @"a" }];
+    for (NSUInteger i = 0; i < 2; ++i) {
+        NSError *error = nil;
+        id value = nil;
+        XCTAssertFalse([context hasValue:&value forMustacheExpression:@"a." error:&error]);
+        XCTAssertEqualObjects(error.domain, GRMustacheErrorDomain);
+        XCTAssertEqual(error.code, GRMustacheErrorCodeParseError);
+    }
+}
+
+- (void)testHasValueForMustacheExpressionCacheIsBounded
+{
+    GRMustacheContext *context = [GRMustacheContext contextWithObject:@{ @"name": @"Arthur" }];
+    for (NSUInteger i = 0; i < 1000; ++i) {
+        id value;
+        NSString *string = [NSString stringWithFormat:@"missing%lu", (unsigned long)i];
+        XCTAssertTrue([context hasValue:&value forMustacheExpression:string error:NULL]);
+        XCTAssertNil(value);
+    }
+    id value;
+    XCTAssertTrue([context hasValue:&value forMustacheExpression:@"name" error:NULL]);
+    XCTAssertEqualObjects(value, @"Arthur");
+}
+
+- (void)testHasValueForMustacheExpressionIsReentrant
+{
+    GRMustacheContext *innerContext = [GRMustacheContext contextWithObject:@{ @"name": @"inner" }];
+    id filter = [GRMustacheFilter filterWithBlock:^id(id value) {
+        id innerValue;
+        [innerContext hasValue:&innerValue forMustacheExpression:@"name" error:NULL];
+        return [NSString stringWithFormat:@"%@-%@", value, innerValue];
+    }];
+    GRMustacheContext *context = [GRMustacheContext contextWithObject:@{ @"name": @"outer", @"f": filter }];
+    id value;
+    XCTAssertTrue([context hasValue:&value forMustacheExpression:@"f(f(name))" error:NULL]);
+    XCTAssertEqualObjects(value, @"outer-inner-inner");
+}
+
+- (void)testHasValueForMustacheExpressionSurvivesExceptions
+{
+    id filter = [GRMustacheFilter filterWithBlock:^id(id value) {
+        [NSException raise:@"GRMustacheContextPrivateTest" format:@"%@", value];
+        return nil;
+    }];
+    GRMustacheContext *context = [GRMustacheContext contextWithObject:@{ @"name": @"Arthur", @"f": filter }];
+    id value;
+    XCTAssertThrows([context hasValue:&value forMustacheExpression:@"f(name)" error:NULL]);
+    XCTAssertTrue([context hasValue:&value forMustacheExpression:@"name" error:NULL]);
+    XCTAssertEqualObjects(value, @"Arthur");
+}
+
+- (void)testHasValueForMustacheExpressionPerformance
+{
+    // Rendering objects and tag delegates may evaluate expressions for each
+    // rendered item.
+    
+    NSMutableArray *items = [NSMutableArray array];
+    for (NSUInteger i = 0; i < 10000; ++i) {
+        [items addObject:@{ @"user": @{ @"name": @"Arthur" } }];
+    }
+    GRMustacheContext *context = [GRMustacheContext contextWithObject:@{ @"uppercase": [GRMustacheFilter filterWithBlock:^id(id value) { return [value uppercaseString]; }] }];
+    
+    GRMustacheContextCurrentStatistics = (GRMustacheContextStatistics){ 0 };
+    for (id item in items) {
+        id value;
+        [[context contextByAddingObject:item] hasValue:&value forMustacheExpression:@"uppercase(user.name)" error:NULL];
+    }
+    XCTAssertTrue(GRMustacheContextCurrentStatistics.expressionCacheMissCount <= 1);
+    NSLog(@"%@: %lu expression cache hits, %lu misses", NSStringFromSelector(_cmd), (unsigned long)GRMustacheContextCurrentStatistics.expressionCacheHitCount, (unsigned long)GRMustacheContextCurrentStatistics.expressionCacheMissCount);
+    
+    [self measureBlock:^{
+        @autoreleasepool {
+            for (id item in items) {
+                id value;
+                [[context contextByAddingObject:item] hasValue:&value forMustacheExpression:@"uppercase(user.name)" error:NULL];
+            }
+        }
+    }];
+}
+
 @end
@@ -94,4 +94,29 @@
     XCTAssertEqualObjects(expression_abcdefghij, parsedExpression);
 }
 
+- (void)testEqualExpressionsInternToTheSameInstance
+{
+    // Build distinct strings, so that the parser doesn't reuse literals.
+    NSString *string1 = [NSString stringWithFormat:@"%@.%@", @"user", @"name"];
+    NSString *string2 = [NSString stringWithFormat:@"%@.%@", @"user", @"name"];
+    GRMustacheScopedExpression *expression1 = (GRMustacheScopedExpression *)[[parser parseExpression:string1 empty:NULL error:NULL] internedExpression];
+    GRMustacheScopedExpression *expression2 = (GRMustacheScopedExpression *)[[parser parseExpression:string2 empty:NULL error:NULL] internedExpression];
+    
+    XCTAssertEqual(expression1, expression2);
+    XCTAssertEqual([[parser parseExpression:@"user" empty:NULL error:NULL] internedExpression], expression1.baseExpression);
+    XCTAssertEqual([GRMustacheExpression internedIdentifier:[NSString stringWithFormat:@"%@", @"name"]], expression1.identifier);
+}
+
+- (void)testInternedExpressionsPreserveCurrying
+{
+    GRMustacheExpression *filter = [GRMustacheIdentifierExpression expressionWithIdentifier:@"f"];
+    GRMustacheExpression *argument = [GRMustacheIdentifierExpression expressionWithIdentifier:@"x"];
+    GRMustacheExpression *expression = [[GRMustacheFilteredExpression expressionWithFilterExpression:filter argumentExpression:argument curried:NO] internedExpression];
+    GRMustacheExpression *curriedExpression = [[GRMustacheFilteredExpression expressionWithFilterExpression:filter argumentExpression:argument curried:YES] internedExpression];
+    
+    XCTAssertNotEqualObjects(expression, curriedExpression);
+    XCTAssertFalse(((GRMustacheFilteredExpression *)expression).isCurried);
+    XCTAssertTrue(((GRMustacheFilteredExpression *)curriedExpression).isCurried);
+}
+
 @end
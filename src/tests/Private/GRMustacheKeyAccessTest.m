@@ -0,0 +1,483 @@
+// The MIT License
+//
+// Copyright (c) 2014 Gwendal Roué
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#import "GRMustachePrivateAPITest.h"
+#import "GRMustacheKeyAccess_private.h"
+
+@interface GRMustacheKeyAccess(GRMustacheKeyAccessTest)
++ (id)dynamicValueForMustacheKey:(NSString *)key inObject:(id)object unsafeKeyAccess:(BOOL)unsafeKeyAccess;
+@end
+
+@interface GRKeyAccessTestPerson : NSObject
+@property (nonatomic, copy) NSString *name;
+@property (nonatomic) NSInteger age;
+@property (nonatomic) double score;
+@property (nonatomic) BOOL vip;
+@property (nonatomic) char initial;
+@property (nonatomic, getter=isEnabled) BOOL enabled;
+@property (nonatomic) NSRange range;
+- (NSString *)secret;
+@end
+
+@implementation GRKeyAccessTestPerson
+- (void)dealloc
+{
+    [_name release];
+    [super dealloc];
+}
+- (NSString *)secret
+{
+    return @"secret";
+}
+@end
+
+@interface GRKeyAccessTestRecorder : NSObject
+@property (nonatomic, copy) NSString *name;
+@property (nonatomic) NSUInteger valueForKeyCount;
+@end
+
+@implementation GRKeyAccessTestRecorder
+- (void)dealloc
+{
+    [_name release];
+    [super dealloc];
+}
+- (id)valueForKey:(NSString *)key
+{
+    ++_valueForKeyCount;
+    return [super valueForKey:key];
+}
+@end
+
+@interface GRKeyAccessTestPrewarmed : NSObject
+@property (nonatomic, copy) NSString *name;
+@end
+
+@implementation GRKeyAccessTestPrewarmed
+- (void)dealloc
+{
+    [_name release];
+    [super dealloc];
+}
+@end
+
+@interface GRKeyAccessTestShared : NSObject
+@property (nonatomic, copy) NSString *name;
+@end
+
+@implementation GRKeyAccessTestShared
+- (void)dealloc
+{
+    [_name release];
+    [super dealloc];
+}
+@end
+
+@interface GRKeyAccessTestOptional : NSObject
+@property (nonatomic, copy) NSString *optional;
+@end
+
+@implementation GRKeyAccessTestOptional
+- (void)dealloc
+{
+    [_optional release];
+    [super dealloc];
+}
+@end
+
+@interface GRKeyAccessTestBare : NSObject
+@end
+
+@implementation GRKeyAccessTestBare
+@end
+
+@interface GRKeyAccessTestUndefinedKey : NSObject
+@end
+
+@implementation GRKeyAccessTestUndefinedKey
+- (id)valueForUndefinedKey:(NSString *)key
+{
+    return key;
+}
+@end
+
+@interface GRKeyAccessTestManyKeys : NSObject
+@end
+
+@implementation GRKeyAccessTestManyKeys
+- (id)valueForUndefinedKey:(NSString *)key
+{
+    return key;
+}
+@end
+
+@interface GRMustacheKeyAccessTest : GRMustachePrivateAPITest
+@end
+
+@implementation GRMustacheKeyAccessTest
+
+- (GRKeyAccessTestPerson *)personWithName:(NSString *)name
+{
+    GRKeyAccessTestPerson *person = [[[GRKeyAccessTestPerson alloc] init] autorelease];
+    person.name = name;
+    person.age = 42;
+    person.score = 1.5;
+    person.vip = YES;
+    person.initial = 'A';
+    person.enabled = YES;
+    person.range = NSMakeRange(1, 2);
+    return person;
+}
+
+- (void)testInlineCacheReturnsTheSameValuesAsKeyAccess
+{
+    NSArray *objects = @[[self personWithName:@"Arthur"],
+                         @{ @"name": @"Barbara", @"age": @36 },
+                         @[@1, @2],
+                         [NSSet setWithObject:@1],
+                         @"string",
+                         @12,
+                         [NSNull null]];
+    NSArray *keys = @[@"name", @"age", @"score", @"vip", @"initial", @"enabled", @"isEnabled", @"range", @"secret", @"count", @"length", @"missing"];
+    for (NSString *key in keys) {
+        for (NSNumber *unsafeKeyAccess in @[@NO, @YES]) {
+            GRMustacheKeyAccessInlineCache inlineCache = { { NULL }, 0 };
+            for (NSUInteger pass = 0; pass < 2; ++pass) {
+                for (id object in objects) {
+                    // The full key-fetching logic is the reference
+                    id expected = [GRMustacheKeyAccess dynamicValueForMustacheKey:key inObject:object unsafeKeyAccess:[unsafeKeyAccess boolValue]];
+                    id value = [GRMustacheKeyAccess valueForMustacheKey:key inObject:object unsafeKeyAccess:[unsafeKeyAccess boolValue] inlineCache:&inlineCache];
+                    XCTAssertEqualObjects(value, expected, @"key %@ in %@", key, object);
+                    value = [GRMustacheKeyAccess valueForMustacheKey:key inObject:object unsafeKeyAccess:[unsafeKeyAccess boolValue]];
+                    XCTAssertEqualObjects(value, expected, @"key %@ in %@", key, object);
+                }
+            }
+        }
+    }
+}
+
+- (void)testInlineCacheResolvesAccessorsOncePerClass
+{
+    NSArray *people = @[[self personWithName:@"Arthur"], [self personWithName:@"Barbara"], [self personWithName:@"Craig"]];
+    GRMustacheKeyAccessInlineCache inlineCache = { { NULL }, 0 };
+    GRMustacheKeyAccessCurrentStatistics = (GRMustacheKeyAccessStatistics){ 0 };
+    for (GRKeyAccessTestPerson *person in people) {
+        XCTAssertEqualObjects([GRMustacheKeyAccess valueForMustacheKey:@"name" inObject:person unsafeKeyAccess:NO inlineCache:&inlineCache], person.name);
+    }
+    XCTAssertEqual(atomic_load(&GRMustacheKeyAccessCurrentStatistics.inlineCacheMissCount), (NSUInteger)1);
+    XCTAssertEqual(atomic_load(&GRMustacheKeyAccessCurrentStatistics.inlineCacheHitCount), (NSUInteger)2);
+    
+    const GRMustacheKeyAccessor *accessor = [GRMustacheKeyAccess accessorForMustacheKey:@"name" inObject:people[0] unsafeKeyAccess:NO];
+    XCTAssertEqual(accessor->type, GRMustacheKeyAccessorTypeObjectGetter);
+    XCTAssertEqual([GRMustacheKeyAccess accessorForMustacheKey:@"name" inObject:people[1] unsafeKeyAccess:NO], accessor);
+    XCTAssertEqual([GRMustacheKeyAccess accessorForMustacheKey:@"age" inObject:people[0] unsafeKeyAccess:NO]->type, GRMustacheKeyAccessorTypeLongGetter);
+    XCTAssertEqual([GRMustacheKeyAccess accessorForMustacheKey:@"secret" inObject:people[0] unsafeKeyAccess:NO]->type, GRMustacheKeyAccessorTypeNone);
+    XCTAssertEqual([GRMustacheKeyAccess accessorForMustacheKey:@"secret" inObject:people[0] unsafeKeyAccess:YES]->type, GRMustacheKeyAccessorTypeObjectGetter);
+    XCTAssertEqual([GRMustacheKeyAccess accessorForMustacheKey:@"range" inObject:people[0] unsafeKeyAccess:NO]->type, GRMustacheKeyAccessorTypeValueForKey);
+    XCTAssertEqual([GRMustacheKeyAccess accessorForMustacheKey:@"name" inObject:@{} unsafeKeyAccess:NO]->type, GRMustacheKeyAccessorTypeKeyedSubscript);
+}
+
+- (void)testAccessorsAreRegisteredWithCopiedKeys
+{
+    GRKeyAccessTestPerson *person = [self personWithName:@"Arthur"];
+    NSMutableString *key = [NSMutableString stringWithString:@"name"];
+    const GRMustacheKeyAccessor *accessor = [GRMustacheKeyAccess accessorForMustacheKey:key inObject:person unsafeKeyAccess:NO];
+    [key setString:@"age"];
+    XCTAssertEqual([GRMustacheKeyAccess accessorForMustacheKey:@"name" inObject:person unsafeKeyAccess:NO], accessor);
+    XCTAssertEqual([GRMustacheKeyAccess accessorForMustacheKey:key inObject:person unsafeKeyAccess:NO]->type, GRMustacheKeyAccessorTypeLongGetter);
+}
+
+- (void)testAccessorsAreBoundedPerClass
+{
+    GRKeyAccessTestManyKeys *object = [[[GRKeyAccessTestManyKeys alloc] init] autorelease];
+    GRMustacheKeyAccessInlineCache inlineCache = { { NULL }, 0 };
+    NSUInteger registeredCount = 0;
+    for (NSUInteger i = 0; i < 1000; ++i) {
+        NSString *key = [NSString stringWithFormat:@"key%lu", (unsigned long)i];
+        const GRMustacheKeyAccessor *accessor = [GRMustacheKeyAccess accessorForMustacheKey:key inObject:object unsafeKeyAccess:YES];
+        if (accessor->klass == [GRKeyAccessTestManyKeys class]) {
+            ++registeredCount;
+        }
+        
+        // Unregistered keys still go through the full key-fetching logic.
+        XCTAssertEqualObjects([GRMustacheKeyAccess valueForMustacheKey:key inObject:object unsafeKeyAccess:YES], key);
+        XCTAssertEqualObjects([GRMustacheKeyAccess valueForMustacheKey:key inObject:object unsafeKeyAccess:YES inlineCache:&inlineCache], key);
+    }
+    XCTAssertTrue(registeredCount > 0);
+    XCTAssertTrue(registeredCount < 1000);
+}
+
+- (void)testInlineCacheChecksKeys
+{
+    GRKeyAccessTestPerson *person = [self personWithName:@"Arthur"];
+    GRMustacheKeyAccessInlineCache inlineCache = { { NULL }, 0 };
+    XCTAssertEqualObjects([GRMustacheKeyAccess valueForMustacheKey:@"name" inObject:person unsafeKeyAccess:NO inlineCache:&inlineCache], @"Arthur");
+    XCTAssertEqualObjects([GRMustacheKeyAccess valueForMustacheKey:@"age" inObject:person unsafeKeyAccess:NO inlineCache:&inlineCache], @42);
+    XCTAssertEqualObjects([GRMustacheKeyAccess valueForMustacheKey:[NSMutableString stringWithString:@"name"] inObject:person unsafeKeyAccess:NO inlineCache:&inlineCache], @"Arthur");
+}
+
+- (void)testInlineCacheRespectsOverriddenValueForKey
+{
+    GRKeyAccessTestRecorder *recorder = [[[GRKeyAccessTestRecorder alloc] init] autorelease];
+    recorder.name = @"Arthur";
+    GRMustacheKeyAccessInlineCache inlineCache = { { NULL }, 0 };
+    XCTAssertEqualObjects([GRMustacheKeyAccess valueForMustacheKey:@"name" inObject:recorder unsafeKeyAccess:NO inlineCache:&inlineCache], @"Arthur");
+    XCTAssertEqualObjects([GRMustacheKeyAccess valueForMustacheKey:@"name" inObject:recorder unsafeKeyAccess:NO inlineCache:&inlineCache], @"Arthur");
+    XCTAssertEqual(recorder.valueForKeyCount, (NSUInteger)2);
+}
+
+- (void)testInlineCacheIsPolymorphic
+{
+    NSArray *objects = @[[self personWithName:@"Arthur"], @{ @"name": @"Barbara" }, [NSMutableDictionary dictionaryWithObject:@"Craig" forKey:@"name"]];
+    GRMustacheKeyAccessInlineCache inlineCache = { { NULL }, 0 };
+    for (id object in objects) {
+        [GRMustacheKeyAccess valueForMustacheKey:@"name" inObject:object unsafeKeyAccess:NO inlineCache:&inlineCache];
+    }
+    GRMustacheKeyAccessCurrentStatistics = (GRMustacheKeyAccessStatistics){ 0 };
+    for (NSUInteger i = 0; i < 10; ++i) {
+        for (id object in objects) {
+            [GRMustacheKeyAccess valueForMustacheKey:@"name" inObject:object unsafeKeyAccess:NO inlineCache:&inlineCache];
+        }
+    }
+    XCTAssertEqual(atomic_load(&GRMustacheKeyAccessCurrentStatistics.inlineCacheMissCount), (NSUInteger)0);
+    XCTAssertEqual(atomic_load(&GRMustacheKeyAccessCurrentStatistics.inlineCacheHitCount), (NSUInteger)30);
+}
+
+- (void)testTemplateExpressionsUseInlineCaches
+{
+    GRMustacheTemplate *template = [GRMustacheTemplate templateFromString:@"{{#people}}{{name}}{{age}}{{/people}}{{#people}}{{person.name}}{{/people}}" error:NULL];
+    NSMutableArray *people = [NSMutableArray array];
+    for (NSUInteger i = 0; i < 100; ++i) {
+        GRKeyAccessTestPerson *person = [self personWithName:@"a"];
+        [people addObject:person];
+    }
+    [template renderObject:@{ @"people": people } error:NULL];
+    GRMustacheKeyAccessCurrentStatistics = (GRMustacheKeyAccessStatistics){ 0 };
+    NSString *rendering = [template renderObject:@{ @"people": people } error:NULL];
+    XCTAssertEqual(rendering.length, (NSUInteger)(3 * 100));
+    XCTAssertEqual(atomic_load(&GRMustacheKeyAccessCurrentStatistics.accessorResolutionCount), (NSUInteger)0);
+    XCTAssertTrue(atomic_load(&GRMustacheKeyAccessCurrentStatistics.inlineCacheHitCount) > 3 * people.count);
+}
+
+- (void)testTagsHaveTheirOwnInlineCaches
+{
+    // The first `{{name}}` tag sees more classes than its inline cache can
+    // hold. The second one, whose expression is equal, must not suffer from
+    // it.
+    GRMustacheTemplate *template = [GRMustacheTemplate templateFromString:@"{{#objects}}{{name}}{{/objects}}{{#people}}{{name}}{{/people}}" error:NULL];
+    GRKeyAccessTestRecorder *recorder = [[[GRKeyAccessTestRecorder alloc] init] autorelease];
+    GRKeyAccessTestPrewarmed *prewarmed = [[[GRKeyAccessTestPrewarmed alloc] init] autorelease];
+    GRKeyAccessTestShared *shared = [[[GRKeyAccessTestShared alloc] init] autorelease];
+    NSArray *objects = @[[self personWithName:@"a"], recorder, prewarmed, shared, @{ @"name": @"a" }, [NSMutableDictionary dictionaryWithObject:@"a" forKey:@"name"]];
+    NSMutableArray *people = [NSMutableArray array];
+    for (NSUInteger i = 0; i < 100; ++i) {
+        [people addObject:[self personWithName:@"a"]];
+    }
+    NSDictionary *data = @{ @"objects": objects, @"people": people };
+    [template renderObject:data error:NULL];
+    GRMustacheKeyAccessCurrentStatistics = (GRMustacheKeyAccessStatistics){ 0 };
+    [template renderObject:data error:NULL];
+    XCTAssertTrue(atomic_load(&GRMustacheKeyAccessCurrentStatistics.inlineCacheMissCount) <= objects.count);
+    XCTAssertTrue(atomic_load(&GRMustacheKeyAccessCurrentStatistics.inlineCacheHitCount) >= people.count);
+}
+
+- (void)testPrewarmedSafeKeysAreNotComputedAgain
+{
+    GRMustacheKeyAccessCurrentStatistics = (GRMustacheKeyAccessStatistics){ 0 };
+    [GRMustache prewarmSafeKeysForClasses:@[[GRKeyAccessTestPrewarmed class]]];
+    XCTAssertEqual(atomic_load(&GRMustacheKeyAccessCurrentStatistics.safeKeysRegistrationCount), (NSUInteger)1);
+    
+    GRKeyAccessTestPrewarmed *object = [[[GRKeyAccessTestPrewarmed alloc] init] autorelease];
+    object.name = @"Arthur";
+    XCTAssertEqualObjects([GRMustacheKeyAccess valueForMustacheKey:@"name" inObject:object unsafeKeyAccess:NO], @"Arthur");
+    XCTAssertNil([GRMustacheKeyAccess valueForMustacheKey:@"description" inObject:object unsafeKeyAccess:NO]);
+    [GRMustache prewarmSafeKeysForClasses:@[[GRKeyAccessTestPrewarmed class]]];
+    XCTAssertEqual(atomic_load(&GRMustacheKeyAccessCurrentStatistics.safeKeysRegistrationCount), (NSUInteger)1);
+}
+
+- (void)testSafeKeysAreSharedBetweenThreads
+{
+    GRKeyAccessTestShared *object = [[[GRKeyAccessTestShared alloc] init] autorelease];
+    object.name = @"Arthur";
+    
+    GRMustacheKeyAccessCurrentStatistics = (GRMustacheKeyAccessStatistics){ 0 };
+    __block NSUInteger failureCount = 0;
+    dispatch_apply(64, dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT, 0), ^(size_t i) {
+        if (![[GRMustacheKeyAccess valueForMustacheKey:@"name" inObject:object unsafeKeyAccess:NO] isEqualToString:@"Arthur"]) {
+            __sync_fetch_and_add(&failureCount, 1);
+        }
+    });
+    XCTAssertEqual(failureCount, (NSUInteger)0);
+    
+    // Concurrent first accesses may compute the safe keys more than once, but
+    // later accesses don't.
+    NSUInteger registrationCount = atomic_load(&GRMustacheKeyAccessCurrentStatistics.safeKeysRegistrationCount);
+    dispatch_apply(64, dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT, 0), ^(size_t i) {
+        [GRMustacheKeyAccess valueForMustacheKey:@"name" inObject:object unsafeKeyAccess:NO];
+    });
+    XCTAssertEqual(atomic_load(&GRMustacheKeyAccessCurrentStatistics.safeKeysRegistrationCount), registrationCount);
+}
+
+- (void)testFoundationCollectionsUseGetters
+{
+    NSArray *array = @[@1, @2];
+    NSSet *set = [NSSet setWithObject:@1];
+    NSOrderedSet *orderedSet = [NSOrderedSet orderedSetWithObject:@1];
+    GRMustacheKeyAccessorType countType = [GRMustacheKeyAccess accessorForMustacheKey:@"count" inObject:array unsafeKeyAccess:NO]->type;
+    XCTAssertTrue(countType == GRMustacheKeyAccessorTypeUnsignedIntGetter || countType == GRMustacheKeyAccessorTypeUnsignedLongGetter || countType == GRMustacheKeyAccessorTypeUnsignedLongLongGetter);
+    XCTAssertEqual([GRMustacheKeyAccess accessorForMustacheKey:@"firstObject" inObject:array unsafeKeyAccess:NO]->type, GRMustacheKeyAccessorTypeObjectGetter);
+    XCTAssertEqual([GRMustacheKeyAccess accessorForMustacheKey:@"anyObject" inObject:set unsafeKeyAccess:NO]->type, GRMustacheKeyAccessorTypeObjectGetter);
+    XCTAssertEqual([GRMustacheKeyAccess accessorForMustacheKey:@"missing" inObject:array unsafeKeyAccess:YES]->type, GRMustacheKeyAccessorTypeMissing);
+    
+    XCTAssertEqualObjects([GRMustacheKeyAccess valueForMustacheKey:@"count" inObject:array unsafeKeyAccess:NO], @2);
+    XCTAssertEqualObjects([GRMustacheKeyAccess valueForMustacheKey:@"firstObject" inObject:array unsafeKeyAccess:NO], @1);
+    XCTAssertEqualObjects([GRMustacheKeyAccess valueForMustacheKey:@"count" inObject:set unsafeKeyAccess:NO], @1);
+    XCTAssertEqualObjects([GRMustacheKeyAccess valueForMustacheKey:@"firstObject" inObject:orderedSet unsafeKeyAccess:NO], @1);
+    XCTAssertNil([GRMustacheKeyAccess valueForMustacheKey:@"missing" inObject:array unsafeKeyAccess:YES]);
+}
+
+- (void)testFoundationCollectionKeyAccessBenchmark
+{
+    NSMutableArray *items = [NSMutableArray array];
+    for (NSUInteger i = 0; i < 10000; ++i) {
+        [items addObject:@{ @"list": @[@1, @2, @3] }];
+    }
+    GRMustacheTemplate *template = [GRMustacheTemplate templateFromString:@"{{#items}}{{#list.count}}{{list.count}}{{list.firstObject}}{{/list.count}}{{/items}}" error:NULL];
+    id data = @{ @"items": items };
+    NSString *rendering = [template renderObject:data error:NULL];
+    XCTAssertEqual(rendering.length, (NSUInteger)(2 * 10000));
+    
+    [self measureBlock:^{
+        @autoreleasepool {
+            [template renderObject:data error:NULL];
+        }
+    }];
+}
+
+- (void)testMissingKeysDoNotRaiseNSUndefinedKeyException
+{
+    GRKeyAccessTestBare *bare = [[[GRKeyAccessTestBare alloc] init] autorelease];
+    XCTAssertEqual([GRMustacheKeyAccess accessorForMustacheKey:@"optional" inObject:bare unsafeKeyAccess:YES]->type, GRMustacheKeyAccessorTypeMissing);
+    
+    GRMustacheKeyAccessDidCatchNSUndefinedKeyException = NO;
+    XCTAssertNil([GRMustacheKeyAccess valueForMustacheKey:@"optional" inObject:bare unsafeKeyAccess:YES]);
+    GRMustacheKeyAccessInlineCache inlineCache = { { NULL }, 0 };
+    XCTAssertNil([GRMustacheKeyAccess valueForMustacheKey:@"optional" inObject:bare unsafeKeyAccess:YES inlineCache:&inlineCache]);
+    XCTAssertFalse(GRMustacheKeyAccessDidCatchNSUndefinedKeyException);
+}
+
+- (void)testOverriddenValueForUndefinedKeyIsStillCalled
+{
+    GRKeyAccessTestUndefinedKey *object = [[[GRKeyAccessTestUndefinedKey alloc] init] autorelease];
+    XCTAssertEqual([GRMustacheKeyAccess accessorForMustacheKey:@"optional" inObject:object unsafeKeyAccess:YES]->type, GRMustacheKeyAccessorTypeValueForKey);
+    XCTAssertEqualObjects([GRMustacheKeyAccess valueForMustacheKey:@"optional" inObject:object unsafeKeyAccess:YES], @"optional");
+    GRMustacheKeyAccessInlineCache inlineCache = { { NULL }, 0 };
+    XCTAssertEqualObjects([GRMustacheKeyAccess valueForMustacheKey:@"optional" inObject:object unsafeKeyAccess:YES inlineCache:&inlineCache], @"optional");
+}
+
+- (void)testOptionalKeyAccessBenchmark
+{
+    // Half of the items lack the `optional` key.
+    
+    NSMutableArray *items = [NSMutableArray array];
+    for (NSUInteger i = 0; i < 10000; ++i) {
+        if (i % 2) {
+            GRKeyAccessTestOptional *item = [[[GRKeyAccessTestOptional alloc] init] autorelease];
+            item.optional = @"optional";
+            [items addObject:item];
+        } else {
+            [items addObject:[[[GRKeyAccessTestBare alloc] init] autorelease]];
+        }
+    }
+    GRMustacheTemplate *template = [GRMustacheTemplate templateFromString:@"{{#items}}{{#optional}}x{{/optional}}{{/items}}" error:NULL];
+    template.baseContext = [template.baseContext contextWithUnsafeKeyAccess];
+    id data = @{ @"items": items };
+    
+    GRMustacheKeyAccessDidCatchNSUndefinedKeyException = NO;
+    NSString *rendering = [template renderObject:data error:NULL];
+    XCTAssertEqual(rendering.length, (NSUInteger)5000);
+    XCTAssertFalse(GRMustacheKeyAccessDidCatchNSUndefinedKeyException);
+    
+    [self measureBlock:^{
+        @autoreleasepool {
+            [template renderObject:data error:NULL];
+        }
+    }];
+}
+
+- (void)benchmarkRenderingOfItems:(NSArray *)items selector:(SEL)selector
+{
+    GRMustacheTemplate *template = [GRMustacheTemplate templateFromString:@"{{#items}}{{name}} {{age}} {{score}} {{#vip}}VIP{{/vip}}{{/items}}" error:NULL];
+    id data = @{ @"items": items };
+    
+    [template renderObject:data error:NULL];
+    GRMustacheKeyAccessCurrentStatistics = (GRMustacheKeyAccessStatistics){ 0 };
+    [template renderObject:data error:NULL];
+    NSLog(@"%@: %lu inline cache hits, %lu misses, %lu resolutions", NSStringFromSelector(selector), (unsigned long)atomic_load(&GRMustacheKeyAccessCurrentStatistics.inlineCacheHitCount), (unsigned long)atomic_load(&GRMustacheKeyAccessCurrentStatistics.inlineCacheMissCount), (unsigned long)atomic_load(&GRMustacheKeyAccessCurrentStatistics.accessorResolutionCount));
+    
+    [self measureBlock:^{
+        @autoreleasepool {
+            [template renderObject:data error:NULL];
+        }
+    }];
+}
+
+- (void)testDictionaryKeyAccessBenchmark
+{
+    NSMutableArray *items = [NSMutableArray array];
+    for (NSUInteger i = 0; i < 10000; ++i) {
+        [items addObject:@{ @"name": @"name", @"age": @42, @"score": @1.5, @"vip": @YES }];
+    }
+    [self benchmarkRenderingOfItems:items selector:_cmd];
+}
+
+- (void)testModelObjectKeyAccessBenchmark
+{
+    NSMutableArray *items = [NSMutableArray array];
+    for (NSUInteger i = 0; i < 10000; ++i) {
+        [items addObject:[self personWithName:@"name"]];
+    }
+    [self benchmarkRenderingOfItems:items selector:_cmd];
+}
+
+- (void)testMixedShapesKeyAccessBenchmark
+{
+    NSMutableArray *items = [NSMutableArray array];
+    for (NSUInteger i = 0; i < 10000; ++i) {
+        switch (i % 3) {
+            case 0:
+                [items addObject:@{ @"name": @"name", @"age": @42, @"score": @1.5, @"vip": @YES }];
+                break;
+            case 1:
+                [items addObject:[self personWithName:@"name"]];
+                break;
+            default: {
+                GRKeyAccessTestRecorder *recorder = [[[GRKeyAccessTestRecorder alloc] init] autorelease];
+                recorder.name = @"name";
+                [items addObject:recorder];
+            } break;
+        }
+    }
+    [self benchmarkRenderingOfItems:items selector:_cmd];
+}
+
+@end
@@ -0,0 +1,285 @@
+// The MIT License
+//
+// Copyright (c) 2014 Gwendal Roué
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#import "GRMustachePrivateAPITest.h"
+#import "GRMustacheSourceGenerator_private.h"
+#import "GRMustacheTemplateRepository_private.h"
+
+// The precompiled templates below are those that grmustache-precompile would
+// generate for the following templates:
+//
+// - footer: `{{&note}}!`
+// - list:   `<ul>{{#items}}<li>{{name}}</li>{{/items}}</ul>{{>footer}}`
+
+static BOOL render_footer(GRMustachePrecompiledRendering *rendering)
+{
+    return GRMustachePrecompiledRenderTag(rendering, 0)
+        && GRMustachePrecompiledRenderText(rendering, 0);
+}
+
+static const GRMustachePrecompiledText texts_footer[] = {
+    { "!", 1 },
+};
+
+static const GRMustachePrecompiledTag tags_footer[] = {
+    { GRMustachePrecompiledTagTypeUnescapedVariable, "note", 1, NULL },
+};
+
+static const GRMustachePrecompiledBlock block_footer = {
+    render_footer,
+    "{{&note}}!",
+    texts_footer, 1,
+    tags_footer, 1,
+    NULL, 0,
+};
+
+static const GRMustachePrecompiledTemplate template_footer = {
+    "footer",
+    GRMustacheContentTypeHTML,
+    &block_footer,
+};
+
+static BOOL render_item(GRMustachePrecompiledRendering *rendering)
+{
+    return GRMustachePrecompiledRenderText(rendering, 0)
+        && GRMustachePrecompiledRenderTag(rendering, 0)
+        && GRMustachePrecompiledRenderText(rendering, 1);
+}
+
+static const GRMustachePrecompiledText texts_item[] = {
+    { "<li>", 4 },
+    { "</li>", 5 },
+};
+
+static const GRMustachePrecompiledTag tags_item[] = {
+    { GRMustachePrecompiledTagTypeEscapedVariable, "name", 1, NULL },
+};
+
+static const GRMustachePrecompiledBlock block_item = {
+    render_item,
+    "<li>{{name}}</li>",
+    texts_item, 2,
+    tags_item, 1,
+    NULL, 0,
+};
+
+static BOOL render_list(GRMustachePrecompiledRendering *rendering)
+{
+    return GRMustachePrecompiledRenderText(rendering, 0)
+        && GRMustachePrecompiledRenderTag(rendering, 0)
+        && GRMustachePrecompiledRenderText(rendering, 1)
+        && GRMustachePrecompiledRenderPartial(rendering, 0);
+}
+
+static const GRMustachePrecompiledText texts_list[] = {
+    { "<ul>", 4 },
+    { "</ul>", 5 },
+};
+
+static const GRMustachePrecompiledTag tags_list[] = {
+    { GRMustachePrecompiledTagTypeSection, "items", 1, &block_item },
+};
+
+static const char * const partials_list[] = {
+    "footer",
+};
+
+static const GRMustachePrecompiledBlock block_list = {
+    render_list,
+    "<ul>{{#items}}<li>{{name}}</li>{{/items}}</ul>{{>footer}}",
+    texts_list, 2,
+    tags_list, 1,
+    partials_list, 1,
+};
+
+static const GRMustachePrecompiledTemplate template_list = {
+    "list",
+    GRMustacheContentTypeHTML,
+    &block_list,
+};
+
+// Templates that use inheritance are compiled from their source.
+
+static const GRMustachePrecompiledBlock block_layout = {
+    NULL,
+    "<{{$content}}default{{/content}}>",
+    NULL, 0,
+    NULL, 0,
+    NULL, 0,
+};
+
+static const GRMustachePrecompiledTemplate template_layout = {
+    "shared/layout",
+    GRMustacheContentTypeHTML,
+    &block_layout,
+};
+
+static const GRMustachePrecompiledBlock block_page = {
+    NULL,
+    "{{<../shared/layout}}{{$content}}page{{/content}}{{/../shared/layout}}",
+    NULL, 0,
+    NULL, 0,
+    NULL, 0,
+};
+
+static const GRMustachePrecompiledTemplate template_page = {
+    "pages/page",
+    GRMustacheContentTypeHTML,
+    &block_page,
+};
+
+@interface GRMustachePrecompiledTemplateTest : GRMustachePrivateAPITest
+@end
+
+@implementation GRMustachePrecompiledTemplateTest
+
+- (GRMustacheTemplateRepository *)precompiledTemplateRepository
+{
+    GRMustacheTemplateRepository *repository = [GRMustacheTemplateRepository templateRepository];
+    [repository registerPrecompiledTemplate:&template_footer];
+    [repository registerPrecompiledTemplate:&template_list];
+    [repository registerPrecompiledTemplate:&template_layout];
+    [repository registerPrecompiledTemplate:&template_page];
+    return repository;
+}
+
+- (NSDictionary *)listData
+{
+    return @{ @"items": @[@{ @"name": @"<a>" }, @{ @"name": @"b" }], @"note": @"<b>" };
+}
+
+- (void)testPrecompiledTemplateRendersLikeCompiledTemplate
+{
+    GRMustacheTemplateRepository *compiledRepository = [GRMustacheTemplateRepository templateRepositoryWithDictionary:@{ @"footer": @"{{&note}}!", @"list": @"<ul>{{#items}}<li>{{name}}</li>{{/items}}</ul>{{>footer}}" }];
+    NSString *expectedRendering = [[compiledRepository templateNamed:@"list" error:NULL] renderObject:[self listData] error:NULL];
+    XCTAssertEqualObjects(expectedRendering, @"<ul><li>&lt;a&gt;</li><li>b</li></ul><b>!", @"");
+    
+    NSError *error;
+    GRMustacheTemplate *template = [[self precompiledTemplateRepository] templateNamed:@"list" error:&error];
+    XCTAssertNotNil(template, @"%@", error);
+    XCTAssertEqualObjects([template renderObject:[self listData] error:NULL], expectedRendering, @"");
+    XCTAssertEqualObjects([template renderObject:@{ @"items": @NO } error:NULL], @"<ul></ul>!", @"");
+}
+
+- (void)testPrecompiledTemplatesComeBeforeDataSourceTemplates
+{
+    GRMustacheTemplateRepository *repository = [GRMustacheTemplateRepository templateRepositoryWithDictionary:@{ @"footer": @"data source", @"other": @"{{>footer}}" }];
+    [repository registerPrecompiledTemplate:&template_footer];
+    
+    XCTAssertEqualObjects([[repository templateNamed:@"footer" error:NULL] renderObject:@{ @"note": @"<b>" } error:NULL], @"<b>!", @"");
+    XCTAssertEqualObjects([[repository templateNamed:@"other" error:NULL] renderObject:@{ @"note": @"<b>" } error:NULL], @"<b>!", @"");
+}
+
+- (void)testPrecompiledTemplatesAreLoadedOnce
+{
+    GRMustacheTemplateRepository *repository = [self precompiledTemplateRepository];
+    GRMustacheTemplateAST *templateAST1 = [repository templateASTNamed:@"list" relativeToTemplateID:nil error:NULL];
+    GRMustacheTemplateAST *templateAST2 = [repository templateASTNamed:@"list" relativeToTemplateID:nil error:NULL];
+    XCTAssertNotNil(templateAST1, @"");
+    XCTAssertTrue(templateAST1 == templateAST2, @"");
+}
+
+- (void)testPrecompiledSectionTagsRenderTheirContent
+{
+    id items = [GRMustacheRendering renderingObjectWithBlock:^NSString *(GRMustacheTag *tag, GRMustacheContext *context, BOOL *HTMLSafe, NSError **error) {
+        NSString *content = [tag renderContentWithContext:[context contextByAddingObject:@{ @"name": @"c" }] HTMLSafe:HTMLSafe error:error];
+        return [NSString stringWithFormat:@"%@%@", tag.innerTemplateString, content];
+    }];
+    GRMustacheTemplate *template = [[self precompiledTemplateRepository] templateNamed:@"list" error:NULL];
+    NSString *rendering = [template renderObject:@{ @"items": items } error:NULL];
+    XCTAssertEqualObjects(rendering, @"<ul><li>{{name}}</li><li>c</li></ul>!", @"");
+}
+
+- (void)testPrecompiledTemplatesUsingInheritanceAreCompiled
+{
+    NSError *error;
+    GRMustacheTemplate *template = [[self precompiledTemplateRepository] templateNamed:@"pages/page" error:&error];
+    XCTAssertNotNil(template, @"%@", error);
+    XCTAssertEqualObjects([template renderObject:nil error:NULL], @"<page>", @"");
+}
+
+- (void)testPrecompiledTemplatesReportMissingPartials
+{
+    GRMustacheTemplateRepository *repository = [GRMustacheTemplateRepository templateRepository];
+    [repository registerPrecompiledTemplate:&template_list];
+    
+    NSError *error;
+    GRMustacheTemplate *template = [repository templateNamed:@"list" error:&error];
+    XCTAssertNil(template, @"");
+    XCTAssertEqual(error.code, (NSInteger)GRMustacheErrorCodeTemplateNotFound, @"");
+}
+
+- (void)testSourceGeneratorGeneratesPrecompiledTemplates
+{
+    GRMustacheTemplateRepository *repository = [GRMustacheTemplateRepository templateRepositoryWithDictionary:@{ @"footer": @"{{&note}}!", @"list": @"<ul>{{#items}}<li>{{name}}</li>{{/items}}</ul>{{>footer}}" }];
+    GRMustacheSourceGenerator *sourceGenerator = [GRMustacheSourceGenerator sourceGeneratorWithTemplateRepository:repository];
+    NSError *error;
+    NSString *source = [sourceGenerator sourceWithTemplateNames:@[@"list", @"footer"] registrationFunctionName:@"RegisterTemplates" error:&error];
+    XCTAssertNotNil(source, @"%@", error);
+    
+    NSArray *expectedFragments = @[@"static BOOL render_0_0(GRMustachePrecompiledRendering *rendering)",
+                                   @"    return GRMustachePrecompiledRenderText(rendering, 0)\n        && GRMustachePrecompiledRenderTag(rendering, 0)\n        && GRMustachePrecompiledRenderText(rendering, 1)\n        && GRMustachePrecompiledRenderPartial(rendering, 0);",
+                                   @"    { \"<ul>\", 4 },",
+                                   @"    { GRMustachePrecompiledTagTypeSection, \"items\", 1, &block_0_1 },",
+                                   @"    { GRMustachePrecompiledTagTypeEscapedVariable, \"name\", 1, NULL },",
+                                   @"    { GRMustachePrecompiledTagTypeUnescapedVariable, \"note\", 1, NULL },",
+                                   @"static const char * const partials_0_0[] = {\n    \"footer\",\n};",
+                                   @"static const GRMustachePrecompiledTemplate template_1 = {\n    \"footer\",\n    GRMustacheContentTypeHTML,\n    &block_1_0,\n};",
+                                   @"void RegisterTemplates(GRMustacheTemplateRepository *templateRepository)\n{\n    [templateRepository registerPrecompiledTemplate:&template_0];\n    [templateRepository registerPrecompiledTemplate:&template_1];\n}"];
+    for (NSString *fragment in expectedFragments) {
+        XCTAssertTrue([source rangeOfString:fragment].location != NSNotFound, @"Missing %@", fragment);
+    }
+    
+    // Section blocks are defined before the tags that refer to them
+    XCTAssertTrue([source rangeOfString:@"block_0_1 = {"].location < [source rangeOfString:@"&block_0_1"].location, @"");
+}
+
+- (void)testSourceGeneratorEscapesStringLiterals
+{
+    GRMustacheTemplateRepository *repository = [GRMustacheTemplateRepository templateRepositoryWithDictionary:@{ @"text": @"a\"b\\c\n?é" }];
+    GRMustacheSourceGenerator *sourceGenerator = [GRMustacheSourceGenerator sourceGeneratorWithTemplateRepository:repository];
+    NSString *source = [sourceGenerator sourceWithTemplateNames:@[@"text"] registrationFunctionName:@"RegisterTemplates" error:NULL];
+    XCTAssertTrue([source rangeOfString:@"{ \"a\\\"b\\\\c\\n\"\n        \"\\?\\303\\251\", 9 }"].location != NSNotFound, @"");
+}
+
+- (void)testSourceGeneratorDoesNotPrecompileTemplatesUsingInheritance
+{
+    GRMustacheTemplateRepository *repository = [GRMustacheTemplateRepository templateRepositoryWithDictionary:@{ @"layout": @"<{{$content}}{{/content}}>", @"page": @"{{<layout}}{{/layout}}", @"partial": @"{{>page}}" }];
+    GRMustacheSourceGenerator *sourceGenerator = [GRMustacheSourceGenerator sourceGeneratorWithTemplateRepository:repository];
+    NSString *source = [sourceGenerator sourceWithTemplateNames:@[@"layout", @"page", @"partial"] registrationFunctionName:@"RegisterTemplates" error:NULL];
+    XCTAssertTrue([source rangeOfString:@"block_0_0 = {\n    NULL,\n    \"<{{$content}}{{/content}}>\","].location != NSNotFound, @"");
+    XCTAssertTrue([source rangeOfString:@"block_1_0 = {\n    NULL,"].location != NSNotFound, @"");
+    XCTAssertTrue([source rangeOfString:@"block_2_0 = {\n    NULL,"].location != NSNotFound, @"");
+    XCTAssertTrue([source rangeOfString:@"render_"].location == NSNotFound, @"");
+}
+
+- (void)testSourceGeneratorRequiresPartials
+{
+    GRMustacheTemplateRepository *repository = [GRMustacheTemplateRepository templateRepositoryWithDictionary:@{ @"footer": @"{{&note}}!", @"list": @"{{>footer}}" }];
+    GRMustacheSourceGenerator *sourceGenerator = [GRMustacheSourceGenerator sourceGeneratorWithTemplateRepository:repository];
+    NSError *error;
+    NSString *source = [sourceGenerator sourceWithTemplateNames:@[@"list"] registrationFunctionName:@"RegisterTemplates" error:&error];
+    XCTAssertNil(source, @"");
+    XCTAssertEqual(error.code, (NSInteger)GRMustacheErrorCodeTemplateNotFound, @"");
+}
+
+@end
@@ -0,0 +1,108 @@
+// The MIT License
+//
+// Copyright (c) 2014 Gwendal Roué
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#import "GRMustachePrivateAPITest.h"
+#import "GRMustacheTemplateASTOptimizer_private.h"
+#import "GRMustacheTemplate_private.h"
+#import "GRMustacheTemplateAST_private.h"
+#import "GRMustacheSectionTag_private.h"
+#import "GRMustacheTextNode_private.h"
+
+@interface GRMustacheTemplateASTOptimizerTest : GRMustachePrivateAPITest
+@end
+
+@implementation GRMustacheTemplateASTOptimizerTest
+
+- (void)setUp
+{
+    [super setUp];
+    GRMustacheTemplateASTOptimizerCurrentStatistics = (GRMustacheTemplateASTOptimizerStatistics){ 0 };
+}
+
+- (void)testAdjacentTextNodesAreMerged
+{
+    GRMustacheTemplate *template = [GRMustacheTemplate templateFromString:@"a{{! comment }}b{{=<% %>=}}c<%={{ }}=%>d{{name}}e{{!}}f" error:NULL];
+    NSArray *ASTNodes = template.templateAST.templateASTNodes;
+    XCTAssertEqual(ASTNodes.count, (NSUInteger)3, @"");
+    XCTAssertEqualObjects([(GRMustacheTextNode *)ASTNodes[0] text], @"abcd", @"");
+    XCTAssertEqualObjects([(GRMustacheTextNode *)ASTNodes[2] text], @"ef", @"");
+    XCTAssertEqualObjects([(GRMustacheTextNode *)ASTNodes[2] UTF8Data], [@"ef" dataUsingEncoding:NSUTF8StringEncoding], @"");
+    XCTAssertEqualObjects([template renderObject:@{ @"name": @"-" } error:NULL], @"abcd-ef", @"");
+    
+    XCTAssertEqual(GRMustacheTemplateASTOptimizerCurrentStatistics.nodeCountBeforeOptimization, (NSUInteger)7, @"");
+    XCTAssertEqual(GRMustacheTemplateASTOptimizerCurrentStatistics.nodeCountAfterOptimization, (NSUInteger)3, @"");
+    XCTAssertEqual(GRMustacheTemplateASTOptimizerCurrentStatistics.mergedTextNodeCount, (NSUInteger)4, @"");
+}
+
+- (void)testTextOnlyTemplateIsStatic
+{
+    GRMustacheTemplate *template = [GRMustacheTemplate templateFromString:@"a{{! comment }}b" error:NULL];
+    XCTAssertEqualObjects(template.templateAST.staticTextNode.text, @"ab", @"");
+    XCTAssertEqualObjects([template renderObject:nil error:NULL], @"ab", @"");
+    
+    template = [GRMustacheTemplate templateFromString:@"a{{name}}" error:NULL];
+    XCTAssertNil(template.templateAST.staticTextNode, @"");
+}
+
+- (void)testSectionWithTextOnlyContentIsStatic
+{
+    GRMustacheTemplate *template = [GRMustacheTemplate templateFromString:@"{{#items}}<li>{{! comment }}&amp;</li>{{/items}}{{^items}}{{/items}}" error:NULL];
+    GRMustacheSectionTag *sectionTag = template.templateAST.templateASTNodes[0];
+    XCTAssertEqualObjects(sectionTag.innerTemplateAST.staticTextNode.text, @"<li>&amp;</li>", @"");
+    GRMustacheSectionTag *invertedSectionTag = template.templateAST.templateASTNodes[1];
+    XCTAssertEqualObjects(invertedSectionTag.innerTemplateAST.staticTextNode.text, @"", @"");
+    XCTAssertEqual(GRMustacheTemplateASTOptimizerCurrentStatistics.staticTemplateASTCount, (NSUInteger)2, @"");
+    
+    XCTAssertEqualObjects([template renderObject:@{ @"items": @[@1, @2] } error:NULL], @"<li>&amp;</li><li>&amp;</li>", @"");
+    XCTAssertEqualObjects([template renderObject:@{ @"items": @YES } error:NULL], @"<li>&amp;</li>", @"");
+    XCTAssertEqualObjects([template renderObject:nil error:NULL], @"", @"");
+    XCTAssertEqualObjects([template renderDataWithObject:@{ @"items": @[@1] } encoding:NSUTF8StringEncoding error:NULL], [@"<li>&amp;</li>" dataUsingEncoding:NSUTF8StringEncoding], @"");
+}
+
+- (void)testStaticTextSectionRendersThroughRenderingObjects
+{
+    GRMustacheTemplate *template = [GRMustacheTemplate templateFromString:@"{{% CONTENT_TYPE:TEXT }}{{#wrap}}<&>{{/wrap}}" error:NULL];
+    id wrap = [GRMustacheRendering renderingObjectWithBlock:^NSString *(GRMustacheTag *tag, GRMustacheContext *context, BOOL *HTMLSafe, NSError **error) {
+        NSString *content = [tag renderContentWithContext:context HTMLSafe:HTMLSafe error:error];
+        return [NSString stringWithFormat:@"[%@]", content];
+    }];
+    XCTAssertEqualObjects([template renderObject:@{ @"wrap": wrap } error:NULL], @"[<&>]", @"");
+}
+
+- (void)testEqualTextNodesAreShared
+{
+    GRMustacheTemplate *template = [GRMustacheTemplate templateFromString:@"{{#a}}<li>{{/a}}{{#b}}<li>{{/b}}" error:NULL];
+    GRMustacheSectionTag *sectionTag1 = template.templateAST.templateASTNodes[0];
+    GRMustacheSectionTag *sectionTag2 = template.templateAST.templateASTNodes[1];
+    XCTAssertTrue(sectionTag1.innerTemplateAST.staticTextNode == sectionTag2.innerTemplateAST.staticTextNode, @"");
+    XCTAssertEqual(GRMustacheTemplateASTOptimizerCurrentStatistics.sharedTextNodeCount, (NSUInteger)1, @"");
+}
+
+- (void)testPartialsAreOptimizedOnce
+{
+    GRMustacheTemplateRepository *repository = [GRMustacheTemplateRepository templateRepositoryWithDictionary:@{ @"template": @"{{>partial}}{{>partial}}", @"partial": @"a{{!}}b" }];
+    GRMustacheTemplate *template = [repository templateNamed:@"template" error:NULL];
+    XCTAssertEqualObjects([template renderObject:nil error:NULL], @"abab", @"");
+    XCTAssertEqual(GRMustacheTemplateASTOptimizerCurrentStatistics.mergedTextNodeCount, (NSUInteger)1, @"");
+}
+
+@end
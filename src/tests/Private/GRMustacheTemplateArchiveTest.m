@@ -0,0 +1,146 @@
+// The MIT License
+//
+// Copyright (c) 2014 Gwendal Roué
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#import "GRMustachePrivateAPITest.h"
+#import "GRMustacheTemplateArchiveGenerator_private.h"
+#import "GRMustacheTemplateRepository_private.h"
+
+@interface GRMustacheTemplateArchiveTest : GRMustachePrivateAPITest
+@end
+
+@implementation GRMustacheTemplateArchiveTest
+
+- (NSDictionary *)templates
+{
+    return @{ @"footer": @"{{&note}}!",
+              @"static": @"Static text",
+              @"list": @"<ul>{{#items}}<li>{{name}}</li>{{^}}<li>none</li>{{/items}}</ul>{{>footer}}",
+              @"shared/layout": @"<{{$content}}default{{/content}}>{{>footer}}",
+              @"page": @"{{<shared/layout}}{{$content}}{{#items}}{{name}},{{/items}}{{/content}}{{/shared/layout}}" };
+}
+
+- (NSDictionary *)data
+{
+    return @{ @"items": @[@{ @"name": @"<a>" }, @{ @"name": @"b" }], @"note": @"<b>" };
+}
+
+- (NSString *)archivePathWithData:(NSData *)data
+{
+    NSString *path = [NSTemporaryDirectory() stringByAppendingPathComponent:[[NSProcessInfo processInfo] globallyUniqueString]];
+    [data writeToFile:path atomically:YES];
+    return path;
+}
+
+- (NSString *)archivePath
+{
+    GRMustacheTemplateRepository *repository = [GRMustacheTemplateRepository templateRepositoryWithDictionary:[self templates]];
+    GRMustacheTemplateArchiveGenerator *archiveGenerator = [GRMustacheTemplateArchiveGenerator templateArchiveGeneratorWithTemplateRepository:repository];
+    NSError *error;
+    NSData *data = [archiveGenerator archiveDataWithTemplateNames:[[[self templates] allKeys] sortedArrayUsingSelector:@selector(compare:)] error:&error];
+    XCTAssertNotNil(data, @"%@", error);
+    return [self archivePathWithData:data];
+}
+
+- (void)testArchivedTemplatesRenderLikeCompiledTemplates
+{
+    GRMustacheTemplateRepository *compiledRepository = [GRMustacheTemplateRepository templateRepositoryWithDictionary:[self templates]];
+    GRMustacheTemplateRepository *archiveRepository = [GRMustacheTemplateRepository templateRepository];
+    NSError *error;
+    XCTAssertTrue([archiveRepository registerTemplateArchiveAtPath:[self archivePath] error:&error], @"%@", error);
+    
+    for (NSString *name in @[@"list", @"page"]) {
+        for (id data in @[[self data], @{ @"items": @NO }]) {
+            NSString *expectedRendering = [[compiledRepository templateNamed:name error:NULL] renderObject:data error:NULL];
+            GRMustacheTemplate *template = [archiveRepository templateNamed:name error:&error];
+            XCTAssertNotNil(template, @"%@", error);
+            XCTAssertEqualObjects([template renderObject:data error:NULL], expectedRendering, @"");
+        }
+    }
+    XCTAssertEqualObjects([[archiveRepository templateNamed:@"list" error:NULL] renderObject:[self data] error:NULL], @"<ul><li>&lt;a&gt;</li><li>b</li></ul><b>!", @"");
+    XCTAssertEqualObjects([[archiveRepository templateNamed:@"page" error:NULL] renderObject:[self data] error:NULL], @"<&lt;a&gt;,b,><b>!", @"");
+}
+
+- (void)testRenderingsOutliveTheArchive
+{
+    // Templates that contain only text return texts of the archive as is.
+    NSString *rendering;
+    NSData *renderingData;
+    @autoreleasepool {
+        GRMustacheTemplateRepository *repository = [GRMustacheTemplateRepository templateRepository];
+        [repository registerTemplateArchiveAtPath:[self archivePath] error:NULL];
+        GRMustacheTemplate *template = [repository templateNamed:@"static" error:NULL];
+        rendering = [[template renderObject:nil error:NULL] retain];
+        renderingData = [[template renderDataWithObject:nil encoding:NSUTF8StringEncoding error:NULL] retain];
+    }
+    XCTAssertEqualObjects(rendering, @"Static text", @"");
+    XCTAssertEqualObjects(renderingData, [@"Static text" dataUsingEncoding:NSUTF8StringEncoding], @"");
+    [rendering release];
+    [renderingData release];
+}
+
+- (void)testArchivedTemplatesAreDecodedWhenLoaded
+{
+    GRMustacheTemplateRepository *repository = [GRMustacheTemplateRepository templateRepository];
+    [repository registerTemplateArchiveAtPath:[self archivePath] error:NULL];
+    XCTAssertEqual([repository cacheStatistics].templateCount, (NSUInteger)0, @"");
+    
+    GRMustacheTemplateAST *templateAST1 = [repository templateASTNamed:@"list" relativeToTemplateID:nil error:NULL];
+    GRMustacheTemplateAST *templateAST2 = [repository templateASTNamed:@"list" relativeToTemplateID:nil error:NULL];
+    XCTAssertNotNil(templateAST1, @"");
+    XCTAssertTrue(templateAST1 == templateAST2, @"");
+    XCTAssertEqual([repository cacheStatistics].templateCount, (NSUInteger)2, @"");   // list and footer
+}
+
+- (void)testArchivedTemplatesComeBeforeDataSourceTemplates
+{
+    GRMustacheTemplateRepository *repository = [GRMustacheTemplateRepository templateRepositoryWithDictionary:@{ @"footer": @"data source", @"other": @"{{>footer}}" }];
+    [repository registerTemplateArchiveAtPath:[self archivePath] error:NULL];
+    
+    XCTAssertEqualObjects([[repository templateNamed:@"footer" error:NULL] renderObject:@{ @"note": @"<b>" } error:NULL], @"<b>!", @"");
+    XCTAssertEqualObjects([[repository templateNamed:@"other" error:NULL] renderObject:@{ @"note": @"<b>" } error:NULL], @"<b>!", @"");
+}
+
+- (void)testArchivesMustContainPartials
+{
+    GRMustacheTemplateRepository *repository = [GRMustacheTemplateRepository templateRepositoryWithDictionary:[self templates]];
+    GRMustacheTemplateArchiveGenerator *archiveGenerator = [GRMustacheTemplateArchiveGenerator templateArchiveGeneratorWithTemplateRepository:repository];
+    NSError *error;
+    XCTAssertNil([archiveGenerator archiveDataWithTemplateNames:@[@"list"] error:&error], @"");
+    XCTAssertEqual(error.code, (NSInteger)GRMustacheErrorCodeTemplateNotFound, @"");
+}
+
+- (void)testInvalidArchivesAreRejected
+{
+    NSData *archiveData = [NSData dataWithContentsOfFile:[self archivePath]];
+    NSArray *invalidArchives = @[[@"not an archive" dataUsingEncoding:NSUTF8StringEncoding],
+                                 [archiveData subdataWithRange:NSMakeRange(0, archiveData.length / 2)]];
+    for (NSData *invalidArchive in invalidArchives) {
+        GRMustacheTemplateRepository *repository = [GRMustacheTemplateRepository templateRepository];
+        NSError *error;
+        XCTAssertFalse([repository registerTemplateArchiveAtPath:[self archivePathWithData:invalidArchive] error:&error], @"");
+        XCTAssertEqualObjects(error.domain, GRMustacheErrorDomain, @"");
+        XCTAssertEqual(error.code, (NSInteger)GRMustacheErrorCodeParseError, @"");
+        XCTAssertNil([repository templateNamed:@"list" error:NULL], @"");
+    }
+}
+
+@end
@@ -0,0 +1,282 @@
+// The MIT License
+//
+// Copyright (c) 2014 Gwendal Roué
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#import "GRMustachePrivateAPITest.h"
+#import "GRMustacheTemplateProgram_private.h"
+#import "GRMustacheRenderingEngine_private.h"
+#import "GRMustacheTemplate_private.h"
+#import "GRMustacheTemplateAST_private.h"
+#import "NSJSONSerialization+Comments.h"
+
+@interface GRMustacheTemplateProgramTestCustomRendering : NSObject<GRMustacheRendering>
+@end
+
+@implementation GRMustacheTemplateProgramTestCustomRendering
+
+- (NSString *)renderForMustacheTag:(GRMustacheTag *)tag context:(GRMustacheContext *)context HTMLSafe:(BOOL *)HTMLSafe error:(NSError **)error
+{
+    return @"<custom>";
+}
+
+@end
+
+@interface GRMustacheTemplateProgramTest : GRMustachePrivateAPITest
+@end
+
+@implementation GRMustacheTemplateProgramTest
+
+- (void)tearDown
+{
+    GRMustacheRenderingEngineExecutesTemplatePrograms = YES;
+    [super tearDown];
+}
+
+/**
+ * Returns the rendering, or the error description, of a template, when
+ * rendered by a template program, or by the visit of its template AST.
+ */
+- (NSString *)renderingOfTemplate:(GRMustacheTemplate *)template object:(id)object executesTemplatePrograms:(BOOL)executesTemplatePrograms
+{
+    GRMustacheRenderingEngineExecutesTemplatePrograms = executesTemplatePrograms;
+    NSError *error;
+    NSString *rendering = [template renderObject:object error:&error];
+    GRMustacheRenderingEngineExecutesTemplatePrograms = YES;
+    return rendering ?: [NSString stringWithFormat:@"Error: %@", error.localizedDescription];
+}
+
+- (void)assertTemplate:(GRMustacheTemplate *)template rendersObject:(id)object identicallyWithDescription:(NSString *)description
+{
+    NSString *visitorRendering = [self renderingOfTemplate:template object:object executesTemplatePrograms:NO];
+    NSString *programRendering = [self renderingOfTemplate:template object:object executesTemplatePrograms:YES];
+    XCTAssertEqualObjects(programRendering, visitorRendering, @"%@", description);
+}
+
+- (void)assertTemplateString:(NSString *)templateString rendersObject:(id)object identicallyAs:(NSString *)expectedRendering
+{
+    GRMustacheTemplate *template = [GRMustacheTemplate templateFromString:templateString error:NULL];
+    XCTAssertEqualObjects([self renderingOfTemplate:template object:object executesTemplatePrograms:NO], expectedRendering, @"");
+    XCTAssertEqualObjects([self renderingOfTemplate:template object:object executesTemplatePrograms:YES], expectedRendering, @"");
+}
+
+- (void)testSectionsAreInlined
+{
+    GRMustacheTemplate *template = [GRMustacheTemplate templateFromString:@"<{{#a}}{{b}}{{#c}}-{{/c}}{{/a}}>" error:NULL];
+    GRMustacheTemplateProgram *program = template.templateAST.program;
+    const GRMustacheInstruction *instructions = program.instructions;
+    
+    XCTAssertEqual(program.instructionCount, (NSUInteger)8, @"");
+    XCTAssertEqual(program.maximumSectionDepth, (NSUInteger)2, @"");
+    XCTAssertEqual(instructions[0].type, GRMustacheInstructionTypeText, @"");
+    XCTAssertEqual(instructions[1].type, GRMustacheInstructionTypeSection, @"");
+    XCTAssertEqual(instructions[1].target, (NSUInteger)7, @"");
+    XCTAssertEqual(instructions[2].type, GRMustacheInstructionTypeVariable, @"");
+    XCTAssertEqual(instructions[3].type, GRMustacheInstructionTypeSection, @"");
+    XCTAssertEqual(instructions[3].target, (NSUInteger)6, @"");
+    XCTAssertEqual(instructions[4].type, GRMustacheInstructionTypeText, @"");
+    XCTAssertEqual(instructions[5].type, GRMustacheInstructionTypeEndSection, @"");
+    XCTAssertEqual(instructions[5].target, (NSUInteger)4, @"");
+    XCTAssertEqual(instructions[6].type, GRMustacheInstructionTypeEndSection, @"");
+    XCTAssertEqual(instructions[6].target, (NSUInteger)2, @"");
+    XCTAssertEqual(instructions[7].type, GRMustacheInstructionTypeText, @"");
+}
+
+- (void)testBuiltInValuesInSections
+{
+    GRMustacheTemplate *template = [GRMustacheTemplate templateFromString:@"{{#v}}[{{.}}]{{/v}}{{^v}}!{{/v}}" error:NULL];
+    NSArray *values = @[[NSNull null], @0, @YES, @"", @"<>", @{ @"a": @1 }, @[], @[@1, @"a", [NSNull null], @[@2]], [NSSet setWithObject:@1], [NSOrderedSet orderedSetWithArray:@[@1, @2]]];
+    [self assertTemplate:template rendersObject:nil identicallyWithDescription:@"nil"];
+    for (id value in values) {
+        [self assertTemplate:template rendersObject:@{ @"v": value } identicallyWithDescription:[value description]];
+    }
+    
+    [self assertTemplateString:@"{{#v}}[{{.}}]{{/v}}" rendersObject:@{ @"v": @"<>" } identicallyAs:@"[&lt;&gt;]"];
+    [self assertTemplateString:@"{{#v}}[{{.}}]{{/v}}" rendersObject:@{ @"v": @[@1, @"a", [NSNull null], @[@2]] } identicallyAs:@"[1][a][][2]"];
+    [self assertTemplateString:@"{{#v}}[{{.}}]{{/v}}" rendersObject:@{ @"v": [NSOrderedSet orderedSetWithArray:@[@1, @2]] } identicallyAs:@"[1][2]"];
+    [self assertTemplateString:@"{{#v}}[{{.}}]{{/v}}{{^v}}!{{/v}}" rendersObject:@{ @"v": @[] } identicallyAs:@"!"];
+}
+
+- (void)testCustomRenderingObjectsInSections
+{
+    id custom = [[[GRMustacheTemplateProgramTestCustomRendering alloc] init] autorelease];
+    id block = [GRMustacheRendering renderingObjectWithBlock:^NSString *(GRMustacheTag *tag, GRMustacheContext *context, BOOL *HTMLSafe, NSError **error) {
+        *HTMLSafe = YES;
+        return @"<b>";
+    }];
+    
+    [self assertTemplateString:@"{{#v}}[{{.}}]{{/v}}" rendersObject:@{ @"v": custom } identicallyAs:@"&lt;custom&gt;"];
+    [self assertTemplateString:@"{{#v}}[{{.}}]{{/v}}" rendersObject:@{ @"v": block } identicallyAs:@"<b>"];
+    [self assertTemplateString:@"{{#v}}[{{.}}]{{/v}}" rendersObject:@{ @"v": @[@1, block, @2] } identicallyAs:@"[1]<b>[2]"];
+    
+    GRMustacheTemplate *template = [GRMustacheTemplate templateFromString:@"{{#v}}[{{.}}]{{/v}}" error:NULL];
+    [self assertTemplate:template rendersObject:@{ @"v": @[@1, custom, @2] } identicallyWithDescription:@""];
+}
+
+- (void)testTrustedDataDoesNotCheckHTMLEscapingConsistencyOfItems
+{
+    id safe = [GRMustacheRendering renderingObjectWithBlock:^NSString *(GRMustacheTag *tag, GRMustacheContext *context, BOOL *HTMLSafe, NSError **error) {
+        *HTMLSafe = YES;
+        return @"1";
+    }];
+    id unsafe = [GRMustacheRendering renderingObjectWithBlock:^NSString *(GRMustacheTag *tag, GRMustacheContext *context, BOOL *HTMLSafe, NSError **error) {
+        *HTMLSafe = NO;
+        return @"2";
+    }];
+    GRMustacheTemplateRepository *repository = [GRMustacheTemplateRepository templateRepository];
+    repository.configuration.rendersTrustedData = YES;
+    GRMustacheTemplate *template = [repository templateFromString:@"{{#items}}{{.}}{{/items}}" error:NULL];
+    id object = @{ @"items": @[safe, unsafe] };
+    XCTAssertEqualObjects([self renderingOfTemplate:template object:object executesTemplatePrograms:NO], @"12", @"");
+    XCTAssertEqualObjects([self renderingOfTemplate:template object:object executesTemplatePrograms:YES], @"12", @"");
+}
+
+- (void)testNestedRenderingsDuringExpressionEvaluation
+{
+    // The filter renders a template while `f(x).b.c` and `f(x).b` are
+    // evaluated: the outer evaluations must not lose their state.
+    GRMustacheTemplate *nestedTemplate = [GRMustacheTemplate templateFromString:@"{{#items}}{{d.e}}{{/items}}" error:NULL];
+    id filter = [GRMustacheFilter filterWithBlock:^id(id value) {
+        NSString *rendering = [nestedTemplate renderObject:@{ @"items": @[@{ @"d": @{ @"e": value } }, @{ @"d": @{ @"e": value } }] } error:NULL];
+        return @{ @"b": @{ @"c": rendering } };
+    }];
+    id object = @{ @"f": filter, @"x": @"x" };
+    [self assertTemplateString:@"{{f(x).b.c}}-{{#f(x).b}}{{c}}{{/}}" rendersObject:object identicallyAs:@"xx-xx"];
+}
+
+- (void)testErrorsInNestedSections
+{
+    id failingFilter = [GRMustacheFilter filterWithBlock:^id(id value) {
+        return [GRMustacheRendering renderingObjectWithBlock:^NSString *(GRMustacheTag *tag, GRMustacheContext *context, BOOL *HTMLSafe, NSError **error) {
+            if (error) {
+                *error = [NSError errorWithDomain:@"GRMustacheTemplateProgramTest" code:0 userInfo:@{ NSLocalizedDescriptionKey: @"failure" }];
+            }
+            return nil;
+        }];
+    }];
+    id data = @{ @"items": @[@1, @2], @"fail": failingFilter };
+    
+    GRMustacheTemplate *template = [GRMustacheTemplate templateFromString:@"{{#items}}{{#items}}{{fail(.)}}{{/items}}{{/items}}" error:NULL];
+    [self assertTemplate:template rendersObject:data identicallyWithDescription:@""];
+    XCTAssertNil([template renderObject:data error:NULL], @"");
+    
+    template = [GRMustacheTemplate templateFromString:@"{{#items}}{{#items}}{{#fail(.)}}{{/}}{{/items}}{{/items}}" error:NULL];
+    [self assertTemplate:template rendersObject:data identicallyWithDescription:@""];
+    XCTAssertNil([template renderObject:data error:NULL], @"");
+    
+    template = [GRMustacheTemplate templateFromString:@"{{#items}}{{#missing(.)}}{{/}}{{/items}}" error:NULL];
+    [self assertTemplate:template rendersObject:data identicallyWithDescription:@""];
+    XCTAssertNil([template renderObject:data error:NULL], @"");
+}
+
+- (void)testExceptionsInNestedSections
+{
+    id failingFilter = [GRMustacheFilter filterWithBlock:^id(id value) {
+        if ([value isEqual:@"raise"]) {
+            [NSException raise:@"GRMustacheTemplateProgramTest" format:@"%@", value];
+        }
+        return value;
+    }];
+    id unsafe = [GRMustacheRendering renderingObjectWithBlock:^NSString *(GRMustacheTag *tag, GRMustacheContext *context, BOOL *HTMLSafe, NSError **error) {
+        *HTMLSafe = NO;
+        return @"unsafe";
+    }];
+    GRMustacheTemplate *template = [GRMustacheTemplate templateFromString:@"{{#a}}{{#items}}<{{f(.)}}>{{/items}}{{/a}}{{name}}" error:NULL];
+    for (NSNumber *executesTemplatePrograms in @[@NO, @YES]) {
+        // Exception raised by a filter, and by the HTML escaping consistency
+        // check of an enumeration.
+        XCTAssertThrows([self renderingOfTemplate:template object:@{ @"a": @{ @"items": @[@"1", @"raise"] }, @"f": failingFilter } executesTemplatePrograms:[executesTemplatePrograms boolValue]], @"");
+        XCTAssertThrows([self renderingOfTemplate:template object:@{ @"a": @{ @"items": @[unsafe, @"1"] }, @"f": failingFilter } executesTemplatePrograms:[executesTemplatePrograms boolValue]], @"");
+        
+        // The context stack of the current thread is intact.
+        id object = @{ @"a": @{ @"items": @[@"1", @"2"], @"name": @"inner" }, @"f": failingFilter, @"name": @"outer" };
+        XCTAssertEqualObjects([self renderingOfTemplate:template object:object executesTemplatePrograms:[executesTemplatePrograms boolValue]], @"<1><2>outer", @"");
+    }
+}
+
+- (void)testTagDelegatesAndProtectedValues
+{
+    GRMustacheTestingDelegate *delegate = [[[GRMustacheTestingDelegate alloc] init] autorelease];
+    delegate.mustacheTagWillRenderObjectBlock = ^id(GRMustacheTag *tag, id object) {
+        return (tag.type == GRMustacheTagTypeVariable) ? [object uppercaseString] : object;
+    };
+    GRMustacheTemplate *template = [GRMustacheTemplate templateFromString:@"{{#items}}{{.}}{{/items}}{{#safe}}{{.name}}{{/safe}}" error:NULL];
+    [template extendBaseContextWithTagDelegate:delegate];
+    [template extendBaseContextWithProtectedObject:@{ @"safe": @{ @"name": @"s" } }];
+    [self assertTemplate:template rendersObject:@{ @"items": @[@"a", @"b"] } identicallyWithDescription:@""];
+    XCTAssertEqualObjects([template renderObject:@{ @"items": @[@"a", @"b"] } error:NULL], @"ABS", @"");
+}
+
+- (void)testJSONSuites
+{
+    // Render all JSON test suites with both template programs and visited
+    // template ASTs, and compare the results.
+    
+    NSArray *subdirectories = @[@"specs", @"GRMustacheSuites", @"GRMustacheSuites_7_2", @"GRHoganSuites"];
+    NSUInteger testCount = 0;
+    
+    for (NSString *subdirectory in subdirectories) {
+        NSString *directoryPath = [self.testBundle pathForResource:subdirectory ofType:nil];
+        XCTAssertNotNil(directoryPath, @"Missing test suites %@", subdirectory);
+        
+        for (NSString *name in [[NSFileManager defaultManager] contentsOfDirectoryAtPath:directoryPath error:NULL]) {
+            if (![[name pathExtension] isEqualToString:@"json"]) {
+                continue;
+            }
+            
+            NSString *path = [directoryPath stringByAppendingPathComponent:name];
+            NSDictionary *testSuite = [NSJSONSerialization JSONObjectWithCommentedData:[NSData dataWithContentsOfFile:path] options:0 error:NULL];
+            XCTAssertNotNil(testSuite, @"Could not load test suite at %@", path);
+            
+            for (NSDictionary *test in [testSuite objectForKey:@"tests"]) {
+                id data = [test objectForKey:@"data"];
+                NSString *templateString = [test objectForKey:@"template"];
+                NSString *templateName = [test objectForKey:@"template_name"];
+                NSDictionary *partials = [test objectForKey:@"partials"];
+                
+                GRMustacheTemplate *template;
+                if (templateName) {
+                    // Partials are referenced without their extension
+                    NSMutableDictionary *templates = [NSMutableDictionary dictionary];
+                    for (NSString *partialName in partials) {
+                        [templates setObject:[partials objectForKey:partialName] forKey:[partialName stringByDeletingPathExtension]];
+                    }
+                    GRMustacheTemplateRepository *repository = [GRMustacheTemplateRepository templateRepositoryWithDictionary:templates];
+                    template = [repository templateNamed:[templateName stringByDeletingPathExtension] error:NULL];
+                } else {
+                    GRMustacheTemplateRepository *repository = [GRMustacheTemplateRepository templateRepositoryWithDictionary:partials];
+                    template = [repository templateFromString:templateString error:NULL];
+                }
+                if (!template) {
+                    // Parsing and compiling errors do not involve rendering
+                    continue;
+                }
+                
+                NSString *description = [NSString stringWithFormat:@"test at %@: %@", path, [test objectForKey:@"name"]];
+                [self assertTemplate:template rendersObject:data identicallyWithDescription:description];
+                ++testCount;
+            }
+        }
+    }
+    
+    XCTAssertTrue(testCount > 0, @"");
+}
+
+@end
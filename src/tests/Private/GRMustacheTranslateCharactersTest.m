@@ -0,0 +1,169 @@
+// The MIT License
+//
+// Copyright (c) 2014 Gwendal Roué
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#import "GRMustachePrivateAPITest.h"
+#import "GRMustacheTranslateCharacters_private.h"
+
+@interface GRMustacheTranslateCharactersTest : GRMustachePrivateAPITest
+@end
+
+@implementation GRMustacheTranslateCharactersTest
+
+- (void)tearDown
+{
+    GRMustacheEscapeTableDisableSIMD = NO;
+    [super tearDown];
+}
+
+/**
+ * Returns a string of _length_ characters, with about _density_ percents of
+ * HTML-escapable characters.
+ */
+- (NSString *)stringWithLength:(NSUInteger)length escapableDensity:(NSUInteger)density nonASCII:(BOOL)nonASCII
+{
+    NSMutableString *string = [NSMutableString stringWithCapacity:length];
+    srandom(1);
+    for (NSUInteger i = 0; i < length; ++i) {
+        if ((NSUInteger)(random() % 100) < density) {
+            [string appendString:@[@"&", @"<", @">", @"\"", @"'"][random() % 5]];
+        } else if (nonASCII && i % 10 == 0) {
+            [string appendString:@"é"];
+        } else {
+            [string appendFormat:@"%c", (char)('a' + random() % 26)];
+        }
+    }
+    return [[string copy] autorelease];
+}
+
+- (NSString *)escapeHTMLWithFoundation:(NSString *)string
+{
+    string = [string stringByReplacingOccurrencesOfString:@"&" withString:@"&amp;"];
+    string = [string stringByReplacingOccurrencesOfString:@"<" withString:@"&lt;"];
+    string = [string stringByReplacingOccurrencesOfString:@">" withString:@"&gt;"];
+    string = [string stringByReplacingOccurrencesOfString:@"\"" withString:@"&quot;"];
+    string = [string stringByReplacingOccurrencesOfString:@"'" withString:@"&apos;"];
+    return string;
+}
+
+- (void)testVectorizedScanMatchesScalarScan
+{
+    const GRMustacheEscapeTable *table = GRMustacheHTMLEscapeTable();
+    for (NSUInteger length = 0; length < 80; ++length) {
+        for (NSUInteger position = 0; position <= length; ++position) {
+            UniChar characters[80];
+            char ASCIICharacters[80];
+            for (NSUInteger i = 0; i < length; ++i) {
+                characters[i] = (i == position) ? '<' : ((i % 3 == 0) ? 0x00E9 : 'a');
+                ASCIICharacters[i] = (i == position) ? '<' : 'a';
+            }
+            GRMustacheEscapeTableDisableSIMD = NO;
+            NSUInteger index = GRMustacheEscapeTableFindCharacter(table, characters, length);
+            NSUInteger ASCIIIndex = GRMustacheEscapeTableFindASCIICharacter(table, ASCIICharacters, length);
+            GRMustacheEscapeTableDisableSIMD = YES;
+            XCTAssertEqual(index, GRMustacheEscapeTableFindCharacter(table, characters, length), @"");
+            XCTAssertEqual(ASCIIIndex, GRMustacheEscapeTableFindASCIICharacter(table, ASCIICharacters, length), @"");
+            XCTAssertEqual(index, position, @"");
+            XCTAssertEqual(ASCIIIndex, position, @"");
+        }
+    }
+}
+
+- (void)testTranslateHTMLCharacters
+{
+    for (NSNumber *nonASCII in @[@NO, @YES]) {
+        for (NSNumber *density in @[@0, @1, @20, @100]) {
+            NSString *string = [self stringWithLength:1000 escapableDensity:density.unsignedIntegerValue nonASCII:nonASCII.boolValue];
+            NSString *expected = [self escapeHTMLWithFoundation:string];
+            XCTAssertEqualObjects(GRMustacheTranslateHTMLCharacters(string), expected, @"");
+            XCTAssertEqualObjects(GRMustacheTranslateHTMLCharacters([NSMutableString stringWithString:string]), expected, @"");
+        }
+    }
+    
+    NSString *string = @"foo";
+    XCTAssertTrue(GRMustacheTranslateHTMLCharacters(string) == string, @"");
+}
+
+- (void)testAppendEscapedStringIntoByteBuffer
+{
+    NSString *string = [NSString stringWithFormat:@"%@ 🍮 %@", [self stringWithLength:1000 escapableDensity:20 nonASCII:YES], [self stringWithLength:1000 escapableDensity:20 nonASCII:NO]];
+    NSString *expected = [self escapeHTMLWithFoundation:string];
+    
+    GRMustacheBuffer buffer = GRMustacheBufferCreateWithEncoding(16, kCFStringEncodingUTF8);
+    GRMustacheBufferAppendHTMLEscapedString(&buffer, string);
+    NSData *data = GRMustacheBufferGetDataAndRelease(&buffer);
+    XCTAssertEqualObjects(data, [expected dataUsingEncoding:NSUTF8StringEncoding], @"");
+}
+
+- (void)testJavascriptEscaping
+{
+    GRMustacheTemplate *template = [GRMustacheTemplate templateFromString:@"{{javascript.escape(value)}}" error:NULL];
+    NSString *rendering = [template renderObject:@{ @"value": [NSString stringWithFormat:@"a%Cb%C<\n", (unichar)0x2028, (unichar)0x2029] } error:NULL];
+    XCTAssertEqualObjects(rendering, @"a\\u2028b\\u2029\\u003C\\u000A", @"");
+}
+
+
+#pragma mark - Benchmarks
+
+- (void)measureHTMLEscapingWithLength:(NSUInteger)length escapableDensity:(NSUInteger)density
+{
+    NSString *string = [self stringWithLength:length escapableDensity:density nonASCII:YES];
+    NSUInteger iterations = 10000000 / length;
+    [self measureBlock:^{
+        GRMustacheBuffer buffer = GRMustacheBufferCreate(1024);
+        for (NSUInteger i = 0; i < iterations; ++i) {
+            GRMustacheBufferAppendHTMLEscapedString(&buffer, string);
+        }
+        GRMustacheBufferRelease(&buffer);
+    }];
+}
+
+- (void)testShortValueWithoutEscapingBenchmark
+{
+    [self measureHTMLEscapingWithLength:20 escapableDensity:0];
+}
+
+- (void)testShortValueWithSparseEscapingBenchmark
+{
+    [self measureHTMLEscapingWithLength:20 escapableDensity:1];
+}
+
+- (void)testShortValueWithDenseEscapingBenchmark
+{
+    [self measureHTMLEscapingWithLength:20 escapableDensity:20];
+}
+
+- (void)testLongValueWithoutEscapingBenchmark
+{
+    [self measureHTMLEscapingWithLength:10000 escapableDensity:0];
+}
+
+- (void)testLongValueWithSparseEscapingBenchmark
+{
+    [self measureHTMLEscapingWithLength:10000 escapableDensity:1];
+}
+
+- (void)testLongValueWithDenseEscapingBenchmark
+{
+    [self measureHTMLEscapingWithLength:10000 escapableDensity:20];
+}
+
+@end
@@ -0,0 +1,125 @@
+// The MIT License
+//
+// Copyright (c) 2014 Gwendal Roué
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#import "GRMustachePrivateAPITest.h"
+#import "GRMustacheConfiguration_private.h"
+#import "GRMustacheContext_private.h"
+#import "NSJSONSerialization+Comments.h"
+
+@interface GRMustacheTrustedDataTest : GRMustachePrivateAPITest
+@end
+
+@implementation GRMustacheTrustedDataTest
+
+/**
+ * Returns an array of [template, data] pairs built from the JSON test suites
+ * found in the provided subdirectories of the test bundle.
+ */
+- (NSArray *)renderingsOfSuitesInSubdirectories:(NSArray *)subdirectories rendersTrustedData:(BOOL)rendersTrustedData
+{
+    NSMutableArray *renderings = [NSMutableArray array];
+    for (NSString *subdirectory in subdirectories) {
+        NSString *directoryPath = [self.testBundle pathForResource:subdirectory ofType:nil];
+        XCTAssertNotNil(directoryPath, @"Missing test suites %@", subdirectory);
+        
+        for (NSString *name in [[NSFileManager defaultManager] contentsOfDirectoryAtPath:directoryPath error:NULL]) {
+            if (![[name pathExtension] isEqualToString:@"json"]) {
+                continue;
+            }
+            
+            NSString *path = [directoryPath stringByAppendingPathComponent:name];
+            NSDictionary *testSuite = [NSJSONSerialization JSONObjectWithCommentedData:[NSData dataWithContentsOfFile:path] options:0 error:NULL];
+            for (NSDictionary *test in [testSuite objectForKey:@"tests"]) {
+                if ([test objectForKey:@"template_name"]) {
+                    continue;
+                }
+                GRMustacheTemplateRepository *repository = [GRMustacheTemplateRepository templateRepositoryWithDictionary:[test objectForKey:@"partials"]];
+                repository.configuration.rendersTrustedData = rendersTrustedData;
+                GRMustacheTemplate *template = [repository templateFromString:[test objectForKey:@"template"] error:NULL];
+                if (template) {
+                    [renderings addObject:@[template, [test objectForKey:@"data"] ?: [NSNull null]]];
+                }
+            }
+        }
+    }
+    XCTAssertTrue(renderings.count > 0, @"");
+    return renderings;
+}
+
+- (void)renderSuiteRenderings:(NSArray *)renderings count:(NSUInteger)count
+{
+    for (NSUInteger i = 0; i < count; ++i) {
+        @autoreleasepool {
+            for (NSArray *rendering in renderings) {
+                [[rendering objectAtIndex:0] renderObject:[rendering objectAtIndex:1] error:NULL];
+            }
+        }
+    }
+}
+
+- (void)testTrustedDataContextsDeriveTrustedDataContexts
+{
+    GRMustacheContext *context = [[GRMustacheContext contextWithObject:@{ @"a": @"a" }] contextWithTrustedData];
+    XCTAssertTrue(context.trustedData, @"");
+    XCTAssertTrue(context.unsafeKeyAccess, @"");
+    XCTAssertTrue([context contextByAddingObject:@{}].trustedData, @"");
+    XCTAssertTrue([context contextByAddingProtectedObject:@{}].trustedData, @"");
+    XCTAssertTrue([context contextWithUnsafeKeyAccess].trustedData, @"");
+    
+    GRMustacheContext *frame = [context pushContextFrameWithObject:@{}];
+    XCTAssertTrue(frame.trustedData, @"");
+    XCTAssertTrue([frame materializedContext].trustedData, @"");
+    [frame popContextFrame];
+    
+    XCTAssertFalse([GRMustacheContext contextWithUnsafeKeyAccess].trustedData, @"");
+}
+
+- (void)testSpecSuitesRenderIdenticallyWithTrustedData
+{
+    NSArray *renderings = [self renderingsOfSuitesInSubdirectories:@[@"specs"] rendersTrustedData:NO];
+    NSArray *trustedRenderings = [self renderingsOfSuitesInSubdirectories:@[@"specs"] rendersTrustedData:YES];
+    XCTAssertEqual(renderings.count, trustedRenderings.count, @"");
+    for (NSUInteger i = 0; i < renderings.count; ++i) {
+        NSArray *rendering = [renderings objectAtIndex:i];
+        NSArray *trustedRendering = [trustedRenderings objectAtIndex:i];
+        XCTAssertEqualObjects([[trustedRendering objectAtIndex:0] renderObject:[trustedRendering objectAtIndex:1] error:NULL],
+                              [[rendering objectAtIndex:0] renderObject:[rendering objectAtIndex:1] error:NULL], @"");
+    }
+}
+
+- (void)testSuitesPerformance
+{
+    NSArray *renderings = [self renderingsOfSuitesInSubdirectories:@[@"specs", @"GRMustacheSuites"] rendersTrustedData:NO];
+    [self measureBlock:^{
+        [self renderSuiteRenderings:renderings count:100];
+    }];
+}
+
+- (void)testSuitesPerformanceWithTrustedData
+{
+    NSArray *renderings = [self renderingsOfSuitesInSubdirectories:@[@"specs", @"GRMustacheSuites"] rendersTrustedData:YES];
+    [self measureBlock:^{
+        [self renderSuiteRenderings:renderings count:100];
+    }];
+}
+
+@end
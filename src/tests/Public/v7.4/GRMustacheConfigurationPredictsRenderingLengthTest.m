@@ -0,0 +1,64 @@
+// The MIT License
+//
+// Copyright (c) 2014 Gwendal Roué
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#define GRMUSTACHE_VERSION_MAX_ALLOWED GRMUSTACHE_VERSION_7_4
+#import "GRMustachePublicAPITest.h"
+
+@interface GRMustacheConfigurationPredictsRenderingLengthTest : GRMustachePublicAPITest
+@end
+
+@implementation GRMustacheConfigurationPredictsRenderingLengthTest
+
+- (void)testFactoryConfigurationPredictsRenderingLength
+{
+    GRMustacheConfiguration *configuration = [GRMustacheConfiguration configuration];
+    XCTAssertTrue(configuration.predictsRenderingLength, @"");
+}
+
+- (void)testConfigurationCopyKeepsPredictsRenderingLength
+{
+    GRMustacheConfiguration *configuration = [GRMustacheConfiguration configuration];
+    configuration.predictsRenderingLength = NO;
+    GRMustacheConfiguration *copy = [[configuration copy] autorelease];
+    XCTAssertFalse(copy.predictsRenderingLength, @"");
+}
+
+- (void)testRenderingIsIndependentFromPredictsRenderingLength
+{
+    for (NSUInteger i = 0; i < 2; ++i) {
+        GRMustacheTemplateRepository *repo = [GRMustacheTemplateRepository templateRepository];
+        repo.configuration.predictsRenderingLength = (i == 0);
+        GRMustacheTemplate *template = [repo templateFromString:@"{{#items}}<{{.}}>{{/items}}" error:NULL];
+        XCTAssertEqualObjects([template renderObject:@{ @"items": @[@1, @2, @3] } error:NULL], @"&lt;1&gt;&lt;2&gt;&lt;3&gt;", @"");
+        XCTAssertEqualObjects([template renderObject:@{ @"items": @[@4] } error:NULL], @"&lt;4&gt;", @"");
+        XCTAssertEqualObjects([template renderObject:@{ @"items": @[@5, @6, @7, @8] } error:NULL], @"&lt;5&gt;&lt;6&gt;&lt;7&gt;&lt;8&gt;", @"");
+    }
+}
+
+- (void)testLockedConfigurationPredictsRenderingLengthCanNotBeMutated
+{
+    GRMustacheTemplateRepository *repo = [GRMustacheTemplateRepository templateRepository];
+    [repo templateFromString:@"" error:NULL];
+    XCTAssertThrows([repo.configuration setPredictsRenderingLength:NO], @"");
+}
+
+@end
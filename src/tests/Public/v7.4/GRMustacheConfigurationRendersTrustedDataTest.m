@@ -0,0 +1,105 @@
+// The MIT License
+//
+// Copyright (c) 2014 Gwendal Roué
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#define GRMUSTACHE_VERSION_MAX_ALLOWED GRMUSTACHE_VERSION_7_4
+#import "GRMustachePublicAPITest.h"
+
+@interface GRMustacheConfigurationRendersTrustedDataTest_Model : NSObject
+- (NSString *)method;
+@end
+
+@implementation GRMustacheConfigurationRendersTrustedDataTest_Model
+
+- (NSString *)method
+{
+    return @"method";
+}
+
+@end
+
+@interface GRMustacheConfigurationRendersTrustedDataTest : GRMustachePublicAPITest
+@end
+
+@implementation GRMustacheConfigurationRendersTrustedDataTest
+
+- (void)testFactoryConfigurationDoesNotRenderTrustedData
+{
+    GRMustacheConfiguration *configuration = [GRMustacheConfiguration configuration];
+    XCTAssertFalse(configuration.rendersTrustedData, @"");
+}
+
+- (void)testConfigurationCopyKeepsRendersTrustedData
+{
+    GRMustacheConfiguration *configuration = [GRMustacheConfiguration configuration];
+    configuration.rendersTrustedData = YES;
+    GRMustacheConfiguration *copy = [[configuration copy] autorelease];
+    XCTAssertTrue(copy.rendersTrustedData, @"");
+}
+
+- (void)testLockedConfigurationRendersTrustedDataCanNotBeMutated
+{
+    GRMustacheTemplateRepository *repo = [GRMustacheTemplateRepository templateRepository];
+    [repo templateFromString:@"" error:NULL];
+    XCTAssertThrows([repo.configuration setRendersTrustedData:YES], @"");
+}
+
+- (void)testTrustedDataHasUnsafeKeyAccess
+{
+    id data = @{ @"model": [[[GRMustacheConfigurationRendersTrustedDataTest_Model alloc] init] autorelease] };
+    for (NSUInteger i = 0; i < 2; ++i) {
+        GRMustacheTemplateRepository *repo = [GRMustacheTemplateRepository templateRepository];
+        repo.configuration.rendersTrustedData = (i == 1);
+        GRMustacheTemplate *template = [repo templateFromString:@"<{{model.method}}>{{#model}}<{{method}}>{{/model}}" error:NULL];
+        XCTAssertEqual(template.baseContext.unsafeKeyAccess, (BOOL)(i == 1), @"");
+        NSString *rendering = [template renderObject:data error:NULL];
+        XCTAssertEqualObjects(rendering, (i == 1) ? @"<method><method>" : @"<><>", @"");
+    }
+}
+
+- (void)testTrustedDataRendersMissingKeys
+{
+    id data = @{ @"model": [[[GRMustacheConfigurationRendersTrustedDataTest_Model alloc] init] autorelease], @"name": @"name" };
+    GRMustacheTemplateRepository *repo = [GRMustacheTemplateRepository templateRepository];
+    repo.configuration.rendersTrustedData = YES;
+    GRMustacheTemplate *template = [repo templateFromString:@"{{#model}}{{name}}{{missing}}{{/model}}" error:NULL];
+    XCTAssertEqualObjects([template renderObject:data error:NULL], @"name", @"");
+}
+
+- (void)testTrustedDataDoesNotCheckHTMLEscapingConsistency
+{
+    id object1 = [GRMustacheRendering renderingObjectWithBlock:^NSString *(GRMustacheTag *tag, GRMustacheContext *context, BOOL *HTMLSafe, NSError **error) {
+        *HTMLSafe = YES;
+        return @"1";
+    }];
+    id object2 = [GRMustacheRendering renderingObjectWithBlock:^NSString *(GRMustacheTag *tag, GRMustacheContext *context, BOOL *HTMLSafe, NSError **error) {
+        *HTMLSafe = NO;
+        return @"2";
+    }];
+    id data = @{@"items": @[object1, object2] };
+    
+    GRMustacheTemplateRepository *repo = [GRMustacheTemplateRepository templateRepository];
+    repo.configuration.rendersTrustedData = YES;
+    XCTAssertEqualObjects([[repo templateFromString:@"{{items}}" error:NULL] renderObject:data error:NULL], @"12", @"");
+    XCTAssertEqualObjects([[repo templateFromString:@"{{#items}}{{.}}{{/items}}" error:NULL] renderObject:data error:NULL], @"12", @"");
+}
+
+@end
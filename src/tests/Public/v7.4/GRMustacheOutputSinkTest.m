@@ -0,0 +1,198 @@
+// The MIT License
+//
+// Copyright (c) 2014 Gwendal Roué
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#define GRMUSTACHE_VERSION_MAX_ALLOWED GRMUSTACHE_VERSION_7_4
+#import "GRMustachePublicAPITest.h"
+
+@interface GRMustacheOutputSinkTestSink : NSObject<GRMustacheOutputSink>
+@property (nonatomic, retain) NSMutableData *data;
+@property (nonatomic) NSUInteger writeCount;
+@property (nonatomic) BOOL fails;
+@end
+
+@implementation GRMustacheOutputSinkTestSink
+
+- (void)dealloc
+{
+    [_data release];
+    [super dealloc];
+}
+
+- (instancetype)init
+{
+    self = [super init];
+    if (self) {
+        _data = [[NSMutableData alloc] init];
+    }
+    return self;
+}
+
+- (BOOL)writeBytes:(const uint8_t *)bytes length:(NSUInteger)length error:(NSError **)error
+{
+    if (_fails) {
+        if (error != NULL) {
+            *error = [NSError errorWithDomain:@"GRMustacheOutputSinkTestSink" code:0 userInfo:nil];
+        }
+        return NO;
+    }
+    ++_writeCount;
+    [_data appendBytes:bytes length:length];
+    return YES;
+}
+
+@end
+
+@interface GRMustacheOutputSinkTest : GRMustachePublicAPITest
+@end
+
+@implementation GRMustacheOutputSinkTest
+
+- (void)testRenderObjectToSink
+{
+    GRMustacheTemplate *template = [GRMustacheTemplate templateFromString:@"<{{name}}>" error:NULL];
+    GRMustacheOutputSinkTestSink *sink = [[[GRMustacheOutputSinkTestSink alloc] init] autorelease];
+    NSError *error;
+    BOOL success = [template renderObject:@{ @"name": @"Élodie & Cie" } toSink:sink error:&error];
+    XCTAssertTrue(success, @"");
+    NSString *rendering = [[[NSString alloc] initWithData:sink.data encoding:NSUTF8StringEncoding] autorelease];
+    XCTAssertEqualObjects(rendering, @"<Élodie &amp; Cie>", @"");
+}
+
+- (void)testRenderObjectsFromArrayToSink
+{
+    GRMustacheTemplate *template = [GRMustacheTemplate templateFromString:@"{{a}}{{b}}" error:NULL];
+    GRMustacheOutputSinkTestSink *sink = [[[GRMustacheOutputSinkTestSink alloc] init] autorelease];
+    BOOL success = [template renderObjectsFromArray:@[@{ @"a": @"a" }, @{ @"b": @"b" }] toSink:sink error:NULL];
+    XCTAssertTrue(success, @"");
+    NSString *rendering = [[[NSString alloc] initWithData:sink.data encoding:NSUTF8StringEncoding] autorelease];
+    XCTAssertEqualObjects(rendering, @"ab", @"");
+}
+
+- (void)testLargeRenderingIsWrittenByChunks
+{
+    NSMutableArray *items = [NSMutableArray array];
+    for (NSUInteger i = 0; i < 10000; ++i) {
+        [items addObject:@{ @"name": [NSString stringWithFormat:@"item%lu", (unsigned long)i] }];
+    }
+    GRMustacheTemplate *template = [GRMustacheTemplate templateFromString:@"{{#items}}<li>{{name}}</li>{{/items}}{{#items}}<li>{{name}}</li>{{/items}}" error:NULL];
+    NSString *expected = [template renderObject:@{ @"items": items } error:NULL];
+    
+    GRMustacheOutputSinkTestSink *sink = [[[GRMustacheOutputSinkTestSink alloc] init] autorelease];
+    BOOL success = [template renderObject:@{ @"items": items } toSink:sink error:NULL];
+    XCTAssertTrue(success, @"");
+    XCTAssertTrue(sink.writeCount > 1, @"");
+    NSString *rendering = [[[NSString alloc] initWithData:sink.data encoding:NSUTF8StringEncoding] autorelease];
+    XCTAssertEqualObjects(rendering, expected, @"");
+}
+
+- (void)testLargeSectionIsWrittenByChunks
+{
+    NSMutableArray *items = [NSMutableArray array];
+    for (NSUInteger i = 0; i < 10000; ++i) {
+        [items addObject:@{ @"name": [NSString stringWithFormat:@"item%lu", (unsigned long)i] }];
+    }
+    GRMustacheTemplate *template = [GRMustacheTemplate templateFromString:@"{{#items}}<li>{{#name}}{{.}}{{/name}}</li>{{/items}}" error:NULL];
+    NSString *expected = [template renderObject:@{ @"items": items } error:NULL];
+    
+    GRMustacheOutputSinkTestSink *sink = [[[GRMustacheOutputSinkTestSink alloc] init] autorelease];
+    BOOL success = [template renderObject:@{ @"items": items } toSink:sink error:NULL];
+    XCTAssertTrue(success, @"");
+    XCTAssertTrue(sink.writeCount > 1, @"");
+    NSString *rendering = [[[NSString alloc] initWithData:sink.data encoding:NSUTF8StringEncoding] autorelease];
+    XCTAssertEqualObjects(rendering, expected, @"");
+}
+
+- (void)testLargeTextPartialIsEscapedAndWrittenByChunks
+{
+    NSMutableArray *items = [NSMutableArray array];
+    for (NSUInteger i = 0; i < 10000; ++i) {
+        [items addObject:@{ @"name": [NSString stringWithFormat:@"<item%lu>", (unsigned long)i] }];
+    }
+    GRMustacheTemplateRepository *repository = [GRMustacheTemplateRepository templateRepositoryWithDictionary:@{ @"main": @"<ul>{{>text}}</ul>",
+                                                                                                                 @"text": @"{{%CONTENT_TYPE:TEXT}}{{#items}}{{name}} & 😀{{/items}}" }];
+    GRMustacheTemplate *template = [repository templateNamed:@"main" error:NULL];
+    
+    GRMustacheOutputSinkTestSink *sink = [[[GRMustacheOutputSinkTestSink alloc] init] autorelease];
+    BOOL success = [template renderObject:@{ @"items": items } toSink:sink error:NULL];
+    XCTAssertTrue(success, @"");
+    XCTAssertTrue(sink.writeCount > 1, @"");
+    
+    NSMutableString *expected = [NSMutableString stringWithString:@"<ul>"];
+    for (NSUInteger i = 0; i < 10000; ++i) {
+        [expected appendFormat:@"&lt;item%lu&gt; &amp; 😀", (unsigned long)i];
+    }
+    [expected appendString:@"</ul>"];
+    NSString *rendering = [[[NSString alloc] initWithData:sink.data encoding:NSUTF8StringEncoding] autorelease];
+    XCTAssertEqualObjects(rendering, expected, @"");
+    XCTAssertEqualObjects([template renderObject:@{ @"items": items } error:NULL], expected, @"");
+}
+
+- (void)testSinkErrorIsReported
+{
+    GRMustacheTemplate *template = [GRMustacheTemplate templateFromString:@"foo" error:NULL];
+    GRMustacheOutputSinkTestSink *sink = [[[GRMustacheOutputSinkTestSink alloc] init] autorelease];
+    sink.fails = YES;
+    NSError *error;
+    BOOL success = [template renderObject:nil toSink:sink error:&error];
+    XCTAssertFalse(success, @"");
+    XCTAssertEqualObjects(error.domain, @"GRMustacheOutputSinkTestSink", @"");
+}
+
+- (void)testRenderingErrorIsReported
+{
+    GRMustacheTemplate *template = [GRMustacheTemplate templateFromString:@"{{f(x)}}" error:NULL];
+    GRMustacheOutputSinkTestSink *sink = [[[GRMustacheOutputSinkTestSink alloc] init] autorelease];
+    NSError *error;
+    BOOL success = [template renderObject:nil toSink:sink error:&error];
+    XCTAssertFalse(success, @"");
+    XCTAssertEqualObjects(error.domain, GRMustacheErrorDomain, @"");
+    XCTAssertEqual(error.code, (NSInteger)GRMustacheErrorCodeRenderingError, @"");
+}
+
+- (void)testOutputStreamSink
+{
+    NSOutputStream *outputStream = [NSOutputStream outputStreamToMemory];
+    [outputStream open];
+    GRMustacheTemplate *template = [GRMustacheTemplate templateFromString:@"<{{name}}>" error:NULL];
+    BOOL success = [template renderObject:@{ @"name": @"Arthur" } toSink:[GRMustacheOutputSink outputSinkWithOutputStream:outputStream] error:NULL];
+    XCTAssertTrue(success, @"");
+    NSData *data = [outputStream propertyForKey:NSStreamDataWrittenToMemoryStreamKey];
+    [outputStream close];
+    NSString *rendering = [[[NSString alloc] initWithData:data encoding:NSUTF8StringEncoding] autorelease];
+    XCTAssertEqualObjects(rendering, @"<Arthur>", @"");
+}
+
+- (void)testFileDescriptorSink
+{
+    NSString *path = [NSTemporaryDirectory() stringByAppendingPathComponent:[[NSProcessInfo processInfo] globallyUniqueString]];
+    [[NSFileManager defaultManager] createFileAtPath:path contents:nil attributes:nil];
+    NSFileHandle *fileHandle = [NSFileHandle fileHandleForWritingAtPath:path];
+    GRMustacheTemplate *template = [GRMustacheTemplate templateFromString:@"<{{name}}>" error:NULL];
+    BOOL success = [template renderObject:@{ @"name": @"Arthur" } toSink:[GRMustacheOutputSink outputSinkWithFileDescriptor:[fileHandle fileDescriptor]] error:NULL];
+    XCTAssertTrue(success, @"");
+    [fileHandle closeFile];
+    NSString *rendering = [NSString stringWithContentsOfFile:path encoding:NSUTF8StringEncoding error:NULL];
+    [[NSFileManager defaultManager] removeItemAtPath:path error:NULL];
+    XCTAssertEqualObjects(rendering, @"<Arthur>", @"");
+}
+
+@end
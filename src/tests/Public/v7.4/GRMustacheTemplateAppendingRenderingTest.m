@@ -0,0 +1,84 @@
+// The MIT License
+//
+// Copyright (c) 2014 Gwendal Roué
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#define GRMUSTACHE_VERSION_MAX_ALLOWED GRMUSTACHE_VERSION_7_4
+#import "GRMustachePublicAPITest.h"
+
+@interface GRMustacheTemplateAppendingRenderingTest : GRMustachePublicAPITest
+@end
+
+@implementation GRMustacheTemplateAppendingRenderingTest
+
+- (void)testRenderObjectAppendingToString
+{
+    GRMustacheTemplate *template = [GRMustacheTemplate templateFromString:@"{{name}}{{#items}}, {{.}}{{/items}}" error:NULL];
+    NSMutableString *rendering = [NSMutableString stringWithString:@"Crème "];
+    XCTAssertTrue([template renderObject:@{ @"name": @"brûlée & café", @"items": @[@1, @"☕"] } appendingToString:rendering error:NULL], @"");
+    XCTAssertEqualObjects(rendering, @"Crème brûlée &amp; café, 1, ☕", @"");
+    XCTAssertTrue([template renderObject:@{ @"name": @"!" } appendingToString:rendering error:NULL], @"");
+    XCTAssertEqualObjects(rendering, @"Crème brûlée &amp; café, 1, ☕!", @"");
+}
+
+- (void)testRenderObjectAppendingToStringReusesString
+{
+    GRMustacheTemplate *template = [GRMustacheTemplate templateFromString:@"<{{.}}>" error:NULL];
+    NSMutableString *rendering = [NSMutableString string];
+    for (NSUInteger i = 0; i < 100; ++i) {
+        [rendering setString:@""];
+        XCTAssertTrue([template renderObject:@(i) appendingToString:rendering error:NULL], @"");
+        XCTAssertEqualObjects(rendering, ([NSString stringWithFormat:@"<%lu>", (unsigned long)i]), @"");
+    }
+}
+
+- (void)testRenderObjectAppendingToStringLeavesStringUntouchedOnError
+{
+    GRMustacheTemplate *template = [GRMustacheTemplate templateFromString:@"foo{{f(x)}}" error:NULL];
+    NSMutableString *rendering = [NSMutableString stringWithString:@"bar"];
+    NSError *error;
+    XCTAssertFalse([template renderObject:nil appendingToString:rendering error:&error], @"");
+    XCTAssertEqual(error.code, (NSInteger)GRMustacheErrorCodeRenderingError, @"");
+    XCTAssertEqualObjects(rendering, @"bar", @"");
+}
+
+- (void)testRenderObjectAppendingToData
+{
+    GRMustacheTemplate *template = [GRMustacheTemplate templateFromString:@"{{name}} {{{raw}}}" error:NULL];
+    id data = @{ @"name": @"brûlée & café", @"raw": @"<b>" };
+    NSStringEncoding encodings[] = { NSUTF8StringEncoding, NSUTF16LittleEndianStringEncoding };
+    for (size_t i = 0; i < sizeof(encodings) / sizeof(NSStringEncoding); ++i) {
+        NSMutableData *rendering = [NSMutableData dataWithData:[@"Crème " dataUsingEncoding:encodings[i]]];
+        XCTAssertTrue([template renderObject:data appendingToData:rendering encoding:encodings[i] error:NULL], @"");
+        XCTAssertEqualObjects(rendering, [@"Crème brûlée &amp; café <b>" dataUsingEncoding:encodings[i]], @"");
+    }
+}
+
+- (void)testRenderObjectAppendingToDataLeavesDataUntouchedOnEncodingError
+{
+    GRMustacheTemplate *template = [GRMustacheTemplate templateFromString:@"foo{{name}}" error:NULL];
+    NSMutableData *rendering = [NSMutableData dataWithBytes:"bar" length:3];
+    NSError *error;
+    XCTAssertFalse([template renderObject:@{ @"name": @"☕" } appendingToData:rendering encoding:NSASCIIStringEncoding error:&error], @"");
+    XCTAssertEqualObjects(error.domain, GRMustacheErrorDomain, @"");
+    XCTAssertEqualObjects(rendering, [NSData dataWithBytes:"bar" length:3], @"");
+}
+
+@end
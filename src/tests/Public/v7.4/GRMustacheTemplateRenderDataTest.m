@@ -0,0 +1,76 @@
+// The MIT License
+//
+// Copyright (c) 2014 Gwendal Roué
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#define GRMUSTACHE_VERSION_MAX_ALLOWED GRMUSTACHE_VERSION_7_4
+#import "GRMustachePublicAPITest.h"
+
+@interface GRMustacheTemplateRenderDataTest : GRMustachePublicAPITest
+@end
+
+@implementation GRMustacheTemplateRenderDataTest
+
+- (void)testRenderDataWithObjectUTF8
+{
+    GRMustacheTemplate *template = [GRMustacheTemplate templateFromString:@"Crème {{name}}{{#items}}, {{.}}{{/items}} {{{raw}}}" error:NULL];
+    id data = @{ @"name": @"brûlée & café", @"items": @[@1, @"☕"], @"raw": @"<b>" };
+    NSString *expected = [template renderObject:data error:NULL];
+    NSData *rendering = [template renderDataWithObject:data encoding:NSUTF8StringEncoding error:NULL];
+    XCTAssertEqualObjects(rendering, [expected dataUsingEncoding:NSUTF8StringEncoding], @"");
+    XCTAssertEqualObjects(expected, @"Crème brûlée &amp; café, 1, ☕ <b>", @"");
+}
+
+- (void)testRenderDataWithObjectUTF16
+{
+    GRMustacheTemplate *template = [GRMustacheTemplate templateFromString:@"Crème {{name}}" error:NULL];
+    id data = @{ @"name": @"brûlée" };
+    NSData *rendering = [template renderDataWithObject:data encoding:NSUTF16LittleEndianStringEncoding error:NULL];
+    XCTAssertEqualObjects(rendering, [@"Crème brûlée" dataUsingEncoding:NSUTF16LittleEndianStringEncoding], @"");
+}
+
+- (void)testRenderDataWithObjectEmptyRendering
+{
+    GRMustacheTemplate *template = [GRMustacheTemplate templateFromString:@"{{name}}" error:NULL];
+    NSData *rendering = [template renderDataWithObject:nil encoding:NSUTF8StringEncoding error:NULL];
+    XCTAssertNotNil(rendering, @"");
+    XCTAssertEqual(rendering.length, (NSUInteger)0, @"");
+}
+
+- (void)testRenderDataWithObjectReportsEncodingErrors
+{
+    GRMustacheTemplate *template = [GRMustacheTemplate templateFromString:@"{{name}}" error:NULL];
+    NSError *error;
+    NSData *rendering = [template renderDataWithObject:@{ @"name": @"☕" } encoding:NSASCIIStringEncoding error:&error];
+    XCTAssertNil(rendering, @"");
+    XCTAssertEqualObjects(error.domain, GRMustacheErrorDomain, @"");
+    XCTAssertEqual(error.code, (NSInteger)GRMustacheErrorCodeRenderingError, @"");
+}
+
+- (void)testRenderDataWithObjectReportsRenderingErrors
+{
+    GRMustacheTemplate *template = [GRMustacheTemplate templateFromString:@"{{f(x)}}" error:NULL];
+    NSError *error;
+    NSData *rendering = [template renderDataWithObject:nil encoding:NSUTF8StringEncoding error:&error];
+    XCTAssertNil(rendering, @"");
+    XCTAssertEqual(error.code, (NSInteger)GRMustacheErrorCodeRenderingError, @"");
+}
+
+@end
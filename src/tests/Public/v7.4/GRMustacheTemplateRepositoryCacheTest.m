@@ -0,0 +1,168 @@
+// The MIT License
+//
+// Copyright (c) 2014 Gwendal Roué
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#define GRMUSTACHE_VERSION_MAX_ALLOWED GRMUSTACHE_VERSION_7_4
+#import "GRMustachePublicAPITest.h"
+
+@interface GRMustacheTemplateRepositoryCacheTest : GRMustachePublicAPITest
+@end
+
+@implementation GRMustacheTemplateRepositoryCacheTest
+
+- (NSString *)longStringWithCharacter:(NSString *)character
+{
+    return [@"" stringByPaddingToLength:10000 withString:character startingAtIndex:0];
+}
+
+- (void)testCacheStatisticsCountHitsAndMisses
+{
+    GRMustacheTemplateRepository *repository = [GRMustacheTemplateRepository templateRepositoryWithDictionary:@{ @"a": @"{{>b}}", @"b": @"b" }];
+    
+    GRMustacheTemplateRepositoryCacheStatistics statistics = [repository cacheStatistics];
+    XCTAssertEqual(statistics.hitCount, (NSUInteger)0, @"");
+    XCTAssertEqual(statistics.missCount, (NSUInteger)0, @"");
+    XCTAssertEqual(statistics.templateCount, (NSUInteger)0, @"");
+    XCTAssertEqual(statistics.memorySize, (NSUInteger)0, @"");
+    
+    [repository templateNamed:@"a" error:NULL];
+    statistics = [repository cacheStatistics];
+    XCTAssertEqual(statistics.hitCount, (NSUInteger)0, @"");
+    XCTAssertEqual(statistics.missCount, (NSUInteger)2, @"");
+    XCTAssertEqual(statistics.templateCount, (NSUInteger)2, @"");
+    XCTAssertTrue(statistics.memorySize > 0, @"");
+    
+    [repository templateNamed:@"a" error:NULL];
+    [repository templateNamed:@"b" error:NULL];
+    statistics = [repository cacheStatistics];
+    XCTAssertEqual(statistics.hitCount, (NSUInteger)2, @"");
+    XCTAssertEqual(statistics.missCount, (NSUInteger)2, @"");
+    XCTAssertEqual(statistics.evictionCount, (NSUInteger)0, @"");
+}
+
+- (void)testMemorySizeGrowsWithTemplateLength
+{
+    GRMustacheTemplateRepository *repository = [GRMustacheTemplateRepository templateRepositoryWithDictionary:@{ @"short": @"a", @"long": [self longStringWithCharacter:@"a"] }];
+    
+    [repository templateNamed:@"short" error:NULL];
+    NSUInteger shortMemorySize = [repository cacheStatistics].memorySize;
+    [repository templateNamed:@"long" error:NULL];
+    NSUInteger longMemorySize = [repository cacheStatistics].memorySize - shortMemorySize;
+    XCTAssertTrue(longMemorySize > shortMemorySize + 10000, @"");
+}
+
+- (void)testReloadTemplatesEmptiesCache
+{
+    GRMustacheTemplateRepository *repository = [GRMustacheTemplateRepository templateRepositoryWithDictionary:@{ @"a": @"a" }];
+    [repository templateNamed:@"a" error:NULL];
+    [repository reloadTemplates];
+    
+    GRMustacheTemplateRepositoryCacheStatistics statistics = [repository cacheStatistics];
+    XCTAssertEqual(statistics.templateCount, (NSUInteger)0, @"");
+    XCTAssertEqual(statistics.memorySize, (NSUInteger)0, @"");
+    XCTAssertEqual(statistics.evictionCount, (NSUInteger)0, @"");
+}
+
+- (void)testCacheMemoryLimitEvictsLeastRecentlyUsedTemplates
+{
+    NSDictionary *templates = @{ @"a": [self longStringWithCharacter:@"a"],
+                                 @"b": [self longStringWithCharacter:@"b"],
+                                 @"c": [self longStringWithCharacter:@"c"] };
+    GRMustacheTemplateRepository *repository = [GRMustacheTemplateRepository templateRepositoryWithDictionary:templates];
+    [repository templateNamed:@"a" error:NULL];
+    NSUInteger templateMemorySize = [repository cacheStatistics].memorySize;
+    
+    // Room for two templates, not three
+    repository.cacheMemoryLimit = templateMemorySize * 5 / 2;
+    [repository templateNamed:@"b" error:NULL];
+    [repository templateNamed:@"a" error:NULL];
+    [repository templateNamed:@"c" error:NULL];
+    
+    GRMustacheTemplateRepositoryCacheStatistics statistics = [repository cacheStatistics];
+    XCTAssertEqual(statistics.evictionCount, (NSUInteger)1, @"");
+    XCTAssertEqual(statistics.templateCount, (NSUInteger)2, @"");
+    XCTAssertTrue(statistics.memorySize <= repository.cacheMemoryLimit, @"");
+    
+    // b was the least recently used
+    NSUInteger missCount = statistics.missCount;
+    [repository templateNamed:@"a" error:NULL];
+    [repository templateNamed:@"c" error:NULL];
+    XCTAssertEqual([repository cacheStatistics].missCount, missCount, @"");
+    [repository templateNamed:@"b" error:NULL];
+    XCTAssertEqual([repository cacheStatistics].missCount, missCount + 1, @"");
+}
+
+- (void)testLoweringCacheMemoryLimitEvictsTemplates
+{
+    GRMustacheTemplateRepository *repository = [GRMustacheTemplateRepository templateRepositoryWithDictionary:@{ @"a": @"a", @"b": @"b" }];
+    [repository templateNamed:@"a" error:NULL];
+    [repository templateNamed:@"b" error:NULL];
+    repository.cacheMemoryLimit = 1;
+    
+    GRMustacheTemplateRepositoryCacheStatistics statistics = [repository cacheStatistics];
+    XCTAssertEqual(statistics.evictionCount, (NSUInteger)2, @"");
+    XCTAssertEqual(statistics.templateCount, (NSUInteger)0, @"");
+    XCTAssertEqual(statistics.memorySize, (NSUInteger)0, @"");
+}
+
+- (void)testEvictedTemplatesKeepOnRendering
+{
+    GRMustacheTemplateRepository *repository = [GRMustacheTemplateRepository templateRepositoryWithDictionary:@{ @"a": @"<{{>b}}>", @"b": @"{{name}}" }];
+    repository.cacheMemoryLimit = 1;
+    
+    GRMustacheTemplate *template = [repository templateNamed:@"a" error:NULL];
+    XCTAssertEqual([repository cacheStatistics].templateCount, (NSUInteger)0, @"");
+    
+    NSString *rendering = [template renderObject:@{ @"name": @"Arthur" } error:NULL];
+    XCTAssertEqualObjects(rendering, @"<Arthur>", @"");
+}
+
+- (void)testPinnedTemplatesAreNotEvicted
+{
+    GRMustacheTemplateRepository *repository = [GRMustacheTemplateRepository templateRepositoryWithDictionary:@{ @"a": @"a", @"b": @"b" }];
+    repository.cacheMemoryLimit = 1;
+    
+    XCTAssertTrue([repository pinTemplateNamed:@"a" error:NULL], @"");
+    [repository templateNamed:@"b" error:NULL];
+    GRMustacheTemplateRepositoryCacheStatistics statistics = [repository cacheStatistics];
+    XCTAssertEqual(statistics.templateCount, (NSUInteger)1, @"");
+    XCTAssertEqual(statistics.evictionCount, (NSUInteger)1, @"");
+    
+    NSUInteger hitCount = statistics.hitCount;
+    [repository templateNamed:@"a" error:NULL];
+    XCTAssertEqual([repository cacheStatistics].hitCount, hitCount + 1, @"");
+    
+    [repository unpinTemplateNamed:@"a"];
+    statistics = [repository cacheStatistics];
+    XCTAssertEqual(statistics.templateCount, (NSUInteger)0, @"");
+    XCTAssertEqual(statistics.evictionCount, (NSUInteger)2, @"");
+}
+
+- (void)testPinMissingTemplateFails
+{
+    GRMustacheTemplateRepository *repository = [GRMustacheTemplateRepository templateRepositoryWithDictionary:@{}];
+    NSError *error;
+    XCTAssertFalse([repository pinTemplateNamed:@"missing" error:&error], @"");
+    XCTAssertEqualObjects(error.domain, GRMustacheErrorDomain, @"");
+    XCTAssertEqual(error.code, (NSInteger)GRMustacheErrorCodeTemplateNotFound, @"");
+}
+
+@end
@@ -0,0 +1,227 @@
+// The MIT License
+//
+// Copyright (c) 2014 Gwendal Roué
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#define GRMUSTACHE_VERSION_MAX_ALLOWED GRMUSTACHE_VERSION_7_4
+#import "GRMustachePublicAPITest.h"
+
+@interface GRMustacheTemplateRepositoryConcurrencyTestDataSource : NSObject<GRMustacheTemplateRepositoryDataSource> {
+    NSDictionary *_templateStrings;
+    NSTimeInterval _delay;
+    NSMutableDictionary *_fetchCounts;
+    dispatch_semaphore_t _slowTemplateSemaphore;
+}
+@property (nonatomic, readonly) dispatch_semaphore_t slowTemplateSemaphore;
+- (instancetype)initWithTemplateStrings:(NSDictionary *)templateStrings delay:(NSTimeInterval)delay;
+- (NSUInteger)fetchCountForTemplateID:(NSString *)templateID;
+@end
+
+@implementation GRMustacheTemplateRepositoryConcurrencyTestDataSource
+@synthesize slowTemplateSemaphore=_slowTemplateSemaphore;
+
+- (instancetype)initWithTemplateStrings:(NSDictionary *)templateStrings delay:(NSTimeInterval)delay
+{
+    self = [super init];
+    if (self) {
+        _templateStrings = [templateStrings retain];
+        _delay = delay;
+        _fetchCounts = [[NSMutableDictionary alloc] init];
+        _slowTemplateSemaphore = dispatch_semaphore_create(0);
+    }
+    return self;
+}
+
+- (void)dealloc
+{
+    [_templateStrings release];
+    [_fetchCounts release];
+    dispatch_release(_slowTemplateSemaphore);
+    [super dealloc];
+}
+
+- (NSUInteger)fetchCountForTemplateID:(NSString *)templateID
+{
+    @synchronized(_fetchCounts) {
+        return [[_fetchCounts objectForKey:templateID] unsignedIntegerValue];
+    }
+}
+
+- (id<NSCopying>)templateRepository:(GRMustacheTemplateRepository *)templateRepository templateIDForName:(NSString *)name relativeToTemplateID:(id)baseTemplateID
+{
+    return name;
+}
+
+- (NSString *)templateRepository:(GRMustacheTemplateRepository *)templateRepository templateStringForTemplateID:(id)templateID error:(NSError **)error
+{
+    @synchronized(_fetchCounts) {
+        [_fetchCounts setObject:@([[_fetchCounts objectForKey:templateID] unsignedIntegerValue] + 1) forKey:templateID];
+    }
+    if ([templateID isEqualToString:@"slow"]) {
+        dispatch_semaphore_wait(_slowTemplateSemaphore, dispatch_time(DISPATCH_TIME_NOW, 5 * NSEC_PER_SEC));
+    }
+    [NSThread sleepForTimeInterval:_delay];
+    return [_templateStrings objectForKey:templateID];
+}
+
+@end
+
+@interface GRMustacheTemplateRepositoryConcurrencyTest : GRMustachePublicAPITest
+@end
+
+@implementation GRMustacheTemplateRepositoryConcurrencyTest
+
+- (void)testConcurrentRequestsForTheSameTemplateCompileItOnce
+{
+    GRMustacheTemplateRepositoryConcurrencyTestDataSource *dataSource = [[[GRMustacheTemplateRepositoryConcurrencyTestDataSource alloc] initWithTemplateStrings:@{ @"a": @"<{{name}}>" } delay:0.1] autorelease];
+    GRMustacheTemplateRepository *repository = [GRMustacheTemplateRepository templateRepository];
+    repository.dataSource = dataSource;
+    
+    NSMutableArray *renderings = [NSMutableArray array];
+    dispatch_apply(8, dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT, 0), ^(size_t i) {
+        GRMustacheTemplate *template = [repository templateNamed:@"a" error:NULL];
+        NSString *rendering = [template renderObject:@{ @"name": @"Arthur" } error:NULL];
+        @synchronized(renderings) {
+            [renderings addObject:rendering ?: @"nil"];
+        }
+    });
+    
+    XCTAssertEqual([dataSource fetchCountForTemplateID:@"a"], (NSUInteger)1, @"");
+    XCTAssertEqual(renderings.count, (NSUInteger)8, @"");
+    for (NSString *rendering in renderings) {
+        XCTAssertEqualObjects(rendering, @"<Arthur>", @"");
+    }
+}
+
+- (void)testConcurrentRequestsForDistinctTemplates
+{
+    NSMutableDictionary *templateStrings = [NSMutableDictionary dictionary];
+    for (NSUInteger i = 0; i < 50; ++i) {
+        [templateStrings setObject:[NSString stringWithFormat:@"%lu{{>partial%lu}}", (unsigned long)i, (unsigned long)(i % 5)] forKey:[NSString stringWithFormat:@"template%lu", (unsigned long)i]];
+    }
+    for (NSUInteger i = 0; i < 5; ++i) {
+        [templateStrings setObject:[NSString stringWithFormat:@"-{{name}}%lu", (unsigned long)i] forKey:[NSString stringWithFormat:@"partial%lu", (unsigned long)i]];
+    }
+    GRMustacheTemplateRepository *repository = [GRMustacheTemplateRepository templateRepositoryWithDictionary:templateStrings];
+    
+    __block NSUInteger failureCount = 0;
+    dispatch_apply(500, dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT, 0), ^(size_t i) {
+        NSUInteger index = i % 50;
+        GRMustacheTemplate *template = [repository templateNamed:[NSString stringWithFormat:@"template%lu", (unsigned long)index] error:NULL];
+        NSString *rendering = [template renderObject:@{ @"name": @"x" } error:NULL];
+        NSString *expectedRendering = [NSString stringWithFormat:@"%lu-x%lu", (unsigned long)index, (unsigned long)(index % 5)];
+        if (![rendering isEqualToString:expectedRendering]) {
+            @synchronized(repository) {
+                ++failureCount;
+            }
+        }
+    });
+    XCTAssertEqual(failureCount, (NSUInteger)0, @"");
+}
+
+- (void)testRecursivePartialsAcrossThreads
+{
+    // Both threads compile a template which embeds the template compiled by
+    // the other thread.
+    NSDictionary *templateStrings = @{ @"a": @"a{{#x}}{{>b}}{{/x}}", @"b": @"b{{#x}}{{>a}}{{/x}}" };
+    for (NSUInteger i = 0; i < 10; ++i) {
+        GRMustacheTemplateRepositoryConcurrencyTestDataSource *dataSource = [[[GRMustacheTemplateRepositoryConcurrencyTestDataSource alloc] initWithTemplateStrings:templateStrings delay:0.01] autorelease];
+        GRMustacheTemplateRepository *repository = [GRMustacheTemplateRepository templateRepository];
+        repository.dataSource = dataSource;
+        
+        NSArray *names = @[@"a", @"b"];
+        NSMutableDictionary *renderings = [NSMutableDictionary dictionary];
+        dispatch_apply(names.count, dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT, 0), ^(size_t j) {
+            NSString *name = [names objectAtIndex:j];
+            GRMustacheTemplate *template = [repository templateNamed:name error:NULL];
+            NSString *rendering = [template renderObject:@{ @"x": @{ @"x": @{ @"x": @NO } } } error:NULL];
+            @synchronized(renderings) {
+                [renderings setObject:rendering ?: @"nil" forKey:name];
+            }
+        });
+        
+        XCTAssertEqualObjects([renderings objectForKey:@"a"], @"aba", @"");
+        XCTAssertEqualObjects([renderings objectForKey:@"b"], @"bab", @"");
+    }
+}
+
+- (void)testFailingRecursivePartialsAcrossThreads
+{
+    // The compilation of a fails after the compilation of b may have borrowed
+    // its placeholder AST.
+    NSDictionary *templateStrings = @{ @"a": @"a{{#x}}{{>b}}{{/x}}{{>missing}}", @"b": @"b{{#x}}{{>a}}{{/x}}" };
+    for (NSUInteger i = 0; i < 10; ++i) {
+        GRMustacheTemplateRepositoryConcurrencyTestDataSource *dataSource = [[[GRMustacheTemplateRepositoryConcurrencyTestDataSource alloc] initWithTemplateStrings:templateStrings delay:0.01] autorelease];
+        GRMustacheTemplateRepository *repository = [GRMustacheTemplateRepository templateRepository];
+        repository.dataSource = dataSource;
+        
+        NSArray *names = @[@"a", @"b"];
+        NSMutableDictionary *errorCodes = [NSMutableDictionary dictionary];
+        dispatch_apply(names.count, dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT, 0), ^(size_t j) {
+            NSString *name = [names objectAtIndex:j];
+            NSError *error = nil;
+            GRMustacheTemplate *template = [repository templateNamed:name error:&error];
+            @synchronized(errorCodes) {
+                [errorCodes setObject:(template ? @0 : @(error.code)) forKey:name];
+            }
+        });
+        
+        XCTAssertEqualObjects([errorCodes objectForKey:@"a"], @(GRMustacheErrorCodeTemplateNotFound), @"");
+        XCTAssertEqualObjects([errorCodes objectForKey:@"b"], @(GRMustacheErrorCodeTemplateNotFound), @"");
+        XCTAssertEqual([repository cacheStatistics].templateCount, (NSUInteger)0, @"");
+        XCTAssertEqual([repository cacheStatistics].memorySize, (NSUInteger)0, @"");
+    }
+}
+
+- (void)testRecursivePartials
+{
+    GRMustacheTemplateRepositoryConcurrencyTestDataSource *dataSource = [[[GRMustacheTemplateRepositoryConcurrencyTestDataSource alloc] initWithTemplateStrings:@{ @"a": @"<{{#x}}{{>a}}{{/x}}>" } delay:0] autorelease];
+    GRMustacheTemplateRepository *repository = [GRMustacheTemplateRepository templateRepository];
+    repository.dataSource = dataSource;
+    GRMustacheTemplate *template = [repository templateNamed:@"a" error:NULL];
+    XCTAssertEqualObjects([template renderObject:@{ @"x": @{ @"x": @{ @"x": @NO } } } error:NULL], @"<<<>>>", @"");
+    XCTAssertEqual([dataSource fetchCountForTemplateID:@"a"], (NSUInteger)1, @"");
+}
+
+- (void)testReloadTemplatesDuringCompilation
+{
+    GRMustacheTemplateRepositoryConcurrencyTestDataSource *dataSource = [[[GRMustacheTemplateRepositoryConcurrencyTestDataSource alloc] initWithTemplateStrings:@{ @"slow": @"slow" } delay:0] autorelease];
+    GRMustacheTemplateRepository *repository = [GRMustacheTemplateRepository templateRepository];
+    repository.dataSource = dataSource;
+    
+    dispatch_group_t group = dispatch_group_create();
+    dispatch_group_async(group, dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT, 0), ^{
+        [repository templateNamed:@"slow" error:NULL];
+    });
+    while ([dataSource fetchCountForTemplateID:@"slow"] == 0) {
+        [NSThread sleepForTimeInterval:0.01];
+    }
+    [repository reloadTemplates];
+    dispatch_semaphore_signal(dataSource.slowTemplateSemaphore);
+    dispatch_group_wait(group, DISPATCH_TIME_FOREVER);
+    dispatch_release(group);
+    
+    // The template compiled before reloading is not cached
+    dispatch_semaphore_signal(dataSource.slowTemplateSemaphore);
+    [repository templateNamed:@"slow" error:NULL];
+    XCTAssertEqual([dataSource fetchCountForTemplateID:@"slow"], (NSUInteger)2, @"");
+}
+
+@end
@@ -0,0 +1,99 @@
+// The MIT License
+//
+// Copyright (c) 2014 Gwendal Roué
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#define GRMUSTACHE_VERSION_MAX_ALLOWED GRMUSTACHE_VERSION_7_4
+#import "GRMustachePublicAPITest.h"
+
+@interface GRMustacheTemplateRepositoryPrecompilationTest : GRMustachePublicAPITest
+@end
+
+@implementation GRMustacheTemplateRepositoryPrecompilationTest
+
+- (NSDictionary *)templates
+{
+    return @{ @"a": @"a{{>shared}}", @"b": @"b{{>shared}}", @"c": @"c{{#items}}{{>shared}}{{/items}}", @"shared": @"{{name}}" };
+}
+
+- (void)testPrecompileTemplatesNamedFillsTheCache
+{
+    for (NSNumber *concurrently in @[@NO, @YES]) {
+        GRMustacheTemplateRepository *repository = [GRMustacheTemplateRepository templateRepositoryWithDictionary:[self templates]];
+        NSError *error;
+        GRMustacheTemplateRepositoryPrecompilationReport *report = [repository precompileTemplatesNamed:@[@"a", @"b", @"c"] concurrently:[concurrently boolValue] error:&error];
+        XCTAssertNotNil(report, @"%@", error);
+        XCTAssertEqualObjects([NSSet setWithArray:[report.templateDurations allKeys]], ([NSSet setWithObjects:@"a", @"b", @"c", nil]), @"");
+        XCTAssertTrue(report.duration >= 0, @"");
+        
+        // The shared partial is compiled once
+        GRMustacheTemplateRepositoryCacheStatistics statistics = [repository cacheStatistics];
+        XCTAssertEqual(statistics.templateCount, (NSUInteger)4, @"");
+        
+        // Loading templates is now a cache hit
+        GRMustacheTemplate *template = [repository templateNamed:@"c" error:NULL];
+        XCTAssertEqual([repository cacheStatistics].missCount, statistics.missCount, @"");
+        XCTAssertEqualObjects([template renderObject:@{ @"items": @[@{ @"name": @"1" }, @{ @"name": @"2" }] } error:NULL], @"c12", @"");
+    }
+}
+
+- (void)testPrecompileTemplatesNamedReportsTheFirstError
+{
+    GRMustacheTemplateRepository *repository = [GRMustacheTemplateRepository templateRepositoryWithDictionary:@{ @"a": @"a", @"b": @"{{#b}}", @"c": @"{{>missing}}" }];
+    NSError *error;
+    XCTAssertNil([repository precompileTemplatesNamed:@[@"a", @"b", @"c"] concurrently:YES error:&error], @"");
+    XCTAssertEqual(error.code, (NSInteger)GRMustacheErrorCodeParseError, @"");
+    
+    // Valid templates have been loaded
+    XCTAssertEqual([repository cacheStatistics].templateCount, (NSUInteger)1, @"");
+}
+
+- (void)testPrecompileAllTemplatesLoadsDictionaryTemplates
+{
+    GRMustacheTemplateRepository *repository = [GRMustacheTemplateRepository templateRepositoryWithDictionary:[self templates]];
+    NSError *error;
+    GRMustacheTemplateRepositoryPrecompilationReport *report = [repository precompileAllTemplatesConcurrently:YES error:&error];
+    XCTAssertNotNil(report, @"%@", error);
+    XCTAssertEqualObjects([NSSet setWithArray:[report.templateDurations allKeys]], [NSSet setWithArray:[[self templates] allKeys]], @"");
+    XCTAssertEqual([repository cacheStatistics].templateCount, (NSUInteger)4, @"");
+}
+
+- (void)testPrecompileAllTemplatesLoadsDirectoryTemplates
+{
+    NSString *directoryPath = [NSTemporaryDirectory() stringByAppendingPathComponent:[[NSProcessInfo processInfo] globallyUniqueString]];
+    [[NSFileManager defaultManager] createDirectoryAtPath:[directoryPath stringByAppendingPathComponent:@"partials"] withIntermediateDirectories:YES attributes:nil error:NULL];
+    [@"<{{>partials/header}}>" writeToFile:[directoryPath stringByAppendingPathComponent:@"document.mustache"] atomically:YES encoding:NSUTF8StringEncoding error:NULL];
+    [@"header" writeToFile:[directoryPath stringByAppendingPathComponent:@"partials/header.mustache"] atomically:YES encoding:NSUTF8StringEncoding error:NULL];
+    [@"not a template" writeToFile:[directoryPath stringByAppendingPathComponent:@"notes.txt"] atomically:YES encoding:NSUTF8StringEncoding error:NULL];
+    
+    for (GRMustacheTemplateRepository *repository in @[[GRMustacheTemplateRepository templateRepositoryWithDirectory:directoryPath],
+                                                       [GRMustacheTemplateRepository templateRepositoryWithBaseURL:[NSURL fileURLWithPath:directoryPath]]]) {
+        NSError *error;
+        GRMustacheTemplateRepositoryPrecompilationReport *report = [repository precompileAllTemplatesConcurrently:YES error:&error];
+        XCTAssertNotNil(report, @"%@", error);
+        XCTAssertEqualObjects([NSSet setWithArray:[report.templateDurations allKeys]], ([NSSet setWithObjects:@"document", @"partials/header", nil]), @"");
+        XCTAssertEqual([repository cacheStatistics].templateCount, (NSUInteger)2, @"");
+        XCTAssertEqualObjects([[repository templateNamed:@"document" error:NULL] renderObject:nil error:NULL], @"<header>", @"");
+    }
+    
+    [[NSFileManager defaultManager] removeItemAtPath:directoryPath error:NULL];
+}
+
+@end
@@ -0,0 +1,136 @@
+// The MIT License
+//
+// Copyright (c) 2014 Gwendal Roué
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#define GRMUSTACHE_VERSION_MAX_ALLOWED GRMUSTACHE_VERSION_7_4
+#import "GRMustachePublicAPITest.h"
+
+@interface GRMustacheTemplateRepositoryReloadTest : GRMustachePublicAPITest
+@end
+
+@implementation GRMustacheTemplateRepositoryReloadTest
+
+- (void)testReloadChangedTemplatesReloadsChangedTemplatesAndTheirDependents
+{
+    NSMutableDictionary *templates = [NSMutableDictionary dictionaryWithDictionary:@{ @"a": @"<{{>b}}>", @"b": @"b", @"c": @"c" }];
+    GRMustacheTemplateRepository *repository = [GRMustacheTemplateRepository templateRepositoryWithDictionary:templates];
+    GRMustacheTemplate *previousTemplate = [repository templateNamed:@"a" error:NULL];
+    [repository templateNamed:@"c" error:NULL];
+    
+    [templates setObject:@"B" forKey:@"b"];
+    NSUInteger missCount = [repository cacheStatistics].missCount;
+    [repository reloadChangedTemplates];
+    
+    // a and b only have been compiled again
+    XCTAssertEqual([repository cacheStatistics].missCount, missCount + 2, @"");
+    
+    // Reloaded templates are published in the cache
+    missCount = [repository cacheStatistics].missCount;
+    NSString *rendering = [[repository templateNamed:@"a" error:NULL] renderObject:nil error:NULL];
+    XCTAssertEqualObjects(rendering, @"<B>", @"");
+    rendering = [[repository templateNamed:@"c" error:NULL] renderObject:nil error:NULL];
+    XCTAssertEqualObjects(rendering, @"c", @"");
+    XCTAssertEqual([repository cacheStatistics].missCount, missCount, @"");
+    
+    // Previous templates are not reloaded
+    rendering = [previousTemplate renderObject:nil error:NULL];
+    XCTAssertEqualObjects(rendering, @"<b>", @"");
+}
+
+- (void)testReloadChangedTemplatesDoesNotCompileUnchangedTemplates
+{
+    GRMustacheTemplateRepository *repository = [GRMustacheTemplateRepository templateRepositoryWithDictionary:@{ @"a": @"<{{>b}}>", @"b": @"b" }];
+    [repository templateNamed:@"a" error:NULL];
+    
+    GRMustacheTemplateRepositoryCacheStatistics statistics = [repository cacheStatistics];
+    [repository reloadChangedTemplates];
+    XCTAssertEqual([repository cacheStatistics].missCount, statistics.missCount, @"");
+    XCTAssertEqual([repository cacheStatistics].templateCount, statistics.templateCount, @"");
+}
+
+- (void)testReloadChangedTemplatesForgetsMissingTemplates
+{
+    NSMutableDictionary *templates = [NSMutableDictionary dictionaryWithDictionary:@{ @"a": @"<{{>b}}>", @"b": @"b" }];
+    GRMustacheTemplateRepository *repository = [GRMustacheTemplateRepository templateRepositoryWithDictionary:templates];
+    [repository templateNamed:@"a" error:NULL];
+    
+    [templates removeObjectForKey:@"b"];
+    [repository reloadChangedTemplates];
+    XCTAssertEqual([repository cacheStatistics].templateCount, (NSUInteger)0, @"");
+    
+    NSError *error;
+    XCTAssertNil([repository templateNamed:@"a" error:&error], @"");
+    XCTAssertEqualObjects(error.domain, GRMustacheErrorDomain, @"");
+    XCTAssertEqual(error.code, (NSInteger)GRMustacheErrorCodeTemplateNotFound, @"");
+}
+
+- (void)testReloadChangedTemplatesReloadsTheDependentsOfEvictedPartials
+{
+    NSMutableDictionary *templates = [NSMutableDictionary dictionaryWithDictionary:@{ @"a": @"<{{>b}}>", @"b": @"b" }];
+    GRMustacheTemplateRepository *repository = [GRMustacheTemplateRepository templateRepositoryWithDictionary:templates];
+    repository.cacheMemoryLimit = 1;
+    XCTAssertTrue([repository pinTemplateNamed:@"a" error:NULL], @"");
+    XCTAssertEqual([repository cacheStatistics].templateCount, (NSUInteger)1, @"");
+    
+    [templates setObject:@"B" forKey:@"b"];
+    [repository reloadChangedTemplates];
+    NSString *rendering = [[repository templateNamed:@"a" error:NULL] renderObject:nil error:NULL];
+    XCTAssertEqualObjects(rendering, @"<B>", @"");
+}
+
+- (void)testReloadChangedTemplatesInDirectory
+{
+    NSString *directoryPath = [NSTemporaryDirectory() stringByAppendingPathComponent:[[NSProcessInfo processInfo] globallyUniqueString]];
+    [[NSFileManager defaultManager] createDirectoryAtPath:directoryPath withIntermediateDirectories:YES attributes:nil error:NULL];
+    NSString *aPath = [directoryPath stringByAppendingPathComponent:@"a.mustache"];
+    NSString *bPath = [directoryPath stringByAppendingPathComponent:@"b.mustache"];
+    [@"<{{>b}}>" writeToFile:aPath atomically:YES encoding:NSUTF8StringEncoding error:NULL];
+    [@"foo" writeToFile:bPath atomically:YES encoding:NSUTF8StringEncoding error:NULL];
+    
+    GRMustacheTemplateRepository *repository = [GRMustacheTemplateRepository templateRepositoryWithDirectory:directoryPath];
+    [repository templateNamed:@"a" error:NULL];
+    
+    // Touched, but not modified
+    [@"foo" writeToFile:bPath atomically:YES encoding:NSUTF8StringEncoding error:NULL];
+    NSUInteger missCount = [repository cacheStatistics].missCount;
+    [repository reloadChangedTemplates];
+    XCTAssertEqual([repository cacheStatistics].missCount, missCount, @"");
+    
+    // Modified, with the same length
+    [@"bar" writeToFile:bPath atomically:YES encoding:NSUTF8StringEncoding error:NULL];
+    [repository reloadChangedTemplates];
+    XCTAssertEqual([repository cacheStatistics].missCount, missCount + 2, @"");
+    NSString *rendering = [[repository templateNamed:@"a" error:NULL] renderObject:nil error:NULL];
+    XCTAssertEqualObjects(rendering, @"<bar>", @"");
+    
+    [[NSFileManager defaultManager] removeItemAtPath:directoryPath error:NULL];
+}
+
+- (void)testReloadTemplatesStillEmptiesTheCache
+{
+    GRMustacheTemplateRepository *repository = [GRMustacheTemplateRepository templateRepositoryWithDictionary:@{ @"a": @"a" }];
+    [repository templateNamed:@"a" error:NULL];
+    [repository reloadTemplates];
+    [repository reloadChangedTemplates];
+    XCTAssertEqual([repository cacheStatistics].templateCount, (NSUInteger)0, @"");
+}
+
+@end